@@ -10,6 +10,7 @@
  */
 #include "include.h"
 #include "mem_pub.h"
+#include "str_pub.h"
 #include "rwnx_config.h"
 #include "app.h"
 
@@ -58,6 +59,173 @@ beken_semaphore_t app_sema = NULL;
 WIFI_CORE_T g_wifi_core = {0};
 volatile int32_t bmsg_rx_count = 0;
 
+static const uint32_t core_lane_qitem[CORE_LANE_MAX] =
+{
+    CORE_CTRL_QITEM_COUNT, CORE_RX_QITEM_COUNT, CORE_TX_QITEM_COUNT, CORE_BULK_QITEM_COUNT
+};
+static const char *core_lane_name[CORE_LANE_MAX] = {"ctrl", "rx", "tx", "bulk"};
+static uint32_t core_bulk_turn = 0;
+
+// data frames queued in the tx and bulk lanes per flow slot, and the lane
+// they are in. another lane would let a short segment or an ack overtake
+// the frames before it, so the size only decides when the slot is empty
+typedef struct _core_flow_
+{
+    uint16_t queued;
+    uint16_t lane;
+} CORE_FLOW_T;
+
+static CORE_FLOW_T core_flow[CORE_FLOW_SLOTS];
+
+// flow slot of an ethernet frame: ipv4 addresses, protocol and ports,
+// the ethertype for anything else. headers are in the first pbuf
+static uint32_t bmsg_tx_flow(struct pbuf *p)
+{
+    uint8_t *eth = (uint8_t *)p->payload;
+    uint8_t *ip = eth + 14;
+    uint32_t hash, ihl;
+
+    if(p->len < 14)
+    {
+        return 0;
+    }
+
+    hash = (eth[12] << 8) | eth[13];
+    if((0x0800 == hash) && (p->len >= 14 + 20))
+    {
+        hash ^= ip[9];
+        hash ^= (ip[12] << 24) | (ip[13] << 16) | (ip[14] << 8) | ip[15];
+        hash ^= (ip[16] << 24) | (ip[17] << 16) | (ip[18] << 8) | ip[19];
+
+        // ports only when not fragmented, every fragment lands in one slot
+        ihl = (ip[0] & 0x0F) * 4;
+        if(((6 == ip[9]) || (17 == ip[9])) && (0 == (((ip[6] & 0x3F) << 8) | ip[7]))
+                && (p->len >= 14 + ihl + 4))
+        {
+            hash ^= (ip[ihl] << 24) | (ip[ihl + 1] << 16) | (ip[ihl + 2] << 8) | ip[ihl + 3];
+        }
+    }
+
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+
+    return hash & (CORE_FLOW_SLOTS - 1);
+}
+
+static OSStatus bmsg_push(uint32_t lane, BUS_MSG_T *msg, uint32_t timeout_ms)
+{
+    CORE_LANE_STAT_T *stat = &g_wifi_core.stat[lane];
+    OSStatus ret;
+    GLOBAL_INT_DECLARATION();
+
+    // counted before the push, the core thread may pop it right away
+    GLOBAL_INT_DISABLE();
+    stat->cnt++;
+    if(stat->cnt > stat->cnt_max)
+    {
+        stat->cnt_max = stat->cnt;
+    }
+    GLOBAL_INT_RESTORE();
+
+    msg->time = rtos_get_time();
+    ret = rtos_push_to_queue(&g_wifi_core.io_queue[lane], msg, timeout_ms);
+
+    GLOBAL_INT_DISABLE();
+    if(kNoErr == ret)
+    {
+        stat->pushed++;
+    }
+    else
+    {
+        stat->cnt--;
+        stat->dropped++;
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(kNoErr == ret)
+    {
+        rtos_set_semaphore(&g_wifi_core.io_sema);
+    }
+
+    return ret;
+}
+
+// control and rx lanes go strictly first, tx and bulk take turns
+static uint32_t bmsg_pop(BUS_MSG_T *msg)
+{
+    CORE_LANE_STAT_T *stat;
+    uint32_t i, lane, wait;
+    GLOBAL_INT_DECLARATION();
+
+    for(i = 0; i < CORE_LANE_MAX; i++)
+    {
+        lane = i;
+        if((lane >= CORE_LANE_TX) && core_bulk_turn)
+        {
+            lane = (CORE_LANE_TX == lane) ? CORE_LANE_BULK : CORE_LANE_TX;
+        }
+
+        if(kNoErr == rtos_pop_from_queue(&g_wifi_core.io_queue[lane], msg, BEKEN_NO_WAIT))
+        {
+            break;
+        }
+    }
+
+    if(CORE_LANE_MAX == i)
+    {
+        return CORE_LANE_MAX;
+    }
+
+    if(lane >= CORE_LANE_TX)
+    {
+        core_bulk_turn = (CORE_LANE_TX == lane);
+    }
+
+    stat = &g_wifi_core.stat[lane];
+    wait = rtos_get_time() - msg->time;
+
+    GLOBAL_INT_DISABLE();
+    stat->cnt--;
+    GLOBAL_INT_RESTORE();
+    stat->wait_sum += wait;
+    if(wait > stat->wait_max)
+    {
+        stat->wait_max = wait;
+    }
+
+    return lane;
+}
+
+void bmsg_lane_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv)
+{
+    CORE_LANE_STAT_T *stat;
+    uint32_t i, done;
+
+    if((argc > 1) && (0 == os_strcmp(argv[1], "clear")))
+    {
+        for(i = 0; i < CORE_LANE_MAX; i++)
+        {
+            stat = &g_wifi_core.stat[i];
+            stat->cnt_max = stat->cnt;
+            stat->pushed = stat->cnt;
+            stat->dropped = 0;
+            stat->wait_max = 0;
+            stat->wait_sum = 0;
+        }
+        return;
+    }
+
+    os_printf("lane  depth  max/size  pushed    dropped  wait_avg  wait_max(ms)\r\n");
+    for(i = 0; i < CORE_LANE_MAX; i++)
+    {
+        stat = &g_wifi_core.stat[i];
+        done = stat->pushed - stat->cnt;
+        os_printf("%-5s %-6d %3d/%-5d %-9d %-8d %-9d %d\r\n", core_lane_name[i], stat->cnt,
+                  stat->cnt_max, core_lane_qitem[i], stat->pushed, stat->dropped,
+                  done ? (stat->wait_sum / done) : 0, stat->wait_max);
+    }
+}
+
 extern void net_wlan_initial(void);
 extern void wpas_thread_start(void);
 
@@ -136,18 +304,13 @@ void bmsg_skt_tx_handler(BUS_MSG_T *msg)
 void bmsg_tx_handler(BUS_MSG_T *msg)
 {
     struct pbuf *p = (struct pbuf *)msg->arg;
-    struct pbuf *q = p;
     uint8_t vif_idx = (uint8_t)msg->len;
+    CORE_FLOW_T *flow = &core_flow[bmsg_tx_flow(p)];
+    GLOBAL_INT_DECLARATION();
 
-    if(p->next)
-    {
-        q = pbuf_coalesce(p, PBUF_RAW);
-        if(q == p)
-        {
-            // must be out of memory
-            goto tx_handler_exit;
-        }
-    }
+    GLOBAL_INT_DISABLE();
+    flow->queued--;
+    GLOBAL_INT_RESTORE();
 
     ps_set_data_prevent();
 
@@ -156,10 +319,8 @@ void bmsg_tx_handler(BUS_MSG_T *msg)
     bk_wlan_dtim_rf_ps_mode_do_wakeup();
 #endif
 
-    rwm_transfer(vif_idx, q->payload, q->len, 0, 0);
-
-tx_handler_exit:
-    pbuf_free(q);
+    // chained pbufs are gathered by the msdu layer, no pbuf_coalesce; it frees p
+    rwm_transfer_pbuf(vif_idx, p);
 }
 
 
@@ -180,7 +341,7 @@ int bmsg_tx_raw_cb_sender(uint8_t *buffer, int length, void *cb, void *param)
 	msg.cb = cb;
 	msg.param = param;
 
-	ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, 1*SECONDS);
+	ret = bmsg_push(CORE_LANE_CTRL, &msg, 1*SECONDS);
 	if(ret != kNoErr)
 	{
 		APP_PRT("bmsg_tx_sender failed\r\n");
@@ -216,9 +377,16 @@ void bmsg_tx_raw_handler(BUS_MSG_T *msg)
 	txdesc_new->status = TXDESC_STA_USED;
 	txdesc_new->host.flags = TXU_CNTRL_MGMT;
 	txdesc_new->host.msdu_node = (void *)node;
+#if NX_AMSDU_TX
+	txdesc_new->host.orig_addr[0] = (UINT32)node->msdu_ptr;
+	txdesc_new->host.packet_addr[0] = (UINT32)content_ptr;
+	txdesc_new->host.packet_len[0] = len;
+	txdesc_new->host.packet_cnt = 1;
+#else
 	txdesc_new->host.orig_addr = (UINT32)node->msdu_ptr;
 	txdesc_new->host.packet_addr = (UINT32)content_ptr;
 	txdesc_new->host.packet_len = len;
+#endif
 	txdesc_new->host.status_desc_addr = (UINT32)content_ptr;
 	txdesc_new->host.tid = 0xff;
 
@@ -267,7 +435,7 @@ void bmsg_skt_tx_sender(void *arg)
     msg.len = 0;
     msg.sema = NULL;
 
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+    ret = bmsg_push(CORE_LANE_CTRL, &msg, BEKEN_NO_WAIT);
     if(kNoErr != ret)
     {
         os_printf("bmsg_rx_sender_failed\r\n");
@@ -367,12 +535,12 @@ void bmsg_null_sender(void)
     msg.len = 0;
     msg.sema = NULL;
 
-    if(!rtos_is_queue_empty(&g_wifi_core.io_queue))
+    if(!bmsg_is_empty())
     {
         return;
     }
 
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+    ret = bmsg_push(CORE_LANE_CTRL, &msg, BEKEN_NO_WAIT);
     if(kNoErr != ret)
     {
         os_printf("bmsg_null_sender_failed\r\n");
@@ -400,7 +568,7 @@ void bmsg_rx_sender(void *arg)
     bmsg_rx_count += 1;
     GLOBAL_INT_RESTORE();
 
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+    ret = bmsg_push(CORE_LANE_RX, &msg, BEKEN_NO_WAIT);
     if(kNoErr != ret)
     {
         APP_PRT("bmsg_rx_sender_failed\r\n");
@@ -411,17 +579,32 @@ int bmsg_tx_sender(struct pbuf *p, uint32_t vif_idx)
 {
     OSStatus ret;
     BUS_MSG_T msg;
+    CORE_FLOW_T *flow = &core_flow[bmsg_tx_flow(p)];
+    uint32_t lane;
+    GLOBAL_INT_DECLARATION();
 
     msg.type = BMSG_TX_TYPE;
     msg.arg = (uint32_t)p;
     msg.len = vif_idx;
     msg.sema = NULL;
 
+    GLOBAL_INT_DISABLE();
+    if(0 == flow->queued)
+    {
+        flow->lane = (p->tot_len >= CORE_BULK_LEN) ? CORE_LANE_BULK : CORE_LANE_TX;
+    }
+    lane = flow->lane;
+    flow->queued++;
+    GLOBAL_INT_RESTORE();
+
     pbuf_ref(p);
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, 1 * SECONDS);
+    ret = bmsg_push(lane, &msg, 1 * SECONDS);
     if(kNoErr != ret)
     {
         APP_PRT("bmsg_tx_sender failed\r\n");
+        GLOBAL_INT_DISABLE();
+        flow->queued--;
+        GLOBAL_INT_RESTORE();
         pbuf_free(p);
     }
 
@@ -438,7 +621,7 @@ int bmsg_tx_raw_sender(uint8_t *payload, uint16_t length)
 	msg.len = length;
 	msg.sema = NULL;
 
-	ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, 1*SECONDS);
+	ret = bmsg_push(CORE_LANE_CTRL, &msg, 1*SECONDS);
 
 	if(ret != kNoErr)
 	{
@@ -463,7 +646,7 @@ void bmsg_rx_lsig(uint16_t len, uint8_t rssi)
 	msg.arg = (uint32_t)((len << 16) | rssi);
 	msg.len = rtos_get_time();
 	msg.sema = NULL;
-	rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+	bmsg_push(CORE_LANE_RX, &msg, BEKEN_NO_WAIT);
 }
 #endif
 
@@ -477,7 +660,7 @@ int bmsg_ioctl_sender(void *arg)
     msg.len = 0;
     msg.sema = NULL;
 
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+    ret = bmsg_push(CORE_LANE_CTRL, &msg, BEKEN_NO_WAIT);
     if(kNoErr != ret)
     {
         APP_PRT("bmsg_ioctl_sender_failed\r\n");
@@ -500,7 +683,7 @@ void bmsg_music_sender(void *arg)
     msg.len = 0;
     msg.sema = NULL;
 
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+    ret = bmsg_push(CORE_LANE_CTRL, &msg, BEKEN_NO_WAIT);
     if(kNoErr != ret)
     {
         APP_PRT("bmsg_media_sender_failed\r\n");
@@ -518,7 +701,7 @@ void bmsg_txing_sender(uint8_t sta_idx)
     msg.len = 0;
     msg.sema = NULL;
 
-    ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+    ret = bmsg_push(CORE_LANE_CTRL, &msg, BEKEN_NO_WAIT);
     if(kNoErr != ret)
     {
         APP_PRT("bmsg_txing_sender failed\r\n");
@@ -538,14 +721,14 @@ void bmsg_ps_sender(uint8_t arg)
 {
     OSStatus ret;
     BUS_MSG_T msg;
-    if(g_wifi_core.io_queue)
+    if(g_wifi_core.io_sema)
     {
         msg.type = BMSG_STA_PS_TYPE;
         msg.arg = (uint32_t)arg;
         msg.len = 0;
         msg.sema = NULL;
 
-        ret = rtos_push_to_queue(&g_wifi_core.io_queue, &msg, BEKEN_NO_WAIT);
+        ret = bmsg_push(CORE_LANE_CTRL, &msg, BEKEN_NO_WAIT);
         if(kNoErr != ret)
         {
             os_printf("bmsg_ps_sender failed\r\n");
@@ -553,7 +736,7 @@ void bmsg_ps_sender(uint8_t arg)
     }
     else
     {
-        os_printf("g_wifi_core.io_queue null\r\n");
+        os_printf("g_wifi_core.io_sema null\r\n");
     }
 }
 #if CFG_USE_STA_PS
@@ -570,6 +753,7 @@ static void core_thread_main( void *arg )
 {
     OSStatus ret;
     BUS_MSG_T msg;
+    uint32_t lane, handled;
     uint8_t ke_skip = 0;
 #if CFG_USE_STA_PS
     uint8_t ps_flag = 0;
@@ -577,9 +761,23 @@ static void core_thread_main( void *arg )
 
     while(1)
     {
-        ret = rtos_pop_from_queue(&g_wifi_core.io_queue, &msg, BEKEN_WAIT_FOREVER);
-        if(kNoErr == ret)
+#if RWM_TX_POLL
+        // wake up in time to retry the queued frames
+        ret = rtos_get_semaphore(&g_wifi_core.io_sema, rwm_tx_wait_ms());
+#else
+        ret = rtos_get_semaphore(&g_wifi_core.io_sema, BEKEN_WAIT_FOREVER);
+#endif
+        handled = 0;
+        while(kNoErr == ret)
         {
+            // one semaphore count per queued message
+            lane = bmsg_pop(&msg);
+            if(CORE_LANE_MAX == lane)
+            {
+                break;
+            }
+            handled++;
+
             switch(msg.type)
             {
 #if CFG_USE_STA_PS
@@ -647,12 +845,31 @@ static void core_thread_main( void *arg )
             {
                 rtos_set_semaphore(&msg.sema);
             }
+
+            // control and rx are scheduled one by one, data frames in batches
+            if((lane < CORE_LANE_TX) || (handled >= CORE_TX_BATCH))
+            {
+                break;
+            }
+            ret = rtos_get_semaphore(&g_wifi_core.io_sema, BEKEN_NO_WAIT);
+        }
+
+        if(handled)
+        {
             if(!ke_skip)
                 ke_evt_core_scheduler();
             else
                 ke_skip = 0;
         }
 
+#if RWM_TX_POLL
+        // tx confirms above may have freed descriptors
+        if(rwm_tx_poll())
+        {
+            ke_evt_core_scheduler();
+        }
+#endif
+
 #if CFG_USE_STA_PS
         if(ps_flag == 1)
         {
@@ -668,17 +885,33 @@ static void core_thread_main( void *arg )
 void core_thread_init(void)
 {
     OSStatus ret;
+    uint32_t i;
+    static const char *queue_name[CORE_LANE_MAX] =
+    {
+        "core_ctrl_queue", "core_rx_queue", "core_tx_queue", "core_bulk_queue"
+    };
 
-    g_wifi_core.queue_item_count = CORE_QITEM_COUNT;
+    g_wifi_core.queue_item_count = 0;
     g_wifi_core.stack_size = CORE_STACK_SIZE;
 
-    ret = rtos_init_queue(&g_wifi_core.io_queue,
-                          "core_queue",
-                          sizeof(BUS_MSG_T),
-                          g_wifi_core.queue_item_count);
+    for(i = 0; i < CORE_LANE_MAX; i++)
+    {
+        ret = rtos_init_queue(&g_wifi_core.io_queue[i],
+                              queue_name[i],
+                              sizeof(BUS_MSG_T),
+                              core_lane_qitem[i]);
+        if (kNoErr != ret)
+        {
+            os_printf("Create io queue failed\r\n");
+            goto fail;
+        }
+        g_wifi_core.queue_item_count += core_lane_qitem[i];
+    }
+
+    ret = rtos_init_semaphore(&g_wifi_core.io_sema, g_wifi_core.queue_item_count);
     if (kNoErr != ret)
     {
-        os_printf("Create io queue failed\r\n");
+        os_printf("Create io sema failed\r\n");
         goto fail;
     }
 
@@ -704,20 +937,32 @@ fail:
 
 void core_thread_uninit(void)
 {
+    uint32_t i;
+
     if(g_wifi_core.handle)
     {
         rtos_delete_thread(&g_wifi_core.handle);
         g_wifi_core.handle = 0;
     }
 
-    if(g_wifi_core.io_queue)
+    if(g_wifi_core.io_sema)
+    {
+        rtos_deinit_semaphore(&g_wifi_core.io_sema);
+        g_wifi_core.io_sema = 0;
+    }
+
+    for(i = 0; i < CORE_LANE_MAX; i++)
     {
-        rtos_deinit_queue(&g_wifi_core.io_queue);
-        g_wifi_core.io_queue = 0;
+        if(g_wifi_core.io_queue[i])
+        {
+            rtos_deinit_queue(&g_wifi_core.io_queue[i]);
+            g_wifi_core.io_queue[i] = 0;
+        }
     }
 
     g_wifi_core.queue_item_count = 0;
     g_wifi_core.stack_size = 0;
+    os_memset(core_flow, 0, sizeof(core_flow));
 }
 
 extern void  user_main(void);
@@ -743,6 +988,10 @@ void app_pre_start(void)
 {
     OSStatus ret;
 
+#if CFG_UART_DEFER_LOG
+    uart_log_init();
+#endif
+
     ret = rtos_init_semaphore(&app_sema, 1);
 
     ASSERT(kNoErr == ret);
@@ -804,14 +1053,17 @@ void user_main_entry(void)
 
 int bmsg_is_empty(void)
 {
-    if(!rtos_is_queue_empty(&g_wifi_core.io_queue))
-    {
-        return 0;
-    }
-    else
+    uint32_t i;
+
+    for(i = 0; i < CORE_LANE_MAX; i++)
     {
-        return 1;
+        if(!rtos_is_queue_empty(&g_wifi_core.io_queue[i]))
+        {
+            return 0;
+        }
     }
+
+    return 1;
 }
 
 // eof
@@ -47,19 +47,49 @@ typedef struct bus_message
 
 	void *cb;
 	void *param;
+    uint32_t time;          /* pushed at, ms*/
 } BUS_MSG_T;
 
-#define CORE_QITEM_COUNT          (64)
+/* core thread lanes, served in this order*/
+enum
+{
+    CORE_LANE_CTRL          = 0,    /* ioctl, ps, hostapd messages, raw frames*/
+    CORE_LANE_RX,
+    CORE_LANE_TX,                   /* short data frames, e.g. tcp ack, dns*/
+    CORE_LANE_BULK,                 /* data frames from CORE_BULK_LEN on, a flow
+                                       stays in its lane while it has frames queued*/
+    CORE_LANE_MAX
+};
+
+#define CORE_CTRL_QITEM_COUNT     (16)
+#define CORE_RX_QITEM_COUNT       (8)
+#define CORE_TX_QITEM_COUNT       (32)
+#define CORE_BULK_QITEM_COUNT     (32)
+#define CORE_TX_BATCH             (8)       /* data messages per ke_evt_core_scheduler*/
+#define CORE_BULK_LEN             (512)
+#define CORE_FLOW_SLOTS           (16)      /* power of 2, flows hashed by ip/port*/
 #if (CFG_SUPPORT_ALIOS)
 #define CORE_STACK_SIZE           (4 * 1024)
 #else
 #define CORE_STACK_SIZE           (2 * 1024)
 #endif
 
+typedef struct _core_lane_stat_
+{
+    uint32_t cnt;
+    uint32_t cnt_max;
+    uint32_t pushed;
+    uint32_t dropped;
+    uint32_t wait_max;      /* ms from push to dispatch*/
+    uint32_t wait_sum;
+} CORE_LANE_STAT_T;
+
 typedef struct _wifi_core_
 {
     uint32_t queue_item_count;
-    beken_queue_t io_queue;
+    beken_queue_t io_queue[CORE_LANE_MAX];
+    beken_semaphore_t io_sema;      /* one count per queued message*/
+    CORE_LANE_STAT_T stat[CORE_LANE_MAX];
 
     beken_thread_t handle;
     uint32_t stack_size;
@@ -70,6 +100,7 @@ void app_pre_start(void);
 int bmsg_is_empty(void);
 void core_thread_uninit(void);
 int bmsg_tx_raw_cb_sender(uint8_t *buffer, int length, void *cb, void *param);
+void bmsg_lane_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
 
 #endif // _APP_H_
 // eof
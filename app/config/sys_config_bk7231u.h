@@ -11,6 +11,15 @@
 #define CFG_USE_UART1                              0
 #define CFG_JTAG_ENABLE                            0
 #define OSMALLOC_STATISTICAL                       0
+/* size-class slab in front of heap_4 for small blocks(<=512 bytes), makes
+   them faster but does not lower heap_4 fragmentation, that comes from the
+   pbuf sized blocks (tools/heap_bench), not used together with OSMALLOC_STATISTICAL*/
+#define CFG_MEM_SLAB                               0
+#define CFG_MEM_SLAB_ARENA_SIZE                    (24 * 1024)
+/* record live allocations with caller address, dump by "memtrace" command,
+   not used together with OSMALLOC_STATISTICAL*/
+#define CFG_MEM_TRACE                              0
+#define CFG_MEM_TRACE_CNT                          512
 
 /*section 0-----app macro config-----*/
 #define CFG_IEEE80211N                             1
@@ -28,6 +37,7 @@
 #define THD_EXTENDED_APP_PRIORITY                  5
 #define THD_HOSTAPD_PRIORITY                       5
 #define THDD_KEY_SCAN_PRIORITY                     7
+#define THD_LOG_PRIORITY                           8
 
 /*section 2-----function macro config-----*/
 #define CFG_TX_EVM_TEST                            1
@@ -74,6 +84,15 @@
 
 #define CFG_MSDU_RESV_HEAD_LEN                    96
 #define CFG_MSDU_RESV_TAIL_LEN                    16
+/* pre-allocated custom pbufs for wifi rx frames, 0: allocate from lwip heap*/
+#define CFG_RX_PBUF_POOL_CNT                      8
+/* per-AC host tx queues with deficit round robin, frames wait for a txdesc
+   instead of being dropped. depth is frames per class*/
+#define CFG_TX_SWQ                                1
+#define CFG_TX_SWQ_DEPTH                          8
+/* tx msdu refers to the lwip pbuf instead of a copy, lwip reserves
+   CFG_MSDU_RESV_HEAD_LEN/TAIL_LEN around its PBUF_RAM pbufs*/
+#define CFG_TX_PBUF_REF                           1
 
 #define CFG_MENTOR_USB                             0
 #define CFG_CHERRY_USB                             1
@@ -107,6 +126,9 @@
 #define CFG_UART_DEBUG                             0
 #define CFG_UART_DEBUG_COMMAND_LINE                1
 #define CFG_BACKGROUND_PRINT                       0
+/* bk_printf only queues the format and its args, a low priority task prints them*/
+#define CFG_UART_DEFER_LOG                         0
+#define CFG_UART_DEFER_LOG_SIZE                    4096
 #define CFG_SUPPORT_BKREG                          1
 #define CFG_ENABLE_WPA_LOG                         0
 #define CFG_IPERF_TEST                             1
@@ -160,6 +182,11 @@
 
 /*section 13-----for GENERRAL DMA */
 #define CFG_GENERAL_DMA                            1
+/* gdma_memcpy_async: copies below MIN_LEN are done by cpu. a driver that sets
+   up one of the mask channels (3 is spi tx dma) takes it from the engine*/
+#define CFG_GDMA_ASYNC                             1
+#define CFG_GDMA_ASYNC_CHNL_MASK                   0x09
+#define CFG_GDMA_ASYNC_MIN_LEN                     128
 
 /*section 14-----for FTPD UPGRADE*/
 #define CFG_USE_FTPD_UPGRADE                       0
@@ -188,6 +215,8 @@
 #else
 #define CFG_USE_SDCARD_HOST                        0
 #endif
+//fatfs sector cache in sectors, 0 to disable
+#define CFG_FATFS_CACHE_SECTORS                    16
 
 /*section 20 ----- support mp3 decoder*/
 #define CONFIG_APP_MP3PLAYER                       0
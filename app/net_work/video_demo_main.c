@@ -143,6 +143,9 @@ void cmd_video_transfer(char *pcWriteBuffer, int xWriteBufferLen, int argc, char
 #if ((CFG_USE_CAMERA_INTF) && (APP_DEMO_CFG_USE_VIDEO_BUFFER))
 extern void video_buffer_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
 #endif
+#if ((CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF) && (CFG_USE_APP_DEMO_VIDEO_TRANSFER))
+extern void video_transfer_stat_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
+#endif
 
 static const struct cli_command video_transfer_clis[] =
 {
@@ -150,7 +153,10 @@ static const struct cli_command video_transfer_clis[] =
     {"video_transfer", "video_transfer --help",    cmd_video_transfer},
     #endif
     #if ((CFG_USE_CAMERA_INTF) && (APP_DEMO_CFG_USE_VIDEO_BUFFER))
-    {"video_buffer",   "open / close / read len",  video_buffer_cmd},
+    {"video_buffer",   "open [nodes] / close / read len", video_buffer_cmd},
+    #endif
+    #if ((CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF) && (CFG_USE_APP_DEMO_VIDEO_TRANSFER))
+    {"video_stat",     "video_stat [clear]",       video_transfer_stat_cmd},
     #endif
 };
 
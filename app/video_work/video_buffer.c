@@ -176,6 +176,9 @@ static int video_buffer_recv_video_data(UINT8 *data, UINT32 len)
     }
 }
 
+// set by "video_buffer open nodes" for the next open
+static UINT16 video_buffer_pool_nodes = APP_DEMO_VBUF_POOL_NODES;
+
 int video_buffer_open(void)
 {
     if (g_vbuf == NULL)
@@ -211,6 +214,7 @@ int video_buffer_open(void)
         g_vbuf->frame_pkt_cnt = 0;
         GLOBAL_INT_RESTORE();
 
+        os_memset(&setup, 0, sizeof(TVIDEO_SETUP_DESC_ST));
         setup.open_type = TVIDEO_OPEN_SCCB;
         setup.send_type = TVIDEO_SND_INTF;
         setup.send_func = video_buffer_recv_video_data;
@@ -219,6 +223,7 @@ int video_buffer_open(void)
 
         setup.pkt_header_size = sizeof(VB_HDR_ST);
         setup.add_pkt_header = video_buffer_add_pkt_header;
+        setup.pool_node_cnt = video_buffer_pool_nodes;
 
         ret = video_transfer_init(&setup);
         if (ret != 0)
@@ -328,6 +333,10 @@ void video_buffer(int argc, char **argv)
 {
     if (strcmp(argv[1], "open") == 0)
     {
+        if (argc > 2)
+        {
+            video_buffer_pool_nodes = atoi(argv[2]);
+        }
         video_buffer_open();
     }
     else if (strcmp(argv[1], "read") == 0)
@@ -367,7 +376,7 @@ void video_buffer(int argc, char **argv)
     }
     else
     {
-        os_printf("vbuf open/read len/close/\r\n");
+        os_printf("vbuf open [nodes]/read len/close/\r\n");
     }
 }
 
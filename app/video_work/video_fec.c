@@ -0,0 +1,366 @@
+#include "include.h"
+
+#if (CFG_USE_APP_DEMO_VIDEO_TRANSFER)
+#include "mem_pub.h"
+
+#include "video_fec.h"
+
+#define VFEC_GF_POLY                0x11D
+
+static UINT8 vfec_gf_exp[512];
+static UINT8 vfec_gf_log[256];
+static UINT8 vfec_gf_ready = 0;
+
+void vfec_gf_init(void)
+{
+    UINT32 i, x = 1;
+
+    if (vfec_gf_ready)
+    {
+        return;
+    }
+
+    for (i = 0; i < 255; i++)
+    {
+        vfec_gf_exp[i] = x;
+        vfec_gf_log[x] = i;
+        x <<= 1;
+        if (x & 0x100)
+        {
+            x ^= VFEC_GF_POLY;
+        }
+    }
+    // exp[log a + log b] without the mod 255
+    for (i = 255; i < 512; i++)
+    {
+        vfec_gf_exp[i] = vfec_gf_exp[i - 255];
+    }
+    vfec_gf_ready = 1;
+}
+
+static UINT8 vfec_gf_mul(UINT8 a, UINT8 b)
+{
+    if ((a == 0) || (b == 0))
+    {
+        return 0;
+    }
+    return vfec_gf_exp[vfec_gf_log[a] + vfec_gf_log[b]];
+}
+
+static UINT8 vfec_gf_div(UINT8 a, UINT8 b)
+{
+    if (a == 0)
+    {
+        return 0;
+    }
+    return vfec_gf_exp[vfec_gf_log[a] + 255 - vfec_gf_log[b]];
+}
+
+/*
+ * Parity row j, data column i: cauchy 1 / (x_j + y_i) with x_j = j and
+ * y_i = VFEC_M_MAX + i, columns scaled so row 0 is all ones, still MDS.
+ */
+static UINT8 vfec_coef(UINT32 j, UINT32 i)
+{
+    UINT8 y = VFEC_M_MAX + i;
+
+    return vfec_gf_div(y, j ^ y);
+}
+
+// dst += c * src
+static void vfec_mul_add(UINT8 *dst, const UINT8 *src, UINT8 c, UINT32 len)
+{
+    UINT32 i;
+    UINT32 lc;
+
+    if (c == 0)
+    {
+        return;
+    }
+
+    if (c == 1)
+    {
+        for (i = 0; i < len; i++)
+        {
+            dst[i] ^= src[i];
+        }
+        return;
+    }
+
+    lc = vfec_gf_log[c];
+    for (i = 0; i < len; i++)
+    {
+        if (src[i])
+        {
+            dst[i] ^= vfec_gf_exp[vfec_gf_log[src[i]] + lc];
+        }
+    }
+}
+
+int vfec_enc_init(VFEC_ENC_PTR enc)
+{
+    vfec_gf_init();
+    os_memset(enc, 0, sizeof(VFEC_ENC_ST));
+
+    return 0;
+}
+
+void vfec_enc_deinit(VFEC_ENC_PTR enc)
+{
+    UINT32 j;
+
+    for (j = 0; j < VFEC_M_MAX; j++)
+    {
+        if (enc->parity[j])
+        {
+            os_free(enc->parity[j]);
+            enc->parity[j] = NULL;
+        }
+    }
+    enc->m = 0;
+    enc->cnt = 0;
+}
+
+// m = 0 turns it off, drops the open block
+int vfec_enc_config(VFEC_ENC_PTR enc, UINT32 k, UINT32 m)
+{
+    UINT32 j;
+
+    if ((k == 0) || (k > VFEC_K_MAX) || (m > VFEC_M_MAX))
+    {
+        return -1;
+    }
+
+    for (j = 0; j < m; j++)
+    {
+        if (enc->parity[j] == NULL)
+        {
+            enc->parity[j] = (UINT8 *)os_malloc(VFEC_HDR_SIZE + VFEC_UNIT_MAX);
+            if (enc->parity[j] == NULL)
+            {
+                m = j;
+                break;
+            }
+        }
+    }
+
+    enc->k = k;
+    enc->m = m;
+    enc->cnt = 0;
+
+    return (int)m;
+}
+
+static void vfec_enc_add(VFEC_ENC_PTR enc, const UINT8 *pkt, UINT32 len)
+{
+    UINT8 prefix[2];
+    UINT8 *unit;
+    UINT32 j;
+
+    prefix[0] = len & 0xFF;
+    prefix[1] = len >> 8;
+    for (j = 0; j < enc->m; j++)
+    {
+        unit = enc->parity[j] + VFEC_HDR_SIZE;
+        // parity is zero behind the longest unit so far
+        if (len + 2 > enc->len)
+        {
+            os_memset(unit + enc->len, 0, len + 2 - enc->len);
+        }
+
+        vfec_mul_add(unit, prefix, vfec_coef(j, enc->cnt), 2);
+        vfec_mul_add(unit + 2, pkt, vfec_coef(j, enc->cnt), len);
+    }
+
+    if (len + 2 > enc->len)
+    {
+        enc->len = len + 2;
+    }
+    enc->cnt++;
+    enc->stats.data_pkts++;
+}
+
+/*
+ * Feed a data packet after it was sent, seq counts from 1 in each frame.
+ * A block starts at every k-th packet, a gap drops the open block.
+ * Returns 1 when the block is complete, its parity packets are ready then.
+ */
+UINT32 vfec_enc_input(VFEC_ENC_PTR enc, UINT32 id, UINT32 seq, UINT32 is_eof,
+                      const UINT8 *pkt, UINT32 len)
+{
+    if ((enc->m == 0) || (len > VFEC_PKT_MAX) || (seq == 0))
+    {
+        return 0;
+    }
+
+    if (enc->cnt == enc->k)
+    {
+        enc->cnt = 0;
+    }
+    if (enc->cnt && ((id != enc->id) || (seq != (UINT8)(enc->first_seq + enc->cnt))))
+    {
+        enc->stats.blocks_cut++;
+        enc->cnt = 0;
+    }
+    if (enc->cnt == 0)
+    {
+        if ((seq - 1) % enc->k)
+        {
+            return 0;
+        }
+        enc->id = id;
+        enc->first_seq = seq;
+        enc->len = 0;
+    }
+
+    vfec_enc_add(enc, pkt, len);
+    if ((enc->cnt < enc->k) && !is_eof)
+    {
+        return 0;
+    }
+
+    enc->stats.blocks++;
+    // closed, the next packet starts a new block
+    enc->k_cur = enc->cnt;
+    enc->cnt = enc->k;
+
+    return 1;
+}
+
+// parity packet idx of the open block, header filled in
+UINT32 vfec_enc_parity(VFEC_ENC_PTR enc, UINT32 idx, UINT8 **pkt)
+{
+    VFEC_HDR_PTR hdr;
+
+    if ((idx >= enc->m) || (enc->cnt != enc->k))
+    {
+        return 0;
+    }
+
+    hdr = (VFEC_HDR_PTR)enc->parity[idx];
+    hdr->id = enc->id;
+    hdr->flag = VFEC_PARITY_FLAG | idx;
+    hdr->first_seq = enc->first_seq;
+    hdr->k = enc->k_cur;
+    hdr->m = enc->m;
+    hdr->rsv = 0;
+    hdr->len[0] = enc->len & 0xFF;
+    hdr->len[1] = enc->len >> 8;
+
+    *pkt = enc->parity[idx];
+
+    return VFEC_HDR_SIZE + enc->len;
+}
+
+#if VFEC_DECODER
+/*
+ * Rebuild the missing units of a block in place. unit[i] holds the coded
+ * unit of data packet i when bit i of have_mask is set, parity[j] the coded
+ * part of parity packet j when bit j of parity_mask is set, all len bytes.
+ * Returns 0 when the block is complete, -1 when too much is missing.
+ */
+int vfec_decode(UINT8 **unit, UINT32 have_mask, UINT8 **parity, UINT32 parity_mask,
+                UINT32 k, UINT32 len)
+{
+    UINT8 a[VFEC_M_MAX][2 * VFEC_M_MAX];
+    UINT32 miss[VFEC_M_MAX], row[VFEC_M_MAX];
+    UINT32 e = 0, r = 0, i, j, c;
+    UINT8 t;
+
+    vfec_gf_init();
+
+    for (i = 0; i < k; i++)
+    {
+        if (!(have_mask & (1 << i)))
+        {
+            if (e == VFEC_M_MAX)
+            {
+                return -1;
+            }
+            miss[e++] = i;
+        }
+    }
+    if (e == 0)
+    {
+        return 0;
+    }
+
+    for (j = 0; (j < VFEC_M_MAX) && (r < e); j++)
+    {
+        if (parity_mask & (1 << j))
+        {
+            row[r++] = j;
+        }
+    }
+    if (r < e)
+    {
+        return -1;
+    }
+
+    // syndromes: take the received units out of the parity rows
+    for (j = 0; j < e; j++)
+    {
+        for (i = 0; i < k; i++)
+        {
+            if (have_mask & (1 << i))
+            {
+                vfec_mul_add(parity[row[j]], unit[i], vfec_coef(row[j], i), len);
+            }
+        }
+    }
+
+    // invert the e x e matrix of the missing columns, gauss-jordan
+    for (j = 0; j < e; j++)
+    {
+        for (i = 0; i < e; i++)
+        {
+            a[j][i] = vfec_coef(row[j], miss[i]);
+            a[j][e + i] = (i == j);
+        }
+    }
+    for (c = 0; c < e; c++)
+    {
+        for (j = c; (j < e) && (a[j][c] == 0); j++);
+        if (j == e)
+        {
+            return -1;
+        }
+        for (i = 0; i < 2 * e; i++)
+        {
+            t = a[c][i];
+            a[c][i] = a[j][i];
+            a[j][i] = t;
+        }
+        t = a[c][c];
+        for (i = 0; i < 2 * e; i++)
+        {
+            a[c][i] = vfec_gf_div(a[c][i], t);
+        }
+        for (j = 0; j < e; j++)
+        {
+            if ((j != c) && a[j][c])
+            {
+                t = a[j][c];
+                for (i = 0; i < 2 * e; i++)
+                {
+                    a[j][i] ^= vfec_gf_mul(t, a[c][i]);
+                }
+            }
+        }
+    }
+
+    for (i = 0; i < e; i++)
+    {
+        os_memset(unit[miss[i]], 0, len);
+        for (j = 0; j < e; j++)
+        {
+            vfec_mul_add(unit[miss[i]], parity[row[j]], a[i][e + j], len);
+        }
+    }
+
+    return 0;
+}
+#endif // VFEC_DECODER
+#endif // CFG_USE_APP_DEMO_VIDEO_TRANSFER
+// eof
+
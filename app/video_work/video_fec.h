@@ -0,0 +1,72 @@
+#ifndef __VIDEO_FEC_H__
+#define __VIDEO_FEC_H__
+
+/*
+ * Packet level erasure code for the udp video stream. The packets of a frame
+ * are cut into blocks of up to k data packets, m parity packets follow each
+ * block and any k of the k + m packets give the block back. The first parity
+ * row is a plain xor, the others are reed-solomon (cauchy) over GF(256).
+ * A coded unit is the 2 byte little endian packet length, the whole packet
+ * including its header, then zeros up to the longest unit of the block.
+ */
+#define VFEC_K_MAX                  16
+#define VFEC_M_MAX                  4
+#define VFEC_PKT_MAX                1472
+#define VFEC_UNIT_MAX               (VFEC_PKT_MAX + 2)
+
+// in place of is_eof of the data packet header, low bits are the parity index
+#define VFEC_PARITY_FLAG            0x80
+
+typedef struct vfec_hdr_st
+{
+    UINT8 id;           // frame id, as in the data packets
+    UINT8 flag;         // VFEC_PARITY_FLAG | parity index
+    UINT8 first_seq;    // pkt_seq of the first data packet of the block
+    UINT8 k;            // data packets in this block
+    UINT8 m;            // parity packets of this block
+    UINT8 rsv;
+    UINT8 len[2];       // coded unit length, little endian
+} VFEC_HDR_ST, *VFEC_HDR_PTR;
+
+#define VFEC_HDR_SIZE               sizeof(VFEC_HDR_ST)
+
+typedef struct vfec_stats_st
+{
+    UINT32 blocks;
+    UINT32 data_pkts;
+    UINT32 parity_pkts;
+    UINT32 parity_bytes;
+    UINT32 parity_dropped;  // socket full, parity is best effort
+    UINT32 blocks_cut;      // block left open by a gap in the data packets
+} VFEC_STATS_ST, *VFEC_STATS_PTR;
+
+typedef struct vfec_enc_st
+{
+    UINT8 k;
+    UINT8 m;
+    UINT8 id;               // frame of the open block
+    UINT8 first_seq;
+    UINT8 cnt;              // data packets in the open block, k once it is closed
+    UINT8 k_cur;            // data packets of the closed block
+    UINT16 len;             // longest coded unit so far
+    UINT8 *parity[VFEC_M_MAX];  // VFEC_HDR_SIZE header room, then the unit
+    VFEC_STATS_ST stats;
+} VFEC_ENC_ST, *VFEC_ENC_PTR;
+
+void vfec_gf_init(void);
+
+int vfec_enc_init(VFEC_ENC_PTR enc);
+void vfec_enc_deinit(VFEC_ENC_PTR enc);
+int vfec_enc_config(VFEC_ENC_PTR enc, UINT32 k, UINT32 m);
+UINT32 vfec_enc_input(VFEC_ENC_PTR enc, UINT32 id, UINT32 seq, UINT32 is_eof,
+                      const UINT8 *pkt, UINT32 len);
+UINT32 vfec_enc_parity(VFEC_ENC_PTR enc, UINT32 idx, UINT8 **pkt);
+
+#if VFEC_DECODER
+int vfec_decode(UINT8 **unit, UINT32 have_mask, UINT8 **parity, UINT32 parity_mask,
+                UINT32 k, UINT32 len);
+#endif
+
+#endif // __VIDEO_FEC_H__
+// eof
+
@@ -0,0 +1,99 @@
+#include "include.h"
+
+#if (CFG_USE_APP_DEMO_VIDEO_TRANSFER)
+#include "mem_pub.h"
+
+#include "video_rtx.h"
+
+#define VRTX_SLOT(rtx, i)           ((rtx)->mem + (i) * VRTX_SLOT_SIZE)
+
+int vrtx_init(VRTX_PTR rtx, UINT32 slots, UINT32 frames)
+{
+    UINT32 i;
+
+    os_memset(rtx, 0, sizeof(VRTX_ST));
+    if ((slots == 0) || (frames == 0))
+    {
+        return -1;
+    }
+
+    rtx->mem = (UINT8 *)os_malloc(slots * VRTX_SLOT_SIZE);
+    if (rtx->mem == NULL)
+    {
+        return -1;
+    }
+    rtx->slots = slots;
+    rtx->frames = frames;
+
+    // seq 0 is never sent, marks an empty slot
+    for (i = 0; i < slots; i++)
+    {
+        VRTX_SLOT(rtx, i)[1] = 0;
+    }
+
+    return 0;
+}
+
+void vrtx_deinit(VRTX_PTR rtx)
+{
+    if (rtx->mem)
+    {
+        os_free(rtx->mem);
+        rtx->mem = NULL;
+    }
+    rtx->slots = 0;
+}
+
+// data packet went out, its header starts with id, is_eof, pkt_cnt, pkt_seq
+void vrtx_put(VRTX_PTR rtx, const UINT8 *pkt, UINT32 len)
+{
+    UINT8 *slot;
+
+    if ((rtx->mem == NULL) || (len < 4) || (len > VRTX_PKT_MAX) || (pkt[3] == 0))
+    {
+        return;
+    }
+
+    slot = VRTX_SLOT(rtx, rtx->head);
+    slot[0] = pkt[0];
+    slot[1] = pkt[3];
+    slot[2] = len & 0xFF;
+    slot[3] = len >> 8;
+    os_memcpy(slot + 4, pkt, len);
+
+    if (++rtx->head == rtx->slots)
+    {
+        rtx->head = 0;
+    }
+    rtx->last_id = pkt[0];
+    rtx->stats.cached++;
+}
+
+// length of the cached packet, 0 when it is gone
+UINT32 vrtx_find(VRTX_PTR rtx, UINT32 id, UINT32 seq, UINT8 **pkt)
+{
+    UINT32 i;
+    UINT8 *slot;
+
+    rtx->stats.asked++;
+    if ((rtx->mem == NULL) || (seq == 0) || ((UINT8)(rtx->last_id - id) >= rtx->frames))
+    {
+        rtx->stats.missed++;
+        return 0;
+    }
+
+    for (i = 0; i < rtx->slots; i++)
+    {
+        slot = VRTX_SLOT(rtx, i);
+        if ((slot[0] == (UINT8)id) && (slot[1] == (UINT8)seq))
+        {
+            *pkt = slot + 4;
+            return slot[2] | (slot[3] << 8);
+        }
+    }
+
+    rtx->stats.missed++;
+    return 0;
+}
+#endif // CFG_USE_APP_DEMO_VIDEO_TRANSFER
+// eof
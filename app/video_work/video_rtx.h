@@ -0,0 +1,39 @@
+#ifndef __VIDEO_RTX_H__
+#define __VIDEO_RTX_H__
+
+/*
+ * Retransmit cache for the udp video stream. Keeps copies of the last data
+ * packets sent, looked up by frame id and pkt_seq when a receiver asks for a
+ * lost one. The oldest packet is overwritten first, packets of frames older
+ * than the last few are not given out any more, they would come too late.
+ */
+#define VRTX_PKT_MAX                1472
+#define VRTX_SLOT_SIZE              (VRTX_PKT_MAX + 4)
+
+typedef struct vrtx_stats_st
+{
+    UINT32 cached;
+    UINT32 asked;           // packets asked for by the receiver
+    UINT32 resent;
+    UINT32 missed;          // overwritten or too old
+    UINT32 req_dropped;     // request queue full
+    UINT32 send_failed;     // socket full, not tried again
+} VRTX_STATS_ST, *VRTX_STATS_PTR;
+
+typedef struct vrtx_st
+{
+    UINT16 slots;
+    UINT16 head;            // next slot to overwrite
+    UINT8 frames;           // frames kept
+    UINT8 last_id;          // frame of the last packet put
+    UINT8 *mem;             // slots of id, seq, len[2], packet
+    VRTX_STATS_ST stats;
+} VRTX_ST, *VRTX_PTR;
+
+int vrtx_init(VRTX_PTR rtx, UINT32 slots, UINT32 frames);
+void vrtx_deinit(VRTX_PTR rtx);
+void vrtx_put(VRTX_PTR rtx, const UINT8 *pkt, UINT32 len);
+UINT32 vrtx_find(VRTX_PTR rtx, UINT32 id, UINT32 seq, UINT8 **pkt);
+
+#endif // __VIDEO_RTX_H__
+// eof
@@ -23,6 +23,28 @@
 #define APP_DEMO_CFG_USE_UDP              1
 #define APP_DEMO_CFG_USE_VIDEO_BUFFER     1
 
+// parity packets over blocks of APP_DEMO_UDP_FEC_K data packets, M = 0 is off
+#define APP_DEMO_UDP_FEC                  1
+#define APP_DEMO_UDP_FEC_K                8
+#define APP_DEMO_UDP_FEC_M                0
+
+// resend lost packets a receiver asks for, the cache is only taken on its first nack
+#define APP_DEMO_UDP_RTX                  1
+#define APP_DEMO_UDP_RTX_PKTS             24
+#define APP_DEMO_UDP_RTX_FRAMES           2
+
+// jpeg size and fps follow the link, CMD_RX_LOSS reports from the receiver help it
+#define APP_DEMO_UDP_RATE_CTRL            1
+
+// spread each frame's packets over the frame interval, drop the ones a newer frame outdated
+#define APP_DEMO_UDP_PACE                 1
+
+// pool nodes per video session, at most 64, 0 takes the video_transfer default of 25.
+// zero-copy udp keeps a node until the mac is done with it, so it gets more
+#define APP_DEMO_UDP_POOL_NODES           32
+#define APP_DEMO_TCP_POOL_NODES           25
+#define APP_DEMO_VBUF_POOL_NODES          25
+
 #define SUPPORT_TIANZHIHENG_DRONE         0
 
 #if SUPPORT_TIANZHIHENG_DRONE
@@ -32,6 +54,9 @@
 #define CMD_START_IMG                     0x76
 #define CMD_STOP_IMG                      0x77
 #define CMD_START_OTA                     0x38
+#define CMD_SET_FEC                       0x39
+#define CMD_NACK                          0x3A
+#define CMD_RX_LOSS                       0x3B
 
 #define APP_DEMO_TCP_SERVER_PORT          8050
 #define APP_DEMO_TCP_SERVER_PORT_VICOE    8040
@@ -54,6 +79,9 @@
 #define CMD_START_IMG                     0x36
 #define CMD_STOP_IMG                      0x37
 #define CMD_START_OTA                     0x38
+#define CMD_SET_FEC                       0x39
+#define CMD_NACK                          0x3A
+#define CMD_RX_LOSS                       0x3B
 
 #define APP_DEMO_TCP_SERVER_PORT          7050
 #define APP_DEMO_TCP_SERVER_PORT_VICOE    7040
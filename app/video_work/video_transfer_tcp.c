@@ -37,6 +37,8 @@
 
 beken_thread_t app_demo_tcp_hdl = NULL;
 int app_demo_watch_fd_list[APP_DEMO_TCP_LISTEN_MAX];
+// bytes a client already took beyond what the video pool counts as sent
+static UINT32 app_demo_tcp_ahead[APP_DEMO_TCP_LISTEN_MAX];
 int app_demo_tcp_server_fd;
 volatile int app_demo_tcp_run = 0;
 
@@ -170,20 +172,24 @@ static void app_demo_tcp_main(beken_thread_arg_t data)
                     if (app_demo_watch_fd_list[i] == -1)
                     {
                         app_demo_watch_fd_list[i] = new_cli_sockfd;
+                        app_demo_tcp_ahead[i] = 0;
 
                         app_demo_tcp_set_keepalive(new_cli_sockfd);
 
                         #if (CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF)
                         TVIDEO_SETUP_DESC_ST setup;
 
+                        os_memset(&setup, 0, sizeof(TVIDEO_SETUP_DESC_ST));
                         setup.open_type = TVIDEO_OPEN_SCCB;
                         setup.send_type = TVIDEO_SND_TCP;
                         setup.send_func = app_demo_tcp_send_packet;
+                        setup.send_batch_func = app_demo_tcp_send_batch;
                         setup.start_cb = app_demo_tcp_app_connected;
                         setup.end_cb = app_demo_tcp_app_disconnected;
 
                         setup.pkt_header_size = 0;
                         setup.add_pkt_header = NULL;
+                        setup.pool_node_cnt = APP_DEMO_TCP_POOL_NODES;
 
                         video_transfer_init(&setup);
                         #endif
@@ -331,13 +337,40 @@ void app_demo_tcp_deinit(void)
 /*---------------------------------------------------------------------------*/
 int app_demo_tcp_send_packet(UINT8 *data, UINT32 len)
 {
-    int i = 0, snd_len = 0;
+    TVIDEO_SEND_VEC_ST vec;
+
+    vec.data = data;
+    vec.len = len;
+
+    return app_demo_tcp_send_batch(&vec, 1);
+}
+
+// every client gets the stream from where it stopped, the pool moves on by
+// what the slowest one took, so no client sees a byte twice
+int app_demo_tcp_send_batch(TVIDEO_SEND_VEC_PTR vec, UINT32 cnt)
+{
+    int i = 0, snd_len = -1, ret;
+    UINT32 j, n, skip, pos, total = 0;
+    struct iovec iov[TVIDEO_SEND_BATCH_MAX];
+    struct msghdr msg;
 
     if ((!app_demo_tcp_hdl) || (app_demo_tcp_server_fd == -1))
     {
         return 0;
     }
 
+    if (cnt > TVIDEO_SEND_BATCH_MAX)
+    {
+        cnt = TVIDEO_SEND_BATCH_MAX;
+    }
+
+    for (j = 0; j < cnt; j++)
+    {
+        total += vec[j].len;
+    }
+
+    os_memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_iov = iov;
 
     for (i = 0; i < APP_DEMO_TCP_LISTEN_MAX; i++)
     {
@@ -346,18 +379,56 @@ int app_demo_tcp_send_packet(UINT8 *data, UINT32 len)
             continue;
         }
 
-        snd_len = send(app_demo_watch_fd_list[i], data, len, MSG_DONTWAIT | MSG_MORE);
-        if (snd_len < 0)
+        pos = app_demo_tcp_ahead[i];
+        if (pos < total)
+        {
+            skip = pos;
+            n = 0;
+            for (j = 0; j < cnt; j++)
+            {
+                if (skip >= vec[j].len)
+                {
+                    skip -= vec[j].len;
+                    continue;
+                }
+
+                iov[n].iov_base = vec[j].data + skip;
+                iov[n].iov_len = vec[j].len - skip;
+                skip = 0;
+                n++;
+            }
+            msg.msg_iovlen = n;
+
+            ret = sendmsg(app_demo_watch_fd_list[i], &msg, MSG_DONTWAIT | MSG_MORE);
+            if (ret > 0)
+            {
+                pos += ret;
+            }
+        }
+
+        app_demo_tcp_ahead[i] = pos;
+        if ((snd_len < 0) || (pos < (UINT32)snd_len))
+        {
+            snd_len = pos;
+        }
+    }
+
+    if (snd_len < 0)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < APP_DEMO_TCP_LISTEN_MAX; i++)
+    {
+        if (app_demo_watch_fd_list[i] != -1)
         {
-            /* err */
-            //APP_DEMO_TCP_PRT("send return fd:%d\r\n", snd_len);
-            snd_len = 0;
+            app_demo_tcp_ahead[i] -= snd_len;
         }
     }
 
     return snd_len;
 }
-/*---------------------------------------------------------------------------*/
+
 #endif  // (APP_DEMO_VIDEO_TRANSFER && APP_DEMO_CFG_USE_TCP)
 #endif  //CFG_USE_APP_DEMO_VIDEO_TRANSFER
 
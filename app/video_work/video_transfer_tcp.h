@@ -1,9 +1,12 @@
 #ifndef _APP_DEMO_TCP_H_
 #define _APP_DEMO_TCP_H_
 
+#include "video_transfer.h"
+
 UINT32 app_demo_tcp_init(void);
 void app_demo_tcp_deinit(void);
 int app_demo_tcp_send_packet(UINT8 *data, UINT32 len);
+int app_demo_tcp_send_batch(TVIDEO_SEND_VEC_PTR vec, UINT32 cnt);
 
 #endif // _APP_DEMO_TCP_H_
 
@@ -12,6 +12,7 @@
 #include <sys/socket.h>
 #endif
 #include "lwip/sockets.h"
+#include "lwip/pbuf.h"
 
 #include "video_transfer_udp.h"
 #include "BkDriverUart.h"
@@ -19,6 +20,12 @@
 #include "uart_pub.h"
 #include "mem_pub.h"
 #include "video_transfer.h"
+#if APP_DEMO_UDP_FEC
+#include "video_fec.h"
+#endif
+#if APP_DEMO_UDP_RTX
+#include "video_rtx.h"
+#endif
 
 #define APP_DEMO_UDP_DEBUG              1
 #if APP_DEMO_UDP_DEBUG
@@ -46,20 +53,50 @@ typedef struct tvideo_hdr_st
     UINT8 id;
     UINT8 is_eof;
     UINT8 pkt_cnt;
-    UINT8 size;
+    UINT8 pkt_seq;      // from 1 in each frame, was an unused size
     #if SUPPORT_TIANZHIHENG_DRONE
     UINT32 unused;
     #endif
 } HDR_ST, *HDR_PTR;
 
+#if APP_DEMO_UDP_FEC
+static VFEC_ENC_ST app_demo_udp_fec;
+// k << 8 | m, taken over by the video thread which owns the encoder
+static volatile UINT32 app_demo_udp_fec_cfg = 0;
+#define APP_DEMO_UDP_FEC_CFG_NEW        (1 << 16)
+#endif
+
+#if APP_DEMO_UDP_RTX
+static VRTX_ST app_demo_udp_rtx;
+// frame id << 8 | pkt_seq asked for, the video thread resends them
+#define APP_DEMO_UDP_RTX_REQ_MAX        32
+static UINT16 app_demo_udp_rtx_req[APP_DEMO_UDP_RTX_REQ_MAX];
+static volatile UINT32 app_demo_udp_rtx_rd = 0;
+static volatile UINT32 app_demo_udp_rtx_wr = 0;
+static volatile UINT32 app_demo_udp_rtx_on = 0;
+static UINT32 app_demo_udp_rtx_req_dropped = 0;
+#endif
+
+#define APP_DEMO_UDP_PKT_HOOK           (APP_DEMO_UDP_FEC || APP_DEMO_UDP_RTX)
+
 void app_demo_add_pkt_header(TV_HDR_PARAM_PTR param)
 {
+    static UINT32 pkt_seq = 0;
+    static UINT32 last_id = 0;
     HDR_PTR elem_tvhdr = (HDR_PTR)param->ptk_ptr;
 
+    // the rest of a frame may be dropped, so restart on a new id, not on eof
+    if (param->frame_id != last_id)
+    {
+        last_id = param->frame_id;
+        pkt_seq = 0;
+    }
+    pkt_seq++;
+
     elem_tvhdr->id = (UINT8)param->frame_id;
     elem_tvhdr->is_eof = param->is_eof;
     elem_tvhdr->pkt_cnt = param->frame_len;
-    elem_tvhdr->size = 0;
+    elem_tvhdr->pkt_seq = pkt_seq;
 
     #if SUPPORT_TIANZHIHENG_DRONE
     elem_tvhdr->unused = 0;
@@ -100,6 +137,185 @@ static void app_demo_udp_handle_cmd_data(UINT8 *data, UINT16 len)
     }
 }
 
+#if APP_DEMO_UDP_PKT_HOOK
+// parity and resends share the link with the nodes, the pacer makes room for them
+static void app_demo_udp_pace_charge(UINT32 len)
+{
+    #if (APP_DEMO_UDP_PACE && (CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF))
+    video_transfer_pace_charge(len);
+    #endif
+}
+#endif
+
+#if APP_DEMO_UDP_FEC
+// k data packets per block, m parity packets each, m = 0 turns it off
+int app_demo_udp_set_fec(UINT32 k, UINT32 m)
+{
+    if ((k == 0) || (k > VFEC_K_MAX) || (m > VFEC_M_MAX))
+    {
+        return -1;
+    }
+
+    app_demo_udp_fec_cfg = APP_DEMO_UDP_FEC_CFG_NEW | (k << 8) | m;
+    APP_DEMO_UDP_PRT("udp fec k:%d m:%d\r\n", k, m);
+
+    return 0;
+}
+
+void app_demo_udp_get_fec_stats(VFEC_STATS_PTR stats)
+{
+    os_memcpy(stats, &app_demo_udp_fec.stats, sizeof(VFEC_STATS_ST));
+}
+
+// a data packet went out, send the parity when its block is complete
+static void app_demo_udp_fec_sent(UINT8 *pkt, UINT32 len)
+{
+    HDR_PTR hdr = (HDR_PTR)pkt;
+    VFEC_ENC_PTR enc = &app_demo_udp_fec;
+    UINT32 cfg, plen, j;
+    UINT8 *parity;
+    GLOBAL_INT_DECLARATION();
+
+    cfg = app_demo_udp_fec_cfg;
+    if (cfg & APP_DEMO_UDP_FEC_CFG_NEW)
+    {
+        GLOBAL_INT_DISABLE();
+        app_demo_udp_fec_cfg &= ~APP_DEMO_UDP_FEC_CFG_NEW;
+        GLOBAL_INT_RESTORE();
+        vfec_enc_config(enc, (cfg >> 8) & 0xFF, cfg & 0xFF);
+    }
+
+    if ((enc->m == 0) || (len < sizeof(HDR_ST)))
+    {
+        return;
+    }
+
+    if (!vfec_enc_input(enc, hdr->id, hdr->pkt_seq, hdr->is_eof, pkt, len))
+    {
+        return;
+    }
+
+    for (j = 0; j < enc->m; j++)
+    {
+        plen = vfec_enc_parity(enc, j, &parity);
+        if (sendto(app_demo_udp_img_fd, parity, plen, MSG_DONTWAIT,
+                   (struct sockaddr *)app_demo_remote, sizeof(struct sockaddr_in)) == plen)
+        {
+            enc->stats.parity_pkts++;
+            enc->stats.parity_bytes += plen;
+            app_demo_udp_pace_charge(plen);
+        }
+        else
+        {
+            enc->stats.parity_dropped++;
+        }
+    }
+}
+#endif
+
+#if APP_DEMO_UDP_RTX
+void app_demo_udp_get_rtx_stats(VRTX_STATS_PTR stats)
+{
+    os_memcpy(stats, &app_demo_udp_rtx.stats, sizeof(VRTX_STATS_ST));
+    stats->req_dropped = app_demo_udp_rtx_req_dropped;
+}
+
+// CMD_IMG_HEADER, CMD_NACK, frame id, count, pkt_seq..., count 0 only arms the cache
+static void app_demo_udp_nack(UINT8 *data, UINT32 len)
+{
+    UINT32 i, cnt;
+    GLOBAL_INT_DECLARATION();
+
+    if (len < 4)
+    {
+        return;
+    }
+    app_demo_udp_rtx_on = 1;
+
+    cnt = data[3];
+    if (cnt > len - 4)
+    {
+        cnt = len - 4;
+    }
+    for (i = 0; i < cnt; i++)
+    {
+        if (app_demo_udp_rtx_wr - app_demo_udp_rtx_rd >= APP_DEMO_UDP_RTX_REQ_MAX)
+        {
+            app_demo_udp_rtx_req_dropped++;
+            continue;
+        }
+
+        app_demo_udp_rtx_req[app_demo_udp_rtx_wr % APP_DEMO_UDP_RTX_REQ_MAX] = (data[2] << 8) | data[4 + i];
+        GLOBAL_INT_DISABLE();
+        app_demo_udp_rtx_wr++;
+        GLOBAL_INT_RESTORE();
+    }
+}
+
+// keep a copy of the data packet, then resend what was asked for meanwhile
+static void app_demo_udp_rtx_sent(UINT8 *pkt, UINT32 len)
+{
+    VRTX_PTR rtx = &app_demo_udp_rtx;
+    UINT32 req, plen;
+    UINT8 *data;
+    GLOBAL_INT_DECLARATION();
+
+    if (!app_demo_udp_rtx_on)
+    {
+        return;
+    }
+    if (rtx->mem == NULL)
+    {
+        if (vrtx_init(rtx, APP_DEMO_UDP_RTX_PKTS, APP_DEMO_UDP_RTX_FRAMES) != 0)
+        {
+            APP_DEMO_UDP_WARN("udp rtx no mem\r\n");
+            app_demo_udp_rtx_on = 0;
+            return;
+        }
+    }
+
+    vrtx_put(rtx, pkt, len);
+
+    while (app_demo_udp_rtx_rd != app_demo_udp_rtx_wr)
+    {
+        req = app_demo_udp_rtx_req[app_demo_udp_rtx_rd % APP_DEMO_UDP_RTX_REQ_MAX];
+        GLOBAL_INT_DISABLE();
+        app_demo_udp_rtx_rd++;
+        GLOBAL_INT_RESTORE();
+
+        plen = vrtx_find(rtx, req >> 8, req & 0xFF, &data);
+        if (plen == 0)
+        {
+            continue;
+        }
+
+        if (sendto(app_demo_udp_img_fd, data, plen, MSG_DONTWAIT,
+                   (struct sockaddr *)app_demo_remote, sizeof(struct sockaddr_in)) == plen)
+        {
+            rtx->stats.resent++;
+            app_demo_udp_pace_charge(plen);
+        }
+        else
+        {
+            rtx->stats.send_failed++;
+        }
+    }
+}
+#endif
+
+#if APP_DEMO_UDP_PKT_HOOK
+// a data packet went out whole
+static void app_demo_udp_pkt_sent(UINT8 *pkt, UINT32 len)
+{
+    #if APP_DEMO_UDP_RTX
+    app_demo_udp_rtx_sent(pkt, len);
+    #endif
+    #if APP_DEMO_UDP_FEC
+    app_demo_udp_fec_sent(pkt, len);
+    #endif
+}
+#endif
+
 static void app_demo_udp_app_connected(void)
 {
     //app_demo_softap_send_msg(DAP_APP_CONECTED, 0);
@@ -143,6 +359,13 @@ static void app_demo_udp_receiver(UINT8 *data, UINT32 len, struct sockaddr_in *a
     {
         if (data[1] == CMD_START_IMG)
         {
+            #if APP_DEMO_UDP_FEC
+            // optional k and m from a receiver that decodes parity
+            if (len >= 4)
+            {
+                app_demo_udp_set_fec(data[2], data[3]);
+            }
+            #endif
 
             UINT8 *src_ipaddr = (UINT8 *)&app_demo_remote->sin_addr.s_addr;
             APP_DEMO_UDP_PRT("src_ipaddr: %d.%d.%d.%d\r\n", src_ipaddr[0], src_ipaddr[1],
@@ -156,14 +379,20 @@ static void app_demo_udp_receiver(UINT8 *data, UINT32 len, struct sockaddr_in *a
             #if (CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF)
             TVIDEO_SETUP_DESC_ST setup;
 
+            os_memset(&setup, 0, sizeof(TVIDEO_SETUP_DESC_ST));
             setup.open_type = TVIDEO_OPEN_SCCB;
             setup.send_type = TVIDEO_SND_UDP;
             setup.send_func = app_demo_udp_send_packet;
+            setup.send_pbuf_func = app_demo_udp_send_pbuf;
+            setup.send_pbufs_func = app_demo_udp_send_pbufs;
             setup.start_cb = app_demo_udp_app_connected;
             setup.end_cb = app_demo_udp_app_disconnected;
 
             setup.pkt_header_size = sizeof(HDR_ST);
             setup.add_pkt_header = app_demo_add_pkt_header;
+            setup.rate_ctrl = APP_DEMO_UDP_RATE_CTRL;
+            setup.pace = APP_DEMO_UDP_PACE;
+            setup.pool_node_cnt = APP_DEMO_UDP_POOL_NODES;
 
             video_transfer_init(&setup);
             #endif
@@ -180,6 +409,20 @@ static void app_demo_udp_receiver(UINT8 *data, UINT32 len, struct sockaddr_in *a
             app_demo_udp_romote_connected = 0;
             GLOBAL_INT_RESTORE();
         }
+        #if (APP_DEMO_UDP_RATE_CTRL && (CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF))
+        else if ((data[1] == CMD_RX_LOSS) && (len >= 4))
+        {
+            // per mille of the data packets lost on the way, little endian
+            video_transfer_set_rx_loss(data[2] | (data[3] << 8));
+        }
+        #endif
+        #if APP_DEMO_UDP_FEC
+        else if ((data[1] == CMD_SET_FEC) && (len >= 4))
+        {
+            // receiver adapts the redundancy to the loss it sees
+            app_demo_udp_set_fec(data[2], data[3]);
+        }
+        #endif
         #if CFG_SUPPORT_HTTP_OTA
         else if (data[1] == CMD_START_OTA)
         {
@@ -241,6 +484,11 @@ static void app_demo_udp_main(beken_thread_arg_t data)
     APP_DEMO_UDP_FATAL("app_demo_udp_main entry\r\n");
     (void)(data);
 
+    #if APP_DEMO_UDP_FEC
+    vfec_enc_init(&app_demo_udp_fec);
+    app_demo_udp_set_fec(APP_DEMO_UDP_FEC_K, APP_DEMO_UDP_FEC_M);
+    #endif
+
     rcv_buf = (u8 *) os_malloc((APP_DEMO_UDP_RCV_BUF_LEN + 1) * sizeof(u8));
     if (!rcv_buf)
     {
@@ -387,6 +635,14 @@ static void app_demo_udp_main(beken_thread_arg_t data)
                     rcv_len = (rcv_len > APP_DEMO_UDP_RCV_BUF_LEN) ? APP_DEMO_UDP_RCV_BUF_LEN : rcv_len;
                     rcv_buf[rcv_len] = 0;
 
+                    #if APP_DEMO_UDP_RTX
+                    if ((rcv_buf[0] == CMD_IMG_HEADER) && (rcv_buf[1] == CMD_NACK))
+                    {
+                        app_demo_udp_nack(rcv_buf, rcv_len);
+                        continue;
+                    }
+                    #endif
+
                     app_demo_udp_handle_cmd_data(rcv_buf, rcv_len);
                 }
 
@@ -423,6 +679,16 @@ app_udp_exit:
     video_transfer_deinit();
     #endif
 
+    #if APP_DEMO_UDP_FEC
+    // video thread is gone, nobody uses the parity buffers or the cache
+    vfec_enc_deinit(&app_demo_udp_fec);
+    #endif
+    #if APP_DEMO_UDP_RTX
+    vrtx_deinit(&app_demo_udp_rtx);
+    app_demo_udp_rtx_on = 0;
+    app_demo_udp_rtx_rd = app_demo_udp_rtx_wr;
+    #endif
+
     if (rcv_buf)
     {
         os_free(rcv_buf);
@@ -513,10 +779,96 @@ int app_demo_udp_send_packet(UINT8 *data, UINT32 len)
         //APP_DEMO_UDP_PRT("send return fd:%d\r\n", send_byte);
         send_byte = 0;
     }
+    #if APP_DEMO_UDP_PKT_HOOK
+    else if (send_byte == len)
+    {
+        app_demo_udp_pkt_sent(data, len);
+    }
+    #endif
+
+    return send_byte;
+}
+
+int app_demo_udp_send_pbuf(struct pbuf *p)
+{
+    int send_byte = 0;
+    #if APP_DEMO_UDP_PKT_HOOK
+    UINT8 *data;
+    UINT32 len;
+    #endif
+
+    if (!app_demo_udp_romote_connected)
+    {
+        return 0;
+    }
+
+    #if APP_DEMO_UDP_PKT_HOOK
+    // lwip prepends its headers in place, so take the packet before the send
+    data = (UINT8 *)p->payload;
+    len = p->tot_len;
+    #endif
+
+    send_byte = lwip_sendto_pbuf(app_demo_udp_img_fd, p, MSG_DONTWAIT,
+                                 (struct sockaddr *)app_demo_remote, sizeof(struct sockaddr_in));
+
+    if (send_byte < 0)
+    {
+        send_byte = 0;
+    }
+    #if APP_DEMO_UDP_PKT_HOOK
+    else if (send_byte == len)
+    {
+        app_demo_udp_pkt_sent(data, len);
+    }
+    #endif
 
     return send_byte;
 }
 
+int app_demo_udp_send_pbufs(struct pbuf **p, UINT32 cnt)
+{
+    int send_cnt = 0;
+    #if APP_DEMO_UDP_PKT_HOOK
+    UINT8 *data[TVIDEO_SEND_BATCH_MAX];
+    UINT16 len[TVIDEO_SEND_BATCH_MAX];
+    int i;
+    #endif
+
+    if (!app_demo_udp_romote_connected)
+    {
+        return 0;
+    }
+
+    #if APP_DEMO_UDP_PKT_HOOK
+    // lwip prepends its headers in place, so take the packets before the send
+    if (cnt > TVIDEO_SEND_BATCH_MAX)
+    {
+        cnt = TVIDEO_SEND_BATCH_MAX;
+    }
+    for (i = 0; i < cnt; i++)
+    {
+        data[i] = (UINT8 *)p[i]->payload;
+        len[i] = p[i]->tot_len;
+    }
+    #endif
+
+    send_cnt = lwip_sendto_pbufs(app_demo_udp_img_fd, p, cnt, MSG_DONTWAIT,
+                                 (struct sockaddr *)app_demo_remote, sizeof(struct sockaddr_in));
+
+    if (send_cnt < 0)
+    {
+        send_cnt = 0;
+    }
+    #if APP_DEMO_UDP_PKT_HOOK
+    for (i = 0; i < send_cnt; i++)
+    {
+        app_demo_udp_pkt_sent(data[i], len[i]);
+    }
+    #endif
+
+    return send_cnt;
+}
+
 #if APP_DEMO_EN_VOICE_TRANSFER
 int app_demo_udp_voice_send_packet(UINT8 *data, UINT32 len)
 {
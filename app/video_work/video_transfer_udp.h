@@ -1,11 +1,28 @@
 #ifndef __APP_DEMO_UDP_H__
 #define __APP_DEMO_UDP_H__
 
+struct pbuf;
+
 UINT32 app_demo_udp_init(void);
 void app_demo_udp_deinit(void);
 int app_demo_udp_send_packet(UINT8 *data, UINT32 len);
+int app_demo_udp_send_pbuf(struct pbuf *p);
+int app_demo_udp_send_pbufs(struct pbuf **p, UINT32 cnt);
 void app_demo_disconnect_cmd_udp(void);
 
+#if APP_DEMO_UDP_FEC
+struct vfec_stats_st;
+
+int app_demo_udp_set_fec(UINT32 k, UINT32 m);
+void app_demo_udp_get_fec_stats(struct vfec_stats_st *stats);
+#endif
+
+#if APP_DEMO_UDP_RTX
+struct vrtx_stats_st;
+
+void app_demo_udp_get_rtx_stats(struct vrtx_stats_st *stats);
+#endif
+
 #endif
 // eof
 
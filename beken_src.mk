@@ -274,6 +274,7 @@ INCLUDES += -I$(BEKEN_DIR)/components/CherryUSB/class/video
 INCLUDES += -I$(BEKEN_DIR)/components/CherryUSB/class/hub
 INCLUDES += -I$(BEKEN_DIR)/components/CherryUSB/demo
 INCLUDES += -I$(BEKEN_DIR)/components/CherryUSB/demo/beken/usb_device
+INCLUDES += -I$(BEKEN_DIR)/components/CherryUSB/port/beken_musb
 ifeq ($(CFG_UF2),1)
 INCLUDES += -I$(BEKEN_DIR)/components/uf2
 INCLUDES += -I$(BEKEN_DIR)/components/uf2/ports
@@ -323,6 +324,8 @@ SRC_C += $(BEKEN_DIR)/app/standalone-station/sa_station.c
 SRC_C += $(BEKEN_DIR)/app/video_work/video_transfer_tcp.c
 SRC_C += $(BEKEN_DIR)/app/video_work/video_transfer_udp.c
 SRC_C += $(BEKEN_DIR)/app/video_work/video_buffer.c
+SRC_C += $(BEKEN_DIR)/app/video_work/video_fec.c
+SRC_C += $(BEKEN_DIR)/app/video_work/video_rtx.c
 SRC_C += $(BEKEN_DIR)/app/net_work/video_demo_main.c
 SRC_C += $(BEKEN_DIR)/app/net_work/video_demo_station.c
 SRC_C += $(BEKEN_DIR)/app/net_work/video_demo_softap.c
@@ -339,6 +342,7 @@ SRC_C += $(BEKEN_DIR)/driver/entry/arch_main.c
 SRC_C += $(BEKEN_DIR)/driver/fft/fft.c
 SRC_C += $(BEKEN_DIR)/driver/flash/flash.c
 SRC_C += $(BEKEN_DIR)/driver/general_dma/general_dma.c
+SRC_C += $(BEKEN_DIR)/driver/general_dma/gdma_async.c
 SRC_C += $(BEKEN_DIR)/driver/gpio/gpio.c
 SRC_C += $(BEKEN_DIR)/driver/i2s/i2s.c
 SRC_C += $(BEKEN_DIR)/driver/icu/icu.c
@@ -358,6 +362,7 @@ SRC_C += $(BEKEN_DIR)/driver/spidma/spidma.c
 SRC_C += $(BEKEN_DIR)/driver/sys_ctrl/sys_ctrl.c
 SRC_C += $(BEKEN_DIR)/driver/uart/Retarget.c
 SRC_C += $(BEKEN_DIR)/driver/uart/uart.c
+SRC_C += $(BEKEN_DIR)/driver/uart/uart_log.c
 SRC_C += $(BEKEN_DIR)/driver/uart/printf.c
 SRC_C += $(BEKEN_DIR)/driver/wdt/wdt.c
 SRC_C += $(BEKEN_DIR)/driver/calendar/calendar.c
@@ -392,6 +397,7 @@ SRC_WPA_C += $(BEKEN_DIR)/components/hostapd_intf/hostapd_intf.c
 ifeq ($(CFG_USE_SDCARD_HOST),1)
 SRC_C += $(BEKEN_DIR)/components/fatfs/cc936.c
 SRC_C += $(BEKEN_DIR)/components/fatfs/ccsbcs.c
+SRC_C += $(BEKEN_DIR)/components/fatfs/disk_cache.c
 SRC_C += $(BEKEN_DIR)/components/fatfs/disk_io.c
 SRC_C += $(BEKEN_DIR)/components/fatfs/driver_udisk.c
 SRC_C += $(BEKEN_DIR)/components/fatfs/ff.c
@@ -482,6 +488,8 @@ SRC_C += $(BEKEN_DIR)/components/utf8/conv_utf8.c
 # video / jpeg
 SRC_C += $(BEKEN_DIR)/components/camera_intf/camera_intf.c
 SRC_C += $(BEKEN_DIR)/components/video_transfer/video_transfer.c
+SRC_C += $(BEKEN_DIR)/components/video_transfer/video_rate.c
+SRC_C += $(BEKEN_DIR)/components/video_transfer/video_pace.c
 
 # For WPA3: wolfssl
 ifeq ($(CFG_WPA3),1)
@@ -744,6 +752,8 @@ endif #CFG_SUPPORT_BLE
 #operation system module
 SRC_OS += $(BEKEN_DIR)/os/FreeRTOSv9.0.0/rtos_pub.c
 SRC_C  += $(BEKEN_DIR)/os/mem_arch.c
+SRC_C  += $(BEKEN_DIR)/os/mem_slab.c
+SRC_C  += $(BEKEN_DIR)/os/mem_trace.c
 SRC_C  += $(BEKEN_DIR)/os/platform_stub.c
 SRC_C  += $(BEKEN_DIR)/os/str_arch.c
 
@@ -45,6 +45,7 @@
 /* Enable test mode */
 // #define CONFIG_USBDEV_TEST_MODE
 
+/* msc transfer chunk, a multiple of the sector size; two are allocated */
 #ifndef CONFIG_USBDEV_MSC_BLOCK_SIZE
 #define CONFIG_USBDEV_MSC_BLOCK_SIZE 512
 #endif
@@ -63,6 +64,9 @@
 
 // #define CONFIG_USBDEV_MSC_THREAD
 
+/* msc per-phase timing, needs usbd_msc_get_time_us() */
+// #define CONFIG_USBDEV_MSC_STATS
+
 #ifndef CONFIG_USBDEV_MSC_PRIO
 #define CONFIG_USBDEV_MSC_PRIO 4
 #endif
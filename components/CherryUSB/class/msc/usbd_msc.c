@@ -13,6 +13,22 @@
 #define MSD_OUT_EP_IDX 0
 #define MSD_IN_EP_IDX  1
 
+#ifdef CONFIG_USBDEV_MSC_STATS
+#define MSC_TIME()               usbd_msc_get_time_us()
+#define MSC_STATS_ADD(field, n)  (g_usbd_msc.stats.field += (n))
+#else
+#define MSC_TIME()               0
+#define MSC_STATS_ADD(field, n)  ((void)(n))
+#endif
+
+#ifdef CONFIG_USBDEV_MSC_THREAD
+/* an out event carries its byte count, the next completion may come in
+ * before the thread has taken this one */
+#define MSC_EVENT(stage, nbytes) ((uintptr_t)(stage) | ((uintptr_t)(nbytes) << 8))
+#define MSC_EVENT_STAGE(event)   ((event)&0xff)
+#define MSC_EVENT_NBYTES(event)  ((uint32_t)((event) >> 8))
+#endif
+
 /* Describe EndPoints configuration */
 static struct usbd_endpoint mass_ep_data[2];
 
@@ -43,12 +59,22 @@ USB_NOCACHE_RAM_SECTION struct usbd_msc_priv {
     uint16_t scsi_blk_size;
     uint32_t scsi_blk_nbr;
 
-    USB_MEM_ALIGNX uint8_t block_buffer[CONFIG_USBDEV_MSC_BLOCK_SIZE];
+    /* ping-pong: media i/o on one buffer while the other is on the bus */
+    USB_MEM_ALIGNX uint8_t block_buffer[2][CONFIG_USBDEV_MSC_BLOCK_SIZE];
+    uint8_t buf_idx;         /* read: next to send, write: receiving */
+    uint32_t buf_len[2];     /* read: bytes read ahead, 0 = empty */
+    uint32_t pipe_sector;    /* the side running ahead: media for reads, bus for writes */
+    uint32_t pipe_nsectors;
+    bool media_err;
+
+#ifdef CONFIG_USBDEV_MSC_STATS
+    struct usbd_msc_stats stats;
+    uint32_t phase_start;
+#endif
 
 #if defined(CONFIG_USBDEV_MSC_THREAD)
     usb_osal_mq_t usbd_msc_mq;
     usb_osal_thread_t usbd_msc_thread;
-    uint32_t nbytes;
 #endif
 } g_usbd_msc;
 
@@ -139,6 +165,28 @@ static void usbd_msc_send_info(uint8_t *buffer, uint8_t size)
 static bool SCSI_processWrite(uint32_t nbytes);
 static bool SCSI_processRead(void);
 
+static void usbd_msc_pipe_start(void)
+{
+    g_usbd_msc.buf_idx = 0;
+    g_usbd_msc.buf_len[0] = 0;
+    g_usbd_msc.buf_len[1] = 0;
+    g_usbd_msc.pipe_sector = g_usbd_msc.start_sector;
+    g_usbd_msc.pipe_nsectors = g_usbd_msc.nsectors;
+    g_usbd_msc.media_err = false;
+#ifdef CONFIG_USBDEV_MSC_STATS
+    g_usbd_msc.phase_start = MSC_TIME();
+#endif
+}
+
+static uint32_t usbd_msc_pipe_next(void)
+{
+    uint32_t len = MIN(g_usbd_msc.pipe_nsectors * g_usbd_msc.scsi_blk_size, CONFIG_USBDEV_MSC_BLOCK_SIZE);
+
+    g_usbd_msc.pipe_sector += (len / g_usbd_msc.scsi_blk_size);
+    g_usbd_msc.pipe_nsectors -= (len / g_usbd_msc.scsi_blk_size);
+    return len;
+}
+
 /**
 * @brief  SCSI_SetSenseData
 *         Load the last error code in the error list
@@ -489,9 +537,10 @@ static bool SCSI_read10(uint8_t **data, uint32_t *len)
         USB_LOG_ERR("scsi_blk_len does not match with dDataLength\r\n");
         return false;
     }
+    usbd_msc_pipe_start();
     g_usbd_msc.stage = MSC_DATA_IN;
 #ifdef CONFIG_USBDEV_MSC_THREAD
-    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_DATA_IN);
+    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_EVENT(MSC_DATA_IN, 0));
     return true;
 #else
     return SCSI_processRead();
@@ -521,9 +570,10 @@ static bool SCSI_read12(uint8_t **data, uint32_t *len)
         USB_LOG_ERR("scsi_blk_len does not match with dDataLength\r\n");
         return false;
     }
+    usbd_msc_pipe_start();
     g_usbd_msc.stage = MSC_DATA_IN;
 #ifdef CONFIG_USBDEV_MSC_THREAD
-    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_DATA_IN);
+    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_EVENT(MSC_DATA_IN, 0));
     return true;
 #else
     return SCSI_processRead();
@@ -553,9 +603,10 @@ static bool SCSI_write10(uint8_t **data, uint32_t *len)
     if (g_usbd_msc.cbw.dDataLength != data_len) {
         return false;
     }
+    usbd_msc_pipe_start();
     g_usbd_msc.stage = MSC_DATA_OUT;
-    data_len = MIN(data_len, CONFIG_USBDEV_MSC_BLOCK_SIZE);
-    usbd_ep_start_read(mass_ep_data[MSD_OUT_EP_IDX].ep_addr, g_usbd_msc.block_buffer, data_len);
+    data_len = usbd_msc_pipe_next();
+    usbd_ep_start_read(mass_ep_data[MSD_OUT_EP_IDX].ep_addr, g_usbd_msc.block_buffer[0], data_len);
     return true;
 }
 
@@ -582,9 +633,10 @@ static bool SCSI_write12(uint8_t **data, uint32_t *len)
     if (g_usbd_msc.cbw.dDataLength != data_len) {
         return false;
     }
+    usbd_msc_pipe_start();
     g_usbd_msc.stage = MSC_DATA_OUT;
-    data_len = MIN(data_len, CONFIG_USBDEV_MSC_BLOCK_SIZE);
-    usbd_ep_start_read(mass_ep_data[MSD_OUT_EP_IDX].ep_addr, g_usbd_msc.block_buffer, data_len);
+    data_len = usbd_msc_pipe_next();
+    usbd_ep_start_read(mass_ep_data[MSD_OUT_EP_IDX].ep_addr, g_usbd_msc.block_buffer[0], data_len);
     return true;
 }
 /* do not use verify to reduce code size */
@@ -634,51 +686,107 @@ static bool SCSI_verify10(uint8_t **data, uint32_t *len)
 }
 #endif
 
+/* media read of the next chunk into buffer idx */
+static int usbd_msc_read_ahead(uint8_t idx)
+{
+    uint32_t len;
+    uint32_t t;
+
+    if (g_usbd_msc.pipe_nsectors == 0) {
+        return 0;
+    }
+
+    len = MIN(g_usbd_msc.pipe_nsectors * g_usbd_msc.scsi_blk_size, CONFIG_USBDEV_MSC_BLOCK_SIZE);
+    t = MSC_TIME();
+    if (usbd_msc_sector_read(g_usbd_msc.pipe_sector, g_usbd_msc.block_buffer[idx], len) != 0) {
+        return -1;
+    }
+    MSC_STATS_ADD(media_read_us, MSC_TIME() - t);
+
+    usbd_msc_pipe_next();
+    g_usbd_msc.buf_len[idx] = len;
+    return 0;
+}
+
 static bool SCSI_processRead(void)
 {
+    uint8_t idx = g_usbd_msc.buf_idx;
     uint32_t transfer_len;
 
     USB_LOG_DBG("read lba:%d\r\n", g_usbd_msc.start_sector);
 
-    transfer_len = MIN(g_usbd_msc.nsectors * g_usbd_msc.scsi_blk_size, CONFIG_USBDEV_MSC_BLOCK_SIZE);
-
-    if (usbd_msc_sector_read(g_usbd_msc.start_sector, g_usbd_msc.block_buffer, transfer_len) != 0) {
-        SCSI_SetSenseData(SCSI_KCQHE_UREINRESERVEDAREA);
-        return false;
+    /* first chunk of the command, or the read ahead failed */
+    if (g_usbd_msc.buf_len[idx] == 0) {
+        MSC_STATS_ADD(read_sync, 1);
+        if (usbd_msc_read_ahead(idx) != 0) {
+            SCSI_SetSenseData(SCSI_KCQHE_UREINRESERVEDAREA);
+            return false;
+        }
     }
 
-    usbd_ep_start_write(mass_ep_data[MSD_IN_EP_IDX].ep_addr, g_usbd_msc.block_buffer, transfer_len);
+    transfer_len = g_usbd_msc.buf_len[idx];
+    g_usbd_msc.buf_len[idx] = 0;
 
     g_usbd_msc.start_sector += (transfer_len / g_usbd_msc.scsi_blk_size);
     g_usbd_msc.nsectors -= (transfer_len / g_usbd_msc.scsi_blk_size);
     g_usbd_msc.csw.dDataResidue -= transfer_len;
+    MSC_STATS_ADD(read_bytes, transfer_len);
 
+    /* before the write, its completion may come at once */
     if (g_usbd_msc.nsectors == 0) {
         g_usbd_msc.stage = MSC_SEND_CSW;
     }
 
+    usbd_ep_start_write(mass_ep_data[MSD_IN_EP_IDX].ep_addr, g_usbd_msc.block_buffer[idx], transfer_len);
+
+    /* fill the other buffer while this one is on the bus, a failure is
+     * retried above when that chunk is due */
+    idx ^= 1;
+    g_usbd_msc.buf_idx = idx;
+    usbd_msc_read_ahead(idx);
+
     return true;
 }
 
 static bool SCSI_processWrite(uint32_t nbytes)
 {
+    uint8_t idx = g_usbd_msc.buf_idx;
     uint32_t data_len = 0;
+    uint32_t t;
+
     USB_LOG_DBG("write lba:%d\r\n", g_usbd_msc.start_sector);
 
-    if (usbd_msc_sector_write(g_usbd_msc.start_sector, g_usbd_msc.block_buffer, nbytes) != 0) {
-        SCSI_SetSenseData(SCSI_KCQHE_WRITEFAULT);
-        return false;
+    /* let the host send the next chunk while this one goes to the media */
+    g_usbd_msc.buf_idx = idx ^ 1;
+    if (g_usbd_msc.pipe_nsectors) {
+        data_len = usbd_msc_pipe_next();
+        usbd_ep_start_read(mass_ep_data[MSD_OUT_EP_IDX].ep_addr, g_usbd_msc.block_buffer[idx ^ 1], data_len);
+    }
+
+    /* after a fault the rest of the data is only drained */
+    if (!g_usbd_msc.media_err) {
+        t = MSC_TIME();
+        if (usbd_msc_sector_write(g_usbd_msc.start_sector, g_usbd_msc.block_buffer[idx], nbytes) != 0) {
+            SCSI_SetSenseData(SCSI_KCQHE_WRITEFAULT);
+            g_usbd_msc.media_err = true;
+        } else {
+            MSC_STATS_ADD(media_write_us, MSC_TIME() - t);
+            MSC_STATS_ADD(write_bytes, nbytes);
+            g_usbd_msc.csw.dDataResidue -= nbytes;
+        }
     }
 
     g_usbd_msc.start_sector += (nbytes / g_usbd_msc.scsi_blk_size);
     g_usbd_msc.nsectors -= (nbytes / g_usbd_msc.scsi_blk_size);
-    g_usbd_msc.csw.dDataResidue -= nbytes;
 
     if (g_usbd_msc.nsectors == 0) {
+#ifdef CONFIG_USBDEV_MSC_STATS
+        MSC_STATS_ADD(data_out_us, MSC_TIME() - g_usbd_msc.phase_start);
+#endif
+        if (g_usbd_msc.media_err) {
+            return false;
+        }
         usbd_msc_send_csw(CSW_STATUS_CMD_PASSED);
-    } else {
-        data_len = MIN(g_usbd_msc.nsectors * g_usbd_msc.scsi_blk_size, CONFIG_USBDEV_MSC_BLOCK_SIZE);
-        usbd_ep_start_read(mass_ep_data[MSD_OUT_EP_IDX].ep_addr, g_usbd_msc.block_buffer, data_len);
     }
 
     return true;
@@ -686,7 +794,7 @@ static bool SCSI_processWrite(uint32_t nbytes)
 
 static bool SCSI_CBWDecode(uint32_t nbytes)
 {
-    uint8_t *buf2send = g_usbd_msc.block_buffer;
+    uint8_t *buf2send = g_usbd_msc.block_buffer[0];
     uint32_t len2send = 0;
     bool ret = false;
 
@@ -784,8 +892,7 @@ void mass_storage_bulk_out(uint8_t ep, uint32_t nbytes)
                 case SCSI_CMD_WRITE10:
                 case SCSI_CMD_WRITE12:
 #ifdef CONFIG_USBDEV_MSC_THREAD
-                    g_usbd_msc.nbytes = nbytes;
-                    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_DATA_OUT);
+                    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_EVENT(MSC_DATA_OUT, nbytes));
 #else
                     if (SCSI_processWrite(nbytes) == false) {
                         usbd_msc_send_csw(CSW_STATUS_CMD_FAILED); /* send fail status to host,and the host will retry*/
@@ -809,7 +916,7 @@ void mass_storage_bulk_in(uint8_t ep, uint32_t nbytes)
                 case SCSI_CMD_READ10:
                 case SCSI_CMD_READ12:
 #ifdef CONFIG_USBDEV_MSC_THREAD
-                    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_DATA_IN);
+                    usb_osal_mq_send(g_usbd_msc.usbd_msc_mq, MSC_EVENT(MSC_DATA_IN, 0));
 #else
                     if (SCSI_processRead() == false) {
                         usbd_msc_send_csw(CSW_STATUS_CMD_FAILED); /* send fail status to host,and the host will retry*/
@@ -823,6 +930,11 @@ void mass_storage_bulk_in(uint8_t ep, uint32_t nbytes)
             break;
         /*the device has to send a CSW*/
         case MSC_SEND_CSW:
+#ifdef CONFIG_USBDEV_MSC_STATS
+            if ((g_usbd_msc.cbw.CB[0] == SCSI_CMD_READ10) || (g_usbd_msc.cbw.CB[0] == SCSI_CMD_READ12)) {
+                MSC_STATS_ADD(data_in_us, MSC_TIME() - g_usbd_msc.phase_start);
+            }
+#endif
             usbd_msc_send_csw(CSW_STATUS_CMD_PASSED);
             break;
 
@@ -850,11 +962,11 @@ static void usbdev_msc_thread(void *argument)
             continue;
         }
         USB_LOG_DBG("%d\r\n", event);
-        if (event == MSC_DATA_OUT) {
-            if (SCSI_processWrite(g_usbd_msc.nbytes) == false) {
+        if (MSC_EVENT_STAGE(event) == MSC_DATA_OUT) {
+            if (SCSI_processWrite(MSC_EVENT_NBYTES(event)) == false) {
                 usbd_msc_send_csw(CSW_STATUS_CMD_FAILED); /* send fail status to host,and the host will retry*/
             }
-        } else if (event == MSC_DATA_IN) {
+        } else if (MSC_EVENT_STAGE(event) == MSC_DATA_IN) {
             if (SCSI_processRead() == false) {
                 usbd_msc_send_csw(CSW_STATUS_CMD_FAILED); /* send fail status to host,and the host will retry*/
             }
@@ -889,7 +1001,8 @@ struct usbd_interface *usbd_msc_init_intf(struct usbd_interface *intf, const uin
     }
 
 #ifdef CONFIG_USBDEV_MSC_THREAD
-    g_usbd_msc.usbd_msc_mq = usb_osal_mq_create(1);
+    /* one event per ping-pong buffer */
+    g_usbd_msc.usbd_msc_mq = usb_osal_mq_create(2);
     if (g_usbd_msc.usbd_msc_mq == NULL) {
         return NULL;
     }
@@ -910,3 +1023,20 @@ bool usbd_msc_set_popup(void)
 {
     return g_usbd_msc.popup;
 }
+
+#ifdef CONFIG_USBDEV_MSC_STATS
+__WEAK uint32_t usbd_msc_get_time_us(void)
+{
+    return 0;
+}
+
+void usbd_msc_get_stats(struct usbd_msc_stats *stats)
+{
+    memcpy(stats, &g_usbd_msc.stats, sizeof(struct usbd_msc_stats));
+}
+
+void usbd_msc_clear_stats(void)
+{
+    memset(&g_usbd_msc.stats, 0, sizeof(struct usbd_msc_stats));
+}
+#endif
@@ -24,6 +24,23 @@ int usbd_msc_sector_write(uint32_t sector, uint8_t *buffer, uint32_t length);
 void usbd_msc_set_readonly(bool readonly);
 bool usbd_msc_set_popup(void);
 
+#ifdef CONFIG_USBDEV_MSC_STATS
+struct usbd_msc_stats {
+    uint32_t read_bytes;     /* data sent to the host */
+    uint32_t write_bytes;    /* data written to the media */
+    uint32_t media_read_us;  /* time in usbd_msc_sector_read */
+    uint32_t media_write_us; /* time in usbd_msc_sector_write */
+    uint32_t data_in_us;     /* wall time of the read data phases */
+    uint32_t data_out_us;    /* wall time of the write data phases */
+    uint32_t read_sync;      /* chunks not read ahead, one per command at best */
+};
+
+/* us time base for the counters, weak, override in the port */
+uint32_t usbd_msc_get_time_us(void);
+void usbd_msc_get_stats(struct usbd_msc_stats *stats);
+void usbd_msc_clear_stats(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
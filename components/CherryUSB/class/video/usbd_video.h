@@ -22,6 +22,13 @@ void usbd_video_open(uint8_t intf);
 void usbd_video_close(uint8_t intf);
 uint32_t usbd_video_mjpeg_payload_fill(uint8_t *input, uint32_t input_len, uint8_t *output, uint32_t *out_len);
 
+/* frame queue of the iso stream, implemented by the application (see demo/beken/usb_device/video) */
+typedef void (*usbd_video_frame_done_cb)(uint8_t *data, void *arg);
+
+int usbd_video_queue_frame(uint8_t *data, uint32_t size, usbd_video_frame_done_cb done, void *arg);
+uint32_t usbd_video_frame_queue_free(void);
+void usbd_video_send_common_frame(uint8_t *data, uint32_t size);
+
 #ifdef __cplusplus
 }
 #endif
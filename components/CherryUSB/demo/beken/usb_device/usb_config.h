@@ -49,6 +49,7 @@
 /* Enable test mode */
 // #define CONFIG_USBDEV_TEST_MODE
 
+/* msc transfer chunk, a multiple of the sector size; two are allocated */
 #ifndef CONFIG_USBDEV_MSC_BLOCK_SIZE
 #define CONFIG_USBDEV_MSC_BLOCK_SIZE 512
 #endif
@@ -67,6 +68,9 @@
 
 // #define CONFIG_USBDEV_MSC_THREAD
 
+/* msc per-phase timing, needs usbd_msc_get_time_us() */
+// #define CONFIG_USBDEV_MSC_STATS
+
 #ifndef CONFIG_USBDEV_MSC_PRIO
 #define CONFIG_USBDEV_MSC_PRIO 4
 #endif
@@ -140,6 +144,27 @@
 #define CONFIG_USBDEV_EP_NUM 4
 #define USB_NUM_BIDIR_ENDPOINTS 16
 
+/* move bulk/iso fifo data with a gdma channel, cpu copy stays the fallback */
+// #define CONFIG_USB_MUSB_GDMA
+
+/* no channel is free of drivers: 0 gdma_memcpy, 1/3 spi and audio dac,
+ * 2 audio adc, 4 camera jpeg, 5 camera and spidma. 4 is only used with the
+ * camera on. a channel already set up by a driver or the copy engine is
+ * refused, a driver setting it up later takes it back; the fifo goes by cpu then */
+#ifndef CONFIG_USB_MUSB_GDMA_CHNL
+#define CONFIG_USB_MUSB_GDMA_CHNL 4
+#endif
+
+/* shorter packets are cheaper by cpu than a channel setup */
+#ifndef CONFIG_USB_MUSB_GDMA_MIN_LEN
+#define CONFIG_USB_MUSB_GDMA_MIN_LEN 32
+#endif
+
+/* dma staging for unaligned buffers, larger packets go by cpu */
+#ifndef CONFIG_USB_MUSB_BOUNCE_SIZE
+#define CONFIG_USB_MUSB_BOUNCE_SIZE 1024
+#endif
+
 /* ================ USB Host Port Configuration ==================*/
 
 #define CONFIG_USBHOST_PIPE_NUM 10
@@ -1,5 +1,6 @@
 #include "usbd_core.h"
 #include "usbd_video.h"
+#include "usb_osal.h"
 #include <os/os.h>
 #include <os/mem.h>
 
@@ -191,25 +192,25 @@ void usbd_configure_done_callback(void)
 }
 
 volatile bool tx_flag = 0;
-volatile bool iso_tx_busy = false;
+
+static void usbd_video_tx_reset(bool on);
+static void usbd_video_tx_next(void);
 
 void usbd_video_open(uint8_t intf)
 {
-    tx_flag = 1;
     USB_LOG_RAW("OPEN\r\n");
-    iso_tx_busy = false;
+    usbd_video_tx_reset(1);
 }
 void usbd_video_close(uint8_t intf)
 {
     USB_LOG_RAW("CLOSE\r\n");
-    tx_flag = 0;
-    iso_tx_busy = false;
+    usbd_video_tx_reset(0);
 }
 
 void usbd_video_iso_callback(uint8_t ep, uint32_t nbytes)
 {
     // USB_LOG_RAW("actual in len:%d\r\n", nbytes);
-    iso_tx_busy = false;
+    usbd_video_tx_next();
 }
 
 static struct usbd_endpoint video_in_ep = {
@@ -244,8 +245,40 @@ void usbd_video_h264_deinit()
 }
 
 #define PACKET_BUFFER_SIZE        (2 << 10)
-static USB_MEM_ALIGNX uint8_t packet_buffer[PACKET_BUFFER_SIZE];
-//__attribute__((section(".video_cache_bss"))) uint8_t packet_buffer[PACKET_BUFFER_SIZE];
+#define PAYLOAD_HEADER_LEN        2
+#define PAYLOAD_BUF_NUM           2     /* one on the wire, one packed ahead */
+#define FRAME_QUEUE_LEN           4     /* power of 2 */
+
+#define PAYLOAD_HDR_FID           (1 << 0)
+#define PAYLOAD_HDR_EOF           (1 << 1)
+#define PAYLOAD_HDR_EOH           (1 << 7)
+
+struct usbd_video_frame {
+    uint8_t *data;
+    uint32_t size;
+    usbd_video_frame_done_cb done;
+    void *arg;
+};
+
+/*
+ * The iso completion callback sends the packed buffer and packs the next
+ * one, so a frame goes out without the producer task. frame queue is
+ * single producer (usbd_video_queue_frame) / single consumer (callback),
+ * usbd_video_close drains it under the same critical section.
+ */
+struct usbd_video_tx {
+    struct usbd_video_frame queue[FRAME_QUEUE_LEN];
+    volatile uint32_t q_in;
+    volatile uint32_t q_out;
+    uint32_t pos;                       /* bytes of the head frame packed */
+    uint8_t fid;
+    uint8_t send_idx;                   /* buffer on the wire, or next to send */
+    uint32_t len[PAYLOAD_BUF_NUM];      /* packed bytes, 0 = empty */
+    volatile bool busy;                 /* a write is in flight */
+};
+
+static USB_MEM_ALIGNX uint8_t packet_buffer[PAYLOAD_BUF_NUM][PACKET_BUFFER_SIZE];
+static struct usbd_video_tx video_tx;
 
 void dump_mem(uint8_t *buf, uint32_t buf_len)
 {
@@ -257,55 +290,174 @@ void dump_mem(uint8_t *buf, uint32_t buf_len)
     os_printf("\r\n");
 }
 
-void usbd_video_send_common_frame(uint8_t *data, uint32_t size)
+/* header in place, payload copied behind it; nothing else of the buffer is touched */
+static uint32_t usbd_video_tx_pack(uint8_t *buf)
 {
-    uint32_t out_len;
-    uint32_t input_len = size;
-    int ret = 0;
-    uint32_t packets = 0;
-    uint32_t last_packet_size = 0;
-    uint32_t stream_pos = 0;
-    const uint32_t payload_header_length = usbd_video_common_get_payload_header_length();
-    const uint32_t max_payload_transfer_size = usbd_video_get_max_payload_transfer_size();
-
-    packets = (input_len % (max_payload_transfer_size - payload_header_length)) ?
-              (input_len / (max_payload_transfer_size - payload_header_length) + 1) :
-              (input_len / (max_payload_transfer_size - payload_header_length));
-
-    last_packet_size = input_len -
-                       ((packets - 1) * (max_payload_transfer_size - payload_header_length)) +
-                       payload_header_length;
-
-    // os_printf("last_packet_size:%d\r\n", last_packet_size);
-    for (size_t i = 0; i < packets; i++) {
-        os_memset(packet_buffer, 0, max_payload_transfer_size);
-        if (i == (packets - 1)) {
-            usbd_video_common_frame_payload_fill(&data[stream_pos],
-                                                 last_packet_size - payload_header_length,
-                                                 packet_buffer,
-                                                 &out_len,
-                                                 true);
-        } else {
-            usbd_video_common_frame_payload_fill(&data[stream_pos],
-                                                 max_payload_transfer_size - payload_header_length,
-                                                 packet_buffer,
-                                                 &out_len,
-                                                 false);
-            stream_pos += (max_payload_transfer_size - payload_header_length);
+    struct usbd_video_frame *frame;
+    uint32_t chunk;
+    uint8_t *data;
+    usbd_video_frame_done_cb done;
+    void *arg;
+
+    if (video_tx.q_in == video_tx.q_out) {
+        return 0;
+    }
+
+    frame = &video_tx.queue[video_tx.q_out & (FRAME_QUEUE_LEN - 1)];
+    chunk = frame->size - video_tx.pos;
+    if (chunk > MAX_PAYLOAD_SIZE - PAYLOAD_HEADER_LEN) {
+        chunk = MAX_PAYLOAD_SIZE - PAYLOAD_HEADER_LEN;
+    }
+
+    buf[0] = PAYLOAD_HEADER_LEN;
+    buf[1] = PAYLOAD_HDR_EOH | video_tx.fid;
+    memcpy(&buf[PAYLOAD_HEADER_LEN], &frame->data[video_tx.pos], chunk);
+    video_tx.pos += chunk;
+
+    if (video_tx.pos >= frame->size) {
+        /* all of the frame is copied out, producer may reuse it */
+        buf[1] |= PAYLOAD_HDR_EOF;
+        video_tx.fid ^= PAYLOAD_HDR_FID;
+        video_tx.pos = 0;
+
+        data = frame->data;
+        done = frame->done;
+        arg = frame->arg;
+        video_tx.q_out++;
+        if (done) {
+            done(data, arg);
         }
-        // dump_mem(packet_buffer, 12);
-        if (tx_flag) {
-            iso_tx_busy = true;
-            do {
-                ret = usbd_ep_start_write(VIDEO_IN_EP, packet_buffer, out_len);
-            } while(ret);
-
-            while (iso_tx_busy) {
-                if (tx_flag == 0) {
-                    break;
-                }
-            }
+    }
+
+    return chunk + PAYLOAD_HEADER_LEN;
+}
+
+static void usbd_video_tx_start(void)
+{
+    uint8_t idx = video_tx.send_idx;
+
+    if (!tx_flag || (video_tx.len[idx] == 0)) {
+        video_tx.busy = false;
+        return;
+    }
+
+    video_tx.busy = true;
+    if (usbd_ep_start_write(VIDEO_IN_EP, packet_buffer[idx], video_tx.len[idx]) < 0) {
+        video_tx.busy = false;
+        return;
+    }
+
+    /* pack the other buffer while this one is on the wire */
+    idx ^= 1;
+    if (video_tx.len[idx] == 0) {
+        video_tx.len[idx] = usbd_video_tx_pack(packet_buffer[idx]);
+    }
+}
+
+/* iso in done: the buffer just sent is free, send the one packed ahead */
+static void usbd_video_tx_next(void)
+{
+    uint8_t idx = video_tx.send_idx;
+
+    video_tx.len[idx] = 0;
+    video_tx.send_idx = idx ^ 1;
+    if (video_tx.len[video_tx.send_idx] == 0) {
+        video_tx.len[video_tx.send_idx] = usbd_video_tx_pack(packet_buffer[video_tx.send_idx]);
+    }
+    usbd_video_tx_start();
+}
+
+static void usbd_video_tx_reset(bool on)
+{
+    size_t flags;
+    struct usbd_video_frame drop[FRAME_QUEUE_LEN];
+    uint32_t cnt = 0, i;
+
+    /* tx_flag and the queue move together, a frame queued just before
+     * close is either refused or handed back here */
+    flags = usb_osal_enter_critical_section();
+    tx_flag = on;
+    video_tx.busy = false;
+    video_tx.len[0] = 0;
+    video_tx.len[1] = 0;
+    video_tx.send_idx = 0;
+    video_tx.pos = 0;
+    while (video_tx.q_in != video_tx.q_out) {
+        drop[cnt++] = video_tx.queue[video_tx.q_out & (FRAME_QUEUE_LEN - 1)];
+        video_tx.q_out++;
+    }
+    usb_osal_leave_critical_section(flags);
+
+    /* host went away, hand the queued frames back */
+    for (i = 0; i < cnt; i++) {
+        if (drop[i].done) {
+            drop[i].done(drop[i].data, drop[i].arg);
+        }
+    }
+}
+
+/*
+ * Queue a frame and return. done(data, arg) runs once the frame is copied
+ * into the payload buffers, from the usb isr; data must stay untouched
+ * until then. returns -1 when the queue is full or no host is streaming.
+ */
+int usbd_video_queue_frame(uint8_t *data, uint32_t size, usbd_video_frame_done_cb done, void *arg)
+{
+    struct usbd_video_frame *frame;
+    size_t flags;
+
+    if (size == 0) {
+        return -1;
+    }
+
+    flags = usb_osal_enter_critical_section();
+    /* checked under the lock, a concurrent close can't drain past this frame */
+    if (!tx_flag || (video_tx.q_in - video_tx.q_out >= FRAME_QUEUE_LEN)) {
+        usb_osal_leave_critical_section(flags);
+        return -1;
+    }
+
+    frame = &video_tx.queue[video_tx.q_in & (FRAME_QUEUE_LEN - 1)];
+    frame->data = data;
+    frame->size = size;
+    frame->done = done;
+    frame->arg = arg;
+    video_tx.q_in++;
+
+    if (!video_tx.busy) {
+        if (video_tx.len[video_tx.send_idx] == 0) {
+            video_tx.len[video_tx.send_idx] = usbd_video_tx_pack(packet_buffer[video_tx.send_idx]);
         }
+        usbd_video_tx_start();
+    }
+    usb_osal_leave_critical_section(flags);
+
+    return 0;
+}
+
+uint32_t usbd_video_frame_queue_free(void)
+{
+    return FRAME_QUEUE_LEN - (video_tx.q_in - video_tx.q_out);
+}
+
+static void usbd_video_frame_sent(uint8_t *data, void *arg)
+{
+    usb_osal_sem_give((usb_osal_sem_t)arg);
+}
+
+/* blocking form of usbd_video_queue_frame, sleeps until the frame is copied out */
+void usbd_video_send_common_frame(uint8_t *data, uint32_t size)
+{
+    static usb_osal_sem_t sent_sem = NULL;
+
+    if (sent_sem == NULL) {
+        sent_sem = usb_osal_sem_create(0);
+        if (sent_sem == NULL) {
+            return;
+        }
+    }
+
+    if (usbd_video_queue_frame(data, size, usbd_video_frame_sent, sent_sem) == 0) {
+        usb_osal_sem_take(sent_sem, USB_OSAL_WAITING_FOREVER);
     }
-    usbd_video_common_update_header_with_new_frame();
 }
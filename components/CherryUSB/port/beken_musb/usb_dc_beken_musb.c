@@ -12,14 +12,25 @@
 #include "intc_pub.h"
 #include "arm_arch.h"
 #include "icu_pub.h"
+#include "usb_dc_beken_musb.h"
+#ifdef CONFIG_USB_MUSB_GDMA
+#include "general_dma_pub.h"
+#endif
 //#include "driver/usb/usb.h"
 
+/* overridable, the host simulation maps them to its registers */
+#ifndef HWREG
 #define HWREG(x) \
     (*((volatile uint32_t *)(x)))
+#endif
+#ifndef HWREGH
 #define HWREGH(x) \
     (*((volatile uint16_t *)(x)))
+#endif
+#ifndef HWREGB
 #define HWREGB(x) \
     (*((volatile uint8_t *)(x)))
+#endif
 
 #ifndef USBD_IRQHandler
 #error "please define USBD_IRQHandler in usb_config.h"
@@ -120,6 +131,29 @@ void USBD_IRQHandler(void);
 static volatile uint8_t usb_ep0_state = USB_EP0_STATE_SETUP;
 volatile bool zlp_flag = 0;
 
+/* [0] out, [1] in; kept over bus resets */
+static struct musb_fifo_stats g_musb_fifo_stats[2][CONFIG_USBDEV_EP_NUM];
+
+#ifdef CONFIG_USB_MUSB_GDMA
+#if CONFIG_USB_MUSB_GDMA_MIN_LEN < 4
+#error "CONFIG_USB_MUSB_GDMA_MIN_LEN must be at least one word"
+#endif
+
+/* one packet on the dma channel at a time, the others go by cpu */
+struct musb_fifo_dma {
+    volatile uint8_t busy;
+    volatile uint8_t off; /* the channel is not ours, all by cpu */
+    uint8_t ep_idx;
+    uint8_t in;
+    uint16_t len;
+    uint8_t *buf; /* caller buffer */
+    uint8_t *mem; /* moved by the dma: buf, or the bounce buffer if buf is unaligned */
+};
+
+static struct musb_fifo_dma g_musb_dma;
+static USB_MEM_ALIGNX uint8_t musb_bounce[CONFIG_USB_MUSB_BOUNCE_SIZE];
+#endif
+
 /* get current active ep */
 static uint8_t musb_get_active_ep(void)
 {
@@ -132,24 +166,25 @@ static void musb_set_active_ep(uint8_t ep_index)
     HWREGB(USB_BASE + MUSB_EPIDX_OFFSET) = ep_index;
 }
 
-/* write @buffer to @ep_idx FIFO */
+/* write @buffer to @ep_idx FIFO, in words also when @buffer is unaligned */
 static void musb_write_packet(uint8_t ep_idx, uint8_t *buffer, uint16_t len)
 {
     uint32_t *buf32;
     uint8_t *buf8;
     uint32_t count32;
     uint32_t count8;
-    int i;
+
+    count32 = len >> 2;
+    count8 = len & 0x03;
 
     if ((uint32_t)buffer & 0x03) {
         buf8 = buffer;
-        for (i = 0; i < len; i++) {
-            HWREGB(USB_FIFO_BASE(ep_idx)) = *buf8++;
+
+        while (count32--) {
+            HWREG(USB_FIFO_BASE(ep_idx)) = buf8[0] | (buf8[1] << 8) | (buf8[2] << 16) | ((uint32_t)buf8[3] << 24);
+            buf8 += 4;
         }
     } else {
-        count32 = len >> 2;
-        count8 = len & 0x03;
-
         buf32 = (uint32_t *)buffer;
 
         while (count32--) {
@@ -157,31 +192,39 @@ static void musb_write_packet(uint8_t ep_idx, uint8_t *buffer, uint16_t len)
         }
 
         buf8 = (uint8_t *)buf32;
+    }
 
-        while (count8--) {
-            HWREGB(USB_FIFO_BASE(ep_idx)) = *buf8++;
-        }
+    while (count8--) {
+        HWREGB(USB_FIFO_BASE(ep_idx)) = *buf8++;
     }
+
+    g_musb_fifo_stats[1][ep_idx].pio_bytes += len;
 }
 
-/* Read @ep_idx FIFO to @buffer */
+/* Read @ep_idx FIFO to @buffer, in words also when @buffer is unaligned */
 static void musb_read_packet(uint8_t ep_idx, uint8_t *buffer, uint16_t len)
 {
     uint32_t *buf32;
     uint8_t *buf8;
     uint32_t count32;
     uint32_t count8;
-    int i;
+    uint32_t word;
+
+    count32 = len >> 2;
+    count8 = len & 0x03;
 
     if ((uint32_t)buffer & 0x03) {
         buf8 = buffer;
-        for (i = 0; i < len; i++) {
-            *buf8++ = HWREGB(USB_FIFO_BASE(ep_idx));
+
+        while (count32--) {
+            word = HWREG(USB_FIFO_BASE(ep_idx));
+            buf8[0] = (uint8_t)word;
+            buf8[1] = (uint8_t)(word >> 8);
+            buf8[2] = (uint8_t)(word >> 16);
+            buf8[3] = (uint8_t)(word >> 24);
+            buf8 += 4;
         }
     } else {
-        count32 = len >> 2;
-        count8 = len & 0x03;
-
         buf32 = (uint32_t *)buffer;
 
         while (count32--) {
@@ -189,11 +232,151 @@ static void musb_read_packet(uint8_t ep_idx, uint8_t *buffer, uint16_t len)
         }
 
         buf8 = (uint8_t *)buf32;
+    }
 
+    while (count8--) {
+        *buf8++ = HWREGB(USB_FIFO_BASE(ep_idx));
+    }
+
+    g_musb_fifo_stats[0][ep_idx].pio_bytes += len;
+}
+
+/* a packet of @ep_idx is in @xfer_buf, the active ep must be @ep_idx */
+static void musb_rx_packet_done(uint8_t ep_idx, uint16_t read_count)
+{
+    g_musb_udc.out_ep[ep_idx].xfer_buf += read_count;
+    g_musb_udc.out_ep[ep_idx].actual_xfer_len += read_count;
+    g_musb_udc.out_ep[ep_idx].xfer_len -= read_count;
+
+    if ((read_count < g_musb_udc.out_ep[ep_idx].ep_mps) || (g_musb_udc.out_ep[ep_idx].xfer_len == 0)) {
+        HWREGB(USB_BASE + MUSB_RXIEL_OFFSET) &= ~(1 << ep_idx);
+        usbd_event_ep_out_complete_handler(ep_idx, g_musb_udc.out_ep[ep_idx].actual_xfer_len);
+    }
+    HWREGB(USB_BASE + MUSB_IND_RXCSRL_OFFSET) &= ~(USB_RXCSRL1_RXRDY);
+}
+
+#ifdef CONFIG_USB_MUSB_GDMA
+/* the words went by dma, the tail bytes and the TXRDY/RXRDY handshake follow here */
+static void musb_dma_done(UINT32 param)
+{
+    struct musb_fifo_dma *dma = &g_musb_dma;
+    struct musb_fifo_stats *stats = &g_musb_fifo_stats[dma->in][dma->ep_idx];
+    uint16_t words = dma->len & ~0x03;
+    uint8_t *tail = dma->mem + words;
+    uint8_t count8 = dma->len & 0x03;
+    uint8_t old_ep_idx;
+
+    /* aborted by a bus reset, or a stale finish status of that one */
+    if (!dma->busy || gdma_fifo_busy(CONFIG_USB_MUSB_GDMA_CHNL)) {
+        return;
+    }
+
+    old_ep_idx = musb_get_active_ep();
+    musb_set_active_ep(dma->ep_idx);
+
+    stats->dma_bytes += words;
+    stats->pio_bytes += count8;
+
+    if (dma->in) {
+        while (count8--) {
+            HWREGB(USB_FIFO_BASE(dma->ep_idx)) = *tail++;
+        }
+        dma->busy = 0;
+        HWREGB(USB_BASE + MUSB_IND_TXCSRL_OFFSET) = USB_TXCSRL1_TXRDY;
+    } else {
         while (count8--) {
-            *buf8++ = HWREGB(USB_FIFO_BASE(ep_idx));
+            *tail++ = HWREGB(USB_FIFO_BASE(dma->ep_idx));
+        }
+        if (dma->mem != dma->buf) {
+            memcpy(dma->buf, dma->mem, dma->len);
+        }
+        dma->busy = 0;
+        musb_rx_packet_done(dma->ep_idx, dma->len);
+    }
+
+    musb_set_active_ep(old_ep_idx);
+}
+
+/* start moving one packet by dma, false: the caller does it by cpu */
+static bool musb_dma_start(uint8_t ep_idx, uint8_t in, uint8_t *buffer, uint16_t len)
+{
+    struct musb_fifo_dma *dma = &g_musb_dma;
+    struct musb_ep_state *ep = in ? &g_musb_udc.in_ep[ep_idx] : &g_musb_udc.out_ep[ep_idx];
+    bool aligned = (((uint32_t)buffer & 0x03) == 0);
+
+    GLOBAL_INT_DECLARATION();
+
+    if ((len < CONFIG_USB_MUSB_GDMA_MIN_LEN) || (!aligned && (len > CONFIG_USB_MUSB_BOUNCE_SIZE))) {
+        return false;
+    }
+    if ((ep->ep_type != USB_ENDPOINT_TYPE_BULK) && (ep->ep_type != USB_ENDPOINT_TYPE_ISOCHRONOUS)) {
+        return false;
+    }
+
+    GLOBAL_INT_DISABLE();
+    if (dma->off) {
+        GLOBAL_INT_RESTORE();
+        return false;
+    }
+    if (dma->busy) {
+        GLOBAL_INT_RESTORE();
+        g_musb_fifo_stats[in][ep_idx].dma_busy++;
+        return false;
+    }
+    dma->busy = 1;
+    GLOBAL_INT_RESTORE();
+
+    dma->ep_idx = ep_idx;
+    dma->in = in;
+    dma->len = len;
+    dma->buf = buffer;
+    dma->mem = aligned ? buffer : musb_bounce;
+
+    if (!aligned) {
+        g_musb_fifo_stats[in][ep_idx].bounce_bytes += len;
+        if (in) {
+            memcpy(musb_bounce, buffer, len);
         }
     }
+
+    if (gdma_fifo_start(CONFIG_USB_MUSB_GDMA_CHNL, (volatile void *)USB_FIFO_BASE(ep_idx), dma->mem, len & ~0x03, in) != GDMA_SUCCESS) {
+        /* a driver took the channel */
+        dma->off = 1;
+        dma->busy = 0;
+        return false;
+    }
+    return true;
+}
+
+/* let a packet in flight finish, its completion is dropped */
+static void musb_dma_abort(void)
+{
+    if (g_musb_dma.busy) {
+        while (gdma_fifo_busy(CONFIG_USB_MUSB_GDMA_CHNL)) {
+        }
+        g_musb_dma.busy = 0;
+    }
+}
+#else
+#define musb_dma_start(ep_idx, in, buffer, len) false
+#define musb_dma_abort()
+#endif
+
+int usbd_musb_get_fifo_stats(uint8_t ep_addr, struct musb_fifo_stats *stats)
+{
+    uint8_t ep_idx = USB_EP_GET_IDX(ep_addr);
+
+    if (ep_idx >= CONFIG_USBDEV_EP_NUM) {
+        return -1;
+    }
+
+    memcpy(stats, &g_musb_fifo_stats[USB_EP_DIR_IS_IN(ep_addr) ? 1 : 0][ep_idx], sizeof(struct musb_fifo_stats));
+    return 0;
+}
+
+void usbd_musb_clear_fifo_stats(void)
+{
+    memset(g_musb_fifo_stats, 0, sizeof(g_musb_fifo_stats));
 }
 
 #ifdef CONFIG_MUSB_DYNFIFO
@@ -314,6 +497,14 @@ int usb_dc_init(void)
     HWREGB(USB_BASE + MUSB_POWER_OFFSET) &= ~USB_POWER_HSENAB;
 #endif
 
+#ifdef CONFIG_USB_MUSB_GDMA
+    g_musb_dma.busy = 0;
+    g_musb_dma.off = (gdma_fifo_init(CONFIG_USB_MUSB_GDMA_CHNL, musb_dma_done) != GDMA_SUCCESS);
+    if (g_musb_dma.off) {
+        USB_LOG_WRN("gdma chnl %d in use, fifo by cpu\r\n", CONFIG_USB_MUSB_GDMA_CHNL);
+    }
+#endif
+
     musb_set_active_ep(0);
     HWREGB(USB_BASE + MUSB_FADDR_OFFSET) = 0;
 
@@ -330,6 +521,10 @@ int usb_dc_init(void)
 
 int usb_dc_deinit(void)
 {
+#ifdef CONFIG_USB_MUSB_GDMA
+    musb_dma_abort();
+    gdma_fifo_deinit(CONFIG_USB_MUSB_GDMA_CHNL);
+#endif
     usb_dc_low_level_deinit();
     return 0;
 }
@@ -750,8 +945,14 @@ int usbd_ep_start_write(const uint8_t ep, const uint8_t *data, uint32_t data_len
     }
     data_len = MIN(data_len, g_musb_udc.in_ep[ep_idx].ep_mps);
 
-    musb_write_packet(ep_idx, (uint8_t *)data, data_len);
     HWREGB(USB_BASE + MUSB_TXIEL_OFFSET) |= (1 << ep_idx);
+    /* TXRDY is set by the dma completion */
+    if ((ep_idx != 0x00) && musb_dma_start(ep_idx, 1, (uint8_t *)data, data_len)) {
+        musb_set_active_ep(old_ep_idx);
+        return 0;
+    }
+
+    musb_write_packet(ep_idx, (uint8_t *)data, data_len);
 
     if (ep_idx == 0x00) {
         usb_ep0_state = USB_EP0_STATE_IN_DATA;
@@ -946,6 +1147,7 @@ void USBD_IRQHandler(void)
 
     /* Receive a reset signal from the USB bus */
     if (is & USB_IS_RESET) {
+        musb_dma_abort();
         memset(&g_musb_udc, 0, sizeof(struct musb_udc));
         g_musb_udc.fifo_size_offset = USB_CTRL_EP_MPS;
         usbd_event_reset_handler();
@@ -1003,8 +1205,10 @@ void USBD_IRQHandler(void)
             } else {
                 write_count = MIN(g_musb_udc.in_ep[ep_idx].xfer_len, g_musb_udc.in_ep[ep_idx].ep_mps);
 
-                musb_write_packet(ep_idx, g_musb_udc.in_ep[ep_idx].xfer_buf, write_count);
-                HWREGB(USB_BASE + MUSB_IND_TXCSRL_OFFSET) = USB_TXCSRL1_TXRDY;
+                if (!musb_dma_start(ep_idx, 1, g_musb_udc.in_ep[ep_idx].xfer_buf, write_count)) {
+                    musb_write_packet(ep_idx, g_musb_udc.in_ep[ep_idx].xfer_buf, write_count);
+                    HWREGB(USB_BASE + MUSB_IND_TXCSRL_OFFSET) = USB_TXCSRL1_TXRDY;
+                }
             }
 
             txis &= ~(1 << ep_idx);
@@ -1021,18 +1225,11 @@ void USBD_IRQHandler(void)
             if (HWREGB(USB_BASE + MUSB_IND_RXCSRL_OFFSET) & USB_RXCSRL1_RXRDY) {
                 read_count = HWREGH(USB_BASE + MUSB_IND_RXCOUNT_OFFSET);
 
-                musb_read_packet(ep_idx, g_musb_udc.out_ep[ep_idx].xfer_buf, read_count);
-
-                g_musb_udc.out_ep[ep_idx].xfer_buf += read_count;
-                g_musb_udc.out_ep[ep_idx].actual_xfer_len += read_count;
-                g_musb_udc.out_ep[ep_idx].xfer_len -= read_count;
-
-                if ((read_count < g_musb_udc.out_ep[ep_idx].ep_mps) || (g_musb_udc.out_ep[ep_idx].xfer_len == 0)) {
-                    HWREGB(USB_BASE + MUSB_RXIEL_OFFSET) &= ~(1 << ep_idx);
-                    usbd_event_ep_out_complete_handler(ep_idx, g_musb_udc.out_ep[ep_idx].actual_xfer_len);
-                } else {
+                /* RXRDY stays set until the dma completion */
+                if (!musb_dma_start(ep_idx, 0, g_musb_udc.out_ep[ep_idx].xfer_buf, read_count)) {
+                    musb_read_packet(ep_idx, g_musb_udc.out_ep[ep_idx].xfer_buf, read_count);
+                    musb_rx_packet_done(ep_idx, read_count);
                 }
-                HWREGB(USB_BASE + MUSB_IND_RXCSRL_OFFSET) &= ~(USB_RXCSRL1_RXRDY);
             }
 
             rxis &= ~(1 << ep_idx);
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2022, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef USB_DC_BEKEN_MUSB_H
+#define USB_DC_BEKEN_MUSB_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* fifo traffic of one endpoint direction */
+struct musb_fifo_stats {
+    uint32_t pio_bytes;    /* moved by cpu loops */
+    uint32_t dma_bytes;    /* moved by the gdma channel */
+    uint32_t bounce_bytes; /* dma packets staged through the aligned bounce buffer */
+    uint32_t dma_busy;     /* packets sent by cpu because the channel was taken */
+};
+
+int usbd_musb_get_fifo_stats(uint8_t ep_addr, struct musb_fifo_stats *stats);
+void usbd_musb_clear_fifo_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_DC_BEKEN_MUSB_H */
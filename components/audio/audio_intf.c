@@ -146,8 +146,6 @@ DD_HANDLE aud_adc_hdl = DD_HANDLE_UNVALID;
 #define AUD_ADC_BUF_LEN            (3 * 1024)
 UINT8 audio_adc_buf[AUD_ADC_BUF_LEN];
 
-#define AUD_ADC_DATA_LEN        (2 * 1024)
-UINT8 adc_data[AUD_ADC_DATA_LEN];
 
 #define ADC_TIMER_INTVAL           (4)
 beken_timer_t audio_adc_get_timer;
@@ -157,21 +155,24 @@ beken_timer_t audio_adc_linein_timer;
 
 static void audio_intf_adc_timer_poll(void)
 {   
-    UINT32 mic_filled_len, audio_free_len, copy_len;
+    UINT32 mic_filled_len, audio_free_len, copy_len, first;
+    RB_SPAN_ST mic;
 
     audio_free_len = ddev_control(aud_dac_hdl, AUD_DAC_CMD_GET_FREE_BUF_SIZE, NULL);
-    mic_filled_len = ddev_control(aud_adc_hdl, AUD_ADC_CMD_GET_FILL_BUF_SIZE, NULL);
+    mic_filled_len = ddev_control(aud_adc_hdl, AUD_ADC_CMD_PEEK, &mic);
 
     copy_len = (audio_free_len > mic_filled_len)? mic_filled_len : audio_free_len;
 
     if(copy_len) 
     {
-        if(copy_len >  AUD_ADC_DATA_LEN) {
-            copy_len = AUD_ADC_DATA_LEN;
-            
+        // straight from the adc ring into the dac ring
+        first = (copy_len > mic.len[0]) ? mic.len[0] : copy_len;
+        ddev_write(aud_dac_hdl, (char *)mic.addr[0], first, 0);
+        if(copy_len > first)
+        {
+            ddev_write(aud_dac_hdl, (char *)mic.addr[1], copy_len - first, 0);
         }
-        ddev_read(aud_adc_hdl, (char *)adc_data, copy_len, 0);
-        ddev_write(aud_dac_hdl, (char *)adc_data, copy_len, 0);
+        ddev_control(aud_adc_hdl, AUD_ADC_CMD_CONSUME, &copy_len);
     }
 
     //AUD_INTF_PRT("%d\r\n", copy_len);
@@ -593,9 +593,40 @@ UINT32 camera_intfer_set_video_param(UINT32 ppi_type, UINT32 pfs_type)
     {
         camera_inf_cfg_gc0328c_fps(pfs_type);
     }
-    #endif
     return 0;
+    #else
+    return 1;
+    #endif
+
+}
+
+UINT32 camera_intfer_get_frame_size(void)
+{
+    if (ejpeg_hdl == DD_HANDLE_UNVALID)
+    {
+        return 0;
+    }
+
+    return ddev_control(ejpeg_hdl, EJPEG_CMD_GET_TARGET_HIGH_BYTE, NULL);
+}
+
+// encoder steps its quality to keep the jpeg size between low and high
+UINT32 camera_intfer_set_frame_size(UINT32 high, UINT32 low)
+{
+    UINT32 param;
 
+    if (ejpeg_hdl == DD_HANDLE_UNVALID)
+    {
+        return 1;
+    }
+
+    ddev_control(ejpeg_hdl, EJPEG_CMD_SET_TARGET_HIGH_BYTE, &high);
+    ddev_control(ejpeg_hdl, EJPEG_CMD_SET_TARGET_LOW_BYTE, &low);
+
+    param = 1;
+    ddev_control(ejpeg_hdl, EJPEG_CMD_ENABLE_BITRATE_CTRL, &param);
+
+    return 0;
 }
 /*---------------------------------------------------------------------------*/
 
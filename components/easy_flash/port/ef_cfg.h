@@ -37,6 +37,15 @@
 /* using power fail safeguard mode for ENV */
 #define EF_ENV_USING_PFS_MODE
 
+/* hash index slots over the ENV ram cache, must be a power of 2. 0 is a linear search */
+#define EF_ENV_INDEX_SIZE              64
+
+/* only append the changed ENV behind the saved ENV, rewrite all when the sector is full */
+#define EF_ENV_USING_INCR_SAVE
+
+/* ram buffer for the ENV changes since the last save */
+#define EF_ENV_INCR_BUF_SIZE           256
+
 /* using IAP function */
 //#define EF_USING_IAP
 
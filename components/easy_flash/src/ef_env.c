@@ -64,6 +64,26 @@ enum {
     ENV_PARAM_BYTE_SIZE = ENV_PARAM_WORD_SIZE * 4,
 };
 
+#ifdef EF_ENV_USING_INCR_SAVE
+/**
+ * The changed ENV are appended as records behind the ENV user setting size, in the
+ * erase sectors of the current ENV area. The whole ENV is only saved again when no
+ * room is left, which also erases the records.
+ * Record: header word (magic and data length), data CRC32 word, data is the changes
+ * of one save, each "key=value\0" filled with '\0' for word alignment. An empty value
+ * deletes the ENV. A save is one record, so it is applied whole or not at all.
+ * An area written without records is erased behind the ENV, it loads as it is.
+ */
+#ifndef EF_ENV_USING_PFS_MODE
+#define ENV_INCR_AREA_SIZE             ENV_AREA_SIZE
+#else
+#define ENV_INCR_AREA_SIZE             (ENV_AREA_SIZE / 2)
+#endif
+#define ENV_INCR_MAGIC                 0xE5000000
+#define ENV_INCR_MAGIC_MASK            0xFF000000
+#define ENV_INCR_HDR_SIZE              8
+#endif
+
 /* default ENV set, must be initialized by user */
 static ef_env const *default_env_set;
 /* default ENV set size, must be initialized by user */
@@ -84,6 +104,28 @@ static uint32_t cur_load_area_addr = 0;
 static uint32_t next_save_area_addr = 0;
 #endif
 
+#if EF_ENV_INDEX_SIZE
+/* ENV byte offset in ram cache of each index slot, 0 is an empty slot */
+static uint16_t env_index_off[EF_ENV_INDEX_SIZE] = { 0 };
+/* low 16 bits of the key hash, it also gives the home slot */
+static uint16_t env_index_tag[EF_ENV_INDEX_SIZE] = { 0 };
+/* ENV count in the index */
+static size_t env_index_cnt = 0;
+/* index is too full for all ENV, find_env is a linear search then */
+static bool env_index_ok = false;
+#endif
+
+#ifdef EF_ENV_USING_INCR_SAVE
+/* record of the ENV changes since the last save, header is set when it is appended */
+static uint32_t env_incr_buf[EF_ENV_INCR_BUF_SIZE / 4] = { 0 };
+/* data bytes in the record */
+static size_t env_incr_len = 0;
+/* next record address in flash */
+static uint32_t env_incr_addr = 0;
+/* changes can't be appended, the next save will rewrite the whole ENV */
+static bool env_incr_full = true;
+#endif
+
 static uint32_t get_env_system_addr(void);
 static uint32_t get_env_data_addr(void);
 static uint32_t get_env_end_addr(void);
@@ -96,6 +138,18 @@ static size_t get_env_user_used_size(void);
 static EfErrCode create_env(const char *key, const char *value);
 static uint32_t calc_env_crc(void);
 static bool env_crc_is_ok(void);
+static EfErrCode set_env(const char *key, const char *value, bool *changed);
+#if EF_ENV_INDEX_SIZE
+static void env_index_build(void);
+static void env_index_add(const char *env);
+static void env_index_del(uint16_t env_off, size_t env_len);
+#endif
+#ifdef EF_ENV_USING_INCR_SAVE
+static void env_incr_reset(void);
+static void env_incr_add(const char *key, const char *value);
+static EfErrCode env_incr_save(void);
+static void env_incr_load(void);
+#endif
 
 /**
  * Flash ENV initialize.
@@ -175,11 +229,20 @@ EfErrCode ef_env_set_default(void){
     env_cache[ENV_PARAM_INDEX_SAVED_COUNT] = 0;
 #endif
 
+#if EF_ENV_INDEX_SIZE
+    env_index_build();
+#endif
+
     /* create default ENV */
     for (i = 0; i < default_env_set_size; i++) {
         create_env(default_env_set[i].key, default_env_set[i].value);
     }
 
+#ifdef EF_ENV_USING_INCR_SAVE
+    /* the whole ENV has changed */
+    env_incr_full = true;
+#endif
+
     /* unlock the ENV cache */
     ef_port_env_unlock();
 
@@ -290,7 +353,7 @@ size_t ef_get_env_write_bytes(void) {
 static EfErrCode write_env(const char *key, const char *value) {
     EfErrCode result = EF_NO_ERR;
     size_t key_len = strlen(key), value_len = strlen(value), env_str_len;
-    char *env_cache_bak = (char *)env_cache;
+    char *env_cache_bak = (char *)env_cache, *env_start;
 
     /* calculate ENV storage length, contain '=' and '\0'. */
     env_str_len = key_len + value_len + 2;
@@ -304,6 +367,7 @@ static EfErrCode write_env(const char *key, const char *value) {
 
     /* calculate current ENV ram cache end address */
     env_cache_bak += get_env_user_used_size();
+    env_start = env_cache_bak;
 
     /* copy key name */
     memcpy(env_cache_bak, key, key_len);
@@ -320,12 +384,112 @@ static EfErrCode write_env(const char *key, const char *value) {
     /* fill '\0' for word alignment */
     memset(env_cache_bak, 0, env_str_len - (key_len + value_len + 2));
     set_env_end_addr(get_env_end_addr() + env_str_len);
+#if EF_ENV_INDEX_SIZE
+    env_index_add(env_start);
+#endif
     /* ENV ram cache has changed */
     env_cache_changed = true;
 
     return result;
 }
 
+#if EF_ENV_INDEX_SIZE
+/**
+ * Calculate the key hash of an ENV name or of an ENV in ram cache.
+ *
+ * @param key ENV name, it ends with '\0' or '='
+ * @param key_len key length
+ *
+ * @return FNV-1a hash
+ */
+static uint32_t calc_key_hash(const char *key, size_t *key_len) {
+    uint32_t hash = 2166136261u;
+    const char *p = key;
+
+    while (*p && (*p != '=')) {
+        hash = (hash ^ (uint8_t) *p) * 16777619u;
+        p++;
+    }
+    *key_len = p - key;
+
+    return hash;
+}
+
+/**
+ * Add an ENV in ram cache to the index.
+ *
+ * @param env ENV in ram cache
+ */
+static void env_index_add(const char *env) {
+    size_t key_len, i;
+    uint16_t tag = calc_key_hash(env, &key_len);
+
+    /* keep some slots empty, it ends the search */
+    if (env_index_cnt + 1 > EF_ENV_INDEX_SIZE * 3 / 4) {
+        env_index_ok = false;
+        return;
+    }
+
+    for (i = tag & (EF_ENV_INDEX_SIZE - 1); env_index_off[i]; i = (i + 1) & (EF_ENV_INDEX_SIZE - 1));
+    env_index_off[i] = env - (char *) env_cache;
+    env_index_tag[i] = tag;
+    env_index_cnt++;
+}
+
+/**
+ * Remove a deleted ENV from the index. The ENV behind it have moved forward.
+ *
+ * @param env_off deleted ENV offset in ram cache
+ * @param env_len deleted ENV length
+ */
+static void env_index_del(uint16_t env_off, size_t env_len) {
+    size_t i, j, home;
+
+    for (i = 0; (i < EF_ENV_INDEX_SIZE) && (env_index_off[i] != env_off); i++);
+    if (i == EF_ENV_INDEX_SIZE) {
+        return;
+    }
+
+    /* move back the following slots which can't be found behind an empty slot */
+    for (j = (i + 1) & (EF_ENV_INDEX_SIZE - 1); env_index_off[j]; j = (j + 1) & (EF_ENV_INDEX_SIZE - 1)) {
+        home = env_index_tag[j] & (EF_ENV_INDEX_SIZE - 1);
+        if (((j - home) & (EF_ENV_INDEX_SIZE - 1)) >= ((j - i) & (EF_ENV_INDEX_SIZE - 1))) {
+            env_index_off[i] = env_index_off[j];
+            env_index_tag[i] = env_index_tag[j];
+            i = j;
+        }
+    }
+    env_index_off[i] = 0;
+    env_index_cnt--;
+
+    for (i = 0; i < EF_ENV_INDEX_SIZE; i++) {
+        if (env_index_off[i] > env_off) {
+            env_index_off[i] -= env_len;
+        }
+    }
+}
+
+/**
+ * Rebuild the index from the ENV ram cache.
+ */
+static void env_index_build(void) {
+    char *env = (char *) env_cache + ENV_PARAM_BYTE_SIZE;
+    char *env_end = (char *) env_cache + get_env_user_used_size();
+    size_t env_len;
+
+    memset(env_index_off, 0, sizeof(env_index_off));
+    env_index_cnt = 0;
+    env_index_ok = true;
+
+    while ((env < env_end) && env_index_ok) {
+        env_index_add(env);
+        /* next ENV and word alignment, contain '\0' */
+        env_len = strlen(env) + 1;
+        env += (env_len + 3) / 4 * 4;
+    }
+}
+#endif /* EF_ENV_INDEX_SIZE */
+
 /**
  * Find ENV.
  *
@@ -342,6 +506,25 @@ static char *find_env(const char *key) {
         return NULL;
     }
 
+#if EF_ENV_INDEX_SIZE
+    if (env_index_ok) {
+        uint16_t tag = calc_key_hash(key, &key_len);
+        size_t i;
+
+        /* the key can't contain '=' */
+        if (key[key_len] != '\0') {
+            return NULL;
+        }
+        for (i = tag & (EF_ENV_INDEX_SIZE - 1); env_index_off[i]; i = (i + 1) & (EF_ENV_INDEX_SIZE - 1)) {
+            env = (char *) env_cache + env_index_off[i];
+            if ((env_index_tag[i] == tag) && !strncmp(env, key, key_len) && (env[key_len] == '=')) {
+                return env;
+            }
+        }
+        return NULL;
+    }
+#endif
+
     /* from data section start to data section end */
     env_start = (char *) ((char *) env_cache + ENV_PARAM_BYTE_SIZE);
     env_end = (char *) ((char *) env_cache + get_env_user_used_size());
@@ -449,9 +632,17 @@ static EfErrCode del_env(const char *key){
     remain_env_length = get_env_data_size()
             - (((uint32_t) del_env + del_env_length) - ((uint32_t) env_cache + ENV_PARAM_BYTE_SIZE));
     /* remain ENV move forward */
-    memcpy(del_env, del_env + del_env_length, remain_env_length);
+    memmove(del_env, del_env + del_env_length, remain_env_length);
     /* reset ENV end address */
     set_env_end_addr(get_env_end_addr() - del_env_length);
+#if EF_ENV_INDEX_SIZE
+    if (env_index_ok) {
+        env_index_del(del_env - (char *) env_cache, del_env_length);
+    } else {
+        /* it may fit again */
+        env_index_build();
+    }
+#endif
     /* ENV ram cache has changed */
     env_cache_changed = true;
 
@@ -459,29 +650,23 @@ static EfErrCode del_env(const char *key){
 }
 
 /**
- * Set an ENV. If it value is empty, delete it.
+ * Set an ENV in ram cache. If it value is empty, delete it.
  * If not find it in ENV table, then create it.
  *
  * @param key ENV name
  * @param value ENV value
+ * @param changed it will be true when the ENV ram cache has changed
  *
  * @return result
  */
-EfErrCode ef_set_env(const char *key, const char *value) {
+static EfErrCode set_env(const char *key, const char *value, bool *changed) {
     EfErrCode result = EF_NO_ERR;
     char *old_env, *old_value;
 
-    if(!init_ok) {
-        EF_INFO("ENV isn't initialize OK.\n");
-        return EF_ENV_INIT_FAILED;
-    }
-
-    /* lock the ENV cache */
-    ef_port_env_lock();
-
     /* if ENV value is empty, delete it */
     if ((value == NULL) || (*value == 0)) {
         result = del_env(key);
+        *changed = (result == EF_NO_ERR);
     } else {
         old_env = find_env(key);
         /* If find this ENV, then compare the new value and old value. */
@@ -495,11 +680,50 @@ EfErrCode ef_set_env(const char *key, const char *value) {
                 if (result == EF_NO_ERR) {
                     result = create_env(key, value);
                 }
+                *changed = true;
             }
         } else {
             result = create_env(key, value);
+            *changed = (result == EF_NO_ERR);
         }
     }
+
+    return result;
+}
+
+/**
+ * Set an ENV. If it value is empty, delete it.
+ * If not find it in ENV table, then create it.
+ *
+ * @param key ENV name
+ * @param value ENV value
+ *
+ * @return result
+ */
+EfErrCode ef_set_env(const char *key, const char *value) {
+    EfErrCode result = EF_NO_ERR;
+    bool changed = false;
+
+    if(!init_ok) {
+        EF_INFO("ENV isn't initialize OK.\n");
+        return EF_ENV_INIT_FAILED;
+    }
+
+    /* lock the ENV cache */
+    ef_port_env_lock();
+
+    result = set_env(key, value, &changed);
+#ifdef EF_ENV_USING_INCR_SAVE
+    if (changed) {
+        if (result == EF_NO_ERR) {
+            env_incr_add(key, value);
+        } else {
+            /* the old value is already deleted */
+            env_incr_add(key, NULL);
+        }
+    }
+#endif
+
     /* unlock the ENV cache */
     ef_port_env_unlock();
 
@@ -569,6 +793,11 @@ void ef_print_env(void) {
             ENV_AREA_SIZE, env_cache[ENV_PARAM_INDEX_SAVED_COUNT]);
 
 #endif
+
+#ifdef EF_ENV_USING_INCR_SAVE
+    ef_print("ENV records: %ld/%ld bytes.\n", env_incr_addr - get_env_system_addr() - ENV_USER_SETTING_SIZE,
+            ENV_INCR_AREA_SIZE - ENV_USER_SETTING_SIZE);
+#endif
 }
 
 /**
@@ -603,6 +832,16 @@ EfErrCode ef_load_env(void) {
             result = ef_env_set_default();
         }
     }
+
+#if EF_ENV_INDEX_SIZE
+    env_index_build();
+#endif
+#ifdef EF_ENV_USING_INCR_SAVE
+    if (result == EF_NO_ERR) {
+        env_incr_load();
+    }
+#endif
+
     return result;
 }
 #else
@@ -679,10 +918,153 @@ EfErrCode ef_load_env(void) {
         /* set the ENV to default */
         result = ef_env_set_default();
     }
+
+#if EF_ENV_INDEX_SIZE
+    env_index_build();
+#endif
+#ifdef EF_ENV_USING_INCR_SAVE
+    if (result == EF_NO_ERR) {
+        env_incr_load();
+    }
+#endif
+
     return result;
 }
 #endif
 
+#ifdef EF_ENV_USING_INCR_SAVE
+/**
+ * The records start behind the ENV of the current area.
+ */
+static void env_incr_reset(void) {
+    env_incr_addr = get_env_system_addr() + ENV_USER_SETTING_SIZE;
+    env_incr_len = 0;
+    env_incr_full = false;
+}
+
+/**
+ * Add an ENV change to the changes buffer.
+ *
+ * @param key ENV name
+ * @param value ENV value, NULL or empty when it is deleted
+ */
+static void env_incr_add(const char *key, const char *value) {
+    size_t key_len = strlen(key), value_len = value ? strlen(value) : 0, data_len;
+    char *data;
+
+    /* contain '=' and '\0' */
+    data_len = (key_len + value_len + 2 + 3) / 4 * 4;
+    if (env_incr_full || (ENV_INCR_HDR_SIZE + env_incr_len + data_len > EF_ENV_INCR_BUF_SIZE)) {
+        env_incr_full = true;
+        return;
+    }
+
+    data = (char *) env_incr_buf + ENV_INCR_HDR_SIZE + env_incr_len;
+    memset(data, 0, data_len);
+    memcpy(data, key, key_len);
+    data[key_len] = '=';
+    if (value_len) {
+        memcpy(data + key_len + 1, value, value_len);
+    }
+    env_incr_len += data_len;
+}
+
+/**
+ * Append the changes buffer to flash.
+ *
+ * @return result, the whole ENV must be saved when it isn't EF_NO_ERR
+ */
+static EfErrCode env_incr_save(void) {
+    uint32_t buf[8], addr, end_addr = env_incr_addr + ENV_INCR_HDR_SIZE + env_incr_len;
+    size_t size, i;
+
+    if (env_incr_full || (env_incr_len == 0)
+            || (end_addr > get_env_system_addr() + ENV_INCR_AREA_SIZE)) {
+        return EF_ENV_FULL;
+    }
+
+    /* a write cut by power fail may have left programmed bits behind the last record */
+    for (addr = env_incr_addr; addr < end_addr; addr += size) {
+        size = end_addr - addr < sizeof(buf) ? end_addr - addr : sizeof(buf);
+        ef_port_read(addr, buf, size);
+        for (i = 0; i < size / 4; i++) {
+            if (buf[i] != 0xFFFFFFFF) {
+                return EF_ENV_FULL;
+            }
+        }
+    }
+
+    env_incr_buf[0] = ENV_INCR_MAGIC | env_incr_len;
+    env_incr_buf[1] = ef_calc_crc32(0, (char *) env_incr_buf + ENV_INCR_HDR_SIZE, env_incr_len);
+    if (ef_port_write(env_incr_addr, env_incr_buf, ENV_INCR_HDR_SIZE + env_incr_len) != EF_NO_ERR) {
+        env_incr_full = true;
+        return EF_WRITE_ERR;
+    }
+    EF_INFO("Appended %ld bytes ENV changes at 0x%08X.\n", env_incr_len, env_incr_addr);
+
+    env_incr_addr = end_addr;
+    env_incr_len = 0;
+
+    return EF_NO_ERR;
+}
+
+/**
+ * Apply the records behind the loaded ENV to the ram cache.
+ */
+static void env_incr_load(void) {
+    uint32_t end_addr, hdr[2], data_len;
+    char *data = (char *) env_incr_buf, *env, *value;
+    size_t env_len;
+    bool changed;
+
+    env_incr_reset();
+    end_addr = get_env_system_addr() + ENV_INCR_AREA_SIZE;
+
+    while (env_incr_addr + ENV_INCR_HDR_SIZE <= end_addr) {
+        ef_port_read(env_incr_addr, hdr, ENV_INCR_HDR_SIZE);
+        /* erased, no more records */
+        if (hdr[0] == 0xFFFFFFFF) {
+            break;
+        }
+
+        data_len = hdr[0] & ~ENV_INCR_MAGIC_MASK;
+        if (((hdr[0] & ENV_INCR_MAGIC_MASK) != ENV_INCR_MAGIC) || (data_len == 0) || (data_len % 4 != 0)
+                || (data_len > EF_ENV_INCR_BUF_SIZE - ENV_INCR_HDR_SIZE)
+                || (env_incr_addr + ENV_INCR_HDR_SIZE + data_len > end_addr)) {
+            env_incr_full = true;
+            break;
+        }
+        ef_port_read(env_incr_addr + ENV_INCR_HDR_SIZE, env_incr_buf, data_len);
+        /* a record cut by power fail, the changes behind it can't be appended anymore */
+        if (ef_calc_crc32(0, data, data_len) != hdr[1]) {
+            EF_INFO("Warning: ENV record at 0x%08X is broken.\n", env_incr_addr);
+            env_incr_full = true;
+            break;
+        }
+
+        data[data_len - 1] = '\0';
+        for (env = data; env < data + data_len; env += env_len) {
+            /* contain '\0' and word alignment */
+            env_len = (strlen(env) + 1 + 3) / 4 * 4;
+            value = strchr(env, '=');
+            if (value) {
+                *value++ = '\0';
+                changed = false;
+                if (set_env(env, value, &changed) != EF_NO_ERR) {
+                    EF_INFO("Warning: ENV record of \"%s\" can't be applied.\n", env);
+                }
+            }
+        }
+        env_incr_addr += ENV_INCR_HDR_SIZE + data_len;
+    }
+
+    /* it was the read buffer */
+    env_incr_len = 0;
+    /* ram cache is the same as flash again */
+    env_cache_changed = false;
+}
+#endif /* EF_ENV_USING_INCR_SAVE */
+
 /**
  * Save ENV to flash.
  */
@@ -695,6 +1077,14 @@ EfErrCode ef_save_env(void) {
         return result;
     }
 
+#ifdef EF_ENV_USING_INCR_SAVE
+    /* only append the changes when there is room, or rewrite the whole ENV */
+    if (env_incr_save() == EF_NO_ERR) {
+        env_cache_changed = false;
+        return result;
+    }
+#endif
+
 #ifndef EF_ENV_USING_PFS_MODE
     write_addr = get_env_system_addr();
     write_size = get_env_user_used_size();
@@ -715,7 +1105,12 @@ EfErrCode ef_save_env(void) {
 #endif
 
     /* erase ENV */
+#ifndef EF_ENV_USING_INCR_SAVE
     result = ef_port_erase(write_addr, write_size);
+#else
+    /* the appended records too */
+    result = ef_port_erase(write_addr, ENV_INCR_AREA_SIZE);
+#endif
     switch (result) {
     case EF_NO_ERR: {
         EF_INFO("Erased ENV OK.\n");
@@ -723,6 +1118,10 @@ EfErrCode ef_save_env(void) {
     }
     case EF_ERASE_ERR: {
         EF_INFO("Error: Erased ENV fault! Start address is 0x%08X, size is %ld.\n", write_addr, write_size);
+#ifdef EF_ENV_USING_INCR_SAVE
+        /* the records belong to the area before */
+        env_incr_full = true;
+#endif
         /* will return when erase fault */
         return result;
     }
@@ -747,6 +1146,14 @@ EfErrCode ef_save_env(void) {
 
     env_cache_changed = false;
 
+#ifdef EF_ENV_USING_INCR_SAVE
+    if (result == EF_NO_ERR) {
+        env_incr_reset();
+    } else {
+        env_incr_full = true;
+    }
+#endif
+
     return result;
 }
 
@@ -0,0 +1,306 @@
+#include "include.h"
+#include "disk_cache.h"
+#include "mem_pub.h"
+
+#if CFG_FATFS_CACHE_SECTORS
+/*
+ * LRU write-back cache of single sectors, which is what fatfs moves for the
+ * FAT, directories and partial file sectors. Multi sector transfers are file
+ * data and go to the device directly, kept coherent with the cached copies.
+ * Dirty sectors are written on eviction and disk_cache_flush (CTRL_SYNC),
+ * contiguous ones as one multi block write. Callers are serialised by fatfs.
+ */
+typedef struct disk_cache_ent_st
+{
+    uint32 sector;
+    uint32 stamp;                   // last use, smallest is evicted
+    uint8 pdrv;
+    uint8 valid;
+    uint8 dirty;
+} DISK_CACHE_ENT_ST;
+
+typedef struct disk_cache_st
+{
+    DISK_CACHE_ENT_ST ent[CFG_FATFS_CACHE_SECTORS];
+    uint32 stamp;
+    const DISK_CACHE_OPS_ST *ops;
+    DISK_CACHE_STATS_ST stats;
+} DISK_CACHE_ST;
+
+static DISK_CACHE_ST disk_cache;
+static uint32 disk_cache_buf[CFG_FATFS_CACHE_SECTORS][DISK_CACHE_SECTOR_SIZE / 4];
+
+#define DISK_CACHE_BUF(e)           ((uint8 *)disk_cache_buf[(e) - disk_cache.ent])
+
+static DISK_CACHE_ENT_ST *disk_cache_find(uint8 pdrv, uint32 sector)
+{
+    DISK_CACHE_ENT_ST *e;
+
+    for(e = disk_cache.ent; e < &disk_cache.ent[CFG_FATFS_CACHE_SECTORS]; e++)
+    {
+        if(e->valid && (e->sector == sector) && (e->pdrv == pdrv))
+        {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+static DISK_CACHE_ENT_ST *disk_cache_dirty(uint8 pdrv, uint32 sector)
+{
+    DISK_CACHE_ENT_ST *e = disk_cache_find(pdrv, sector);
+
+    return (e && e->dirty) ? e : NULL;
+}
+
+static void disk_cache_touch(DISK_CACHE_ENT_ST *e)
+{
+    e->stamp = ++disk_cache.stamp;
+}
+
+// write the run of dirty sectors around e, one device call if memory allows
+static int disk_cache_write_run(DISK_CACHE_ENT_ST *e)
+{
+    DISK_CACHE_ENT_ST *run;
+    uint32 first = e->sector;
+    uint32 count = 1;
+    uint32 i;
+    uint8 *buf;
+    int ret = 0;
+
+    while(first && disk_cache_dirty(e->pdrv, first - 1))
+    {
+        first--;
+        count++;
+    }
+    while(disk_cache_dirty(e->pdrv, first + count))
+    {
+        count++;
+    }
+
+    buf = (count > 1) ? (uint8 *)os_malloc(count * DISK_CACHE_SECTOR_SIZE) : NULL;
+    if(buf)
+    {
+        for(i = 0; i < count; i++)
+        {
+            run = disk_cache_find(e->pdrv, first + i);
+            os_memcpy(buf + i * DISK_CACHE_SECTOR_SIZE, DISK_CACHE_BUF(run), DISK_CACHE_SECTOR_SIZE);
+        }
+
+        disk_cache.stats.dev_write++;
+        ret = disk_cache.ops->write(e->pdrv, buf, first, count);
+        os_free(buf);
+
+        for(i = 0; (i < count) && (0 == ret); i++)
+        {
+            disk_cache_find(e->pdrv, first + i)->dirty = 0;
+        }
+    }
+    else
+    {
+        // a sector at a time
+        for(i = 0; (i < count) && (0 == ret); i++)
+        {
+            run = disk_cache_find(e->pdrv, first + i);
+            disk_cache.stats.dev_write++;
+            ret = disk_cache.ops->write(e->pdrv, DISK_CACHE_BUF(run), first + i, 1);
+            if(0 == ret)
+            {
+                run->dirty = 0;
+            }
+        }
+    }
+
+    if(0 == ret)
+    {
+        disk_cache.stats.writeback += count;
+    }
+
+    return ret;
+}
+
+// a free or the least recently used entry, written back if dirty
+static DISK_CACHE_ENT_ST *disk_cache_evict(void)
+{
+    DISK_CACHE_ENT_ST *e, *victim = NULL;
+
+    for(e = disk_cache.ent; e < &disk_cache.ent[CFG_FATFS_CACHE_SECTORS]; e++)
+    {
+        if(!e->valid)
+        {
+            return e;
+        }
+        if((NULL == victim) || ((int32)(e->stamp - victim->stamp) < 0))
+        {
+            victim = e;
+        }
+    }
+
+    if(victim->dirty && disk_cache_write_run(victim))
+    {
+        return NULL;
+    }
+    victim->valid = 0;
+
+    return victim;
+}
+
+void disk_cache_init(const DISK_CACHE_OPS_ST *ops)
+{
+    os_memset(&disk_cache, 0, sizeof(disk_cache));
+    disk_cache.ops = ops;
+}
+
+int disk_cache_read(uint8 pdrv, uint8 *buff, uint32 sector, uint32 count)
+{
+    DISK_CACHE_ENT_ST *e;
+    uint32 i;
+    int ret;
+
+    if(count > 1)
+    {
+        disk_cache.stats.bypass++;
+        ret = disk_cache.ops->read(pdrv, buff, sector, count);
+        if(ret)
+        {
+            return ret;
+        }
+
+        // the cache is newer than the media where it is dirty
+        for(i = 0; i < count; i++)
+        {
+            e = disk_cache_dirty(pdrv, sector + i);
+            if(e)
+            {
+                os_memcpy(buff + i * DISK_CACHE_SECTOR_SIZE, DISK_CACHE_BUF(e), DISK_CACHE_SECTOR_SIZE);
+            }
+        }
+        return 0;
+    }
+
+    e = disk_cache_find(pdrv, sector);
+    if(e)
+    {
+        disk_cache.stats.hit++;
+    }
+    else
+    {
+        disk_cache.stats.miss++;
+        e = disk_cache_evict();
+        if(NULL == e)
+        {
+            return -1;
+        }
+
+        ret = disk_cache.ops->read(pdrv, DISK_CACHE_BUF(e), sector, 1);
+        if(ret)
+        {
+            return ret;
+        }
+        e->pdrv = pdrv;
+        e->sector = sector;
+        e->dirty = 0;
+        e->valid = 1;
+    }
+
+    disk_cache_touch(e);
+    os_memcpy(buff, DISK_CACHE_BUF(e), DISK_CACHE_SECTOR_SIZE);
+
+    return 0;
+}
+
+int disk_cache_write(uint8 pdrv, const uint8 *buff, uint32 sector, uint32 count)
+{
+    DISK_CACHE_ENT_ST *e;
+    uint32 i;
+    int ret;
+
+    if(count > 1)
+    {
+        disk_cache.stats.bypass++;
+        ret = disk_cache.ops->write(pdrv, buff, sector, count);
+        if(ret)
+        {
+            return ret;
+        }
+
+        // cached copies take the new data and are clean now
+        for(i = 0; i < count; i++)
+        {
+            e = disk_cache_find(pdrv, sector + i);
+            if(e)
+            {
+                os_memcpy(DISK_CACHE_BUF(e), buff + i * DISK_CACHE_SECTOR_SIZE, DISK_CACHE_SECTOR_SIZE);
+                e->dirty = 0;
+            }
+        }
+        return 0;
+    }
+
+    e = disk_cache_find(pdrv, sector);
+    if(e)
+    {
+        disk_cache.stats.hit++;
+    }
+    else
+    {
+        disk_cache.stats.miss++;
+        e = disk_cache_evict();
+        if(NULL == e)
+        {
+            return -1;
+        }
+        e->pdrv = pdrv;
+        e->sector = sector;
+        e->valid = 1;
+    }
+
+    os_memcpy(DISK_CACHE_BUF(e), buff, DISK_CACHE_SECTOR_SIZE);
+    e->dirty = 1;
+    disk_cache_touch(e);
+
+    return 0;
+}
+
+int disk_cache_flush(uint8 pdrv)
+{
+    DISK_CACHE_ENT_ST *e;
+    int ret;
+
+    for(e = disk_cache.ent; e < &disk_cache.ent[CFG_FATFS_CACHE_SECTORS]; e++)
+    {
+        if(e->valid && e->dirty && (e->pdrv == pdrv))
+        {
+            ret = disk_cache_write_run(e);
+            if(ret)
+            {
+                return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// drops the sectors of pdrv, dirty ones too: flush first
+void disk_cache_invalidate(uint8 pdrv)
+{
+    DISK_CACHE_ENT_ST *e;
+
+    for(e = disk_cache.ent; e < &disk_cache.ent[CFG_FATFS_CACHE_SECTORS]; e++)
+    {
+        if(e->pdrv == pdrv)
+        {
+            e->valid = 0;
+            e->dirty = 0;
+        }
+    }
+}
+
+void disk_cache_get_stats(DISK_CACHE_STATS_ST *stats)
+{
+    *stats = disk_cache.stats;
+}
+#endif // CFG_FATFS_CACHE_SECTORS
+// eof
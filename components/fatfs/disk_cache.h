@@ -0,0 +1,34 @@
+#ifndef _DISK_CACHE_H_
+#define _DISK_CACHE_H_
+
+#include "include.h"
+#include "typedef.h"
+
+#define DISK_CACHE_SECTOR_SIZE      512
+
+// device access of one drive, 0 on success
+typedef struct disk_cache_ops_st
+{
+    int (*read)(uint8 pdrv, uint8 *buff, uint32 sector, uint32 count);
+    int (*write)(uint8 pdrv, const uint8 *buff, uint32 sector, uint32 count);
+} DISK_CACHE_OPS_ST;
+
+typedef struct disk_cache_stats_st
+{
+    uint32 hit;
+    uint32 miss;
+    uint32 bypass;          // multi sector reads/writes straight to the device
+    uint32 writeback;       // dirty sectors written to the device
+    uint32 dev_write;       // device write calls for them, less when coalesced
+} DISK_CACHE_STATS_ST;
+
+#if CFG_FATFS_CACHE_SECTORS
+void disk_cache_init(const DISK_CACHE_OPS_ST *ops);
+int disk_cache_read(uint8 pdrv, uint8 *buff, uint32 sector, uint32 count);
+int disk_cache_write(uint8 pdrv, const uint8 *buff, uint32 sector, uint32 count);
+int disk_cache_flush(uint8 pdrv);
+void disk_cache_invalidate(uint8 pdrv);
+void disk_cache_get_stats(DISK_CACHE_STATS_ST *stats);
+#endif
+
+#endif
@@ -14,6 +14,7 @@
 #include "ff.h"
 #include "usb_pub.h"
 #include "usb_msd.h"
+#include "disk_cache.h"
 
 #define USB_RET_OK			0
 #define USB_RET_ERROR 		1
@@ -63,12 +64,48 @@ uint8 udisk_init(void)
 }
 
 DD_HANDLE sdcard_hdl;
+
+static int disk_dev_read(uint8 pdrv, uint8 *buff, uint32 sector, uint32 count)
+{
+    if(pdrv == DISK_TYPE_SD)
+    {
+        // sdcard_read returns the blocks read
+        return (ddev_read(sdcard_hdl, (char *)buff, count, sector) == count) ? 0 : -1;
+    }
+    else if(pdrv == DISK_TYPE_UDISK)
+    {
+        return (MUSB_HfiRead(sector, count, buff) == USB_RET_OK) ? 0 : -1;
+    }
+    return 0;
+}
+
+#if CFG_FATFS_CACHE_SECTORS
+// multi block writes on sd, for the cache write back
+static int disk_dev_write(uint8 pdrv, const uint8 *buff, uint32 sector, uint32 count)
+{
+    if(pdrv == DISK_TYPE_SD)
+    {
+        return (ddev_write(sdcard_hdl, (char *)buff, count, sector) == SD_OK) ? 0 : -1;
+    }
+    return -1;
+}
+
+static const DISK_CACHE_OPS_ST disk_dev_ops =
+{
+    disk_dev_read,
+    disk_dev_write,
+};
+#endif
+
 DSTATUS disk_initialize (uint8 pdrv)
 {
     int cnt = 5;
     UINT32 status;
 
     os_printf("disk_initialize\r\n");
+#if CFG_FATFS_CACHE_SECTORS
+    disk_cache_init(&disk_dev_ops);
+#endif
     if(pdrv == DISK_TYPE_SD)
     {
         while(cnt--)
@@ -103,26 +140,17 @@ DRESULT disk_read (
     uint32 sector_cnt
 )
 {
-    uint32 err;
+    int err;
 
-    os_printf("disk_read: pdrv=%d, buff=0x%p, start_sector=0x%x, sector_cnt=0x%x\r\n", pdrv, buff, start_sector, sector_cnt);
-    if( pdrv == DISK_TYPE_SD)
-    {
-        err = ddev_read(sdcard_hdl, (char *)buff, sector_cnt, start_sector);
-        if(err != SD_OK )
-            return RES_ERROR;
-    }
-    else if(pdrv == DISK_TYPE_UDISK)
+#if CFG_FATFS_CACHE_SECTORS
+    err = disk_cache_read(pdrv, buff, start_sector, sector_cnt);
+#else
+    err = disk_dev_read(pdrv, buff, start_sector, sector_cnt);
+#endif
+    if(err)
     {
-        err = MUSB_HfiRead(start_sector, sector_cnt, buff);
-        os_printf("err = 0x%x\r\n", err);
-        if(err != USB_RET_OK)
-        {
-            os_printf("disk_read: RES_ERROR\r\n");
-            return RES_ERROR;
-        }
-        os_printf("disk_read: RES_OK\r\n");
-        return RES_OK;
+        FAT_WARN("disk_read: pdrv=%d sector=0x%x cnt=%d failed\r\n", pdrv, start_sector, sector_cnt);
+        return RES_ERROR;
     }
     return RES_OK;
 }
@@ -131,6 +159,10 @@ DRESULT disk_read (
 DSTATUS disk_close(void)
 {
     os_printf("disk_close\r\n");
+#if CFG_FATFS_CACHE_SECTORS
+    disk_cache_flush(DISK_TYPE_SD);
+    disk_cache_invalidate(DISK_TYPE_SD);
+#endif
     ddev_close(sdcard_hdl);
 
     sdcard_hdl = DD_HANDLE_UNVALID;
@@ -144,6 +176,7 @@ DSTATUS disk_close(void)
 #include <stdio.h>
 #include <string.h>
 #include "driver_udisk.h"
+#include "disk_cache.h"
 
 enum
 {
@@ -153,6 +186,24 @@ enum
 
 static uint8 cur_disk_type = DISK_TYPE_SD;
 
+#if CFG_FATFS_CACHE_SECTORS
+static int disk_dev_read(uint8 pdrv, uint8 *buff, uint32 sector, uint32 count)
+{
+    return (udisk_rd_blk_sync(sector, count, buff) == USB_RET_OK) ? 0 : -1;
+}
+
+static int disk_dev_write(uint8 pdrv, const uint8 *buff, uint32 sector, uint32 count)
+{
+    return (udisk_wr_blk_sync(sector, count, (uint8 *)buff) == 0) ? 0 : -1;
+}
+
+static const DISK_CACHE_OPS_ST disk_dev_ops =
+{
+    disk_dev_read,
+    disk_dev_write,
+};
+#endif
+
 DSTATUS disk_initialize(uint8 pdrv)
 {
     cur_disk_type = pdrv;
@@ -165,6 +216,9 @@ DSTATUS disk_initialize(uint8 pdrv)
     }
     else if (udisk_init() == USB_RET_OK)
     {
+#if CFG_FATFS_CACHE_SECTORS
+        disk_cache_init(&disk_dev_ops);
+#endif
         return RES_OK;
     }
 
@@ -193,7 +247,11 @@ DRESULT disk_read (
     }
     else
     {
+#if CFG_FATFS_CACHE_SECTORS
+        if (disk_cache_read(drv, buff, sector, count))
+#else
         if (udisk_rd_blk_sync(sector, count, buff) !=  USB_RET_OK)
+#endif
         {
         	os_printf("disk_read_error\r\n");
             ret =  RES_ERROR;
@@ -222,7 +280,11 @@ DRESULT disk_write (
     }
     else
     {
+#if CFG_FATFS_CACHE_SECTORS
+        res = disk_cache_write(drv, buff, sector, count);
+#else
         res = udisk_wr_blk_sync((int)sector, (int)count, (uint8 *)buff);
+#endif
     }
 
     if (res == 0x00)return RES_OK;
@@ -251,7 +313,11 @@ DRESULT disk_ioctl (
             //   else res = RES_ERROR;
             //	Delay(10000);
             //		    	printf("CTRL_SYNC \r\n");
+#if CFG_FATFS_CACHE_SECTORS
+            res = disk_cache_flush(drv) ? RES_ERROR : RES_OK;
+#else
             res = RES_OK;
+#endif
             break;
         case GET_SECTOR_SIZE:
             *(WORD *)buff = 512;
@@ -298,8 +364,14 @@ DRESULT disk_unmount(uint8 pdrv)
         //		SD_SPI_Uninit();
         return RES_ERROR;
     else
+    {
+#if CFG_FATFS_CACHE_SECTORS
+        disk_cache_flush(pdrv);
+        disk_cache_invalidate(pdrv);
+#endif
         //    	udisk_uninit();
         return RES_OK;
+    }
 }
 
 #endif
@@ -197,6 +197,10 @@ int hapd_intf_sta_add(struct prism2_hostapd_param *param, int len)
 
 #if CFG_USE_AP_PS
         rwm_flush_txing_list(cfm->sta_idx);
+#endif
+#if CFG_TX_SWQ
+        // the index may have been used by a station that left
+        rwm_swq_flush(0xFF, cfm->sta_idx);
 #endif
     }
     os_free(cfm);
@@ -280,6 +280,9 @@ u8 rwn_mgmt_is_only_sta_role_add(void);
 
 void rwm_msdu_init(void);
 void rwm_flush_txing_list(UINT8 sta_idx);
+#if CFG_TX_SWQ
+void rwm_swq_flush(UINT8 vif_idx, UINT8 sta_idx);
+#endif
 void rwm_msdu_ps_change_ind_handler(void *msg) ;
 void rwm_msdu_send_txing_node(UINT8 sta_idx);
 
@@ -223,6 +223,13 @@
  */
 #define PBUF_POOL_BUFSIZE               1580
 
+#if CFG_TX_PBUF_REF
+/* room the wifi tx path writes around the frame, pbufs are sent without copy */
+#define PBUF_LINK_ENCAPSULATION_HLEN    CFG_MSDU_RESV_HEAD_LEN
+#define PBUF_LINK_ENCAPSULATION_TLEN    CFG_MSDU_RESV_TAIL_LEN
+#define PBUF_CUSTOM_MEM_BOUNDS          1
+#endif
+
 
 /*
    ---------------------------------
@@ -436,6 +443,9 @@ The STM32F107 allows computing and verifying the IP, UDP, TCP and ICMP checksums
 #define MEMP_NUM_REASSDATA              0
 #define IP_FRAG                         0
 
+/* custom pbufs let drivers hand their own buffers to the stack (zero-copy tx) */
+#define LWIP_SUPPORT_CUSTOM_PBUF        1
+
 #define MEM_LIBC_MALLOC                (0)
 
 #define DEFAULT_UDP_RECVMBOX_SIZE       3 //each udp socket max buffer 3 packets.
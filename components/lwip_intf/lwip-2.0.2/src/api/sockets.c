@@ -1151,7 +1151,7 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
         apiflags |= NETCONN_MORE;
       }
       written = 0;
-      err = netconn_write_partly(sock->conn, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len, write_flags, &written);
+      err = netconn_write_partly(sock->conn, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len, apiflags, &written);
       if (err == ERR_OK) {
         size += written;
         /* check that the entire IO vector was accepected, if not return a partial write */
@@ -1363,6 +1363,124 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
   return (err == ERR_OK ? short_size : -1);
 }
 
+#if LWIP_UDP
+/**
+ * Send a caller-built pbuf on a UDP socket without copying its payload.
+ * The pbuf must have room for the UDP/IP/link headers in front of its
+ * payload (e.g. allocated at PBUF_TRANSPORT); the caller keeps its own
+ * reference and must pbuf_free() it once this function returns.
+ */
+int
+lwip_sendto_pbuf(int s, struct pbuf *p, int flags,
+       const struct sockaddr *to, socklen_t tolen)
+{
+  struct lwip_sock *sock;
+  err_t err;
+  u16_t remote_port;
+  u16_t short_size;
+  struct netbuf buf;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  LWIP_UNUSED_ARG(flags);
+  LWIP_UNUSED_ARG(tolen);
+  if ((p == NULL) || (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_UDP)) {
+    sock_set_errno(sock, err_to_errno(ERR_ARG));
+    return -1;
+  }
+  LWIP_ERROR("lwip_sendto_pbuf: invalid address", (((to == NULL) && (tolen == 0)) ||
+             (IS_SOCK_ADDR_LEN_VALID(tolen) &&
+             IS_SOCK_ADDR_TYPE_VALID(to) && IS_SOCK_ADDR_ALIGNED(to))),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+  short_size = p->tot_len;
+
+  /* the netbuf borrows the caller's pbuf, netbuf_free() drops this reference */
+  pbuf_ref(p);
+  buf.p = buf.ptr = p;
+#if LWIP_CHECKSUM_ON_COPY
+  buf.flags = 0;
+#endif /* LWIP_CHECKSUM_ON_COPY */
+  if (to) {
+    SOCKADDR_TO_IPADDR_PORT(to, &buf.addr, remote_port);
+  } else {
+    remote_port = 0;
+    ip_addr_set_any(NETCONNTYPE_ISIPV6(netconn_type(sock->conn)), &buf.addr);
+  }
+  netbuf_fromport(&buf) = remote_port;
+
+  err = netconn_send(sock->conn, &buf);
+
+  netbuf_free(&buf);
+
+  sock_set_errno(sock, err_to_errno(err));
+  return (err == ERR_OK ? short_size : -1);
+}
+
+/**
+ * Send several caller-built pbufs on a UDP socket, one datagram each, while
+ * taking the core lock only once. Same pbuf rules as lwip_sendto_pbuf().
+ * Returns the number of pbufs sent, or -1 if none could be sent.
+ */
+int
+lwip_sendto_pbufs(int s, struct pbuf **p, int cnt, int flags,
+       const struct sockaddr *to, socklen_t tolen)
+{
+#if LWIP_TCPIP_CORE_LOCKING
+  struct lwip_sock *sock;
+  err_t err = ERR_OK;
+  ip_addr_t addr;
+  u16_t remote_port;
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+  int i;
+
+#if !LWIP_TCPIP_CORE_LOCKING
+  for (i = 0; i < cnt; i++) {
+    if (lwip_sendto_pbuf(s, p[i], flags, to, tolen) < 0) {
+      break;
+    }
+  }
+  return ((i == 0) && (cnt > 0)) ? -1 : i;
+#else /* !LWIP_TCPIP_CORE_LOCKING */
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  LWIP_UNUSED_ARG(flags);
+  LWIP_UNUSED_ARG(tolen);
+  if ((p == NULL) || (to == NULL) || (NETCONNTYPE_GROUP(netconn_type(sock->conn)) != NETCONN_UDP)) {
+    sock_set_errno(sock, err_to_errno(ERR_ARG));
+    return -1;
+  }
+  LWIP_ERROR("lwip_sendto_pbufs: invalid address", (IS_SOCK_ADDR_LEN_VALID(tolen) &&
+             IS_SOCK_ADDR_TYPE_VALID(to) && IS_SOCK_ADDR_ALIGNED(to)),
+             sock_set_errno(sock, err_to_errno(ERR_ARG)); return -1;);
+
+  SOCKADDR_TO_IPADDR_PORT(to, &addr, remote_port);
+
+  LOCK_TCPIP_CORE();
+  for (i = 0; i < cnt; i++) {
+    if (sock->conn->pcb.udp == NULL) {
+      err = ERR_CONN;
+      break;
+    }
+    err = udp_sendto(sock->conn->pcb.udp, p[i], &addr, remote_port);
+    if (err != ERR_OK) {
+      break;
+    }
+  }
+  UNLOCK_TCPIP_CORE();
+
+  sock_set_errno(sock, err_to_errno(err));
+  return ((i == 0) && (cnt > 0)) ? -1 : i;
+#endif /* !LWIP_TCPIP_CORE_LOCKING */
+}
+#endif /* LWIP_UDP */
+
 int
 lwip_socket(int domain, int type, int protocol)
 {
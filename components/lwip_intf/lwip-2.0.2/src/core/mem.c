@@ -86,6 +86,16 @@ mem_trim(void *mem, mem_size_t size)
   LWIP_UNUSED_ARG(size);
   return mem;
 }
+
+/** the size behind a pool element or a malloc() block is not known here,
+ * 0 tells the caller to use no more than it asked for
+ */
+mem_size_t
+mem_usable_size(void *mem)
+{
+  LWIP_UNUSED_ARG(mem);
+  return 0;
+}
 #endif /* MEM_LIBC_MALLOC || MEM_USE_POOLS */
 
 #if MEM_LIBC_MALLOC
@@ -464,6 +474,27 @@ mem_free(void *rmem)
   LWIP_MEM_FREE_UNPROTECT();
 }
 
+/**
+ * Size of a block returned by mem_malloc(), at least what was asked for.
+ * The block is in use, so its end does not move until mem_trim() or
+ * mem_free() by the owner.
+ *
+ * @param rmem pointer to memory allocated by mem_malloc
+ * @return usable size in bytes, 0 if rmem is not in the heap
+ */
+mem_size_t
+mem_usable_size(void *rmem)
+{
+  struct mem *mem;
+
+  if ((u8_t *)rmem < (u8_t *)ram + SIZEOF_STRUCT_MEM || (u8_t *)rmem >= (u8_t *)ram_end) {
+    return 0;
+  }
+  mem = (struct mem *)(void *)((u8_t *)rmem - SIZEOF_STRUCT_MEM);
+
+  return (mem_size_t)(mem->next - ((u8_t *)mem - ram) - SIZEOF_STRUCT_MEM);
+}
+
 /**
  * Shrink memory returned by mem_malloc().
  *
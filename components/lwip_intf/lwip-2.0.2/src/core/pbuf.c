@@ -351,7 +351,8 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
     break;
   case PBUF_RAM:
     {
-      mem_size_t alloc_len = LWIP_MEM_ALIGN_SIZE(SIZEOF_STRUCT_PBUF + offset) + LWIP_MEM_ALIGN_SIZE(length);
+      mem_size_t alloc_len = LWIP_MEM_ALIGN_SIZE(SIZEOF_STRUCT_PBUF + offset) + LWIP_MEM_ALIGN_SIZE(length)
+                            + LWIP_MEM_ALIGN_SIZE(PBUF_LINK_ENCAPSULATION_TLEN);
       
       /* bug #50040: Check for integer overflow when calculating alloc_len */
       if (alloc_len < LWIP_MEM_ALIGN_SIZE(length)) {
@@ -469,6 +470,10 @@ pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type, struct pbuf_cust
   p->pbuf.len = p->pbuf.tot_len = length;
   p->pbuf.type = type;
   p->pbuf.ref = 1;
+#if PBUF_CUSTOM_MEM_BOUNDS
+  p->payload_mem = payload_mem;
+  p->payload_mem_len = payload_mem_len;
+#endif /* PBUF_CUSTOM_MEM_BOUNDS */
   return &p->pbuf;
 }
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
@@ -537,7 +542,8 @@ pbuf_realloc(struct pbuf *p, u16_t new_len)
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
      ) {
     /* reallocate and adjust the length of the pbuf that will be split */
-    q = (struct pbuf *)mem_trim(q, (u16_t)((u8_t *)q->payload - (u8_t *)q) + rem_len);
+    q = (struct pbuf *)mem_trim(q, (u16_t)((u8_t *)q->payload - (u8_t *)q) + rem_len
+                                  + PBUF_LINK_ENCAPSULATION_TLEN);
     LWIP_ASSERT("mem_trim returned q == NULL", q != NULL);
   }
   /* adjust length fields for new last pbuf */
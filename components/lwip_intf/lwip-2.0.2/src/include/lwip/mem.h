@@ -71,6 +71,7 @@ typedef u16_t mem_size_t;
 
 void  mem_init(void);
 void *mem_trim(void *mem, mem_size_t size);
+mem_size_t mem_usable_size(void *mem);
 void *mem_malloc(mem_size_t size);
 void *mem_calloc(mem_size_t count, mem_size_t size);
 void  mem_free(void *mem);
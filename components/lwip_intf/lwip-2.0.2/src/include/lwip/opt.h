@@ -1364,6 +1364,24 @@
 #define PBUF_LINK_ENCAPSULATION_HLEN    0u
 #endif
 
+/**
+ * PBUF_LINK_ENCAPSULATION_TLEN: the number of bytes that should be allocated
+ * behind the data of PBUF_RAM pbufs for an encapsulation trailer (e.g. a MIC
+ * appended by the link layer in place)
+ */
+#if !defined PBUF_LINK_ENCAPSULATION_TLEN || defined __DOXYGEN__
+#define PBUF_LINK_ENCAPSULATION_TLEN    0u
+#endif
+
+/**
+ * PBUF_CUSTOM_MEM_BOUNDS==1: struct pbuf_custom remembers the payload_mem
+ * buffer given to pbuf_alloced_custom(), so a driver can tell how much room
+ * is left around the data of a custom pbuf
+ */
+#if !defined PBUF_CUSTOM_MEM_BOUNDS || defined __DOXYGEN__
+#define PBUF_CUSTOM_MEM_BOUNDS          0
+#endif
+
 /**
  * PBUF_POOL_BUFSIZE: the size of each pbuf in the pbuf pool. The default is
  * designed to accommodate single full size TCP frame in one pbuf, including
@@ -195,6 +195,11 @@ struct pbuf_custom {
   struct pbuf pbuf;
   /** This function is called when pbuf_free deallocates this pbuf(_custom) */
   pbuf_free_custom_fn custom_free_function;
+#if PBUF_CUSTOM_MEM_BOUNDS
+  /** The buffer given to pbuf_alloced_custom() and its size */
+  void *payload_mem;
+  u16_t payload_mem_len;
+#endif /* PBUF_CUSTOM_MEM_BOUNDS */
 };
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
 
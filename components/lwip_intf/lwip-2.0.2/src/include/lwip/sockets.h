@@ -500,6 +500,13 @@ int lwip_send(int s, const void *dataptr, size_t size, int flags);
 int lwip_sendmsg(int s, const struct msghdr *message, int flags);
 int lwip_sendto(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
+#if LWIP_UDP
+struct pbuf;
+int lwip_sendto_pbuf(int s, struct pbuf *p, int flags,
+    const struct sockaddr *to, socklen_t tolen);
+int lwip_sendto_pbufs(int s, struct pbuf **p, int cnt, int flags,
+    const struct sockaddr *to, socklen_t tolen);
+#endif /* LWIP_UDP */
 int lwip_socket(int domain, int type, int protocol);
 int lwip_write(int s, const void *dataptr, size_t size);
 int lwip_writev(int s, const struct iovec *iov, int iovcnt);
@@ -7,6 +7,7 @@
 #include "txu_cntrl.h"
 
 #include "lwip/pbuf.h"
+#include "lwip/mem.h"
 #ifdef CFG_WFA_CERTIFICATION
 #include "prot/ip4.h"
 #include "prot/ip6.h"
@@ -111,7 +112,7 @@ void rwm_tx_confirm(void *param)
 
 		os_null_printf("flush_desc:0x%x\r\n", txdesc->host.msdu_node);
 
-		os_free(txdesc->host.msdu_node);
+		rwm_node_free(txdesc->host.msdu_node);
 		txdesc->host.msdu_node = NULL;
 	}
 }
@@ -166,9 +167,16 @@ int rwm_raw_frame_with_cb(uint8_t *buffer, int len, void *cb, void *param)
 
 	txdesc_new->status = TXDESC_STA_USED;
 	txdesc_new->host.flags = TXU_CNTRL_MGMT;
+#if NX_AMSDU_TX
+	txdesc_new->host.orig_addr[0] = (UINT32)node->msdu_ptr;
+	txdesc_new->host.packet_addr[0] = (UINT32)content_ptr;
+	txdesc_new->host.packet_len[0] = len;
+	txdesc_new->host.packet_cnt = 1;
+#else
 	txdesc_new->host.orig_addr = (UINT32)node->msdu_ptr;
 	txdesc_new->host.packet_addr = (UINT32)content_ptr;
 	txdesc_new->host.packet_len = len;
+#endif
 	txdesc_new->host.status_desc_addr = (UINT32)content_ptr;
 	txdesc_new->host.tid = 0xff;
 	txdesc_new->host.callback = (mgmt_tx_cb_t)cb;
@@ -234,6 +242,9 @@ MSDU_NODE_T *rwm_tx_node_alloc(UINT32 len)
 
     node_ptr->msdu_ptr = buff_ptr;
     node_ptr->len = len;
+#if CFG_TX_PBUF_REF
+    node_ptr->p = NULL;
+#endif
 
 alloc_exit:
     return node_ptr;
@@ -242,6 +253,12 @@ alloc_exit:
 void rwm_node_free(MSDU_NODE_T *node)
 {
     ASSERT(node);
+#if CFG_TX_PBUF_REF
+    if(node->p)
+    {
+        pbuf_free(node->p);
+    }
+#endif
     os_free(node);
 }
 
@@ -601,11 +618,27 @@ uint8_t classify8021d(UINT8 *buf)
 #endif
 }
 
+static void rwm_transfer_msdu(UINT8 vif_idx, MSDU_NODE_T *node, int sync, void *args)
+{
+    ETH_HDR_PTR eth_hdr_ptr = (ETH_HDR_PTR)rwm_get_msdu_content_ptr(node);
+
+    node->vif_idx = vif_idx;
+	node->sync = sync;
+	node->args = args;
+    node->sta_idx = rwm_mgmt_tx_get_staidx(vif_idx,
+                             &eth_hdr_ptr->e_dest);
+
+#if CFG_USE_AP_PS
+    rwm_ps_tranfer_node(node);
+#else
+    rwm_transfer_node(node, 0);
+#endif
+}
+
 UINT32 rwm_transfer(UINT8 vif_idx, UINT8 *buf, UINT32 len, int sync, void *args)
 {
     UINT32 ret = 0;
     MSDU_NODE_T *node;
-    ETH_HDR_PTR eth_hdr_ptr;
 
     ret = RW_FAILURE;
     node = rwm_tx_node_alloc(len);
@@ -620,23 +653,94 @@ UINT32 rwm_transfer(UINT8 vif_idx, UINT8 *buf, UINT32 len, int sync, void *args)
     }
     rwm_tx_msdu_renew(buf, len, node->msdu_ptr);
 
-    eth_hdr_ptr = (ETH_HDR_PTR)buf;
-    node->vif_idx = vif_idx;
-	node->sync = sync;
-	node->args = args;
-    node->sta_idx = rwm_mgmt_tx_get_staidx(vif_idx,
-                             &eth_hdr_ptr->e_dest);
-
-#if CFG_USE_AP_PS
-    rwm_ps_tranfer_node(node);
-#else
-    rwm_transfer_node(node, 0);
-#endif
+    rwm_transfer_msdu(vif_idx, node, sync, args);
 
 tx_exit:
     return ret;
 }
 
+#if CFG_TX_PBUF_REF
+// a single pbuf can be sent in place when its buffer has the msdu head and
+// tail room around the data: PBUF_RAM pbufs get it from
+// PBUF_LINK_ENCAPSULATION_HLEN/TLEN, custom pbufs when the owner left it
+static int rwm_pbuf_ref_ok(struct pbuf *p)
+{
+    UINT8 *start, *end;
+
+    if(p->next)
+    {
+        return 0;
+    }
+
+    if(p->flags & PBUF_FLAG_IS_CUSTOM)
+    {
+        struct pbuf_custom *pc = (struct pbuf_custom *)p;
+
+        if(NULL == pc->payload_mem)
+        {
+            return 0;
+        }
+        start = (UINT8 *)pc->payload_mem;
+        end = start + pc->payload_mem_len;
+    }
+    else if(PBUF_RAM == p->type)
+    {
+        // pbuf header and data are one heap block
+        start = (UINT8 *)p + LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf));
+        end = (UINT8 *)p + mem_usable_size(p);
+    }
+    else
+    {
+        return 0;
+    }
+
+    return (((UINT8 *)p->payload >= start + CFG_MSDU_RESV_HEAD_LEN)
+            && ((UINT8 *)p->payload + p->len + CFG_MSDU_RESV_TAIL_LEN <= end));
+}
+#endif
+
+// send a frame from lwip, the caller's reference of p is taken over.
+// the msdu refers to the pbuf if it can, otherwise the chain is gathered
+// straight into a new msdu
+UINT32 rwm_transfer_pbuf(UINT8 vif_idx, struct pbuf *p)
+{
+    MSDU_NODE_T *node;
+
+#if CFG_TX_PBUF_REF
+    if(rwm_pbuf_ref_ok(p))
+    {
+        node = (MSDU_NODE_T *)os_malloc(sizeof(MSDU_NODE_T));
+        if(node)
+        {
+            // held until rwm_tx_confirm
+            node->msdu_ptr = (UINT8 *)p->payload - CFG_MSDU_RESV_HEAD_LEN;
+            node->len = p->len;
+            node->p = p;
+            rwm_transfer_msdu(vif_idx, node, 0, 0);
+            return RW_SUCCESS;
+        }
+    }
+#endif
+
+    node = rwm_tx_node_alloc(p->tot_len);
+    if(node)
+    {
+        pbuf_copy_partial(p, rwm_get_msdu_content_ptr(node), p->tot_len, 0);
+    }
+    pbuf_free(p);
+
+    if(NULL == node)
+    {
+#if NX_POWERSAVE
+        txl_cntrl_dec_pck_cnt();
+#endif
+        return RW_FAILURE;
+    }
+
+    rwm_transfer_msdu(vif_idx, node, 0, 0);
+    return RW_SUCCESS;
+}
+
 void ieee80211_data_tx_cb(void *param)
 {
 	struct txdesc *txdesc_new = (struct txdesc *)param;
@@ -686,6 +790,346 @@ int qos_need_enabled(struct sta_info_tag *sta)
 }
 #endif
 
+// fill a descriptor for a classified node, RW_FAILURE if the hw queue has none left;
+// the node is still owned by the caller then
+// one msdu per descriptor: the lmac in librwnx is built without NX_AMSDU_TX,
+// so the host cannot hand it a-msdu subframes
+static UINT32 rwm_tx_node_push(MSDU_NODE_T *node)
+{
+    UINT8 tid = node->tid;
+    UINT32 queue_idx = node->queue_idx;
+    UINT8 *content_ptr;
+    ETH_HDR_PTR eth_hdr_ptr;
+    struct txdesc *txdesc_new;
+
+    content_ptr = rwm_get_msdu_content_ptr(node);
+    eth_hdr_ptr = (ETH_HDR_PTR)content_ptr;
+
+    txdesc_new = tx_txdesc_prepare(queue_idx);
+    if(TXDESC_STA_USED == txdesc_new->status)
+    {
+        return RW_FAILURE;
+    }
+
+    txdesc_new->status = TXDESC_STA_USED;
+    rwm_txdesc_copy(txdesc_new, eth_hdr_ptr);
+
+    txdesc_new->host.flags            = node->flag;
+#if NX_AMSDU_TX
+    txdesc_new->host.orig_addr[0]     = (UINT32)node->msdu_ptr;
+    txdesc_new->host.packet_addr[0]   = (UINT32)content_ptr + 14;
+    txdesc_new->host.packet_len[0]    = node->len - 14;
+    txdesc_new->host.packet_cnt       = 1;
+#else
+    txdesc_new->host.orig_addr        = (UINT32)node->msdu_ptr;
+    txdesc_new->host.packet_addr      = (UINT32)content_ptr + 14;
+    txdesc_new->host.packet_len       = node->len - 14;
+#endif
+    txdesc_new->host.status_desc_addr = (UINT32)content_ptr + 14;
+    txdesc_new->host.ethertype        = eth_hdr_ptr->e_proto;
+    txdesc_new->host.tid              = tid;
+
+    txdesc_new->host.vif_idx          = node->vif_idx;
+    txdesc_new->host.staid            = node->sta_idx;
+	txdesc_new->host.msdu_node        = (void *)node;
+
+	if (node->sync)
+	{
+		txdesc_new->host.callback		  = (mgmt_tx_cb_t)ieee80211_data_tx_cb;
+		txdesc_new->host.param			  = (void *)txdesc_new;
+	}
+	else
+	{
+		txdesc_new->host.callback = 0;
+	}
+
+    txdesc_new->lmac.agg_desc = NULL;
+    txdesc_new->lmac.hw_desc->cfm.status = 0;
+
+    txu_cntrl_push(txdesc_new, queue_idx);
+    return RW_SUCCESS;
+}
+
+#if CFG_TX_SWQ
+#define RWM_SWQ_RETRY_MS            2
+
+#define RWM_ETH_P_IP                0x0800
+#define RWM_ETH_P_ARP               0x0806
+#define RWM_ETH_P_EAPOL             0x888E
+#define RWM_IP_P_ICMP               1
+#define RWM_IP_P_TCP                6
+#define RWM_IP_P_UDP                17
+
+// host side queue per access category, frames wait here for a descriptor
+typedef struct rwm_swq_st
+{
+    LIST_HEADER_T list;
+    UINT32 cnt;
+    INT32 deficit;
+    UINT32 drops;
+} RWM_SWQ_ST;
+
+// deficit round robin quantum in bytes, AC_BK..AC_VO
+static const UINT16 rwm_swq_quantum[AC_MAX] = {1600, 3200, 4800, 6400};
+static RWM_SWQ_ST rwm_swq[AC_MAX];
+static UINT32 rwm_swq_total = 0;
+static UINT32 rwm_swq_cur = AC_VO;
+static UINT8 rwm_swq_inited = 0;
+
+// host queue class only, the tid and hw queue used on air are not touched.
+// control traffic goes first, the rest follows the ip precedence
+static UINT32 rwm_swq_class(UINT8 *buf, UINT32 len)
+{
+    UINT16 proto, sport, dport;
+    UINT8 *ip = buf + sizeof(ETH_HDR_T);
+    UINT32 ihl;
+
+    proto = (buf[12] << 8) | buf[13];
+    if((RWM_ETH_P_ARP == proto) || (RWM_ETH_P_EAPOL == proto))
+    {
+        return AC_VO;
+    }
+
+    if((RWM_ETH_P_IP != proto) || (len < sizeof(ETH_HDR_T) + 20))
+    {
+        return AC_BE;
+    }
+
+    ihl = (ip[0] & 0x0F) * 4;
+    if(RWM_IP_P_ICMP == ip[9])
+    {
+        return AC_VO;
+    }
+
+    // ports only in the first fragment
+    if((0 == (((ip[6] & 0x1F) << 8) | ip[7]))
+            && ((RWM_IP_P_UDP == ip[9]) || (RWM_IP_P_TCP == ip[9]))
+            && (len >= sizeof(ETH_HDR_T) + ihl + 4))
+    {
+        sport = (ip[ihl] << 8) | ip[ihl + 1];
+        dport = (ip[ihl + 2] << 8) | ip[ihl + 3];
+
+        // dhcp, dns
+        if((RWM_IP_P_UDP == ip[9])
+                && ((67 == dport) || (68 == dport) || (53 == dport) || (53 == sport)))
+        {
+            return AC_VO;
+        }
+
+        // mqtt
+        if((RWM_IP_P_TCP == ip[9])
+                && ((1883 == dport) || (8883 == dport) || (1883 == sport) || (8883 == sport)))
+        {
+            return AC_VO;
+        }
+    }
+
+    if(ip[1] >> 5)
+    {
+        return mac_tid2ac[ip[1] >> 5];
+    }
+
+    return AC_BE;
+}
+
+static void rwm_swq_init(void)
+{
+    UINT32 i;
+
+    if(0 == rwm_swq_inited)
+    {
+        for(i = 0; i < AC_MAX; i++)
+        {
+            INIT_LIST_HEAD(&rwm_swq[i].list);
+        }
+        rwm_swq_inited = 1;
+    }
+}
+
+// the queues are filled by the core thread and by the wpa thread (eapol),
+// and flushed on sta and vif removal, list changes are done with irq off
+static UINT32 rwm_swq_enqueue(MSDU_NODE_T *node)
+{
+    RWM_SWQ_ST *swq;
+    UINT32 ret = RW_SUCCESS;
+    GLOBAL_INT_DECLARATION();
+
+    swq = &rwm_swq[rwm_swq_class(rwm_get_msdu_content_ptr(node), node->len)];
+
+    GLOBAL_INT_DISABLE();
+    rwm_swq_init();
+    if(swq->cnt >= CFG_TX_SWQ_DEPTH)
+    {
+        swq->drops++;
+        ret = RW_FAILURE;
+    }
+    else
+    {
+        list_add_tail(&node->hdr, &swq->list);
+        swq->cnt++;
+        rwm_swq_total++;
+    }
+    GLOBAL_INT_RESTORE();
+
+    return ret;
+}
+
+// drop the queued frames of a vif and station, 0xFF matches any. called before
+// the lmac forgets the sta or the vif, the frames would go out with a stale
+// index otherwise
+void rwm_swq_flush(UINT8 vif_idx, UINT8 sta_idx)
+{
+    LIST_HEADER_T *pos, *tmp;
+    LIST_HEADER_T drop;
+    MSDU_NODE_T *node;
+    UINT32 i, cnt = 0;
+    GLOBAL_INT_DECLARATION();
+
+    INIT_LIST_HEAD(&drop);
+
+    GLOBAL_INT_DISABLE();
+    rwm_swq_init();
+    for(i = 0; i < AC_MAX; i++)
+    {
+        list_for_each_safe(pos, tmp, &rwm_swq[i].list)
+        {
+            node = list_entry(pos, MSDU_NODE_T, hdr);
+            if(((0xFF != vif_idx) && (node->vif_idx != vif_idx))
+                    || ((0xFF != sta_idx) && (node->sta_idx != sta_idx)))
+            {
+                continue;
+            }
+
+            list_del(pos);
+            list_add_tail(pos, &drop);
+            rwm_swq[i].cnt--;
+            rwm_swq_total--;
+        }
+
+        if(0 == rwm_swq[i].cnt)
+        {
+            rwm_swq[i].deficit = 0;
+        }
+    }
+    GLOBAL_INT_RESTORE();
+
+    list_for_each_safe(pos, tmp, &drop)
+    {
+        list_del(pos);
+        rwm_node_free(list_entry(pos, MSDU_NODE_T, hdr));
+#if NX_POWERSAVE
+        txl_cntrl_dec_pck_cnt();
+#endif
+        cnt++;
+    }
+
+    if(cnt)
+    {
+        os_printf("swq flush vif:%d sta:%d, %d frames\r\n", vif_idx, sta_idx, cnt);
+    }
+}
+
+// deficit round robin over the classes, stops when all queues are empty or
+// wait on a hw queue without descriptor. returns the number of frames pushed
+static UINT32 rwm_swq_schedule(void)
+{
+    RWM_SWQ_ST *swq;
+    MSDU_NODE_T *node;
+    UINT32 blocked = 0, idle = 0, pushed = 0;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    while(rwm_swq_total && (idle < 2 * AC_MAX))
+    {
+        swq = &rwm_swq[rwm_swq_cur];
+        node = NULL;
+        if(swq->cnt)
+        {
+            node = list_entry(swq->list.next, MSDU_NODE_T, hdr);
+            if(blocked & BIT(node->queue_idx))
+            {
+                node = NULL;
+            }
+        }
+
+        if(node && ((INT32)node->len <= swq->deficit))
+        {
+            list_del(&node->hdr);
+            swq->cnt--;
+            rwm_swq_total--;
+            GLOBAL_INT_RESTORE();
+
+            if(RW_SUCCESS == rwm_tx_node_push(node))
+            {
+                GLOBAL_INT_DISABLE();
+                swq->deficit -= node->len;
+                pushed++;
+                idle = 0;
+                continue;
+            }
+
+            // keep it at the head, a tx confirm gives the descriptor back
+            GLOBAL_INT_DISABLE();
+            list_add_head(&node->hdr, &swq->list);
+            swq->cnt++;
+            rwm_swq_total++;
+            blocked |= BIT(node->queue_idx);
+            continue;
+        }
+
+        if(0 == swq->cnt)
+        {
+            swq->deficit = 0;
+        }
+
+        // next class, it earns its quantum only if it can send
+        rwm_swq_cur = (rwm_swq_cur + AC_MAX - 1) % AC_MAX;
+        swq = &rwm_swq[rwm_swq_cur];
+        if(swq->cnt
+                && !(blocked & BIT(list_entry(swq->list.next, MSDU_NODE_T, hdr)->queue_idx)))
+        {
+            swq->deficit += rwm_swq_quantum[rwm_swq_cur];
+        }
+        idle++;
+    }
+    GLOBAL_INT_RESTORE();
+
+    return pushed;
+}
+#endif
+
+#if RWM_TX_POLL
+// how long the core thread may sleep before rwm_tx_poll has work to do
+UINT32 rwm_tx_wait_ms(void)
+{
+    UINT32 wait = BEKEN_WAIT_FOREVER;
+
+#if CFG_TX_SWQ
+    if(rwm_swq_total)
+    {
+        wait = MIN(wait, RWM_SWQ_RETRY_MS);
+    }
+#endif
+
+    return wait;
+}
+
+// called by the core thread after each message, returns number of frames given to lmac
+UINT32 rwm_tx_poll(void)
+{
+    UINT32 cnt = 0;
+
+#if CFG_TX_SWQ
+    if(rwm_swq_total)
+    {
+        cnt += rwm_swq_schedule();
+    }
+#endif
+
+    return cnt;
+}
+#endif
+
 UINT32 rwm_transfer_node(MSDU_NODE_T *node, u8 flag)
 {
     UINT8 tid;
@@ -695,7 +1139,6 @@ UINT32 rwm_transfer_node(MSDU_NODE_T *node, u8 flag)
     UINT32 queue_idx;
 
     ETH_HDR_PTR eth_hdr_ptr;
-    struct txdesc *txdesc_new;
 #if CFG_RWNX_QOS_MSDU
 	struct sta_info_tag *sta;
 	struct vif_info_tag *vif;
@@ -746,50 +1189,23 @@ UINT32 rwm_transfer_node(MSDU_NODE_T *node, u8 flag)
     queue_idx = AC_VI;
 #endif /* CFG_RWNX_QOS_MSDU */
 
-    txdesc_new = tx_txdesc_prepare(queue_idx);
-    if(TXDESC_STA_USED == txdesc_new->status)
+    node->tid = tid;
+    node->queue_idx = queue_idx;
+    node->flag = flag;
+
+#if CFG_TX_SWQ
+    if(RW_SUCCESS == rwm_swq_enqueue(node))
     {
-        // os_printf("rwm_transfer no txdesc \r\n");
-        goto tx_exit;
+        rwm_swq_schedule();
+        return ret;
     }
-
-    txdesc_new->status = TXDESC_STA_USED;
-    rwm_txdesc_copy(txdesc_new, eth_hdr_ptr);
-
-    txdesc_new->host.flags            = flag;
-#if NX_AMSDU_TX
-    txdesc_new->host.orig_addr[0]     = (UINT32)node->msdu_ptr;
-    txdesc_new->host.packet_addr[0]   = (UINT32)content_ptr + 14;
-    txdesc_new->host.packet_len[0]    = node->len - 14;
-    txdesc_new->host.packet_cnt       = 1;
 #else
-    txdesc_new->host.orig_addr        = (UINT32)node->msdu_ptr;
-    txdesc_new->host.packet_addr      = (UINT32)content_ptr + 14;
-    txdesc_new->host.packet_len       = node->len - 14;
+    if(RW_SUCCESS == rwm_tx_node_push(node))
+    {
+        return ret;
+    }
+    // os_printf("rwm_transfer no txdesc \r\n");
 #endif
-    txdesc_new->host.status_desc_addr = (UINT32)content_ptr + 14;
-    txdesc_new->host.ethertype        = eth_hdr_ptr->e_proto;
-    txdesc_new->host.tid              = tid;
-
-    txdesc_new->host.vif_idx          = node->vif_idx;
-    txdesc_new->host.staid            = node->sta_idx;
-	txdesc_new->host.msdu_node        = (void *)node;
-
-	if (node->sync)
-	{
-		txdesc_new->host.callback		  = (mgmt_tx_cb_t)ieee80211_data_tx_cb;
-		txdesc_new->host.param			  = (void *)txdesc_new;
-	}
-	else
-	{
-		txdesc_new->host.callback = 0;
-	}
-
-    txdesc_new->lmac.agg_desc = NULL;
-    txdesc_new->lmac.hw_desc->cfm.status = 0;
-
-    txu_cntrl_push(txdesc_new, queue_idx);
-    return ret;
 
 tx_exit:
     if (NULL != node)
@@ -800,11 +1216,87 @@ tx_exit:
     return ret;
 }
 
-UINT32 rwm_get_rx_free_node(struct pbuf **p_ret, UINT32 len)
+#if CFG_RX_PBUF_POOL_CNT
+// rx slot: pbuf_custom followed by the frame, like a PBUF_RAM pbuf,
+// so lwip can still move the payload pointer back over the headers.
+// A free slot is linked through pc.pbuf.next.
+#define RWM_RX_SLOT_BUF_LEN         LWIP_MEM_ALIGN_SIZE(PBUF_POOL_BUFSIZE)
+
+typedef struct rwm_rx_slot_st
+{
+    struct pbuf_custom pc;
+    UINT8 buf[RWM_RX_SLOT_BUF_LEN];
+} RWM_RX_SLOT_ST, *RWM_RX_SLOT_PTR;
+
+static RWM_RX_SLOT_ST rwm_rx_slot[CFG_RX_PBUF_POOL_CNT];
+static struct pbuf *rwm_rx_slot_free = NULL;
+static UINT8 rwm_rx_slot_inited = 0;
+
+static void rwm_rx_pbuf_free(struct pbuf *p)
 {
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    p->next = rwm_rx_slot_free;
+    rwm_rx_slot_free = p;
+    GLOBAL_INT_RESTORE();
+}
+
+static struct pbuf *rwm_rx_pbuf_alloc(UINT32 len)
+{
+    RWM_RX_SLOT_PTR slot;
     struct pbuf *p;
+    UINT32 i;
+    GLOBAL_INT_DECLARATION();
+
+    if(len > RWM_RX_SLOT_BUF_LEN)
+    {
+        return NULL;
+    }
+
+    GLOBAL_INT_DISABLE();
+    if(0 == rwm_rx_slot_inited)
+    {
+        for(i = 0; i < CFG_RX_PBUF_POOL_CNT; i++)
+        {
+            rwm_rx_slot[i].pc.pbuf.next = rwm_rx_slot_free;
+            rwm_rx_slot_free = &rwm_rx_slot[i].pc.pbuf;
+        }
+        rwm_rx_slot_inited = 1;
+    }
+
+    p = rwm_rx_slot_free;
+    if(p)
+    {
+        rwm_rx_slot_free = p->next;
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(NULL == p)
+    {
+        return NULL;
+    }
 
-    p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    slot = (RWM_RX_SLOT_PTR)p;
+    slot->pc.custom_free_function = rwm_rx_pbuf_free;
+
+    return pbuf_alloced_custom(PBUF_RAW, len, PBUF_RAM, &slot->pc,
+                               slot->buf, RWM_RX_SLOT_BUF_LEN);
+}
+#endif
+
+UINT32 rwm_get_rx_free_node(struct pbuf **p_ret, UINT32 len)
+{
+    struct pbuf *p = NULL;
+
+#if CFG_RX_PBUF_POOL_CNT
+    // pool slot is recycled by pbuf_free, lwip heap only when pool is empty
+    p = rwm_rx_pbuf_alloc(len);
+    if(NULL == p)
+#endif
+    {
+        p = pbuf_alloc(PBUF_RAW, len, PBUF_RAM);
+    }
     *p_ret = p;
 
     return RW_SUCCESS;
@@ -13,6 +13,12 @@
 
 #define ETH_ADDR_LEN	               6		/* Octets in one ethernet addr	 */
 
+#if CFG_TX_SWQ
+#define RWM_TX_POLL                   1
+#else
+#define RWM_TX_POLL                   0
+#endif
+
 static inline int is_broadcast_eth_addr(const u8 *a)
 {
     return (a[0] & a[1] & a[2] & a[3] & a[4] & a[5]) == 0xff;
@@ -41,6 +47,13 @@ typedef struct _msdu_node_
     UINT8 sta_idx;
 	void *args;
 	int sync;
+
+    UINT8 tid;
+    UINT8 queue_idx;
+    UINT8 flag;
+#if CFG_TX_PBUF_REF
+    struct pbuf *p;                 // frame data lives in this pbuf, not behind the node
+#endif
 } MSDU_NODE_T, *MSDU_NODE_PTR;
 
 extern void rwm_push_rx_list(MSDU_NODE_T *node);
@@ -51,6 +64,7 @@ extern UINT8 *rwm_get_msdu_content_ptr(MSDU_NODE_T *node);
 extern void rwm_txdesc_copy(struct txdesc *dst_local, ETH_HDR_PTR eth_hdr_ptr);
 extern int rwm_raw_frame_with_cb(uint8_t *buffer, int len, void *cb, void *param);
 extern MSDU_NODE_T *rwm_tx_node_alloc(UINT32 len);
+extern UINT32 rwm_transfer_pbuf(UINT8 vif_idx, struct pbuf *p);
 extern void rwm_node_free(MSDU_NODE_T *node);
 extern UINT8 *rwm_rx_buf_alloc(UINT32 len);
 extern UINT32 rwm_upload_data(RW_RXIFO_PTR rx_info);
@@ -59,6 +73,10 @@ extern UINT32 rwm_get_rx_valid(void);
 extern UINT8 rwm_get_tid();
 extern void rwm_set_tid(UINT8 tid);
 uint8_t classify8021d(UINT8 *buf);
+#if RWM_TX_POLL
+extern UINT32 rwm_tx_wait_ms(void);
+extern UINT32 rwm_tx_poll(void);
+#endif
 
 #endif // _RW_MSDU_H_
 // eof
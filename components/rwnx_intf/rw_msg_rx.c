@@ -385,6 +385,9 @@ void mhdr_disconnect_ind(void *msg)
     disc = (struct sm_disconnect_ind *)msg_ptr->param;
 
     os_printf("%s reason_code=%d\n", __FUNCTION__, disc->reason_code);
+#if CFG_TX_SWQ
+    rwm_swq_flush(disc->vif_idx, 0xFF);
+#endif
     switch (disc->reason_code)
     {
         case WLAN_REASON_PREV_AUTH_NOT_VALID:
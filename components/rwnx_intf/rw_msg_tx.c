@@ -310,6 +310,10 @@ int rw_msg_send_remove_if(u8 vif_index)
     /* Set parameters for the MM_REMOVE_IF_REQ message */
     remove_if_req->inst_nbr = vif_index;
 
+#if CFG_TX_SWQ
+    rwm_swq_flush(vif_index, 0xFF);
+#endif
+
     /* Send the MM_REMOVE_IF_REQ message to LMAC FW */
     return rw_msg_send(remove_if_req, MM_REMOVE_IF_CFM, &cfm);
 }
@@ -492,6 +496,10 @@ int rw_msg_send_me_sta_del(u8 sta_idx, bool tdls_sta)
     req->sta_idx = sta_idx;
     req->tdls_sta = tdls_sta;
 
+#if CFG_TX_SWQ
+    rwm_swq_flush(0xFF, sta_idx);
+#endif
+
     /* Send the ME_STA_DEL_REQ message to LMAC FW */
     return rw_msg_send(req, ME_STA_DEL_CFM, NULL);
 }
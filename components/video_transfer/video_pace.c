@@ -0,0 +1,178 @@
+#include "include.h"
+
+#if ((CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF) && CFG_USE_APP_DEMO_VIDEO_TRANSFER)
+#include "video_pace.h"
+
+// new sample weighs 1/4 in the averages
+#define VPACE_AVG_SHIFT             2
+// more than this many ms between two refills fills the bucket anyway
+#define VPACE_REFILL_MAX_MS         1000
+
+static UINT32 vpace_avg(UINT32 avg, UINT32 sample)
+{
+    if (avg == 0)
+    {
+        return sample;
+    }
+    return avg - (avg >> VPACE_AVG_SHIFT) + (sample >> VPACE_AVG_SHIFT);
+}
+
+// add tokens, what was sent past the bucket is paid first
+static void vpace_pay(VPACE_PTR pace, UINT64 add)
+{
+    if (pace->debt)
+    {
+        if (add <= pace->debt)
+        {
+            pace->debt -= (UINT32)add;
+            return;
+        }
+        add -= pace->debt;
+        pace->debt = 0;
+    }
+
+    if ((UINT64)pace->tokens + add > (UINT64)pace->burst * 1000)
+    {
+        pace->tokens = pace->burst * 1000;
+    }
+    else
+    {
+        pace->tokens += (UINT32)add;
+    }
+}
+
+void vpace_init(VPACE_PTR pace, UINT32 pkt_len)
+{
+    pace->pkt_len = pkt_len;
+    pace->rate = 0;
+    pace->burst = pkt_len * VPACE_BURST_PKTS;
+    pace->tokens = pace->burst * 1000;
+    pace->debt = 0;
+    pace->now = 0;
+    pace->frame_bytes = 0;
+    pace->interval = 0;
+    pace->frame_at = 0;
+    pace->started = 0;
+    pace->extra = 0;
+}
+
+void vpace_frame(VPACE_PTR pace, UINT32 now, UINT32 frames, UINT32 bytes)
+{
+    if (frames == 0)
+    {
+        return;
+    }
+
+    if (pace->started)
+    {
+        pace->interval = vpace_avg(pace->interval, (now - pace->frame_at) / frames);
+    }
+    // what went out besides the frames takes the link as well
+    pace->frame_bytes = vpace_avg(pace->frame_bytes, (bytes + pace->extra) / frames);
+    pace->extra = 0;
+    pace->frame_at = now;
+    pace->started = 1;
+}
+
+void vpace_refill(VPACE_PTR pace, UINT32 now, UINT32 queued)
+{
+    UINT32 window, need, elapse;
+
+    elapse = now - pace->now;
+    pace->now = now;
+
+    if (pace->interval == 0)
+    {
+        return;
+    }
+
+    // a frame worth, or the backlog, out within the share of the interval
+    window = pace->interval * VPACE_SHARE_NUM / VPACE_SHARE_DEN;
+    if (window == 0)
+    {
+        window = 1;
+    }
+    need = (queued > pace->frame_bytes) ? queued : pace->frame_bytes;
+    pace->rate = (UINT32)((UINT64)need * 1000 / window);
+
+    pace->burst = pace->rate * VPACE_BURST_MS / 1000;
+    if (pace->burst < pace->pkt_len * VPACE_BURST_PKTS)
+    {
+        pace->burst = pace->pkt_len * VPACE_BURST_PKTS;
+    }
+
+    if (elapse > VPACE_REFILL_MAX_MS)
+    {
+        elapse = VPACE_REFILL_MAX_MS;
+    }
+    vpace_pay(pace, (UINT64)pace->rate * elapse);
+}
+
+UINT32 vpace_take(VPACE_PTR pace, UINT32 len)
+{
+    if (pace->rate == 0)
+    {
+        return 1;
+    }
+    if (pace->tokens < len * 1000)
+    {
+        return 0;
+    }
+
+    pace->tokens -= len * 1000;
+    return 1;
+}
+
+void vpace_give(VPACE_PTR pace, UINT32 len)
+{
+    if (pace->rate == 0)
+    {
+        return;
+    }
+
+    vpace_pay(pace, (UINT64)len * 1000);
+}
+
+UINT32 vpace_wait(VPACE_PTR pace, UINT32 len)
+{
+    UINT32 need;
+
+    if ((pace->rate == 0) || ((pace->debt == 0) && (pace->tokens >= len * 1000)))
+    {
+        return 0;
+    }
+
+    // tokens are 0 while in debt
+    need = len * 1000 + pace->debt - pace->tokens;
+    return (need + pace->rate - 1) / pace->rate;
+}
+
+void vpace_charge(VPACE_PTR pace, UINT32 len)
+{
+    UINT32 max;
+
+    pace->extra += len;
+    if (pace->rate == 0)
+    {
+        return;
+    }
+
+    if (pace->tokens >= len * 1000)
+    {
+        pace->tokens -= len * 1000;
+        return;
+    }
+
+    // it is on the air anyway, the next packets wait until the link had time for it
+    pace->debt += len * 1000 - pace->tokens;
+    pace->tokens = 0;
+
+    // not more than a frame behind
+    max = (pace->frame_bytes > pace->burst) ? pace->frame_bytes : pace->burst;
+    if (pace->debt > max * 1000)
+    {
+        pace->debt = max * 1000;
+    }
+}
+#endif // ((CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF) && CFG_USE_APP_DEMO_VIDEO_TRANSFER)
+// eof
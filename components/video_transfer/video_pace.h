@@ -0,0 +1,47 @@
+#ifndef __VIDEO_PACE_H__
+#define __VIDEO_PACE_H__
+
+/*
+ * Token bucket in front of the video socket. The rate follows the frames:
+ * what a frame brings, or what is still queued when that is more, is spread
+ * over VPACE_SHARE of the frame interval. A frame is then out before the
+ * next one comes, and lwip and the mac see a steady stream instead of a
+ * whole frame at once. No sdk calls in here, the video thread feeds it.
+ */
+#define VPACE_SHARE_NUM             3
+#define VPACE_SHARE_DEN             4
+
+#define VPACE_BURST_PKTS            2       // bucket holds at least this many packets
+#define VPACE_BURST_MS              4       // or what the rate gives in this time
+
+typedef struct vpace_st
+{
+    UINT32 pkt_len;
+    UINT32 rate;                // bytes/s, 0 until the frame interval is known
+    UINT32 burst;               // bucket depth, bytes
+    UINT32 tokens;              // 1/1000 bytes
+    UINT32 debt;                // 1/1000 bytes sent past the bucket, paid before tokens
+    UINT32 now;                 // ms of the last refill
+    UINT32 frame_bytes;         // per frame, averaged
+    UINT32 interval;            // ms between frames, averaged
+    UINT32 frame_at;            // ms of the last frame end
+    UINT32 started;             // frame_at is valid
+    UINT32 extra;               // charged bytes since the last frame end
+} VPACE_ST, *VPACE_PTR;
+
+void vpace_init(VPACE_PTR pace, UINT32 pkt_len);
+// frames that ended since the last call and the bytes they brought
+void vpace_frame(VPACE_PTR pace, UINT32 now, UINT32 frames, UINT32 bytes);
+// tokens for the time gone, queued is what still waits to be sent
+void vpace_refill(VPACE_PTR pace, UINT32 now, UINT32 queued);
+// 1 and the tokens are gone when len may be sent now
+UINT32 vpace_take(VPACE_PTR pace, UINT32 len);
+// len was taken but not sent
+void vpace_give(VPACE_PTR pace, UINT32 len);
+// ms until len may be sent
+UINT32 vpace_wait(VPACE_PTR pace, UINT32 len);
+// len went out on the socket without the bucket, fec parity or a resend
+void vpace_charge(VPACE_PTR pace, UINT32 len);
+
+#endif // __VIDEO_PACE_H__
+// eof
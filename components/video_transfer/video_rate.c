@@ -0,0 +1,298 @@
+#include "include.h"
+
+#if (CFG_USE_CAMERA_INTF && CFG_USE_APP_DEMO_VIDEO_TRANSFER)
+#include "video_transfer.h"
+#include "video_rate.h"
+
+// cut to 3/4, or to what the link carried, below 1/2 in one go only when the pool overflowed
+#define VRATE_CUT_NUM               3
+#define VRATE_CUT_DEN               4
+#define VRATE_CUT_FLOOR_DEN         2
+// share of the carried bytes a frame may take, the rest drains the pool
+#define VRATE_FIT_NUM               7
+#define VRATE_FIT_DEN               8
+// grow by 1/16 of the range per period, 1/4 of that above 7/8 of the rate the link
+// gave up at last time, or by half the target while that is unknown
+#define VRATE_STEP_DIV              16
+#define VRATE_STEP_SLOW_DIV         4
+#define VRATE_STEP_FAST_DIV         2
+// the link carried 9/8 of it, or 17/16 with the pool empty for 2 periods,
+// so it is not the limit any more
+#define VRATE_CEIL_UP_NUM           8
+#define VRATE_CEIL_UP_DEN           9
+#define VRATE_CEIL_IDLE_NUM         16
+#define VRATE_CEIL_IDLE_DEN         17
+#define VRATE_CEIL_IDLE             2
+// every further idle period doubles the step, up to 8 times, below the ceiling if known
+#define VRATE_STEP_IDLE_SHIFT       3
+// low target while the pool stays empty, the encoder climbs up to the target
+#define VRATE_IDLE_LOW_NUM          7
+#define VRATE_IDLE_LOW_DEN          8
+
+#define VRATE_LOSS_HIGH             50      // per mille
+#define VRATE_LOSS_LOW              10
+#define VRATE_HOLD                  2       // periods at fps_max, as long at lower fps
+#define VRATE_FPS_DOWN              2
+#define VRATE_FPS_UP                4       // periods at fps_max, as long at lower fps
+
+UINT32 vrate_fps(UINT32 fps_type)
+{
+    switch (fps_type)
+    {
+    case TYPE_5FPS:
+        return 5;
+    case TYPE_10FPS:
+        return 10;
+    default:
+        return 20;
+    }
+}
+
+static UINT32 vrate_clamp(VRATE_PTR rc, UINT32 size)
+{
+    if (size < rc->cfg.size_min)
+    {
+        return rc->cfg.size_min;
+    }
+    if (size > rc->cfg.size_max)
+    {
+        return rc->cfg.size_max;
+    }
+    return size;
+}
+
+// periods at this fps that take as long as cnt of them at fps_max
+static UINT32 vrate_periods(VRATE_PTR rc, UINT32 fps, UINT32 cnt)
+{
+    cnt = cnt * vrate_fps(fps) / vrate_fps(rc->cfg.fps_max);
+
+    return cnt ? cnt : 1;
+}
+
+void vrate_init(VRATE_PTR rc, VRATE_CFG_PTR cfg)
+{
+    rc->cfg = *cfg;
+    if (rc->cfg.size_min > rc->cfg.size_max)
+    {
+        rc->cfg.size_min = rc->cfg.size_max;
+    }
+    if (rc->cfg.period == 0)
+    {
+        rc->cfg.period = 1;
+    }
+    if (rc->cfg.fps_max >= FPS_MAX)
+    {
+        rc->cfg.fps_max = FPS_MAX - 1;
+    }
+    if (rc->cfg.fps_min > rc->cfg.fps_max)
+    {
+        rc->cfg.fps_min = rc->cfg.fps_max;
+    }
+
+    // start at the top, the first congestion brings it down to the link
+    rc->target = rc->cfg.size_max;
+    rc->low = VRATE_LOW(rc->target);
+    rc->fps = rc->cfg.fps_max;
+    rc->rate = 0;
+    rc->ceil = 0;
+    rc->hold = 0;
+    rc->behind = 0;
+    rc->ahead = 0;
+    rc->idle = 0;
+    rc->stats.updates = 0;
+    rc->stats.cuts = 0;
+    rc->stats.raises = 0;
+    rc->stats.fps_downs = 0;
+    rc->stats.fps_ups = 0;
+}
+
+void vrate_set_fps_max(VRATE_PTR rc, UINT32 fps_type)
+{
+    if (fps_type >= FPS_MAX)
+    {
+        return;
+    }
+
+    rc->cfg.fps_max = fps_type;
+    if (rc->cfg.fps_min > fps_type)
+    {
+        rc->cfg.fps_min = fps_type;
+    }
+    rc->fps = fps_type;
+    rc->behind = 0;
+    rc->ahead = 0;
+}
+
+UINT32 vrate_update(VRATE_PTR rc, VRATE_IN_PTR in)
+{
+    UINT32 target = rc->target, fps = rc->fps, low;
+    UINT32 loss, congested, idle, small, size, sent, step, ret = 0;
+
+    if ((in->elapse_ms == 0) || (in->node_cnt == 0))
+    {
+        return 0;
+    }
+    rc->stats.updates++;
+    rc->rate = (UINT32)((UINT64)in->bytes_sent * 1000 / in->elapse_ms);
+
+    loss = (in->rx_loss == VRATE_RX_LOSS_NONE) ? 0 : in->rx_loss;
+    // stale drops keep the pool from filling up, so they count like a full pool:
+    // one cut per period, not below half of the target
+    congested = in->pkts_dropped || in->frames_dropped || in->pkts_stale
+                || (loss >= VRATE_LOSS_HIGH) || (in->nodes_in_use * 4 > in->node_cnt * 3);
+    idle = !congested && (loss < VRATE_LOSS_LOW) && (in->nodes_in_use * 4 <= in->node_cnt);
+    if (!idle)
+    {
+        rc->idle = 0;
+    }
+    else if (rc->idle < 0xFF)
+    {
+        rc->idle++;
+    }
+
+    if (congested)
+    {
+        size = target * VRATE_CUT_NUM / VRATE_CUT_DEN;
+        sent = rc->rate / vrate_fps(fps) * VRATE_FIT_NUM / VRATE_FIT_DEN;
+        if (sent < size)
+        {
+            size = sent;
+        }
+        if (!in->pkts_dropped && (size < target / VRATE_CUT_FLOOR_DEN))
+        {
+            size = target / VRATE_CUT_FLOOR_DEN;
+        }
+        target = vrate_clamp(rc, size);
+        if (loss < VRATE_LOSS_HIGH)
+        {
+            // the pool filled up, so this is what the link can do
+            rc->ceil = rc->rate;
+        }
+        rc->hold = vrate_periods(rc, fps, VRATE_HOLD);
+        rc->ahead = 0;
+
+        // smallest frames are still too much, fewer of them then
+        if ((rc->target == rc->cfg.size_min) && (++rc->behind >= VRATE_FPS_DOWN)
+                && (fps > rc->cfg.fps_min))
+        {
+            fps--;
+            target = vrate_clamp(rc, rc->rate / vrate_fps(fps) * VRATE_FIT_NUM / VRATE_FIT_DEN);
+            rc->behind = 0;
+            rc->stats.fps_downs++;
+        }
+        else if (rc->target != rc->cfg.size_min)
+        {
+            rc->behind = 0;
+        }
+    }
+    else if (rc->hold)
+    {
+        rc->hold--;
+        rc->behind = 0;
+    }
+    else if (idle)
+    {
+        rc->behind = 0;
+
+        // carried more than where it gave up last time, the link got better
+        if (rc->ceil && ((rc->rate / VRATE_CEIL_UP_DEN * VRATE_CEIL_UP_NUM > rc->ceil)
+                         || ((rc->idle >= VRATE_CEIL_IDLE)
+                             && (rc->rate / VRATE_CEIL_IDLE_DEN * VRATE_CEIL_IDLE_NUM > rc->ceil))))
+        {
+            rc->ceil = 0;
+        }
+
+        step = (rc->cfg.size_max - rc->cfg.size_min) / VRATE_STEP_DIV;
+        if (rc->ceil == 0)
+        {
+            // no idea where the link ends, grow faster
+            if (step < target / VRATE_STEP_FAST_DIV)
+            {
+                step = target / VRATE_STEP_FAST_DIV;
+            }
+        }
+        else if (rc->rate / VRATE_FIT_NUM * VRATE_FIT_DEN >= rc->ceil)
+        {
+            step /= VRATE_STEP_SLOW_DIV;
+        }
+        size = target + step;
+
+        // still nothing queued, the link has more to give than it takes now,
+        // up to where it gave up last time if that is known
+        if (rc->idle > 1)
+        {
+            step <<= (rc->idle - 1 < VRATE_STEP_IDLE_SHIFT) ? (rc->idle - 1) : VRATE_STEP_IDLE_SHIFT;
+            sent = target + step;
+            if (rc->ceil && (sent > rc->ceil / vrate_fps(fps) * VRATE_FIT_NUM / VRATE_FIT_DEN))
+            {
+                sent = rc->ceil / vrate_fps(fps) * VRATE_FIT_NUM / VRATE_FIT_DEN;
+            }
+            if (sent > size)
+            {
+                size = sent;
+            }
+        }
+
+        // frames under the low target, the encoder has no use for more
+        small = in->frames && (in->bytes_sent / in->frames < rc->low);
+        if (small)
+        {
+            size = target;
+        }
+        target = vrate_clamp(rc, size);
+
+        // frames are big enough and the link keeps up, spend it on more of them
+        if (rc->ceil || (!small && (target < VRATE_LOW(rc->cfg.size_max))))
+        {
+            rc->ahead = 0;
+        }
+        else if ((++rc->ahead >= vrate_periods(rc, fps, VRATE_FPS_UP)) && (fps < rc->cfg.fps_max))
+        {
+            target = vrate_clamp(rc, target * vrate_fps(fps) / vrate_fps(fps + 1));
+            fps++;
+            rc->hold = vrate_periods(rc, fps, VRATE_HOLD);
+            rc->ahead = 0;
+            rc->stats.fps_ups++;
+        }
+    }
+    else
+    {
+        rc->behind = 0;
+        rc->ahead = 0;
+    }
+
+    // the link keeps up, let the encoder spend what the target gives
+    if (rc->idle >= VRATE_CEIL_IDLE)
+    {
+        low = target / VRATE_IDLE_LOW_DEN * VRATE_IDLE_LOW_NUM;
+    }
+    else
+    {
+        low = VRATE_LOW(target);
+    }
+
+    if (target < rc->target)
+    {
+        rc->stats.cuts++;
+    }
+    else if (target > rc->target)
+    {
+        rc->stats.raises++;
+    }
+
+    if ((target != rc->target) || (low != rc->low))
+    {
+        rc->target = target;
+        rc->low = low;
+        ret |= VRATE_NEW_SIZE;
+    }
+    if (fps != rc->fps)
+    {
+        rc->fps = fps;
+        ret |= VRATE_NEW_FPS;
+    }
+
+    return ret;
+}
+#endif // (CFG_USE_CAMERA_INTF && CFG_USE_APP_DEMO_VIDEO_TRANSFER)
+// eof
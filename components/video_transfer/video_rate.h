@@ -0,0 +1,76 @@
+#ifndef __VIDEO_RATE_H__
+#define __VIDEO_RATE_H__
+
+/*
+ * Rate controller for the jpeg stream. Every few frames it looks at what the
+ * link took (bytes sent, pool depth, dropped packets, loss the receiver
+ * reports) and moves the target frame size of the encoder: cut down to what
+ * the link carried when the pool fills up or packets get lost, grow in small
+ * steps while the link keeps up. With the size at its minimum and the link
+ * still behind, the frame rate goes one step down, and up again once the size
+ * is back at its maximum. No sdk calls in here, the video thread feeds it.
+ */
+#define VRATE_RX_LOSS_NONE          0xFFFF
+
+// low target of the encoder, it gets more quality below this size
+#define VRATE_LOW(target)           ((target) * 5 / 8)
+
+// vrate_update result
+#define VRATE_NEW_SIZE              0x01
+#define VRATE_NEW_FPS               0x02
+
+typedef struct vrate_cfg_st
+{
+    UINT32 size_min;            // bounds of the target frame size, bytes
+    UINT32 size_max;
+    UINT32 period;              // frames between two updates
+    UINT8 fps_min;              // FPS_TYPE
+    UINT8 fps_max;
+} VRATE_CFG_ST, *VRATE_CFG_PTR;
+
+// what happened since the last update
+typedef struct vrate_in_st
+{
+    UINT32 elapse_ms;
+    UINT32 frames;
+    UINT32 frames_dropped;
+    UINT32 pkts_dropped;        // pool ran out, frames broke at the camera
+    UINT32 pkts_stale;          // unsent, the pacer dropped them for a newer frame
+    UINT32 bytes_sent;
+    UINT32 nodes_in_use;        // pool depth right now
+    UINT32 node_cnt;
+    UINT32 rx_loss;             // per mille seen by the receiver, or VRATE_RX_LOSS_NONE
+} VRATE_IN_ST, *VRATE_IN_PTR;
+
+typedef struct vrate_stats_st
+{
+    UINT32 updates;
+    UINT32 cuts;
+    UINT32 raises;
+    UINT32 fps_downs;
+    UINT32 fps_ups;
+} VRATE_STATS_ST, *VRATE_STATS_PTR;
+
+typedef struct vrate_st
+{
+    VRATE_CFG_ST cfg;
+    UINT32 target;              // high target of the encoder
+    UINT32 low;                 // low target, VRATE_LOW() of it or closer while the link keeps up
+    UINT32 fps;                 // FPS_TYPE
+    UINT32 rate;                // bytes/s the link carried in the last period
+    UINT32 ceil;                // rate at the last congestion, 0 when outgrown
+    UINT8 hold;                 // periods left to wait after a change
+    UINT8 behind;               // periods in a row behind at size_min
+    UINT8 ahead;                // periods in a row idle with big frames
+    UINT8 idle;                 // periods in a row with the pool empty
+    VRATE_STATS_ST stats;
+} VRATE_ST, *VRATE_PTR;
+
+UINT32 vrate_fps(UINT32 fps_type);
+void vrate_init(VRATE_PTR rc, VRATE_CFG_PTR cfg);
+// frame rate picked by the user, new ceiling and new starting point
+void vrate_set_fps_max(VRATE_PTR rc, UINT32 fps_type);
+UINT32 vrate_update(VRATE_PTR rc, VRATE_IN_PTR in);
+
+#endif // __VIDEO_RATE_H__
+// eof
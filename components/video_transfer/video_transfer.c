@@ -12,6 +12,7 @@
 
 #include "drv_model_pub.h"
 #include "mem_pub.h"
+#include "str_pub.h"
 
 #include "spidma_intf_pub.h"
 #include "camera_intf_pub.h"
@@ -20,6 +21,36 @@
 #include "general_dma_pub.h"
 #endif
 
+// jpeg isr only starts the copy into the node, video thread waits for it
+#if (CFG_GENERAL_DMA && GDMA_ASYNC_EN)
+#define TVIDEO_ASYNC_COPY           1
+#else
+#define TVIDEO_ASYNC_COPY           0
+#endif
+
+#define TVIDEO_USE_ZERO_COPY        1
+
+// move jpeg target size and fps with what the link takes, camera encoder only
+#define TVIDEO_RATE_CTRL            CFG_USE_CAMERA_INTF
+
+// spread each frame over its interval and drop what a newer frame made useless
+#define TVIDEO_PACE                 1
+
+#if TVIDEO_USE_ZERO_COPY
+#include "lwip/pbuf.h"
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error "zero-copy video transfer need LWIP_SUPPORT_CUSTOM_PBUF"
+#endif
+#endif
+
+#if TVIDEO_RATE_CTRL
+#include "video_rate.h"
+#endif
+
+#if TVIDEO_PACE
+#include "video_pace.h"
+#endif
+
 #define TVIDEO_DEBUG                1
 #include "uart_pub.h"
 #if TVIDEO_DEBUG
@@ -49,6 +80,42 @@
 #define TVIDEO_POOL_LEN             (TVIDEO_RXNODE_SIZE * 25)  // 7KB
 #endif
 
+#define TVIDEO_POOL_NODE_CNT        (TVIDEO_POOL_LEN / TVIDEO_RXNODE_SIZE)
+#define TVIDEO_POOL_NODE_MAX        64
+// frame drop hysteresis, in free nodes: stop taking frames below LOW, resume at HIGH
+#define TVIDEO_POOL_LOW_WM          (TVIDEO_POOL_NODE_CNT / 5)
+#define TVIDEO_POOL_HIGH_WM         (TVIDEO_POOL_NODE_CNT / 2)
+
+// ready ring between jpeg isr and video thread, power of 2 and >= node count
+#define TVIDEO_READY_RING_LEN       TVIDEO_POOL_NODE_MAX
+#define TVIDEO_READY_RING_MASK      (TVIDEO_READY_RING_LEN - 1)
+// retry interval while socket is full and ready nodes are left
+#define TVIDEO_SEND_RETRY_MS        2
+
+#if TVIDEO_RATE_CTRL
+#define TVIDEO_RATE_PERIOD          8       // frames between two controller updates
+#define TVIDEO_RATE_SIZE_DIV        8       // smallest target, part of the one jpeg starts with
+#endif
+
+#if TVIDEO_PACE
+// udp node is stale once this many newer frames are complete
+#define TVIDEO_PACE_STALE_FRAMES    2
+#endif
+
+#define TVIDEO_DROP_FRAME_NONODE    0x01    // ran out of node in this frame
+#define TVIDEO_DROP_FRAME_WM        0x02    // free nodes under low watermark
+
+#if TVIDEO_USE_ZERO_COPY
+// zero-copy slot: [pbuf_custom][udp/ip/link header room][node data][link trailer room],
+// the wifi tx path sends it in place when both rooms are there
+#define TVIDEO_ZC_PC_SIZE           LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf_custom))
+#define TVIDEO_ZC_HDR_ROOM          LWIP_MEM_ALIGN_SIZE(PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN \
+                                        + PBUF_IP_HLEN + PBUF_TRANSPORT_HLEN)
+#define TVIDEO_ZC_MEM_SIZE          (TVIDEO_ZC_HDR_ROOM + LWIP_MEM_ALIGN_SIZE(TVIDEO_RXNODE_SIZE) \
+                                        + LWIP_MEM_ALIGN_SIZE(PBUF_LINK_ENCAPSULATION_TLEN))
+#define TVIDEO_ZC_SLOT_SIZE         (TVIDEO_ZC_PC_SIZE + TVIDEO_ZC_MEM_SIZE)
+#endif
+
 #define TVIDEO_RXBUF_LEN            (TVIDEO_RXNODE_SIZE_UDP * 4)
 
 UINT8 tvideo_rxbuf[TVIDEO_RXBUF_LEN];
@@ -59,15 +126,42 @@ typedef struct tvideo_elem_st
     struct co_list_hdr hdr;
     void *buf_start;
     UINT32 buf_len;
+    UINT32 sent_len;
+    UINT32 rx_time;
+    #if TVIDEO_PACE
+    UINT32 frame;               // pace_frames when it came in
+    #endif
+    #if TVIDEO_USE_ZERO_COPY
+    struct pbuf_custom *pc;
+    #endif
+    #if TVIDEO_ASYNC_COPY
+    GDMA_REQ_ST dma;
+    #endif
 } TVIDEO_ELEM_ST, *TVIDEO_ELEM_PTR;
 
+// single producer (isr) / single consumer (video thread), no lock needed
+typedef struct tvideo_ready_ring_st
+{
+    volatile UINT32 in;     // only written by producer
+    volatile UINT32 out;    // only written by consumer
+    TVIDEO_ELEM_PTR node[TVIDEO_READY_RING_LEN];
+} TVIDEO_READY_RING_ST;
+
 typedef struct tvideo_pool_st
 {
     //UINT8*  pool[TVIDEO_POOL_LEN];
     UINT8 *pool;
-    TVIDEO_ELEM_ST elem[TVIDEO_POOL_LEN / TVIDEO_RXNODE_SIZE];
+    UINT32 pool_len;
+    TVIDEO_ELEM_PTR elem;
+    UINT32 node_cnt;
+    UINT32 low_wm;
+    UINT32 high_wm;
     struct co_list free;
-    struct co_list ready;
+    TVIDEO_READY_RING_ST ready;
+
+    UINT32 drop_frame_flag;
+    UINT32 frame_drop_pkts;
+    TVIDEO_STATS_ST stats;
 
     #if TVIDEO_DROP_DATA_NONODE
     struct co_list receiving;
@@ -77,14 +171,43 @@ typedef struct tvideo_pool_st
     UINT16 open_type;
     UINT16 send_type;
     video_transfer_send_func send_func;
+    video_transfer_send_batch_func send_batch_func;
     video_transfer_start_cb start_cb;
     video_transfer_end_cb end_cb;
 
+    #if TVIDEO_USE_ZERO_COPY
+    video_transfer_send_pbuf_func send_pbuf_func;
+    video_transfer_send_pbufs_func send_pbufs_func;
+    volatile UINT32 zc_inflight;  // nodes held by lwip/mac, back on free list by pbuf free
+    // pool of a closed session with pbufs still out, the last pbuf free releases it
+    UINT8 *zc_old_pool;
+    UINT32 zc_old_len;
+    UINT32 zc_old_inflight;
+    #endif
+
     #if(TVIDEO_USE_HDR && CFG_USE_CAMERA_INTF)
     UINT16 frame_id;
     UINT16 pkt_header_size;
     tvideo_add_pkt_header add_pkt_header;
     #endif
+
+    #if TVIDEO_RATE_CTRL
+    UINT32 rate_on;
+    VRATE_ST rate;
+    TVIDEO_STATS_ST rate_last;
+    UINT32 rate_time;
+    volatile UINT32 rate_rx_loss;       // last receiver report, per mille
+    volatile UINT32 rate_fps_req;       // fps picked by the user, FPS_MAX when none
+    #endif
+
+    #if TVIDEO_PACE
+    UINT32 pace_on;
+    VPACE_ST pace;
+    volatile UINT32 pace_frames;        // frames ended, counted by isr
+    volatile UINT32 pace_rx_bytes;      // bytes put into nodes, counted by isr
+    UINT32 pace_last_frames;
+    UINT32 pace_last_rx_bytes;
+    #endif
 } TVIDEO_POOL_ST, *TVIDEO_POOL_PTR;
 
 TVIDEO_POOL_ST tvideo_pool;
@@ -100,10 +223,68 @@ typedef struct tvideo_message
     UINT32 data;
 } TV_MSG_T;
 
-#define TV_QITEM_COUNT      (60)
+#define TV_QITEM_COUNT      (10)
 beken_thread_t  tvideo_thread_hdl = NULL;
 beken_queue_t tvideo_msg_que = NULL;
 
+static UINT32 tvideo_ready_cnt(void)
+{
+    return tvideo_pool.ready.in - tvideo_pool.ready.out;
+}
+
+// producer side, return 1 if ring was empty, so consumer need a wakeup
+static UINT32 tvideo_ready_put(TVIDEO_ELEM_PTR elem)
+{
+    UINT32 in = tvideo_pool.ready.in;
+    UINT32 was_empty = (in == tvideo_pool.ready.out);
+
+    tvideo_pool.ready.node[in & TVIDEO_READY_RING_MASK] = elem;
+    barrier();
+    tvideo_pool.ready.in = in + 1;
+
+    return was_empty;
+}
+
+// consumer side, idx-th ready node from head without removing it
+static TVIDEO_ELEM_PTR tvideo_ready_peek(UINT32 idx)
+{
+    TVIDEO_ELEM_PTR elem;
+
+    if (idx >= tvideo_ready_cnt())
+    {
+        return NULL;
+    }
+
+    barrier();
+    elem = tvideo_pool.ready.node[(tvideo_pool.ready.out + idx) & TVIDEO_READY_RING_MASK];
+    #if TVIDEO_ASYNC_COPY
+    // node is queued before its data has landed
+    gdma_req_wait(&elem->dma);
+    #endif
+
+    return elem;
+}
+
+static void tvideo_ready_pop(void)
+{
+    barrier();
+    tvideo_pool.ready.out++;
+}
+
+static void tvideo_copy_to_node(TVIDEO_ELEM_PTR elem, void *dst, void *src, UINT32 len)
+{
+    #if TVIDEO_ASYNC_COPY
+    if (GDMA_SUCCESS != gdma_memcpy_async(&elem->dma, dst, src, len, NULL, NULL))
+    {
+        // the last copy into this node is still running, let it land first
+        gdma_req_wait(&elem->dma);
+        gdma_memcpy(dst, src, len);
+    }
+    #else
+    gdma_memcpy(dst, src, len);
+    #endif
+}
+
 void tvideo_intfer_send_msg(UINT32 new_msg)
 {
     OSStatus ret;
@@ -121,14 +302,189 @@ void tvideo_intfer_send_msg(UINT32 new_msg)
     }
 }
 
+#if TVIDEO_USE_ZERO_COPY
+static void tvideo_pbuf_free_handler(struct pbuf *p)
+{
+    UINT8 *slot = (UINT8 *)p;
+    UINT8 *old_pool = NULL;
+    UINT32 idx, stale = 0;
+    GLOBAL_INT_DECLARATION();
+
+    // pool may be retired by the video thread meanwhile, look at it under lock
+    GLOBAL_INT_DISABLE();
+    if (tvideo_pool.pool && (slot >= tvideo_pool.pool)
+            && (slot < tvideo_pool.pool + tvideo_pool.pool_len))
+    {
+        idx = (slot - tvideo_pool.pool) / TVIDEO_ZC_SLOT_SIZE;
+        tvideo_pool.zc_inflight--;
+        tvideo_pool.stats.nodes_in_use--;
+        co_list_push_back(&tvideo_pool.free, (struct co_list_hdr *)&tvideo_pool.elem[idx].hdr);
+    }
+    else if (tvideo_pool.zc_old_pool && (slot >= tvideo_pool.zc_old_pool)
+             && (slot < tvideo_pool.zc_old_pool + tvideo_pool.zc_old_len))
+    {
+        // closed session, the node has no free list any more
+        if (--tvideo_pool.zc_old_inflight == 0)
+        {
+            old_pool = tvideo_pool.zc_old_pool;
+            tvideo_pool.zc_old_pool = NULL;
+        }
+    }
+    else
+    {
+        stale = 1;
+    }
+    GLOBAL_INT_RESTORE();
+
+    if (old_pool)
+    {
+        os_free(old_pool);
+    }
+    else if (stale)
+    {
+        TVIDEO_WPRT("tvideo stale pbuf:%p\r\n", p);
+    }
+}
+#endif
+
+// video thread, camera is stopped, no isr touches the pool any more
+static void tvideo_pool_deinit(void)
+{
+    UINT8 *pool;
+    #if TVIDEO_USE_ZERO_COPY
+    UINT32 leak = 0;
+    #endif
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    pool = tvideo_pool.pool;
+    tvideo_pool.pool = NULL;
+    #if TVIDEO_USE_ZERO_COPY
+    // pbufs may still wait in core thread or mac, don't free the pool under them
+    if (tvideo_pool.zc_inflight)
+    {
+        if (tvideo_pool.zc_old_pool == NULL)
+        {
+            tvideo_pool.zc_old_pool = pool;
+            tvideo_pool.zc_old_len = tvideo_pool.pool_len;
+            tvideo_pool.zc_old_inflight = tvideo_pool.zc_inflight;
+        }
+        else
+        {
+            // an older session still waits for its pbufs, this pool can't be tracked
+            leak = tvideo_pool.zc_inflight;
+        }
+        tvideo_pool.zc_inflight = 0;
+        pool = NULL;
+    }
+    #endif
+    GLOBAL_INT_RESTORE();
+
+    #if TVIDEO_USE_ZERO_COPY
+    if (leak)
+    {
+        TVIDEO_WPRT("tvideo pool leaked, %d pbufs still inflight\r\n", leak);
+    }
+    #endif
+
+    if (pool)
+    {
+        os_free(pool);
+    }
+
+    if (tvideo_pool.elem)
+    {
+        os_free(tvideo_pool.elem);
+        tvideo_pool.elem = NULL;
+    }
+}
+
+static const UINT16 tvideo_latency_bound[TVIDEO_LATENCY_BUCKETS - 1] = {2, 5, 10, 20, 50};
+
+static void tvideo_latency_record(UINT32 rx_time)
+{
+    UINT32 delay = rtos_get_time() - rx_time;
+    UINT32 idx;
+
+    #if TVIDEO_PACE
+    // a node should be out within one frame interval
+    if (tvideo_pool.pace_on && tvideo_pool.pace.interval && (delay > tvideo_pool.pace.interval))
+    {
+        idx = delay - tvideo_pool.pace.interval;
+        tvideo_pool.stats.pkts_late++;
+        tvideo_pool.stats.late_sum_ms += idx;
+        if (idx > tvideo_pool.stats.late_max_ms)
+        {
+            tvideo_pool.stats.late_max_ms = idx;
+        }
+    }
+    #endif
+
+    for (idx = 0; idx < (TVIDEO_LATENCY_BUCKETS - 1); idx++)
+    {
+        if (delay < tvideo_latency_bound[idx])
+        {
+            break;
+        }
+    }
+
+    tvideo_pool.stats.latency_hist[idx]++;
+}
+
+static void tvideo_pool_setup_wm(TVIDEO_SETUP_DESC_PTR setup)
+{
+    UINT32 node_cnt = setup->pool_node_cnt;
+
+    if ((node_cnt == 0) || (node_cnt > TVIDEO_POOL_NODE_MAX))
+    {
+        node_cnt = TVIDEO_POOL_NODE_CNT;
+    }
+
+    tvideo_pool.node_cnt = node_cnt;
+    tvideo_pool.low_wm = setup->pool_low_wm;
+    tvideo_pool.high_wm = setup->pool_high_wm;
+
+    if ((tvideo_pool.low_wm == 0) && (tvideo_pool.high_wm == 0))
+    {
+        tvideo_pool.low_wm = node_cnt * TVIDEO_POOL_LOW_WM / TVIDEO_POOL_NODE_CNT;
+        tvideo_pool.high_wm = node_cnt * TVIDEO_POOL_HIGH_WM / TVIDEO_POOL_NODE_CNT;
+    }
+
+    if ((tvideo_pool.high_wm < tvideo_pool.low_wm) || (tvideo_pool.high_wm > node_cnt))
+    {
+        TVIDEO_WPRT("tvideo bad watermark:%d-%d\r\n", tvideo_pool.low_wm, tvideo_pool.high_wm);
+        tvideo_pool.high_wm = tvideo_pool.low_wm = 0;
+    }
+}
+
 static void tvideo_pool_init(void *data)
 {
     UINT32 i = 0;
-    TVIDEO_SETUP_DESC_PTR setup = (TVIDEO_SETUP_DESC_PTR)((int)data);
+    UINT32 slot_size = TVIDEO_RXNODE_SIZE;
+    UINT32 buf_offset = 0;
+    TVIDEO_SETUP_DESC_PTR setup = (TVIDEO_SETUP_DESC_PTR)data;
+
+    tvideo_pool_setup_wm(setup);
+    os_memset(&tvideo_pool.stats, 0, sizeof(TVIDEO_STATS_ST));
+    tvideo_pool.stats.node_cnt = tvideo_pool.node_cnt;
+    tvideo_pool.stats.start_time = rtos_get_time();
+    tvideo_pool.drop_frame_flag = 0;
+    tvideo_pool.frame_drop_pkts = 0;
+
+    #if TVIDEO_USE_ZERO_COPY
+    tvideo_pool.send_pbuf_func = setup->send_pbuf_func;
+    tvideo_pool.send_pbufs_func = setup->send_pbufs_func;
+    if (tvideo_pool.send_pbuf_func || tvideo_pool.send_pbufs_func)
+    {
+        slot_size = TVIDEO_ZC_SLOT_SIZE;
+        buf_offset = TVIDEO_ZC_PC_SIZE + TVIDEO_ZC_HDR_ROOM;
+    }
+    #endif
 
     if (tvideo_pool.pool == NULL)
     {
-        tvideo_pool.pool = os_malloc(sizeof(UINT8) * TVIDEO_POOL_LEN);
+        tvideo_pool.pool_len = slot_size * tvideo_pool.node_cnt;
+        tvideo_pool.pool = os_malloc(sizeof(UINT8) * tvideo_pool.pool_len);
         if (tvideo_pool.pool == NULL)
         {
             TVIDEO_FATAL("tvideo_pool alloc failed\r\n");
@@ -136,20 +492,37 @@ static void tvideo_pool_init(void *data)
         }
     }
 
-    os_memset(&tvideo_pool.pool[0], 0, sizeof(UINT8)*TVIDEO_POOL_LEN);
+    if (tvideo_pool.elem == NULL)
+    {
+        tvideo_pool.elem = os_malloc(sizeof(TVIDEO_ELEM_ST) * tvideo_pool.node_cnt);
+        if (tvideo_pool.elem == NULL)
+        {
+            TVIDEO_FATAL("tvideo_pool elem alloc failed\r\n");
+            ASSERT(1);
+        }
+    }
+
+    os_memset(&tvideo_pool.pool[0], 0, sizeof(UINT8)*tvideo_pool.pool_len);
 
     co_list_init(&tvideo_pool.free);
-    co_list_init(&tvideo_pool.ready);
+    tvideo_pool.ready.in = 0;
+    tvideo_pool.ready.out = 0;
     #if TVIDEO_DROP_DATA_NONODE
     co_list_init(&tvideo_pool.receiving);
     tvideo_pool.drop_pkt_flag = 0;
     #endif
 
-    for (i = 0; i < (TVIDEO_POOL_LEN / TVIDEO_RXNODE_SIZE); i++)
+    for (i = 0; i < tvideo_pool.node_cnt; i++)
     {
         tvideo_pool.elem[i].buf_start =
-            (void *)&tvideo_pool.pool[i * TVIDEO_RXNODE_SIZE];
+            (void *)&tvideo_pool.pool[i * slot_size + buf_offset];
         tvideo_pool.elem[i].buf_len = 0;
+        #if TVIDEO_USE_ZERO_COPY
+        tvideo_pool.elem[i].pc = (struct pbuf_custom *)&tvideo_pool.pool[i * slot_size];
+        #endif
+        #if TVIDEO_ASYNC_COPY
+        os_memset(&tvideo_pool.elem[i].dma, 0, sizeof(GDMA_REQ_ST));
+        #endif
 
         co_list_push_back(&tvideo_pool.free,
                           (struct co_list_hdr *)&tvideo_pool.elem[i].hdr);
@@ -161,9 +534,25 @@ static void tvideo_pool_init(void *data)
     tvideo_pool.open_type = setup->open_type;
     tvideo_pool.send_type = setup->send_type;
     tvideo_pool.send_func = setup->send_func;
+    tvideo_pool.send_batch_func = setup->send_batch_func;
     tvideo_pool.start_cb = setup->start_cb;
     tvideo_pool.end_cb = setup->end_cb;
 
+    #if TVIDEO_RATE_CTRL
+    tvideo_pool.rate_on = setup->rate_ctrl && (setup->open_type != TVIDEO_OPEN_SPIDMA);
+    tvideo_pool.rate_rx_loss = VRATE_RX_LOSS_NONE;
+    tvideo_pool.rate_fps_req = FPS_MAX;
+    #endif
+
+    #if TVIDEO_PACE
+    tvideo_pool.pace_on = setup->pace;
+    vpace_init(&tvideo_pool.pace, TVIDEO_RXNODE_SIZE);
+    tvideo_pool.pace_frames = 0;
+    tvideo_pool.pace_rx_bytes = 0;
+    tvideo_pool.pace_last_frames = 0;
+    tvideo_pool.pace_last_rx_bytes = 0;
+    #endif
+
     #if(TVIDEO_USE_HDR && CFG_USE_CAMERA_INTF)
     // sccb with camera interface on chip, or default
     if ((tvideo_pool.open_type != TVIDEO_OPEN_SPIDMA)
@@ -182,6 +571,7 @@ static void tvideo_pool_init(void *data)
 static void tvideo_rx_handler(void *curptr, UINT32 newlen, UINT32 is_eof, UINT32 frame_len)
 {
     TVIDEO_ELEM_PTR elem = NULL;
+    UINT32 wakeup = 0;
     do
     {
         if (!newlen)
@@ -197,6 +587,13 @@ static void tvideo_rx_handler(void *curptr, UINT32 newlen, UINT32 is_eof, UINT32
         }
         #endif
 
+        // frame already broken or pool under watermark, drop rest of this frame
+        if (tvideo_pool.drop_frame_flag)
+        {
+            tvideo_pool.frame_drop_pkts++;
+            break;
+        }
+
         elem = (TVIDEO_ELEM_PTR)co_list_pick(&tvideo_pool.free);
         if (elem)
         {
@@ -232,7 +629,8 @@ static void tvideo_rx_handler(void *curptr, UINT32 newlen, UINT32 is_eof, UINT32
                     tvideo_pool.add_pkt_header(&param);
                 }
 
-                gdma_memcpy(param.ptk_ptr + tvideo_pool.pkt_header_size, curptr, newlen);
+                tvideo_copy_to_node(elem, param.ptk_ptr + tvideo_pool.pkt_header_size,
+                                    curptr, newlen);
                 if (tvideo_st.node_len > newlen)
                 {
                     //UINT32 left = tvideo_st.node_len - newlen;
@@ -245,7 +643,7 @@ static void tvideo_rx_handler(void *curptr, UINT32 newlen, UINT32 is_eof, UINT32
             #endif //#if (TVIDEO_USE_HDR && CFG_USE_CAMERA_INTF)
             {
                 // only copy data
-                gdma_memcpy(elem->buf_start, curptr, newlen);
+                tvideo_copy_to_node(elem, elem->buf_start, curptr, newlen);
                 if (tvideo_st.node_len > newlen)
                 {
                     //UINT32 left = tvideo_st.node_len - newlen;
@@ -255,11 +653,23 @@ static void tvideo_rx_handler(void *curptr, UINT32 newlen, UINT32 is_eof, UINT32
                 elem->buf_len = newlen;
             }
 
+            elem->sent_len = 0;
+            elem->rx_time = rtos_get_time();
+            #if TVIDEO_PACE
+            elem->frame = tvideo_pool.pace_frames;
+            tvideo_pool.pace_rx_bytes += elem->buf_len;
+            #endif
             co_list_pop_front(&tvideo_pool.free);
+            tvideo_pool.stats.nodes_in_use++;
+            if (tvideo_pool.stats.nodes_in_use > tvideo_pool.stats.nodes_in_use_max)
+            {
+                tvideo_pool.stats.nodes_in_use_max = tvideo_pool.stats.nodes_in_use;
+            }
             #if TVIDEO_DROP_DATA_NONODE
             co_list_push_back(&tvideo_pool.receiving, (struct co_list_hdr *)&elem->hdr);
             #else
-            co_list_push_back(&tvideo_pool.ready, (struct co_list_hdr *)&elem->hdr);
+            // thread is still draining if ring not empty, it will see this node
+            wakeup = tvideo_ready_put(elem);
             #endif
         }
         else
@@ -273,25 +683,66 @@ static void tvideo_rx_handler(void *curptr, UINT32 newlen, UINT32 is_eof, UINT32
             if (cnt_rdy)
             {
                 co_list_concat(&tvideo_pool.free, &tvideo_pool.receiving);
+                tvideo_pool.stats.nodes_in_use -= cnt_rdy;
             }
-            #else
-            TVIDEO_WPRT("lost\r\n");
             #endif
+            // the rest of this frame is garbage for receiver, don't waste nodes on it
+            tvideo_pool.drop_frame_flag |= TVIDEO_DROP_FRAME_NONODE;
+            tvideo_pool.frame_drop_pkts++;
         }
     }
     while (0);
 
-    tvideo_intfer_send_msg(TV_INT_POLL);
+    if (wakeup)
+    {
+        tvideo_intfer_send_msg(TV_INT_POLL);
+    }
+}
+
+static void tvideo_frame_drop_update(void)
+{
+    UINT32 free_cnt = tvideo_pool.node_cnt - tvideo_pool.stats.nodes_in_use;
+
+    tvideo_pool.stats.frames++;
+    if (tvideo_pool.frame_drop_pkts)
+    {
+        tvideo_pool.stats.frames_dropped++;
+        tvideo_pool.stats.pkts_dropped += tvideo_pool.frame_drop_pkts;
+        if (tvideo_pool.frame_drop_pkts > tvideo_pool.stats.max_drops_per_frame)
+        {
+            tvideo_pool.stats.max_drops_per_frame = tvideo_pool.frame_drop_pkts;
+        }
+        tvideo_pool.frame_drop_pkts = 0;
+    }
+
+    // decide for next frame, with hysteresis between low and high watermark
+    tvideo_pool.drop_frame_flag &= ~TVIDEO_DROP_FRAME_NONODE;
+    if (tvideo_pool.drop_frame_flag & TVIDEO_DROP_FRAME_WM)
+    {
+        if (free_cnt >= tvideo_pool.high_wm)
+        {
+            tvideo_pool.drop_frame_flag &= ~TVIDEO_DROP_FRAME_WM;
+        }
+    }
+    else if (free_cnt < tvideo_pool.low_wm)
+    {
+        tvideo_pool.drop_frame_flag |= TVIDEO_DROP_FRAME_WM;
+    }
 }
 
 static void tvideo_end_frame_handler(void)
 {
+    tvideo_frame_drop_update();
+    #if TVIDEO_PACE
+    tvideo_pool.pace_frames++;
+    #endif
+
     #if TVIDEO_DROP_DATA_NONODE
     // reset drop flag, new pkt can receive
     tvideo_pool.drop_pkt_flag &= (~TVIDEO_DROP_DATA_FLAG);
-    if (!co_list_is_empty(&tvideo_pool.receiving))
+    while (!co_list_is_empty(&tvideo_pool.receiving))
     {
-        co_list_concat(&tvideo_pool.ready, &tvideo_pool.receiving);
+        tvideo_ready_put((TVIDEO_ELEM_PTR)co_list_pop_front(&tvideo_pool.receiving));
     }
     #endif
 
@@ -358,34 +809,414 @@ static void tvideo_config_desc(void)
     tvideo_st.data_end_handler = tvideo_end_frame_handler;
 }
 
+static void tvideo_node_sent(TVIDEO_ELEM_PTR elem)
+{
+    GLOBAL_INT_DECLARATION();
+
+    tvideo_latency_record(elem->rx_time);
+
+    tvideo_ready_pop();
+
+    GLOBAL_INT_DISABLE();
+    co_list_push_back(&tvideo_pool.free, (struct co_list_hdr *)&elem->hdr);
+    tvideo_pool.stats.nodes_in_use--;
+    tvideo_pool.stats.pkts_sent++;
+    tvideo_pool.stats.bytes_sent += elem->buf_len;
+    GLOBAL_INT_RESTORE();
+}
+
+#if TVIDEO_PACE
+// drop udp nodes of a frame the receiver has no use for any more, a newer
+// one is complete and on its way
+static void tvideo_pace_drop_stale(UINT32 frames)
+{
+    TVIDEO_ELEM_PTR elem;
+    GLOBAL_INT_DECLARATION();
+
+    while ((elem = tvideo_ready_peek(0)) != NULL)
+    {
+        if (frames - elem->frame < TVIDEO_PACE_STALE_FRAMES)
+        {
+            break;
+        }
+
+        tvideo_ready_pop();
+
+        GLOBAL_INT_DISABLE();
+        co_list_push_back(&tvideo_pool.free, (struct co_list_hdr *)&elem->hdr);
+        tvideo_pool.stats.nodes_in_use--;
+        tvideo_pool.stats.pkts_stale++;
+        GLOBAL_INT_RESTORE();
+    }
+}
+
+// video thread, before each send round
+static void tvideo_pace_poll(void)
+{
+    UINT32 frames, bytes, now;
+
+    if (!tvideo_pool.pace_on)
+    {
+        return;
+    }
+
+    now = rtos_get_time();
+    bytes = tvideo_pool.pace_rx_bytes;
+    frames = tvideo_pool.pace_frames;
+    if (frames != tvideo_pool.pace_last_frames)
+    {
+        vpace_frame(&tvideo_pool.pace, now, frames - tvideo_pool.pace_last_frames,
+                    bytes - tvideo_pool.pace_last_rx_bytes);
+        tvideo_pool.pace_last_frames = frames;
+        tvideo_pool.pace_last_rx_bytes = bytes;
+    }
+
+    // a stream can't lose bytes in the middle, only udp drops
+    if (tvideo_pool.send_type == TVIDEO_SND_UDP)
+    {
+        tvideo_pace_drop_stale(frames);
+    }
+
+    vpace_refill(&tvideo_pool.pace, now, tvideo_ready_cnt() * tvideo_st.node_len);
+    tvideo_pool.stats.pace_rate = tvideo_pool.pace.rate;
+}
+
+// 1 if len may go out now, its tokens are taken then
+static UINT32 tvideo_pace_take(UINT32 len)
+{
+    if (!tvideo_pool.pace_on || vpace_take(&tvideo_pool.pace, len))
+    {
+        return 1;
+    }
+
+    tvideo_pool.stats.pace_waits++;
+    return 0;
+}
+
+// taken, but the socket didn't take it
+static void tvideo_pace_give(UINT32 len)
+{
+    if (tvideo_pool.pace_on)
+    {
+        vpace_give(&tvideo_pool.pace, len);
+    }
+}
+
+// ms until the head node may go out, 0 if now
+static UINT32 tvideo_pace_wait(void)
+{
+    TVIDEO_ELEM_PTR elem = tvideo_ready_peek(0);
+
+    if (!tvideo_pool.pace_on || (elem == NULL))
+    {
+        return 0;
+    }
+
+    return vpace_wait(&tvideo_pool.pace, elem->buf_len - elem->sent_len);
+}
+#else
+#define tvideo_pace_take(len)       1
+#define tvideo_pace_give(len)
+#endif
+
+#if TVIDEO_USE_ZERO_COPY
+static void tvideo_poll_handler_zero_copy(void)
+{
+    struct pbuf *p[TVIDEO_SEND_BATCH_MAX];
+    TVIDEO_ELEM_PTR elem = NULL;
+    UINT32 cnt, i, j;
+    int sent;
+    GLOBAL_INT_DECLARATION();
+
+    do
+    {
+        // wrap the head of ready ring into pbufs, nodes stay queued until sent
+        cnt = 0;
+        elem = tvideo_ready_peek(0);
+        while (elem && (cnt < TVIDEO_SEND_BATCH_MAX) && tvideo_pace_take(elem->buf_len))
+        {
+            p[cnt] = pbuf_alloced_custom(PBUF_TRANSPORT, elem->buf_len, PBUF_RAM, elem->pc,
+                                         (UINT8 *)elem->pc + TVIDEO_ZC_PC_SIZE, TVIDEO_ZC_MEM_SIZE);
+            if (p[cnt] == NULL)
+            {
+                tvideo_pace_give(elem->buf_len);
+                break;
+            }
+            elem->pc->custom_free_function = tvideo_pbuf_free_handler;
+
+            cnt++;
+            elem = tvideo_ready_peek(cnt);
+        }
+
+        if (cnt == 0)
+        {
+            break;
+        }
+
+        if (tvideo_pool.send_pbufs_func)
+        {
+            sent = tvideo_pool.send_pbufs_func(p, cnt);
+        }
+        else
+        {
+            for (sent = 0; sent < cnt; sent++)
+            {
+                UINT32 len = p[sent]->tot_len;
+
+                if (tvideo_pool.send_pbuf_func(p[sent]) != len)
+                {
+                    break;
+                }
+            }
+        }
+        tvideo_pool.stats.send_calls++;
+
+        for (i = 0; i < cnt; i++)
+        {
+            if (((int)i >= sent) && (p[i]->ref == 1))
+            {
+                // nobody else took the pbuf, keep node in ready list and retry
+                for (j = i; j < cnt; j++)
+                {
+                    tvideo_pace_give(p[j]->tot_len);
+                }
+                break;
+            }
+
+            elem = tvideo_ready_peek(0);
+            tvideo_latency_record(elem->rx_time);
+            tvideo_ready_pop();
+
+            GLOBAL_INT_DISABLE();
+            tvideo_pool.zc_inflight++;
+            tvideo_pool.stats.pkts_sent++;
+            tvideo_pool.stats.bytes_sent += elem->buf_len;
+            GLOBAL_INT_RESTORE();
+
+            // node goes back to free list when lwip and mac release the pbuf
+            pbuf_free(p[i]);
+        }
+    }
+    while (i == cnt);
+}
+#endif
+
+static void tvideo_poll_handler_batch(void)
+{
+    TVIDEO_SEND_VEC_ST vec[TVIDEO_SEND_BATCH_MAX];
+    TVIDEO_ELEM_PTR elem = NULL;
+    UINT32 cnt, total, left, rem;
+    int sent;
+
+    do
+    {
+        cnt = 0;
+        total = 0;
+        elem = tvideo_ready_peek(0);
+        while (elem && (cnt < TVIDEO_SEND_BATCH_MAX)
+                && tvideo_pace_take(elem->buf_len - elem->sent_len))
+        {
+            vec[cnt].data = (UINT8 *)elem->buf_start + elem->sent_len;
+            vec[cnt].len = elem->buf_len - elem->sent_len;
+            total += vec[cnt].len;
+
+            cnt++;
+            elem = tvideo_ready_peek(cnt);
+        }
+
+        if (cnt == 0)
+        {
+            break;
+        }
+
+        sent = tvideo_pool.send_batch_func(vec, cnt);
+        tvideo_pool.stats.send_calls++;
+        if (sent < (int)total)
+        {
+            tvideo_pace_give(total - ((sent > 0) ? sent : 0));
+        }
+        if (sent <= 0)
+        {
+            break;
+        }
+
+        // retire fully sent nodes, a stream socket may stop inside one
+        left = sent;
+        while (left)
+        {
+            elem = tvideo_ready_peek(0);
+            rem = elem->buf_len - elem->sent_len;
+            if (left < rem)
+            {
+                elem->sent_len += left;
+                break;
+            }
+
+            left -= rem;
+            tvideo_node_sent(elem);
+        }
+    }
+    while ((UINT32)sent == total);
+}
+
 static void tvideo_poll_handler(void)
 {
-    UINT32 send_len;
+    int send_len;
+    UINT32 rem;
     TVIDEO_ELEM_PTR elem = NULL;
 
+    #if TVIDEO_PACE
+    tvideo_pace_poll();
+    #endif
+
+    #if TVIDEO_USE_ZERO_COPY
+    if (tvideo_pool.send_pbuf_func || tvideo_pool.send_pbufs_func)
+    {
+        tvideo_poll_handler_zero_copy();
+        return;
+    }
+    #endif
+
+    if (tvideo_pool.send_batch_func)
+    {
+        tvideo_poll_handler_batch();
+        return;
+    }
+
     do
     {
-        elem = (TVIDEO_ELEM_PTR)co_list_pick(&tvideo_pool.ready);
+        elem = tvideo_ready_peek(0);
         if (elem)
         {
             if (tvideo_pool.send_func)
             {
+                rem = elem->buf_len - elem->sent_len;
+                if (!tvideo_pace_take(rem))
+                {
+                    break;
+                }
                 //REG_WRITE((0x00802800+(18*4)), 0x02);
-                send_len = tvideo_pool.send_func(elem->buf_start, elem->buf_len);
+                send_len = tvideo_pool.send_func((UINT8 *)elem->buf_start + elem->sent_len, rem);
                 //REG_WRITE((0x00802800+(18*4)), 0x00);
-                if (send_len != elem->buf_len)
+                tvideo_pool.stats.send_calls++;
+                if (send_len != rem)
                 {
+                    // partial write of a stream socket, continue from there next time
+                    if ((send_len > 0) && (send_len < rem))
+                    {
+                        elem->sent_len += send_len;
+                        tvideo_pace_give(rem - send_len);
+                    }
+                    else
+                    {
+                        tvideo_pace_give(rem);
+                    }
                     break;
                 }
             }
 
-            co_list_pop_front(&tvideo_pool.ready);
-            co_list_push_back(&tvideo_pool.free, (struct co_list_hdr *)&elem->hdr);
+            tvideo_node_sent(elem);
         }
     }
     while (elem);
 }
 
+#if TVIDEO_RATE_CTRL
+static void tvideo_rate_init(void)
+{
+    VRATE_CFG_ST cfg;
+
+    if (!tvideo_pool.rate_on)
+    {
+        return;
+    }
+
+    // jpeg starts with the size picked for the resolution, the controller stays under it
+    cfg.size_max = camera_intfer_get_frame_size();
+    if (cfg.size_max == 0)
+    {
+        tvideo_pool.rate_on = 0;
+        return;
+    }
+    cfg.size_min = cfg.size_max / TVIDEO_RATE_SIZE_DIV;
+    cfg.period = TVIDEO_RATE_PERIOD;
+    cfg.fps_min = TYPE_5FPS;
+    cfg.fps_max = CMPARAM_GET_FPS(tvideo_st.sener_cfg);
+    vrate_init(&tvideo_pool.rate, &cfg);
+
+    camera_intfer_set_frame_size(tvideo_pool.rate.target, tvideo_pool.rate.low);
+    video_transfer_get_stats(&tvideo_pool.rate_last);
+    tvideo_pool.rate_time = rtos_get_time();
+}
+
+// video thread, every TVIDEO_RATE_PERIOD frames
+static void tvideo_rate_poll(void)
+{
+    TVIDEO_STATS_ST stats;
+    TVIDEO_STATS_PTR last = &tvideo_pool.rate_last;
+    VRATE_IN_ST in;
+    UINT32 fps, ret, now;
+    GLOBAL_INT_DECLARATION();
+
+    if (!tvideo_pool.rate_on)
+    {
+        return;
+    }
+
+    fps = tvideo_pool.rate_fps_req;
+    if (fps < FPS_MAX)
+    {
+        tvideo_pool.rate_fps_req = FPS_MAX;
+        vrate_set_fps_max(&tvideo_pool.rate, fps);
+    }
+
+    video_transfer_get_stats(&stats);
+    if ((stats.frames >= last->frames) && (stats.frames - last->frames < TVIDEO_RATE_PERIOD))
+    {
+        return;
+    }
+    now = rtos_get_time();
+
+    // stats cleared meanwhile, start over
+    if ((stats.frames < last->frames) || (stats.bytes_sent < last->bytes_sent))
+    {
+        os_memcpy(last, &stats, sizeof(TVIDEO_STATS_ST));
+        tvideo_pool.rate_time = now;
+        return;
+    }
+
+    in.elapse_ms = now - tvideo_pool.rate_time;
+    in.frames = stats.frames - last->frames;
+    in.frames_dropped = stats.frames_dropped - last->frames_dropped;
+    in.pkts_dropped = stats.pkts_dropped - last->pkts_dropped;
+    in.pkts_stale = stats.pkts_stale - last->pkts_stale;
+    in.bytes_sent = stats.bytes_sent - last->bytes_sent;
+    in.nodes_in_use = stats.nodes_in_use;
+    in.node_cnt = stats.node_cnt;
+
+    GLOBAL_INT_DISABLE();
+    in.rx_loss = tvideo_pool.rate_rx_loss;
+    tvideo_pool.rate_rx_loss = VRATE_RX_LOSS_NONE;
+    GLOBAL_INT_RESTORE();
+
+    ret = vrate_update(&tvideo_pool.rate, &in);
+    if (ret & VRATE_NEW_SIZE)
+    {
+        camera_intfer_set_frame_size(tvideo_pool.rate.target, tvideo_pool.rate.low);
+    }
+    if ((ret & VRATE_NEW_FPS) && camera_intfer_set_video_param(PPI_MAX, tvideo_pool.rate.fps))
+    {
+        // sensor has no fps tables, stay where it is
+        fps = CMPARAM_GET_FPS(tvideo_st.sener_cfg);
+        tvideo_pool.rate.cfg.fps_min = fps;
+        vrate_set_fps_max(&tvideo_pool.rate, fps);
+    }
+
+    os_memcpy(last, &stats, sizeof(TVIDEO_STATS_ST));
+    tvideo_pool.rate_time = now;
+}
+#endif
+
 /*---------------------------------------------------------------------------*/
 static void video_transfer_main(beken_thread_arg_t data)
 {
@@ -408,6 +1239,10 @@ static void video_transfer_main(beken_thread_arg_t data)
         }
     }
 
+    #if TVIDEO_RATE_CTRL
+    tvideo_rate_init();
+    #endif
+
     if (tvideo_pool.start_cb != NULL)
     {
         tvideo_pool.start_cb();
@@ -416,13 +1251,41 @@ static void video_transfer_main(beken_thread_arg_t data)
     while (1)
     {
         TV_MSG_T msg;
-        err = rtos_pop_from_queue(&tvideo_msg_que, &msg, BEKEN_WAIT_FOREVER);
+        UINT32 wait_ms = BEKEN_WAIT_FOREVER;
+        #if TVIDEO_PACE
+        UINT32 pace_ms;
+        #endif
+
+        // isr only wakes us on empty ring, so poll again if send was blocked
+        if (tvideo_ready_cnt())
+        {
+            wait_ms = TVIDEO_SEND_RETRY_MS;
+            #if TVIDEO_PACE
+            // pacer holds the head back, sleep till its tokens are there
+            pace_ms = tvideo_pace_wait();
+            if (pace_ms > wait_ms)
+            {
+                wait_ms = pace_ms;
+            }
+            #endif
+        }
+
+        err = rtos_pop_from_queue(&tvideo_msg_que, &msg, wait_ms);
+        if (kNoErr != err)
+        {
+            msg.data = TV_INT_POLL;
+            err = kNoErr;
+        }
+
         if (kNoErr == err)
         {
             switch (msg.data)
             {
             case TV_INT_POLL:
                 tvideo_poll_handler();
+                #if TVIDEO_RATE_CTRL
+                tvideo_rate_poll();
+                #endif
                 break;
 
             case TV_EXIT:
@@ -443,12 +1306,6 @@ static void video_transfer_main(beken_thread_arg_t data)
 tvideo_exit:
     TVIDEO_PRT("video_transfer_main exit\r\n");
 
-    if (tvideo_pool.pool)
-    {
-        os_free(tvideo_pool.pool);
-        tvideo_pool.pool = NULL;
-    }
-
     if (tvideo_pool.open_type == TVIDEO_OPEN_SPIDMA)
     {
         #if CFG_USE_SPIDMA
@@ -460,6 +1317,8 @@ tvideo_exit:
         camera_intfer_deinit();
     }
 
+    tvideo_pool_deinit();
+
     rtos_deinit_queue(&tvideo_msg_que);
     tvideo_msg_que = NULL;
 
@@ -526,8 +1385,117 @@ int video_transfer_deinit(void)
     return kNoErr;
 }
 
+void video_transfer_get_stats(TVIDEO_STATS_PTR stats)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    os_memcpy(stats, &tvideo_pool.stats, sizeof(TVIDEO_STATS_ST));
+    GLOBAL_INT_RESTORE();
+}
+
+void video_transfer_clear_stats(void)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    tvideo_pool.stats.nodes_in_use_max = tvideo_pool.stats.nodes_in_use;
+    tvideo_pool.stats.frames = 0;
+    tvideo_pool.stats.frames_dropped = 0;
+    tvideo_pool.stats.pkts_dropped = 0;
+    tvideo_pool.stats.max_drops_per_frame = 0;
+    tvideo_pool.stats.pkts_sent = 0;
+    tvideo_pool.stats.bytes_sent = 0;
+    tvideo_pool.stats.send_calls = 0;
+    tvideo_pool.stats.pace_waits = 0;
+    tvideo_pool.stats.pkts_late = 0;
+    tvideo_pool.stats.late_max_ms = 0;
+    tvideo_pool.stats.late_sum_ms = 0;
+    tvideo_pool.stats.pkts_stale = 0;
+    tvideo_pool.stats.start_time = rtos_get_time();
+    os_memset(tvideo_pool.stats.latency_hist, 0, sizeof(tvideo_pool.stats.latency_hist));
+    GLOBAL_INT_RESTORE();
+}
+
+void video_transfer_stat_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv)
+{
+    TVIDEO_STATS_ST stats;
+    UINT32 elapse;
+
+    if ((argc > 1) && (os_strcmp(argv[1], "clear") == 0))
+    {
+        video_transfer_clear_stats();
+        return;
+    }
+
+    video_transfer_get_stats(&stats);
+
+    os_printf("pool nodes:%d, in use:%d, max:%d, wm:%d-%d\r\n", stats.node_cnt,
+              stats.nodes_in_use, stats.nodes_in_use_max, tvideo_pool.low_wm, tvideo_pool.high_wm);
+    os_printf("frames:%d, dropped:%d, pkts dropped:%d, max per frame:%d\r\n", stats.frames,
+              stats.frames_dropped, stats.pkts_dropped, stats.max_drops_per_frame);
+    os_printf("queue latency(ms) <2:%d <5:%d <10:%d <20:%d <50:%d >=50:%d\r\n",
+              stats.latency_hist[0], stats.latency_hist[1], stats.latency_hist[2],
+              stats.latency_hist[3], stats.latency_hist[4], stats.latency_hist[5]);
+
+    elapse = rtos_get_time() - stats.start_time;
+    if (elapse == 0)
+    {
+        elapse = 1;
+    }
+    os_printf("sent pkts:%d, bytes:%d, send calls:%d, %d pkt/s, %d kB/s\r\n", stats.pkts_sent,
+              stats.bytes_sent, stats.send_calls, (UINT32)((UINT64)stats.pkts_sent * 1000 / elapse),
+              (UINT32)((UINT64)stats.bytes_sent / elapse));
+
+    #if TVIDEO_PACE
+    if (tvideo_pool.pace_on)
+    {
+        os_printf("pace:%d B/s, sent:%d B/s, waits:%d, late pkts:%d avg:%d max:%d ms, stale:%d\r\n",
+                  stats.pace_rate, (UINT32)((UINT64)stats.bytes_sent * 1000 / elapse),
+                  stats.pace_waits, stats.pkts_late,
+                  stats.pkts_late ? (stats.late_sum_ms / stats.pkts_late) : 0,
+                  stats.late_max_ms, stats.pkts_stale);
+    }
+    #endif
+
+    #if TVIDEO_RATE_CTRL
+    if (tvideo_pool.rate_on)
+    {
+        os_printf("rate target:%d, fps:%d, link:%d B/s, cuts:%d, raises:%d, fps down:%d up:%d\r\n",
+                  tvideo_pool.rate.target, vrate_fps(tvideo_pool.rate.fps), tvideo_pool.rate.rate,
+                  tvideo_pool.rate.stats.cuts, tvideo_pool.rate.stats.raises,
+                  tvideo_pool.rate.stats.fps_downs, tvideo_pool.rate.stats.fps_ups);
+    }
+    #endif
+}
+
+// loss the receiver sees, in per mille, the rate controller takes it at its next update
+void video_transfer_set_rx_loss(UINT32 loss)
+{
+    #if TVIDEO_RATE_CTRL
+    tvideo_pool.rate_rx_loss = (loss > 1000) ? 1000 : loss;
+    #endif
+}
+
+// bytes the app sent on the video socket besides the nodes, fec parity or a
+// resend, the pacer holds the nodes back for them. video thread only
+void video_transfer_pace_charge(UINT32 len)
+{
+    #if TVIDEO_PACE
+    if (tvideo_pool.pace_on)
+    {
+        vpace_charge(&tvideo_pool.pace, len);
+    }
+    #endif
+}
+
 UINT32 video_transfer_set_video_param(UINT32 ppi, UINT32 fps)
 {
+    #if TVIDEO_RATE_CTRL
+    // user pick is the ceiling of the rate controller from now on
+    tvideo_pool.rate_fps_req = fps;
+    #endif
+
     #if CFG_USE_CAMERA_INTF
     return camera_intfer_set_video_param(ppi, fps);
     #endif // CFG_USE_CAMERA_INTF
@@ -67,8 +67,25 @@ typedef struct tvideo_hdr_param
     UINT32 frame_len;
 } TV_HDR_PARAM_ST, *TV_HDR_PARAM_PTR;
 
+struct pbuf;
+
 typedef void (*tvideo_add_pkt_header)(TV_HDR_PARAM_PTR param);
 typedef int (*video_transfer_send_func)(UINT8 *data, UINT32 len);
+// zero-copy send: return payload length on success, the pbuf is still owned by caller
+typedef int (*video_transfer_send_pbuf_func)(struct pbuf *p);
+
+#define TVIDEO_SEND_BATCH_MAX       8
+
+typedef struct tvideo_send_vec
+{
+    UINT8 *data;
+    UINT32 len;
+} TVIDEO_SEND_VEC_ST, *TVIDEO_SEND_VEC_PTR;
+
+// batched send: return bytes accepted over all vectors, may stop inside one
+typedef int (*video_transfer_send_batch_func)(TVIDEO_SEND_VEC_PTR vec, UINT32 cnt);
+// batched zero-copy send: return number of pbufs sent, pbufs still owned by caller
+typedef int (*video_transfer_send_pbufs_func)(struct pbuf **p, UINT32 cnt);
 typedef void (*video_transfer_start_cb)(void);
 typedef void (*video_transfer_end_cb)(void);
 
@@ -82,13 +99,61 @@ typedef struct tvideo_setup_desc
 
     UINT32 pkt_header_size;
     tvideo_add_pkt_header add_pkt_header;
+
+    // optional, if set, pool nodes are sent as pbufs without copy
+    video_transfer_send_pbuf_func send_pbuf_func;
+    // optional, send up to TVIDEO_SEND_BATCH_MAX nodes per call
+    video_transfer_send_batch_func send_batch_func;
+    video_transfer_send_pbufs_func send_pbufs_func;
+
+    // optional, 0 for default pool size and watermarks
+    UINT16 pool_node_cnt;
+    UINT8 pool_low_wm;
+    UINT8 pool_high_wm;
+
+    // optional, move jpeg target size and fps with what the link takes
+    UINT8 rate_ctrl;
+    // optional, spread each frame's packets over the frame interval
+    UINT8 pace;
 } TVIDEO_SETUP_DESC_ST, *TVIDEO_SETUP_DESC_PTR;
 
+#define TVIDEO_LATENCY_BUCKETS      6   // <2, <5, <10, <20, <50, >=50 ms
+
+typedef struct tvideo_stats
+{
+    UINT32 node_cnt;
+    UINT32 nodes_in_use;
+    UINT32 nodes_in_use_max;
+    UINT32 frames;
+    UINT32 frames_dropped;
+    UINT32 pkts_dropped;
+    UINT32 max_drops_per_frame;
+    UINT32 latency_hist[TVIDEO_LATENCY_BUCKETS];
+
+    UINT32 start_time;
+    UINT32 pkts_sent;
+    UINT32 bytes_sent;
+    UINT32 send_calls;
+
+    // only counted with setup pace on
+    UINT32 pace_rate;           // bytes/s the pacer lets out now
+    UINT32 pace_waits;          // sends held back for tokens
+    UINT32 pkts_late;           // out later than one frame interval after rx
+    UINT32 late_max_ms;         // beyond the interval
+    UINT32 late_sum_ms;
+    UINT32 pkts_stale;          // dropped unsent, newer frame was complete
+} TVIDEO_STATS_ST, *TVIDEO_STATS_PTR;
+
 #if (CFG_USE_SPIDMA || CFG_USE_CAMERA_INTF)
 void tvideo_intfer_send_msg(UINT32 new_msg);
 int video_transfer_init(TVIDEO_SETUP_DESC_PTR setup_cfg);
 int video_transfer_deinit(void);
 UINT32 video_transfer_set_video_param(UINT32 ppi, UINT32 fps);
+void video_transfer_set_rx_loss(UINT32 loss);
+void video_transfer_pace_charge(UINT32 len);
+void video_transfer_get_stats(TVIDEO_STATS_PTR stats);
+void video_transfer_clear_stats(void);
+void video_transfer_stat_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
 
 int video_buffer_open(void);
 int video_buffer_close(void);
@@ -85,6 +85,7 @@ extern int cli_putstr(const char *msg);
 extern int hexstr2bin(const char *hex, u8 *buf, size_t len);
 extern void make_tcp_server_command(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
 extern void net_Command(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
+extern void bmsg_lane_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
 uint32_t bk_wlan_reg_rx_mgmt_cb(mgmt_rx_cb_t cb, uint32_t rx_mgmt_flag);
 
 #if CFG_AIRKISS_TEST
@@ -1047,6 +1048,9 @@ void socket_show_Command(char *pcWriteBuffer, int xWriteBufferLen, int argc, cha
 void memory_show_Command(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv)
 {
     cmd_printf("free memory %d\r\n", xPortGetFreeHeapSize());
+#if MEM_SLAB_EN
+    mem_slab_dump();
+#endif
 }
 
 
@@ -2633,12 +2637,19 @@ static const struct cli_command built_ins[] =
     {"sockshow", "Show all sockets", socket_show_Command},
     // os
     {"tasklist", "list all thread name status", task_Command},
+    {"corelane", "core thread lane stats [clear]", bmsg_lane_cmd},
+#if CFG_UART_DEFER_LOG
+    {"logmode", "logmode [direct|text|bin]", uart_log_cmd},
+#endif
 
     // others
     {"memshow", "print memory information", memory_show_Command},
     {"memdump", "<addr> <length>", memory_dump_Command},
     {"os_memset", "<addr> <value 1> [<value 2> ... <value n>]", memory_set_Command},
     {"memp", "print memp list", memp_dump_Command},
+#if MEM_TRACE_EN
+    {"memtrace", "memtrace [live|log|clear|on|off]", mem_trace_cmd},
+#endif
 
     {"reboot", "reboot system", reboot},
 
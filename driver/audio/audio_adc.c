@@ -508,6 +508,41 @@ static UINT32 audio_adc_read(char *user_buf, UINT32 count, UINT32 op_flag)
     return fill_size;
 }
 
+static UINT32 audio_adc_peek(RB_SPAN_PTR span)
+{
+    if(aud_adc.status != AUD_ADC_STA_PLAYING)
+    {
+        span->len[0] = span->len[1] = 0;
+        return 0;
+    }
+
+    if(aud_adc.mode & AUD_ADC_MODE_DMA_BIT)
+    {
+        #if CFG_GENERAL_DMA
+        return rb_peek_dma_write(&aud_adc.u.rb_dma_wr, span);
+        #endif
+    }
+
+    return rb_peek(&aud_adc.u.rb, span);
+}
+
+static void audio_adc_consume(UINT32 len)
+{
+    if(aud_adc.status != AUD_ADC_STA_PLAYING)
+        return;
+
+    if(aud_adc.mode & AUD_ADC_MODE_DMA_BIT)
+    {
+        #if CFG_GENERAL_DMA
+        rb_consume_dma_write(&aud_adc.u.rb_dma_wr, len);
+        #endif
+    }
+    else
+    {
+        rb_consume(&aud_adc.u.rb, len);
+    }
+}
+
 static UINT32 audio_adc_get_fill_buf_size(void)
 {
     int free_size;
@@ -623,6 +658,16 @@ static UINT32 audio_adc_ctrl(UINT32 cmd, void *param)
             ASSERT(param);
             audio_adc_set_volume(*((UINT32 *)param));
             break;
+
+        case AUD_ADC_CMD_PEEK:
+            ASSERT(param);
+            ret = audio_adc_peek((RB_SPAN_PTR)param);
+            break;
+
+        case AUD_ADC_CMD_CONSUME:
+            ASSERT(param);
+            audio_adc_consume(*((UINT32 *)param));
+            break;
             
         default:
             break;
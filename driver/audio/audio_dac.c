@@ -621,6 +621,27 @@ static UINT32 audio_dac_close(void)
     return AUD_SUCCESS;
 }
 
+#if CFG_GENERAL_DMA
+// ring filled up for the first time, start the dma draining it
+static void audio_dac_dma_start_play(void)
+{
+    GDMA_CFG_ST en_cfg;
+
+    en_cfg.channel = AUD_DAC_DEF_DMA_CHANNEL;
+    en_cfg.param = aud_dac.need_write_len; // dma translen
+    sddev_control(GDMA_DEV_NAME, CMD_GDMA_SET_TRANS_LENGTH, &en_cfg);
+
+    audio_dac_set_dma(1);
+    audio_dac_set_enable_bit(1);
+
+    aud_dac.status = AUD_DAC_STA_PLAYING;
+
+    #if AUD_USE_EXT_PA
+    audio_dac_eable_mute(0);
+    #endif
+}
+#endif
+
 static UINT32 audio_dac_write(char *user_buf, UINT32 count, UINT32 op_flag)
 {
 	int free_size;
@@ -644,19 +665,7 @@ static UINT32 audio_dac_write(char *user_buf, UINT32 count, UINT32 op_flag)
         {
             if(aud_dac.status == AUD_DAC_STA_OPENED) 
             {
-    		    GDMA_CFG_ST en_cfg;
-    			en_cfg.channel = AUD_DAC_DEF_DMA_CHANNEL;
-    		    en_cfg.param = aud_dac.need_write_len; // dma translen
-    		    sddev_control(GDMA_DEV_NAME, CMD_GDMA_SET_TRANS_LENGTH, &en_cfg);
-    			
-    		    audio_dac_set_dma(1);
-    		    audio_dac_set_enable_bit(1);
-    		    
-    		    aud_dac.status = AUD_DAC_STA_PLAYING;
-
-                #if AUD_USE_EXT_PA
-                audio_dac_eable_mute(0);
-                #endif
+                audio_dac_dma_start_play();
     		}
 			return 0;
 		}
@@ -682,6 +691,53 @@ static UINT32 audio_dac_write(char *user_buf, UINT32 count, UINT32 op_flag)
 	return free_size;
 }
 
+static UINT32 audio_dac_acquire(RB_SPAN_PTR span)
+{
+    UINT32 free_size;
+
+    span->len[0] = span->len[1] = 0;
+    if(aud_dac.status == AUD_DAC_STA_CLOSED)
+        return 0;
+
+    if(aud_dac.dma_mode)
+    {
+        #if CFG_GENERAL_DMA
+        free_size = rb_acquire_dma_read(&aud_dac.u.rb_dma_rd, span);
+        // same as audio_dac_write: start once a chunk no longer fits
+        if((aud_dac.status == AUD_DAC_STA_OPENED) && (free_size < aud_dac.need_write_len))
+        {
+            audio_dac_dma_start_play();
+        }
+        return free_size;
+        #else
+        return 0;
+        #endif
+    }
+
+    return rb_acquire(&aud_dac.u.rb, span);
+}
+
+static void audio_dac_commit(UINT32 len)
+{
+    if(aud_dac.status == AUD_DAC_STA_CLOSED)
+        return;
+
+    if(aud_dac.dma_mode)
+    {
+        #if CFG_GENERAL_DMA
+        rb_commit_dma_read(&aud_dac.u.rb_dma_rd, len);
+        if(aud_dac.status == AUD_DAC_STA_OPENED)
+        {
+            aud_dac.need_write_len = len;
+        }
+        #endif
+    }
+    else
+    {
+        rb_commit(&aud_dac.u.rb, len);
+    }
+}
+
 static UINT32 audio_dac_get_free_buf_size(void)
 {
     int free_size;
@@ -770,6 +826,16 @@ static UINT32 audio_dac_ctrl(UINT32 cmd, void *param)
             ASSERT(param);
             audio_dac_set_volume(*((UINT32 *)param));
             break;
+
+        case AUD_DAC_CMD_ACQUIRE:
+            ASSERT(param);
+            ret = audio_dac_acquire((RB_SPAN_PTR)param);
+            break;
+
+        case AUD_DAC_CMD_COMMIT:
+            ASSERT(param);
+            audio_dac_commit(*((UINT32 *)param));
+            break;
             
         default:
             break;
@@ -1,6 +1,8 @@
 #ifndef __AUDIO_PUB_H__
 #define __AUDIO_PUB_H__
 
+#include "ring_buffer.h"
+
 #define AUD_FAILURE                  (1)
 #define AUD_SUCCESS                  (0)
 
@@ -30,6 +32,8 @@ enum
     AUD_DAC_CMD_PAUSE,
     AUD_DAC_CMD_SET_SAMPLE_RATE,
     AUD_DAC_CMD_SET_VOLUME,    
+    AUD_DAC_CMD_ACQUIRE,            // param RB_SPAN_PTR, free room in place, ret bytes
+    AUD_DAC_CMD_COMMIT,             // param UINT32 *, bytes written into the span
 };
 
 #include "gpio_pub.h"
@@ -67,7 +71,9 @@ enum
     AUD_ADC_CMD_PAUSE,
     AUD_ADC_CMD_DO_LINEIN_DETECT,
     AUD_ADC_CMD_SET_SAMPLE_RATE,
-    AUD_ADC_CMD_SET_VOLUME
+    AUD_ADC_CMD_SET_VOLUME,
+    AUD_ADC_CMD_PEEK,               // param RB_SPAN_PTR, samples in place, ret bytes
+    AUD_ADC_CMD_CONSUME,            // param UINT32 *, bytes done with
 };
 
 
@@ -3,13 +3,63 @@
 #include "arch.h"
 #include "mem_pub.h"
 
-#define RWP_SAFE_INTERVAL           (4)
-
 #define RB_MEMCPY                   os_memcpy
 #define RB_INT_DECLARATION()        GLOBAL_INT_DECLARATION()
 #define RB_INT_DISABLE()            GLOBAL_INT_DISABLE()
 #define RB_INT_RESTORE()            GLOBAL_INT_RESTORE()
 
+UINT32 rb_fill_len(UINT32 capacity, UINT32 wp, UINT32 rp)
+{
+    return wp >= rp ? wp - rp : capacity - rp + wp;
+}
+
+// wp never catches up with rp, keeps full apart from empty
+UINT32 rb_free_len(UINT32 capacity, UINT32 wp, UINT32 rp)
+{
+    UINT32 free_size;
+
+    free_size = wp >= rp ? capacity - wp + rp : rp - wp;
+
+    return free_size > RWP_SAFE_INTERVAL ? free_size - RWP_SAFE_INTERVAL : 0;
+}
+
+UINT32 rb_span_set(RB_SPAN_PTR span, UINT8 *addr, UINT32 capacity, UINT32 from, UINT32 len)
+{
+    UINT32 first = capacity - from;
+
+    if(first > len)
+        first = len;
+
+    span->addr[0] = &addr[from];
+    span->len[0]  = first;
+    span->addr[1] = &addr[0];
+    span->len[1]  = len - first;
+
+    return len;
+}
+
+UINT32 rb_span_copy_out(RB_SPAN_PTR span, UINT8 *buffer, UINT32 len)
+{
+    UINT32 first = len > span->len[0] ? span->len[0] : len;
+    UINT32 second = len - first > span->len[1] ? span->len[1] : len - first;
+
+    RB_MEMCPY(buffer, span->addr[0], first);
+    RB_MEMCPY(buffer + first, span->addr[1], second);
+
+    return first + second;
+}
+
+UINT32 rb_span_copy_in(RB_SPAN_PTR span, const UINT8 *buffer, UINT32 len)
+{
+    UINT32 first = len > span->len[0] ? span->len[0] : len;
+    UINT32 second = len - first > span->len[1] ? span->len[1] : len - first;
+
+    RB_MEMCPY(span->addr[0], buffer, first);
+    RB_MEMCPY(span->addr[1], buffer + first, second);
+
+    return first + second;
+}
+
 void rb_init(RB_PTR rb, UINT8 *addr, UINT32 capacity)
 {
     RB_INT_DECLARATION();
@@ -22,173 +72,103 @@ void rb_init(RB_PTR rb, UINT8 *addr, UINT32 capacity)
     RB_INT_RESTORE();
 }
 
+// moves both points, only while neither side is running
 void rb_clear(RB_PTR rb)
 {
     RB_INT_DECLARATION();
- 
-    RB_INT_DISABLE();   
+
+    RB_INT_DISABLE();
     rb->wp    = 0;
     rb->rp    = 0;
     RB_INT_RESTORE();
 }
 
-UINT32 rb_read(RB_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
+UINT32 rb_peek(RB_PTR rb, RB_SPAN_PTR span)
 {
-    UINT32 required_bytes = size * count;
-    UINT32 read_bytes;
-    UINT32 remain_bytes;
-    UINT32 wp;
-    RB_INT_DECLARATION();
+    UINT32 wp = rb->wp;
+    UINT32 rp = rb->rp;
 
-    wp = rb->wp;
+    // data behind wp is in memory before wp is seen
+    barrier();
 
-    if(required_bytes == 0) 
+    return rb_span_set(span, rb->address, rb->capacity, rp, rb_fill_len(rb->capacity, wp, rp));
+}
+
+void rb_consume(RB_PTR rb, UINT32 len)
+{
+    UINT32 rp = rb->rp + len;
+
+    if(rp >= rb->capacity)
+        rp -= rb->capacity;
+
+    // done with the data before the producer may overwrite it
+    barrier();
+    rb->rp = rp;
+}
+
+UINT32 rb_acquire(RB_PTR rb, RB_SPAN_PTR span)
+{
+    UINT32 wp = rb->wp;
+    UINT32 rp = rb->rp;
+
+    barrier();
+
+    return rb_span_set(span, rb->address, rb->capacity, wp, rb_free_len(rb->capacity, wp, rp));
+}
+
+void rb_commit(RB_PTR rb, UINT32 len)
+{
+    UINT32 wp = rb->wp + len;
+
+    if(wp >= rb->capacity)
+        wp -= rb->capacity;
+
+    // data must be in place before the consumer sees the new wp
+    barrier();
+    rb->wp = wp;
+}
+
+UINT32 rb_read(RB_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
+{
+    RB_SPAN_ST span;
+    UINT32 read_bytes = size * count;
+
+    if(read_bytes == 0)
         return 0;
 
-    if(wp >= rb->rp)
-    {
-        remain_bytes = wp - rb->rp;
-
-        if(required_bytes > remain_bytes)
-        {
-            read_bytes = remain_bytes;
-            RB_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-
-            RB_INT_DISABLE();
-            rb->rp += read_bytes;
-            RB_INT_RESTORE();
-        }
-        else
-        {
-            read_bytes = required_bytes;
-            RB_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-            RB_INT_DISABLE();
-            rb->rp += read_bytes;
-            RB_INT_RESTORE();
-        }
-    }
-    else
-    {
-        remain_bytes = rb->capacity - rb->rp;
-
-        if(required_bytes > remain_bytes)
-        {
-            read_bytes = remain_bytes;
-            RB_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-
-            if(required_bytes - read_bytes > wp)
-            {
-                RB_MEMCPY(buffer + read_bytes, &rb->address[0], wp);
-                RB_INT_DISABLE();
-                rb->rp = wp;
-                RB_INT_RESTORE();
-                read_bytes += wp;
-            }
-            else
-            {
-                RB_MEMCPY(buffer + read_bytes, &rb->address[0], required_bytes - read_bytes);
-                RB_INT_DISABLE();
-                rb->rp = required_bytes - read_bytes;
-                RB_INT_RESTORE();
-                read_bytes = required_bytes;
-            }
-        }
-        else
-        {
-            read_bytes = required_bytes;
-            RB_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-            RB_INT_DISABLE();
-            rb->rp += read_bytes;
-            RB_INT_RESTORE();
-        }
-    }
+    if(read_bytes > rb_peek(rb, &span))
+        read_bytes = span.len[0] + span.len[1];
+
+    rb_span_copy_out(&span, buffer, read_bytes);
+    rb_consume(rb, read_bytes);
 
     return read_bytes;
 }
 
+// all or nothing, as before
 UINT32 rb_write(RB_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
 {
-    UINT32 remain_bytes;
+    RB_SPAN_ST span;
     UINT32 write_bytes = size * count;
-    UINT32 rp;
-    RB_INT_DECLARATION();
-    
-    if(write_bytes == 0) 
+
+    if(write_bytes == 0)
+        return 0;
+
+    if(write_bytes > rb_acquire(rb, &span))
         return 0;
 
-    rp = rb->rp;
-
-    if(rb->wp >= rp)
-    {
-        remain_bytes = rb->capacity - rb->wp + rp;
-
-        if(remain_bytes >= write_bytes + RWP_SAFE_INTERVAL)
-        {
-            remain_bytes = rb->capacity - rb->wp;
-
-            if(remain_bytes >= write_bytes)
-            {
-                RB_MEMCPY(&rb->address[rb->wp], buffer, write_bytes);
-                RB_INT_DISABLE();
-                rb->wp += write_bytes;
-                RB_INT_RESTORE();
-            }
-            else
-            {
-                RB_MEMCPY(&rb->address[rb->wp], buffer, remain_bytes);
-                RB_INT_DISABLE();
-                rb->wp = write_bytes - remain_bytes;
-                RB_INT_RESTORE();
-                RB_MEMCPY(&rb->address[0], &buffer[remain_bytes], rb->wp);
-            }
-        }
-        else
-        {
-            return 0;
-        }
-    }
-    else
-    {
-        remain_bytes = rp - rb->wp;
-
-        if(remain_bytes >= write_bytes + RWP_SAFE_INTERVAL)
-        {
-            RB_MEMCPY(&rb->address[rb->wp], buffer, write_bytes);
-            RB_INT_DISABLE();
-            rb->wp += write_bytes;
-            RB_INT_RESTORE();
-        }
-        else
-        {
-            return 0;
-        }
-    }
-
-    if(rb->wp >= rb->capacity && rb->rp)
-    {
-        RB_INT_DISABLE();
-        rb->wp = 0;
-        RB_INT_RESTORE();
-    }
+    rb_span_copy_in(&span, buffer, write_bytes);
+    rb_commit(rb, write_bytes);
 
     return write_bytes;
 }
 
 UINT32 rb_get_fill_size(RB_PTR rb)
 {
-    UINT32 fill_size;
-
-    fill_size = rb->wp >= rb->rp ? rb->wp - rb->rp : rb->capacity - rb->rp + rb->wp;
-
-    return fill_size;
+    return rb_fill_len(rb->capacity, rb->wp, rb->rp);
 }
 
 UINT32 rb_get_free_size(RB_PTR rb)
 {
-    UINT32 free_size;
-
-    free_size = rb->wp >= rb->rp ? rb->capacity - rb->wp + rb->rp : rb->rp - rb->wp;
-
-    return free_size > RWP_SAFE_INTERVAL ? free_size - RWP_SAFE_INTERVAL : 0;
+    return rb_free_len(rb->capacity, rb->wp, rb->rp);
 }
-
@@ -1,15 +1,27 @@
 #ifndef __RING_BUFFER_H__
 #define __RING_BUFFER_H__
 
+#define RWP_SAFE_INTERVAL           (4)
 
+/*
+ * Single producer / single consumer: wp is only written by the producer,
+ * rp only by the consumer, so neither side masks interrupts.
+ */
 typedef struct rb_st
 {
-    UINT8 *address;     
+    UINT8 *address;
     UINT32 capacity;    /**< memory capacity in bytes */
-    UINT32 wp;          /**< write point in bytes     */
-    UINT32 rp;          /**< read point in bytes      */
+    volatile UINT32 wp; /**< write point in bytes     */
+    volatile UINT32 rp; /**< read point in bytes      */
 }RB_ST, *RB_PTR;
 
+/* a region of the ring, second part is only used when it wraps */
+typedef struct rb_span_st
+{
+    UINT8 *addr[2];
+    UINT32 len[2];
+}RB_SPAN_ST, *RB_SPAN_PTR;
+
 void rb_init(RB_PTR rb, UINT8 *addr, UINT32 capacity);
 void rb_clear(RB_PTR rb);
 UINT32 rb_read(RB_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count);
@@ -17,4 +29,18 @@ UINT32 rb_write(RB_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count);
 UINT32 rb_get_fill_size(RB_PTR rb);
 UINT32 rb_get_free_size(RB_PTR rb);
 
+/* consumer: data in place, then give back the bytes used */
+UINT32 rb_peek(RB_PTR rb, RB_SPAN_PTR span);
+void rb_consume(RB_PTR rb, UINT32 len);
+/* producer: free room in place, then publish the bytes written */
+UINT32 rb_acquire(RB_PTR rb, RB_SPAN_PTR span);
+void rb_commit(RB_PTR rb, UINT32 len);
+
+/* helpers shared with the dma variants */
+UINT32 rb_fill_len(UINT32 capacity, UINT32 wp, UINT32 rp);
+UINT32 rb_free_len(UINT32 capacity, UINT32 wp, UINT32 rp);
+UINT32 rb_span_set(RB_SPAN_PTR span, UINT8 *addr, UINT32 capacity, UINT32 from, UINT32 len);
+UINT32 rb_span_copy_out(RB_SPAN_PTR span, UINT8 *buffer, UINT32 len);
+UINT32 rb_span_copy_in(RB_SPAN_PTR span, const UINT8 *buffer, UINT32 len);
+
 #endif//__RING_BUFFER_H__
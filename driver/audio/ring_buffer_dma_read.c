@@ -8,9 +8,6 @@
 #if CFG_GENERAL_DMA
 #include "general_dma_pub.h"
 
-#define RWP_SAFE_INTERVAL           (4)
-
-#define RB_DMA_RD_MEMCPY                   os_memcpy
 #define RB_DMA_RD_INT_DECLARATION()
 #define RB_DMA_RD_INT_DISABLE()
 #define RB_DMA_RD_INT_RESTORE()
@@ -54,116 +51,81 @@ void rb_clear_dma_read(RB_DMA_RD_PTR rb)
 }
 
 
-UINT32 rb_write_dma_read(RB_DMA_RD_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
+// dma is the consumer, its read address is the rp
+static UINT32 rb_update_rp_dma_read(RB_DMA_RD_PTR rb)
 {
-    UINT32 remain_bytes;
-    UINT32 write_bytes = size * count;
     UINT32 rp;
     GDMA_CFG_ST en_cfg;
-    
-    RB_DMA_RD_INT_DECLARATION();
-    
-    if(write_bytes == 0) 
-        return 0;
 
     en_cfg.channel = rb->dma_ch;
     en_cfg.param = 0;
     rp = sddev_control(GDMA_DEV_NAME, CMD_GDMA_GET_SRC_READ_ADDR, &en_cfg);
-    RB_DMA_RD_PRT("write get src_rd:%x\r\n", rp);
+    RB_DMA_RD_PRT("get src_rd:%x\r\n", rp);
     rp -= (UINT32)rb->address;
+    if(rp >= rb->capacity)
+        rp -= rb->capacity;
     rb->rp = rp;
 
-    if(rb->wp >= rp)
-    {
-        remain_bytes = rb->capacity - rb->wp + rp;
-
-        if(remain_bytes >= write_bytes + RWP_SAFE_INTERVAL)
-        {
-            remain_bytes = rb->capacity - rb->wp;
-
-            if(remain_bytes >= write_bytes)
-            {
-                RB_DMA_RD_MEMCPY(&rb->address[rb->wp], buffer, write_bytes);
-                RB_DMA_RD_INT_DISABLE();
-                rb->wp += write_bytes;
-                RB_DMA_RD_INT_RESTORE();
-            }
-            else
-            {
-                RB_DMA_RD_MEMCPY(&rb->address[rb->wp], buffer, remain_bytes);
-                RB_DMA_RD_INT_DISABLE();
-                rb->wp = write_bytes - remain_bytes;
-                RB_DMA_RD_INT_RESTORE();
-                RB_DMA_RD_MEMCPY(&rb->address[0], &buffer[remain_bytes], rb->wp);
-            }
-        }
-        else
-        {
-            return 0;
-        }
-    }
-    else
-    {
-        remain_bytes = rp - rb->wp;
-
-        if(remain_bytes >= write_bytes + RWP_SAFE_INTERVAL)
-        {
-            RB_DMA_RD_MEMCPY(&rb->address[rb->wp], buffer, write_bytes);
-            RB_DMA_RD_INT_DISABLE();
-            rb->wp += write_bytes;
-            RB_DMA_RD_INT_RESTORE();
-        }
-        else
-        {
-            return 0;
-        }
-    }
-
-    if(rb->wp >= rb->capacity && rb->rp)
-    {
-        RB_DMA_RD_INT_DISABLE();
-        rb->wp = 0;
-        RB_DMA_RD_INT_RESTORE();
-    }
+    return rp;
+}
+
+UINT32 rb_acquire_dma_read(RB_DMA_RD_PTR rb, RB_SPAN_PTR span)
+{
+    UINT32 rp = rb_update_rp_dma_read(rb);
+
+    barrier();
+
+    return rb_span_set(span, rb->address, rb->capacity, rb->wp,
+                       rb_free_len(rb->capacity, rb->wp, rp));
+}
+
+void rb_commit_dma_read(RB_DMA_RD_PTR rb, UINT32 len)
+{
+    UINT32 wp = rb->wp + len;
+    GDMA_CFG_ST en_cfg;
+
+    if(wp >= rb->capacity)
+        wp -= rb->capacity;
 
+    barrier();
+    rb->wp = wp;
+
+    // let the dma run up to the new wp
     en_cfg.channel = rb->dma_ch;
     en_cfg.param = (UINT32)(rb->address + rb->wp);
     RB_DMA_RD_PRT("write set src:%x\r\n", en_cfg.param);
     sddev_control(GDMA_DEV_NAME, CMD_GDMA_SET_SRC_PAUSE_ADDR, &en_cfg);
-
-    return write_bytes;
 }
 
-UINT32 rb_get_fill_size_dma_read(RB_DMA_RD_PTR rb)
+UINT32 rb_write_dma_read(RB_DMA_RD_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
 {
-    UINT32 fill_size, rp;
-    GDMA_CFG_ST en_cfg;
+    RB_SPAN_ST span;
+    UINT32 write_bytes = size * count;
 
-    en_cfg.channel = rb->dma_ch;
-    rp = sddev_control(GDMA_DEV_NAME, CMD_GDMA_GET_SRC_READ_ADDR, &en_cfg);
-    RB_DMA_RD_PRT("fillsize get src_rd:%x\r\n", rp);
-    rp -= (UINT32)rb->address;
-    rb->rp = rp;
+    if(write_bytes == 0)
+        return 0;
 
-    fill_size = rb->wp >= rb->rp ? rb->wp - rb->rp : rb->capacity - rb->rp + rb->wp;
+    if(write_bytes > rb_acquire_dma_read(rb, &span))
+        return 0;
 
-    return fill_size;
+    rb_span_copy_in(&span, buffer, write_bytes);
+    rb_commit_dma_read(rb, write_bytes);
+
+    return write_bytes;
 }
 
-UINT32 rb_get_free_size_dma_read(RB_DMA_RD_PTR rb)
+UINT32 rb_get_fill_size_dma_read(RB_DMA_RD_PTR rb)
 {
-    UINT32 free_size, rp;
-    GDMA_CFG_ST en_cfg;
+    UINT32 rp = rb_update_rp_dma_read(rb);
 
-    en_cfg.channel = rb->dma_ch;
-    rp = sddev_control(GDMA_DEV_NAME, CMD_GDMA_GET_SRC_READ_ADDR, &en_cfg);
-    RB_DMA_RD_PRT("freesize get src_rd:%x\r\n", rp);
-    rp -= (UINT32)rb->address;
-    rb->rp = rp;
+    return rb_fill_len(rb->capacity, rb->wp, rp);
+}
 
-    free_size = rb->wp >= rb->rp ? rb->capacity - rb->wp + rb->rp : rb->rp - rb->wp;
+UINT32 rb_get_free_size_dma_read(RB_DMA_RD_PTR rb)
+{
+    UINT32 rp = rb_update_rp_dma_read(rb);
 
-    return free_size > RWP_SAFE_INTERVAL ? free_size - RWP_SAFE_INTERVAL : 0;
+    return rb_free_len(rb->capacity, rb->wp, rp);
 }
 
 #endif // CFG_GENERAL_DMA
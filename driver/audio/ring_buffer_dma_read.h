@@ -1,6 +1,8 @@
 #ifndef __RING_BUFFER_DMA_RD_H__
 #define __RING_BUFFER_DMA_RD_H__
 
+#include "ring_buffer.h"
+
 
 typedef struct rb_dma_rd_st
 {
@@ -16,5 +18,7 @@ void rb_clear_dma_read(RB_DMA_RD_PTR rb);
 UINT32 rb_write_dma_read(RB_DMA_RD_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count);
 UINT32 rb_get_fill_size_dma_read(RB_DMA_RD_PTR rb);
 UINT32 rb_get_free_size_dma_read(RB_DMA_RD_PTR rb);
+UINT32 rb_acquire_dma_read(RB_DMA_RD_PTR rb, RB_SPAN_PTR span);
+void rb_commit_dma_read(RB_DMA_RD_PTR rb, UINT32 len);
 
 #endif//__RING_BUFFER_DMA_RD_H__
\ No newline at end of file
@@ -8,8 +8,6 @@
 #if CFG_GENERAL_DMA
 #include "general_dma_pub.h"
 
-#define RWP_SAFE_INTERVAL           (4)
-#define RB_DMA_WR_MEMCPY                   os_memcpy
 #define RB_DMA_WR_INT_DECLARATION()
 #define RB_DMA_WR_INT_DISABLE()
 #define RB_DMA_WR_INT_RESTORE()
@@ -50,123 +48,84 @@ void rb_clear_dma_write(RB_DMA_WR_PTR rb)
     sddev_control(GDMA_DEV_NAME, CMD_GDMA_SET_DST_PAUSE_ADDR, &en_cfg);
 }
 
-UINT32 rb_read_dma_write(RB_DMA_WR_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
+// dma is the producer, its write address is the wp
+static UINT32 rb_update_wp_dma_write(RB_DMA_WR_PTR rb)
 {
-    UINT32 required_bytes = size * count;
-    UINT32 read_bytes;
-    UINT32 remain_bytes;
     UINT32 wp;
     GDMA_CFG_ST en_cfg;
-    
-    RB_DMA_WR_INT_DECLARATION();
 
-    if(required_bytes == 0) 
-        return 0;
-    
     en_cfg.channel = rb->dma_ch;
     wp = sddev_control(GDMA_DEV_NAME, CMD_GDMA_GET_DST_WRITE_ADDR, &en_cfg);
-    RB_DMA_WR_PRT("rb read get dst_wr:%x\r\n", wp);
+    RB_DMA_WR_PRT("get dst_wr:%x\r\n", wp);
     wp -= (UINT32)rb->address;
+    if(wp >= rb->capacity)
+        wp -= rb->capacity;
     rb->wp = wp;
 
-    if(wp >= rb->rp)
-    {
-        remain_bytes = wp - rb->rp;
-
-        if(required_bytes > remain_bytes)
-        {
-            read_bytes = remain_bytes;
-        }
-        else
-        {
-            read_bytes = required_bytes;
-        }
-        
-        RB_DMA_WR_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-        RB_DMA_WR_INT_DISABLE();
-        rb->rp += read_bytes;
-        RB_DMA_WR_INT_RESTORE();
-    }
-    else
-    {
-        remain_bytes = rb->capacity - rb->rp;
-
-        if(required_bytes > remain_bytes)
-        {
-            read_bytes = remain_bytes;
-            RB_DMA_WR_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-
-            if(required_bytes - read_bytes > wp)
-            {
-                RB_DMA_WR_MEMCPY(buffer + read_bytes, &rb->address[0], wp);
-                RB_DMA_WR_INT_DISABLE();
-                rb->rp = wp;
-                RB_DMA_WR_INT_RESTORE();
-                read_bytes += wp;
-            }
-            else
-            {
-                RB_DMA_WR_MEMCPY(buffer + read_bytes, &rb->address[0], required_bytes - read_bytes);
-                RB_DMA_WR_INT_DISABLE();
-                rb->rp = required_bytes - read_bytes;
-                RB_DMA_WR_INT_RESTORE();
-                read_bytes = required_bytes;
-            }
-        }
-        else
-        {
-            read_bytes = required_bytes;
-            RB_DMA_WR_MEMCPY(buffer, &rb->address[rb->rp], read_bytes);
-            RB_DMA_WR_INT_DISABLE();
-            rb->rp += read_bytes;
-            RB_DMA_WR_INT_RESTORE();
-        }
-    }
-
-    
+    return wp;
+}
+
+UINT32 rb_peek_dma_write(RB_DMA_WR_PTR rb, RB_SPAN_PTR span)
+{
+    UINT32 wp = rb_update_wp_dma_write(rb);
+
+    barrier();
+
+    return rb_span_set(span, rb->address, rb->capacity, rb->rp,
+                       rb_fill_len(rb->capacity, wp, rb->rp));
+}
 
+void rb_consume_dma_write(RB_DMA_WR_PTR rb, UINT32 len)
+{
+    UINT32 rp = rb->rp + len;
+    GDMA_CFG_ST en_cfg;
+
+    if(rp >= rb->capacity)
+        rp -= rb->capacity;
+
+    barrier();
+    rb->rp = rp;
+
+    // let the dma run up to just before the new rp
     en_cfg.channel = rb->dma_ch;
     if(rb->rp >= RWP_SAFE_INTERVAL)
         en_cfg.param = (UINT32)(rb->address + rb->rp - RWP_SAFE_INTERVAL);
     else
         en_cfg.param = (UINT32)(rb->address + rb->capacity + rb->rp - RWP_SAFE_INTERVAL);
-    
+
     RB_DMA_WR_PRT("read set dst:%x\r\n", en_cfg.param);
     sddev_control(GDMA_DEV_NAME, CMD_GDMA_SET_DST_PAUSE_ADDR, &en_cfg);
-
-    return read_bytes;
 }
 
-UINT32 rb_get_fill_size_dma_write(RB_DMA_WR_PTR rb)
+UINT32 rb_read_dma_write(RB_DMA_WR_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count)
 {
-    UINT32 fill_size, wp;
-    GDMA_CFG_ST en_cfg;
+    RB_SPAN_ST span;
+    UINT32 read_bytes = size * count;
 
-    en_cfg.channel = rb->dma_ch;
-    wp = sddev_control(GDMA_DEV_NAME, CMD_GDMA_GET_DST_WRITE_ADDR, &en_cfg);
-    RB_DMA_WR_PRT("fillsize get dst_wr:%x\r\n", wp);
-    wp -= (UINT32)rb->address;
-    rb->wp = wp;
+    if(read_bytes == 0)
+        return 0;
+
+    if(read_bytes > rb_peek_dma_write(rb, &span))
+        read_bytes = span.len[0] + span.len[1];
 
-    fill_size = rb->wp >= rb->rp ? rb->wp - rb->rp : rb->capacity - rb->rp + rb->wp;
+    rb_span_copy_out(&span, buffer, read_bytes);
+    rb_consume_dma_write(rb, read_bytes);
 
-    return fill_size;
+    return read_bytes;
 }
 
-UINT32 rb_get_free_size_dma_write(RB_DMA_WR_PTR rb)
+UINT32 rb_get_fill_size_dma_write(RB_DMA_WR_PTR rb)
 {
-    UINT32 free_size, wp;
-    GDMA_CFG_ST en_cfg;
+    UINT32 wp = rb_update_wp_dma_write(rb);
 
-    en_cfg.channel = rb->dma_ch;
-    wp = sddev_control(GDMA_DEV_NAME, CMD_GDMA_GET_DST_WRITE_ADDR, &en_cfg);
-    RB_DMA_WR_PRT("free size get dst_wr:%x\r\n", wp);
-    wp -= (UINT32)rb->address;
-    rb->wp = wp;
+    return rb_fill_len(rb->capacity, wp, rb->rp);
+}
 
-    free_size = rb->wp >= rb->rp ? rb->capacity - rb->wp + rb->rp : rb->rp - rb->wp;
+UINT32 rb_get_free_size_dma_write(RB_DMA_WR_PTR rb)
+{
+    UINT32 wp = rb_update_wp_dma_write(rb);
 
-    return free_size > RWP_SAFE_INTERVAL ? free_size - RWP_SAFE_INTERVAL : 0;
+    return rb_free_len(rb->capacity, wp, rb->rp);
 }
 
 #endif // CFG_GENERAL_DMA
@@ -1,6 +1,8 @@
 #ifndef __RING_BUFFER_DMA_WR_H__
 #define __RING_BUFFER_DMA_WR_H__
 
+#include "ring_buffer.h"
+
 
 typedef struct rb_dma_rd_st
 {
@@ -16,5 +18,7 @@ void rb_clear_dma_write(RB_DMA_WR_PTR rb);
 UINT32 rb_read_dma_write(RB_DMA_WR_PTR rb, UINT8 *buffer, UINT32 size, UINT32 count);
 UINT32 rb_get_fill_size_dma_write(RB_DMA_WR_PTR rb);
 UINT32 rb_get_free_size_dma_write(RB_DMA_WR_PTR rb);
+UINT32 rb_peek_dma_write(RB_DMA_WR_PTR rb, RB_SPAN_PTR span);
+void rb_consume_dma_write(RB_DMA_WR_PTR rb, UINT32 len);
 
 #endif//__RING_BUFFER_DMA_RD_H__
\ No newline at end of file
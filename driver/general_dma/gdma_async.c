@@ -0,0 +1,353 @@
+#include "include.h"
+#include "arm_arch.h"
+
+#if CFG_GENERAL_DMA
+#include "general_dma_pub.h"
+#include "general_dma.h"
+
+#include "mem_pub.h"
+#include "rtos_pub.h"
+
+#if GDMA_ASYNC_EN
+// channel bookkeeping and request queue, the registers are behind the
+// gdma_async_hw_xxx hooks of general_dma.c
+typedef struct gdma_async_st
+{
+    UINT32 chnl_mask;               // channels owned by the copy engine
+    UINT32 free_mask;               // owned and idle
+    GDMA_REQ_PTR busy[GDMA_CHANNEL_MAX];
+    GDMA_REQ_PTR head;              // waiting for a channel, fifo
+    GDMA_REQ_PTR tail;
+    UINT32 queue_cnt;
+    GDMA_ASYNC_STATS_ST stats;
+} GDMA_ASYNC_ST;
+
+static GDMA_ASYNC_ST gdma_async;
+
+static INT32 gdma_async_pick(void)
+{
+    UINT32 ch;
+
+    for(ch = 0; ch < GDMA_CHANNEL_MAX; ch++)
+    {
+        if(gdma_async.free_mask & (1 << ch))
+        {
+            gdma_async.free_mask &= ~(1 << ch);
+            return ch;
+        }
+    }
+
+    return -1;
+}
+
+static void gdma_async_start(UINT32 ch, GDMA_REQ_PTR req)
+{
+    req->cur = MIN(req->len - req->done, GDMA_ASYNC_CHUNK_MAX);
+    req->state = GDMA_REQ_BUSY;
+    gdma_async.busy[ch] = req;
+
+    gdma_async_hw_start(ch, req->dst + req->done, req->src + req->done, req->cur);
+}
+
+// channel is idle again, give it to the next waiting request
+static void gdma_async_next(UINT32 ch)
+{
+    GDMA_REQ_PTR req = gdma_async.head;
+
+    gdma_async.busy[ch] = NULL;
+    if(0 == (gdma_async.chnl_mask & (1 << ch)))
+    {
+        // taken over by a driver meanwhile
+        return;
+    }
+    if(NULL == req)
+    {
+        gdma_async.free_mask |= (1 << ch);
+        return;
+    }
+
+    gdma_async.head = req->next;
+    if(NULL == gdma_async.head)
+    {
+        gdma_async.tail = NULL;
+    }
+    gdma_async.queue_cnt--;
+    req->next = NULL;
+
+    gdma_async_start(ch, req);
+}
+
+void gdma_async_init(UINT32 chnl_mask)
+{
+    os_memset(&gdma_async, 0, sizeof(gdma_async));
+    gdma_async.chnl_mask = chnl_mask & ((1 << GDMA_CHANNEL_MAX) - 1);
+    gdma_async.free_mask = gdma_async.chnl_mask;
+}
+
+// with interrupts disabled. returns the request that is done, if any
+static GDMA_REQ_PTR gdma_async_finish(UINT32 ch)
+{
+    GDMA_REQ_PTR req = gdma_async.busy[ch];
+
+    // a late status of a channel already restarted by gdma_req_wait
+    if((NULL == req) || gdma_async_hw_busy(ch))
+    {
+        return NULL;
+    }
+
+    req->done += req->cur;
+    if(req->done < req->len)
+    {
+        gdma_async_start(ch, req);
+        return NULL;
+    }
+
+    gdma_async_next(ch);
+
+    return req;
+}
+
+static void gdma_async_notify(GDMA_REQ_PTR req)
+{
+    gdma_done_cb cb = req->cb;
+    void *arg = req->arg;
+
+    // req may be reused by its owner from here on
+    req->state = GDMA_REQ_DONE;
+    if(cb)
+    {
+        cb(arg);
+    }
+}
+
+// finish interrupt of an engine channel
+void gdma_async_complete(UINT32 ch)
+{
+    GDMA_REQ_PTR req;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    req = gdma_async_finish(ch);
+    GLOBAL_INT_RESTORE();
+
+    if(req)
+    {
+        gdma_async_notify(req);
+    }
+}
+
+UINT32 gdma_async_owns(UINT32 ch)
+{
+    return (gdma_async.chnl_mask & (1 << ch)) != 0;
+}
+
+/*
+ * A driver configures channel ch, the engine gives it up for good. A copy
+ * running on it is waited for, at most one chunk. What is left of that
+ * request, and the waiting ones when no channel remains, is done by cpu.
+ */
+void gdma_async_revoke(UINT32 ch)
+{
+    GDMA_REQ_PTR req, cpu = NULL, next;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    if(0 == (gdma_async.chnl_mask & (1 << ch)))
+    {
+        GLOBAL_INT_RESTORE();
+        return;
+    }
+    gdma_async.chnl_mask &= ~(1 << ch);
+    gdma_async.free_mask &= ~(1 << ch);
+
+    req = gdma_async.busy[ch];
+    if(req)
+    {
+        while(gdma_async_hw_busy(ch))
+            ;
+        gdma_async.busy[ch] = NULL;
+        req->done += req->cur;
+        req->next = cpu;
+        cpu = req;
+    }
+    gdma_async_hw_ack(ch);
+
+    if(0 == gdma_async.chnl_mask)
+    {
+        while(gdma_async.head)
+        {
+            req = gdma_async.head;
+            gdma_async.head = req->next;
+            req->next = cpu;
+            cpu = req;
+        }
+        gdma_async.tail = NULL;
+        gdma_async.queue_cnt = 0;
+    }
+    GLOBAL_INT_RESTORE();
+
+    // out of the engine, only their owners wait on them
+    for(req = cpu; req; req = next)
+    {
+        next = req->next;
+        req->next = NULL;
+        os_memcpy(req->dst + req->done, req->src + req->done, req->len - req->done);
+        req->done = req->len;
+        gdma_async.stats.cpu_copy++;
+        gdma_async_notify(req);
+    }
+}
+
+// a channel for a synchronous copy, -1 if all are busy
+INT32 gdma_async_claim(void)
+{
+    INT32 ch;
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    ch = gdma_async_pick();
+    if(ch < 0)
+    {
+        gdma_async.stats.sync_cpu++;
+    }
+    GLOBAL_INT_RESTORE();
+
+    return ch;
+}
+
+void gdma_async_release(UINT32 ch)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    gdma_async_next(ch);
+    GLOBAL_INT_RESTORE();
+}
+
+/*
+ * Copy n bytes in the background. cb(arg) runs when the copy is done, in
+ * the finish isr, or right here for small copies which the cpu does
+ * faster than a channel setup. out/in must stay valid until then.
+ */
+UINT32 gdma_memcpy_async(GDMA_REQ_PTR req, void *out, const void *in, UINT32 n,
+                         gdma_done_cb cb, void *arg)
+{
+    INT32 ch;
+    GLOBAL_INT_DECLARATION();
+
+    if((NULL == req) || ((GDMA_REQ_QUEUED == req->state) || (GDMA_REQ_BUSY == req->state)))
+    {
+        return GDMA_FAILURE;
+    }
+
+    req->next = NULL;
+    req->dst = out;
+    req->src = in;
+    req->len = n;
+    req->done = 0;
+    req->cur = 0;
+    req->cb = cb;
+    req->arg = arg;
+
+    if((n < CFG_GDMA_ASYNC_MIN_LEN) || (0 == gdma_async.chnl_mask))
+    {
+        os_memcpy(out, in, n);
+        req->done = n;
+        req->state = GDMA_REQ_DONE;
+        gdma_async.stats.cpu_copy++;
+        if(cb)
+        {
+            cb(arg);
+        }
+        return GDMA_SUCCESS;
+    }
+
+    GLOBAL_INT_DISABLE();
+    gdma_async.stats.submit++;
+    ch = gdma_async_pick();
+    if(ch >= 0)
+    {
+        gdma_async_start(ch, req);
+    }
+    else
+    {
+        req->state = GDMA_REQ_QUEUED;
+        if(gdma_async.tail)
+        {
+            gdma_async.tail->next = req;
+        }
+        else
+        {
+            gdma_async.head = req;
+        }
+        gdma_async.tail = req;
+
+        gdma_async.queue_cnt++;
+        gdma_async.stats.queued++;
+        if(gdma_async.queue_cnt > gdma_async.stats.queue_max)
+        {
+            gdma_async.stats.queue_max = gdma_async.queue_cnt;
+        }
+    }
+    GLOBAL_INT_RESTORE();
+
+    return GDMA_SUCCESS;
+}
+
+UINT32 gdma_req_done(GDMA_REQ_PTR req)
+{
+    return (GDMA_REQ_QUEUED != req->state) && (GDMA_REQ_BUSY != req->state);
+}
+
+// spin until req is done. polls the channels itself, so it also works with
+// interrupts disabled
+void gdma_req_wait(GDMA_REQ_PTR req)
+{
+    GDMA_REQ_PTR done[GDMA_CHANNEL_MAX];
+    UINT32 ch, cnt;
+    GLOBAL_INT_DECLARATION();
+
+    while(!gdma_req_done(req))
+    {
+        cnt = 0;
+        GLOBAL_INT_DISABLE();
+        for(ch = 0; ch < GDMA_CHANNEL_MAX; ch++)
+        {
+            if(gdma_async.busy[ch] && !gdma_async_hw_busy(ch))
+            {
+                gdma_async_hw_ack(ch);
+                done[cnt] = gdma_async_finish(ch);
+                if(done[cnt])
+                {
+                    cnt++;
+                }
+            }
+        }
+        GLOBAL_INT_RESTORE();
+
+        for(ch = 0; ch < cnt; ch++)
+        {
+            gdma_async_notify(done[ch]);
+        }
+    }
+}
+
+// cb for callers that block on a semaphore, arg is the beken_semaphore_t
+void gdma_done_sema(void *sema)
+{
+    beken_semaphore_t handle = (beken_semaphore_t)sema;
+
+    rtos_set_semaphore(&handle);
+}
+
+void gdma_async_get_stats(GDMA_ASYNC_STATS_ST *stats)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    *stats = gdma_async.stats;
+    GLOBAL_INT_RESTORE();
+}
+#endif // GDMA_ASYNC_EN
+#endif // CFG_GENERAL_DMA
+// EOF
@@ -19,6 +19,10 @@ static SDD_OPERATIONS gdma_op =
 #if (CFG_SOC_NAME != SOC_BK7231)
 void (*p_dma_fin_handler[GDMA_CHANNEL_MAX])(UINT32);
 void (*p_dma_hfin_handler[GDMA_CHANNEL_MAX])(UINT32);
+
+static UINT32 gdma_drv_mask;    // channels a driver set up through gdma_ctrl
+static UINT32 gdma_fifo_mask;   // channels taken by gdma_fifo_init
+static void gdma_fifo_revoke(UINT32 channel);
 #endif
 
 static void gdma_isr(void);
@@ -712,6 +716,8 @@ void gdma_init(void)
         p_dma_fin_handler[i] = NULL;
         p_dma_hfin_handler[i] = NULL;
     }
+    gdma_drv_mask = 0;
+    gdma_fifo_mask = 0;
     #endif // (CFG_SOC_NAME != SOC_BK7231)
     
     os_memset(&cfg, 0, sizeof(GDMACFG_TPYES_ST));
@@ -770,6 +776,20 @@ void gdma_init(void)
     gdma_congfig_type2(&cfg); 
 
     gdma_set_priority(0);  // round-robin mode, all dma priority are same
+
+#if GDMA_ASYNC_EN
+    // memory to memory channels of the copy engine, done by finish interrupt
+    cfg.prio = 0;
+    for(int i = 0; i < GDMA_CHANNEL_MAX; i++) {
+        if(CFG_GDMA_ASYNC_CHNL_MASK & (1 << i)) {
+            cfg.channel = i;
+            gdma_congfig_type0(&cfg);
+            gdma_cfg_finish_inten(i, 1);
+        }
+    }
+    gdma_async_init(CFG_GDMA_ASYNC_CHNL_MASK);
+#endif // GDMA_ASYNC_EN
+
     gdma_enable_interrupt();
 #endif // (CFG_SOC_NAME != SOC_BK7231)
 }
@@ -807,6 +827,22 @@ UINT32 gdma_ctrl(UINT32 cmd, void *param)
 
     dma_cfg = (GDMA_CFG_PTR)param;
 
+#if GDMA_ASYNC_EN
+    // a driver sets up a channel of the copy engine, the engine gives it up
+    if((cmd >= CMD_GDMA_CFG_TYPE0) && (cmd <= CMD_GDMA_CFG_TYPE6)
+            && gdma_async_owns(((GDMACFG_TPYES_PTR)param)->channel))
+    {
+        gdma_async_revoke(((GDMACFG_TPYES_PTR)param)->channel);
+        gdma_cfg_finish_inten(((GDMACFG_TPYES_PTR)param)->channel, 0);
+    }
+#endif
+#if (CFG_SOC_NAME != SOC_BK7231)
+    if((cmd >= CMD_GDMA_CFG_TYPE0) && (cmd <= CMD_GDMA_CFG_TYPE6))
+    {
+        gdma_fifo_revoke(((GDMACFG_TPYES_PTR)param)->channel);
+    }
+#endif
+
     switch(cmd)
     {
     case CMD_GDMA_SET_DMA_ENABLE:
@@ -963,18 +999,199 @@ void *gdma_memcpy(void *out, const void *in, UINT32 n)
 {
     GLOBAL_INT_DECLARATION();
     GDMA_DO_ST do_st;
-    
-    do_st.channel = GDMA_CHANNEL_0;
+#if GDMA_ASYNC_EN
+    INT32 ch;
+
+#endif
+
     do_st.src_addr = (void*)in;
     do_st.length = n;
     do_st.dst_addr = out;
     GLOBAL_INT_DISABLE();
+#if GDMA_ASYNC_EN
+    // channel 0 may be running an async copy, take any idle one. claimed
+    // with interrupts off, a driver can't take it over in between
+    ch = gdma_async_claim();
+    if(ch < 0)
+    {
+        GLOBAL_INT_RESTORE();
+        return os_memcpy(out, in, n);
+    }
+    do_st.channel = ch;
+#else
+    do_st.channel = GDMA_CHANNEL_0;
+#endif
     gdma_enable(&do_st);
+#if GDMA_ASYNC_EN
+    // polled to the end, the finish interrupt is not for the engine
+    gdma_clr_finish_interrupt_bit(do_st.channel);
+    gdma_async_release(do_st.channel);
+#endif
     GLOBAL_INT_RESTORE();    
 
     return out;
 }
 
+#if GDMA_ASYNC_EN
+void gdma_async_hw_start(UINT32 channel, void *dst, const void *src, UINT32 len)
+{
+    gdma_set_dst_start_addr(channel, dst);
+    gdma_set_src_start_addr(channel, (void *)src);
+    gdma_set_transfer_length(channel, len);
+    gdma_set_dma_en(channel, 1);
+}
+
+UINT32 gdma_async_hw_busy(UINT32 channel)
+{
+    return gdma_get_dma_en(channel);
+}
+
+void gdma_async_hw_ack(UINT32 channel)
+{
+    gdma_clr_finish_interrupt_bit(channel);
+}
+#endif // GDMA_ASYNC_EN
+
+#if (CFG_SOC_NAME != SOC_BK7231)
+// a channel moving words between memory and one fixed register, e.g. a
+// peripheral fifo without a request line. fin_handler runs in the isr.
+// refused when the channel has another user: channel 0 (gdma_memcpy), the
+// copy engine or a driver that set it up through gdma_ctrl
+UINT32 gdma_fifo_init(UINT32 channel, void (*fin_handler)(UINT32))
+{
+    GDMACFG_TPYES_ST cfg;
+    UINT32 busy;
+    GLOBAL_INT_DECLARATION();
+
+    if((channel == GDMA_CHANNEL_0) || (channel >= GDMA_CHANNEL_MAX))
+    {
+        GENER_DMA_WPRT("gdma fifo: chnl %d not allowed\r\n", channel);
+        return GDMA_FAILURE;
+    }
+
+    GLOBAL_INT_DISABLE();
+    busy = ((gdma_drv_mask | gdma_fifo_mask) & (1 << channel))
+           || (p_dma_fin_handler[channel] != NULL);
+#if GDMA_ASYNC_EN
+    busy = busy || gdma_async_owns(channel);
+#endif
+    if(!busy)
+    {
+        gdma_fifo_mask |= (1 << channel);
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(busy)
+    {
+        GENER_DMA_WPRT("gdma fifo: chnl %d in use\r\n", channel);
+        return GDMA_FAILURE;
+    }
+
+    os_memset(&cfg, 0, sizeof(GDMACFG_TPYES_ST));
+    cfg.channel = channel;
+    cfg.dstdat_width = 32;
+    cfg.srcdat_width = 32;
+    gdma_congfig_type0(&cfg);
+
+    p_dma_fin_handler[channel] = fin_handler;
+    gdma_cfg_finish_inten(channel, (fin_handler != NULL));
+
+    return GDMA_SUCCESS;
+}
+
+void gdma_fifo_deinit(UINT32 channel)
+{
+    GLOBAL_INT_DECLARATION();
+
+    if(channel >= GDMA_CHANNEL_MAX)
+        return;
+
+    GLOBAL_INT_DISABLE();
+    if(gdma_fifo_mask & (1 << channel))
+    {
+        gdma_fifo_mask &= ~(1 << channel);
+        gdma_set_dma_en(channel, 0);
+        gdma_cfg_finish_inten(channel, 0);
+        gdma_clr_finish_interrupt_bit(channel);
+        p_dma_fin_handler[channel] = NULL;
+    }
+    GLOBAL_INT_RESTORE();
+}
+
+// a driver sets the channel up, the fifo user loses it. the packet in
+// flight still finishes and its handler runs, later starts fail
+static void gdma_fifo_revoke(UINT32 channel)
+{
+    void (*fin_handler)(UINT32) = NULL;
+    GLOBAL_INT_DECLARATION();
+
+    if(channel >= GDMA_CHANNEL_MAX)
+        return;
+
+    GLOBAL_INT_DISABLE();
+    gdma_drv_mask |= (1 << channel);
+    if(gdma_fifo_mask & (1 << channel))
+    {
+        gdma_fifo_mask &= ~(1 << channel);
+        while(gdma_get_dma_en(channel));
+        gdma_cfg_finish_inten(channel, 0);
+        gdma_clr_finish_interrupt_bit(channel);
+        fin_handler = p_dma_fin_handler[channel];
+        p_dma_fin_handler[channel] = NULL;
+        if(fin_handler)
+            fin_handler(1);
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(fin_handler)
+        GENER_DMA_WPRT("gdma fifo: chnl %d taken by a driver\r\n", channel);
+}
+
+// len in bytes, a multiple of 4. fails once a driver took the channel
+UINT32 gdma_fifo_start(UINT32 channel, volatile void *fifo, void *mem, UINT32 len, UINT32 to_fifo)
+{
+    GLOBAL_INT_DECLARATION();
+
+    if(channel >= GDMA_CHANNEL_MAX)
+        return GDMA_FAILURE;
+
+    GLOBAL_INT_DISABLE();
+    if(!(gdma_fifo_mask & (1 << channel)))
+    {
+        GLOBAL_INT_RESTORE();
+        return GDMA_FAILURE;
+    }
+
+    if(to_fifo)
+    {
+        gdma_cfg_srcaddr_increase(channel, 1);
+        gdma_cfg_dstaddr_increase(channel, 0);
+        gdma_set_src_start_addr(channel, mem);
+        gdma_set_dst_start_addr(channel, (void *)fifo);
+    }
+    else
+    {
+        gdma_cfg_srcaddr_increase(channel, 0);
+        gdma_cfg_dstaddr_increase(channel, 1);
+        gdma_set_src_start_addr(channel, (void *)fifo);
+        gdma_set_dst_start_addr(channel, mem);
+    }
+    gdma_set_transfer_length(channel, len);
+    gdma_set_dma_en(channel, 1);
+    GLOBAL_INT_RESTORE();
+
+    return GDMA_SUCCESS;
+}
+
+UINT32 gdma_fifo_busy(UINT32 channel)
+{
+    if((channel >= GDMA_CHANNEL_MAX) || !(gdma_fifo_mask & (1 << channel)))
+        return 0;
+
+    return gdma_get_dma_en(channel);
+}
+#endif // (CFG_SOC_NAME != SOC_BK7231)
+
 static void gdma_isr(void)
 {
     #if (CFG_SOC_NAME == SOC_BK7231)
@@ -999,6 +1216,14 @@ static void gdma_isr(void)
         }
 
         cmp_bit = (1 << (i+GENER_DMA_FIN_INT_STATUS_POSI));
+        #if GDMA_ASYNC_EN
+        if((status & cmp_bit) && gdma_async_owns(i))
+        {
+            REG_WRITE(GENER_DMA_REG38_DMA_INT_STATUS, cmp_bit);
+            gdma_async_complete(i);
+            continue;
+        }
+        #endif // GDMA_ASYNC_EN
         if(status & cmp_bit) 
         {
             if(p_dma_fin_handler[i]){
@@ -258,6 +258,23 @@
 
 UINT32 gdma_ctrl(UINT32 cmd, void *param);
 
+#if GDMA_ASYNC_EN
+// max bytes of one transfer, longer copies are done in chunks
+#define GDMA_ASYNC_CHUNK_MAX                (GDMA_X_TRANS_LEN_MASK + 1)
+
+// channel access for gdma_async.c, called with interrupts disabled
+void gdma_async_hw_start(UINT32 channel, void *dst, const void *src, UINT32 len);
+UINT32 gdma_async_hw_busy(UINT32 channel);
+void gdma_async_hw_ack(UINT32 channel);
+
+void gdma_async_init(UINT32 chnl_mask);
+void gdma_async_complete(UINT32 channel);
+UINT32 gdma_async_owns(UINT32 channel);
+void gdma_async_revoke(UINT32 channel);
+INT32 gdma_async_claim(void);
+void gdma_async_release(UINT32 channel);
+#endif // GDMA_ASYNC_EN
+
 #endif // CFG_GENERAL_DMA
 
 #endif // __GENER_DMA_H__
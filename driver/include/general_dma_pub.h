@@ -184,6 +184,61 @@ void gdma_init(void);
 void gdma_exit(void);
 void *gdma_memcpy(void *out, const void *in, UINT32 n);
 
+#if (CFG_SOC_NAME != SOC_BK7231)
+UINT32 gdma_fifo_init(UINT32 channel, void (*fin_handler)(UINT32));
+void gdma_fifo_deinit(UINT32 channel);
+UINT32 gdma_fifo_start(UINT32 channel, volatile void *fifo, void *mem, UINT32 len, UINT32 to_fifo);
+UINT32 gdma_fifo_busy(UINT32 channel);
+#endif
+
+#if (CFG_GDMA_ASYNC && (CFG_SOC_NAME != SOC_BK7231))
+#define GDMA_ASYNC_EN               1
+#else
+#define GDMA_ASYNC_EN               0
+#endif
+
+#if GDMA_ASYNC_EN
+enum
+{
+    GDMA_REQ_IDLE = 0,
+    GDMA_REQ_QUEUED,
+    GDMA_REQ_BUSY,
+    GDMA_REQ_DONE,
+};
+
+typedef void (*gdma_done_cb)(void *arg);
+
+// owned by the caller until state is GDMA_REQ_DONE
+typedef struct gdma_req_st
+{
+    struct gdma_req_st *next;
+    UINT8 *dst;
+    const UINT8 *src;
+    UINT32 len;
+    UINT32 done;                    // bytes copied so far
+    UINT32 cur;                     // bytes of the transfer on the channel
+    gdma_done_cb cb;                // isr context, may submit the next copy
+    void *arg;
+    volatile UINT32 state;
+} GDMA_REQ_ST, *GDMA_REQ_PTR;
+
+typedef struct gdma_async_stats_st
+{
+    UINT32 submit;
+    UINT32 cpu_copy;                // below CFG_GDMA_ASYNC_MIN_LEN
+    UINT32 queued;                  // had to wait for a free channel
+    UINT32 queue_max;
+    UINT32 sync_cpu;                // gdma_memcpy found no free channel
+} GDMA_ASYNC_STATS_ST;
+
+UINT32 gdma_memcpy_async(GDMA_REQ_PTR req, void *out, const void *in, UINT32 n,
+                         gdma_done_cb cb, void *arg);
+UINT32 gdma_req_done(GDMA_REQ_PTR req);
+void gdma_req_wait(GDMA_REQ_PTR req);
+void gdma_done_sema(void *sema);
+void gdma_async_get_stats(GDMA_ASYNC_STATS_ST *stats);
+#endif // GDMA_ASYNC_EN
+
 #endif  // CFG_GENERAL_DMA
 
 #endif
@@ -2,6 +2,7 @@
 #define _UART_PUB_H
 
 #include <stdio.h>
+#include <stdarg.h>
 #include "include.h"
 
 #define os_printf                      bk_printf
@@ -123,7 +124,14 @@ extern void uart2_isr(void);
 extern INT32 os_null_printf(const char *fmt, ...);
 extern void fatal_print(const char *fmt, ...);
 extern void bk_printf(const char *fmt, ...);
+extern void bk_log_flush(void);
+#if CFG_UART_DEFER_LOG
+extern int uart_log_vput(const char *fmt, va_list ap);
+extern void uart_log_init(void);
+extern void uart_log_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
+#endif
 extern void uart_send_byte(UINT8 ch, UINT8 data);
+extern void bk_send_byte(UINT8 uport, UINT8 data);
 extern void bk_send_string(UINT8 uport, const char *string);
 extern UINT32 uart_wait_tx_over();
 extern UINT8 uart_is_tx_fifo_empty(UINT8 uport);
@@ -295,6 +295,7 @@ void bk_cpu_shutdown(void)
     GLOBAL_INT_DECLARATION();
 	
     os_printf("shutdown...\n");
+    bk_log_flush();
 	
     GLOBAL_INT_DISABLE();	
     while(1);
@@ -574,6 +574,12 @@ static UINT32 ejpeg_ctrl(UINT32 cmd, void *param)
     case EJPEG_CMD_GET_FRAME_LEN:
         ret = ejpeg_get_frame_len();
         break;
+    case EJPEG_CMD_SET_TARGET_HIGH_BYTE:
+        ejpeg_set_target_high_byte(*((UINT32 *)param));
+        break;
+    case EJPEG_CMD_SET_TARGET_LOW_BYTE:
+        ejpeg_set_target_low_byte(*((UINT32 *)param));
+        break;
 
     default:
         break;
@@ -59,6 +59,8 @@ enum
     EJPEG_CMD_GET_TARGET_HIGH_BYTE,
     EJPEG_CMD_GET_TARTGE_LOW_BYTE,
     EJPEG_CMD_GET_FRAME_LEN,
+    EJPEG_CMD_SET_TARGET_HIGH_BYTE,
+    EJPEG_CMD_SET_TARGET_LOW_BYTE,
 };
 
 #define Y_PIXEL_480                                  (60)  // Y * 8
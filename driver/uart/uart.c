@@ -140,6 +140,13 @@ void bk_printf(const char *fmt, ...)
     char string[128];
 
     va_start(ap, fmt);
+#if CFG_UART_DEFER_LOG
+    if(0 == uart_log_vput(fmt, ap))
+    {
+        va_end(ap);
+        return;
+    }
+#endif
     vsnprintf(string, sizeof(string) - 1, fmt, ap);
     string[127] = 0;
     bk_send_string(uart_print_port, string);
@@ -126,6 +126,7 @@ typedef struct _uart_
 
 #if (0 == CFG_RELEASE_FIRMWARE)
 #define DEAD_WHILE()   do{           \
+                            bk_log_flush();\
                             while(1);\
                          }while(0)
 #else
@@ -0,0 +1,623 @@
+#include "include.h"
+#include "arm_arch.h"
+#include "uart_pub.h"
+#include "uart.h"
+#include "mem_pub.h"
+#include "str_pub.h"
+#include "rtos_pub.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+#if CFG_UART_DEFER_LOG
+#define UART_LOG_MASK               (CFG_UART_DEFER_LOG_SIZE - 1)
+#define UART_LOG_REC_MAX            128
+#define UART_LOG_STR_MAX            64
+#define UART_LOG_LINE_MAX           160
+#define UART_LOG_SPEC_MAX           24
+#define UART_LOG_STACK_SIZE         2048
+
+// formats above this address live in ram and may be gone at print time
+#define UART_LOG_FLASH_END          0x00400000
+
+// start of a record in binary mode, see tools/uart_log/uart_log_decode.py
+#define UART_LOG_SYNC0              0xA5
+#define UART_LOG_SYNC1              0x5A
+
+#define CPSR_MODE_MASK              0x1F
+#define CPSR_MODE_ABT               0x17
+#define CPSR_MODE_UND               0x1B
+
+#if (CFG_UART_DEFER_LOG_SIZE & UART_LOG_MASK)
+#error "CFG_UART_DEFER_LOG_SIZE must be power of 2"
+#endif
+
+enum
+{
+    UART_LOG_DIRECT = 0,
+    UART_LOG_TEXT,
+    UART_LOG_BIN,
+};
+
+enum
+{
+    UART_LOG_ARG_NONE = 0,
+    UART_LOG_ARG_INT,
+    UART_LOG_ARG_LL,
+    UART_LOG_ARG_DBL,
+    UART_LOG_ARG_STR,
+};
+
+// record: header, then the args in format order. int 4 bytes, long long and
+// double 8 bytes, string 1 byte length + chars padded to 4 bytes
+typedef struct uart_log_hdr_st
+{
+    const char *fmt;
+    UINT32 time;
+    UINT16 len;                     // whole record, multiple of 4
+    UINT16 resv;
+} UART_LOG_HDR_ST;
+
+static UINT8 uart_log_buf[CFG_UART_DEFER_LOG_SIZE];
+static volatile UINT32 uart_log_in = 0;
+static volatile UINT32 uart_log_out = 0;
+static volatile UINT32 uart_log_mode = UART_LOG_DIRECT;
+static UINT32 uart_log_drops = 0;
+static UINT32 uart_log_drops_shown = 0;
+static UINT32 uart_log_used_max = 0;
+static beken_semaphore_t uart_log_sema = NULL;
+static beken_thread_t uart_log_thread = NULL;
+
+static UINT32 uart_log_cpu_mode(void)
+{
+    UINT32 cpsr;
+
+    __asm volatile("MRS %0, CPSR\n" : "=r"(cpsr) : : "memory");
+
+    return cpsr & CPSR_MODE_MASK;
+}
+
+// one conversion spec, p points behind '%'. returns the end of the spec
+static const char *uart_log_spec(const char *p, UINT8 *type, UINT8 *stars)
+{
+    UINT32 l_cnt = 0;
+
+    *stars = 0;
+    while((*p == '-') || (*p == '+') || (*p == ' ') || (*p == '#') || (*p == '0'))
+    {
+        p++;
+    }
+
+    if(*p == '*')
+    {
+        (*stars)++;
+        p++;
+    }
+    while((*p >= '0') && (*p <= '9'))
+    {
+        p++;
+    }
+
+    if(*p == '.')
+    {
+        p++;
+        if(*p == '*')
+        {
+            (*stars)++;
+            p++;
+        }
+        while((*p >= '0') && (*p <= '9'))
+        {
+            p++;
+        }
+    }
+
+    while((*p == 'l') || (*p == 'h') || (*p == 'z') || (*p == 'j')
+            || (*p == 't') || (*p == 'L') || (*p == 'q'))
+    {
+        if((*p == 'l') || (*p == 'j') || (*p == 'q'))
+        {
+            l_cnt += (*p == 'l') ? 1 : 2;
+        }
+        p++;
+    }
+
+    switch(*p)
+    {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        *type = (l_cnt >= 2) ? UART_LOG_ARG_LL : UART_LOG_ARG_INT;
+        break;
+
+    case 'c':
+    case 'p':
+    case 'n':
+        *type = UART_LOG_ARG_INT;
+        break;
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        *type = UART_LOG_ARG_DBL;
+        break;
+
+    case 's':
+        *type = UART_LOG_ARG_STR;
+        break;
+
+    case 0:
+        *type = UART_LOG_ARG_NONE;
+        return p;
+
+    default:
+        *type = UART_LOG_ARG_NONE;
+        break;
+    }
+
+    return p + 1;
+}
+
+static UINT32 uart_log_encode(UINT8 *rec, const char *fmt, va_list ap)
+{
+    UINT32 pos = sizeof(UART_LOG_HDR_ST);
+    UINT32 val, i, n;
+    UINT64 val64;
+    double dbl;
+    const char *str;
+    UINT8 type, stars;
+
+    while(*fmt)
+    {
+        if(*fmt++ != '%')
+        {
+            continue;
+        }
+
+        fmt = uart_log_spec(fmt, &type, &stars);
+        for(i = 0; i < stars; i++)
+        {
+            val = va_arg(ap, int);
+            if(pos + 4 <= UART_LOG_REC_MAX)
+            {
+                os_memcpy(rec + pos, &val, 4);
+                pos += 4;
+            }
+        }
+
+        // args that do not fit are dropped, the printer shows '?' for them
+        switch(type)
+        {
+        case UART_LOG_ARG_INT:
+            val = va_arg(ap, UINT32);
+            if(pos + 4 <= UART_LOG_REC_MAX)
+            {
+                os_memcpy(rec + pos, &val, 4);
+                pos += 4;
+            }
+            break;
+
+        case UART_LOG_ARG_LL:
+            val64 = va_arg(ap, UINT64);
+            if(pos + 8 <= UART_LOG_REC_MAX)
+            {
+                os_memcpy(rec + pos, &val64, 8);
+                pos += 8;
+            }
+            break;
+
+        case UART_LOG_ARG_DBL:
+            dbl = va_arg(ap, double);
+            if(pos + 8 <= UART_LOG_REC_MAX)
+            {
+                os_memcpy(rec + pos, &dbl, 8);
+                pos += 8;
+            }
+            break;
+
+        case UART_LOG_ARG_STR:
+            str = va_arg(ap, const char *);
+            if(NULL == str)
+            {
+                str = "(null)";
+            }
+            for(n = 0; (n < UART_LOG_STR_MAX) && str[n]; n++)
+                ;
+            if(pos + 1 + n > UART_LOG_REC_MAX)
+            {
+                n = (pos + 1 < UART_LOG_REC_MAX) ? (UART_LOG_REC_MAX - pos - 1) : 0;
+            }
+            if(pos + 1 + n <= UART_LOG_REC_MAX)
+            {
+                rec[pos] = n;
+                os_memcpy(rec + pos + 1, str, n);
+                pos = (pos + 1 + n + 3) & ~3;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if(pos > UART_LOG_REC_MAX)
+        {
+            pos = UART_LOG_REC_MAX;
+        }
+    }
+
+    return pos;
+}
+
+static void uart_log_ring_read(UINT8 *dst, UINT32 from, UINT32 len)
+{
+    UINT32 off = from & UART_LOG_MASK;
+    UINT32 first = MIN(len, CFG_UART_DEFER_LOG_SIZE - off);
+
+    os_memcpy(dst, &uart_log_buf[off], first);
+    os_memcpy(dst + first, &uart_log_buf[0], len - first);
+}
+
+static void uart_log_ring_write(const UINT8 *src, UINT32 to, UINT32 len)
+{
+    UINT32 off = to & UART_LOG_MASK;
+    UINT32 first = MIN(len, CFG_UART_DEFER_LOG_SIZE - off);
+
+    os_memcpy(&uart_log_buf[off], src, first);
+    os_memcpy(&uart_log_buf[0], src + first, len - first);
+}
+
+static void uart_log_put(UINT8 *rec, UINT32 len)
+{
+    UINT32 used, was_empty;
+    GLOBAL_INT_DECLARATION();
+
+    // short copy under the interrupt lock, callers may be isr or any task
+    GLOBAL_INT_DISABLE();
+    used = uart_log_in - uart_log_out;
+    if(used + len > CFG_UART_DEFER_LOG_SIZE)
+    {
+        uart_log_drops++;
+        GLOBAL_INT_RESTORE();
+        return;
+    }
+
+    was_empty = (0 == used);
+    uart_log_ring_write(rec, uart_log_in, len);
+    uart_log_in += len;
+    if(used + len > uart_log_used_max)
+    {
+        uart_log_used_max = used + len;
+    }
+    GLOBAL_INT_RESTORE();
+
+    if(was_empty)
+    {
+        rtos_set_semaphore(&uart_log_sema);
+    }
+}
+
+// returns 0 if the message was queued, otherwise bk_printf prints it itself
+int uart_log_vput(const char *fmt, va_list ap)
+{
+    UINT8 rec[UART_LOG_REC_MAX];
+    UART_LOG_HDR_ST *hdr = (UART_LOG_HDR_ST *)rec;
+    UINT32 mode, len, n;
+
+    if(UART_LOG_DIRECT == uart_log_mode)
+    {
+        return -1;
+    }
+
+    // exception dumps must reach the uart before the cpu stops
+    mode = uart_log_cpu_mode();
+    if((CPSR_MODE_ABT == mode) || (CPSR_MODE_UND == mode))
+    {
+        uart_log_mode = UART_LOG_DIRECT;
+        bk_log_flush();
+        return -1;
+    }
+
+    hdr->time = rtos_get_time();
+    hdr->resv = 0;
+    if((UINT32)fmt < UART_LOG_FLASH_END)
+    {
+        hdr->fmt = fmt;
+        len = uart_log_encode(rec, fmt, ap);
+    }
+    else
+    {
+        // format built at run time, print it now and queue the text
+        hdr->fmt = "%s";
+        n = vsnprintf((char *)&rec[sizeof(UART_LOG_HDR_ST) + 1],
+                      UART_LOG_REC_MAX - sizeof(UART_LOG_HDR_ST) - 1, fmt, ap);
+        n = MIN(n, UART_LOG_REC_MAX - sizeof(UART_LOG_HDR_ST) - 2);
+        n = MIN(n, 255);
+        rec[sizeof(UART_LOG_HDR_ST)] = n;
+        len = sizeof(UART_LOG_HDR_ST) + 1 + n;
+    }
+
+    len = (len + 3) & ~3;
+    hdr->len = len;
+    uart_log_put(rec, len);
+
+    return 0;
+}
+
+static UINT32 uart_log_get_arg(UINT8 *rec, UINT32 *pos, UINT32 size, void *val)
+{
+    if(*pos + size > ((UART_LOG_HDR_ST *)rec)->len)
+    {
+        return 0;
+    }
+
+    os_memcpy(val, rec + *pos, size);
+    *pos += size;
+
+    return 1;
+}
+
+// prints one spec with the args taken from the record, returns the chars written
+static int uart_log_print_spec(char *out, UINT32 room, const char *spec,
+                               UINT8 type, UINT8 stars, UINT8 *rec, UINT32 *pos)
+{
+    char str[UART_LOG_REC_MAX];   // %s args are up to UART_LOG_STR_MAX, run time text up to the record
+    INT32 star[2] = {0, 0};
+    UINT32 i, val = 0, n;
+    UINT64 val64 = 0;
+    double dbl = 0;
+    int ok = 1;
+
+    for(i = 0; i < stars; i++)
+    {
+        ok &= uart_log_get_arg(rec, pos, 4, &star[i]);
+    }
+
+    switch(type)
+    {
+    case UART_LOG_ARG_INT:
+        ok &= uart_log_get_arg(rec, pos, 4, &val);
+        break;
+
+    case UART_LOG_ARG_LL:
+        ok &= uart_log_get_arg(rec, pos, 8, &val64);
+        break;
+
+    case UART_LOG_ARG_DBL:
+        ok &= uart_log_get_arg(rec, pos, 8, &dbl);
+        break;
+
+    case UART_LOG_ARG_STR:
+        n = 0;
+        ok &= uart_log_get_arg(rec, pos, 1, &n);
+        if(ok && (n < sizeof(str)) && (*pos + n <= ((UART_LOG_HDR_ST *)rec)->len))
+        {
+            os_memcpy(str, rec + *pos, n);
+            str[n] = 0;
+            *pos = (*pos + n + 3) & ~3;
+        }
+        else
+        {
+            ok = 0;
+        }
+        break;
+
+    default:
+        return snprintf(out, room, "%s", (spec[1] == '%') ? "%" : "");
+    }
+
+    if(!ok)
+    {
+        return snprintf(out, room, "?");
+    }
+
+    if(spec[os_strlen(spec) - 1] == 'n')
+    {
+        return 0;
+    }
+
+#define UART_LOG_PRINT(arg) \
+    ((0 == stars) ? snprintf(out, room, spec, arg) : \
+     (1 == stars) ? snprintf(out, room, spec, star[0], arg) : \
+     snprintf(out, room, spec, star[0], star[1], arg))
+
+    switch(type)
+    {
+    case UART_LOG_ARG_INT:
+        return UART_LOG_PRINT(val);
+    case UART_LOG_ARG_LL:
+        return UART_LOG_PRINT(val64);
+    case UART_LOG_ARG_DBL:
+        return UART_LOG_PRINT(dbl);
+    default:
+        return UART_LOG_PRINT(str);
+    }
+#undef UART_LOG_PRINT
+}
+
+static void uart_log_print_text(UINT8 *rec)
+{
+    char line[UART_LOG_LINE_MAX];
+    char spec[UART_LOG_SPEC_MAX];
+    const char *fmt = ((UART_LOG_HDR_ST *)rec)->fmt;
+    const char *end;
+    UINT32 pos = sizeof(UART_LOG_HDR_ST), cnt = 0;
+    UINT8 type, stars;
+    int n;
+
+    while(*fmt)
+    {
+        if(cnt + UART_LOG_SPEC_MAX + UART_LOG_STR_MAX >= sizeof(line))
+        {
+            line[cnt] = 0;
+            bk_send_string(uart_print_port, line);
+            cnt = 0;
+        }
+
+        if(*fmt != '%')
+        {
+            line[cnt++] = *fmt++;
+            continue;
+        }
+
+        end = uart_log_spec(fmt + 1, &type, &stars);
+        if(end - fmt >= UART_LOG_SPEC_MAX)
+        {
+            line[cnt++] = *fmt++;
+            continue;
+        }
+        os_memcpy(spec, fmt, end - fmt);
+        spec[end - fmt] = 0;
+        fmt = end;
+
+        n = uart_log_print_spec(&line[cnt], sizeof(line) - cnt, spec, type, stars, rec, &pos);
+        if(n > 0)
+        {
+            cnt = MIN(cnt + n, sizeof(line) - 1);
+        }
+    }
+
+    line[cnt] = 0;
+    bk_send_string(uart_print_port, line);
+}
+
+static void uart_log_print_bin(UINT8 *rec)
+{
+    UINT32 i, len = ((UART_LOG_HDR_ST *)rec)->len;
+
+    bk_send_byte(uart_print_port, UART_LOG_SYNC0);
+    bk_send_byte(uart_print_port, UART_LOG_SYNC1);
+    for(i = 0; i < len; i++)
+    {
+        bk_send_byte(uart_print_port, rec[i]);
+    }
+}
+
+static UINT32 uart_log_drain(UINT32 max)
+{
+    UINT32 rec_buf[UART_LOG_REC_MAX / sizeof(UINT32)];
+    UINT8 *rec = (UINT8 *)rec_buf;
+    UART_LOG_HDR_ST *hdr = (UART_LOG_HDR_ST *)rec;
+    UINT32 cnt = 0;
+    char msg[40];
+
+    while((uart_log_in != uart_log_out) && (cnt < max))
+    {
+        uart_log_ring_read(rec, uart_log_out, sizeof(UART_LOG_HDR_ST));
+        uart_log_ring_read(rec, uart_log_out, hdr->len);
+
+        if(UART_LOG_BIN == uart_log_mode)
+        {
+            uart_log_print_bin(rec);
+        }
+        else
+        {
+            uart_log_print_text(rec);
+        }
+
+        // the slot is free only after it is printed
+        barrier();
+        uart_log_out += hdr->len;
+        cnt++;
+    }
+
+    if(uart_log_drops != uart_log_drops_shown)
+    {
+        snprintf(msg, sizeof(msg), "[log] %d dropped\r\n", uart_log_drops - uart_log_drops_shown);
+        bk_send_string(uart_print_port, msg);
+        uart_log_drops_shown = uart_log_drops;
+    }
+
+    return cnt;
+}
+
+// for fatal paths only: prints the rest of the ring with interrupts off,
+// the log task is not expected to run again
+void bk_log_flush(void)
+{
+    GLOBAL_INT_DECLARATION();
+
+    if(uart_log_in != uart_log_out)
+    {
+        GLOBAL_INT_DISABLE();
+        uart_log_drain(0xFFFFFFFF);
+        GLOBAL_INT_RESTORE();
+    }
+}
+
+static void uart_log_thread_main(void *arg)
+{
+    while(1)
+    {
+        rtos_get_semaphore(&uart_log_sema, BEKEN_WAIT_FOREVER);
+        uart_log_drain(0xFFFFFFFF);
+    }
+}
+
+void uart_log_init(void)
+{
+    OSStatus ret;
+
+    ret = rtos_init_semaphore(&uart_log_sema, 1);
+    if(kNoErr != ret)
+    {
+        return;
+    }
+
+    ret = rtos_create_thread(&uart_log_thread,
+                             THD_LOG_PRIORITY,
+                             "log_thread",
+                             (beken_thread_function_t)uart_log_thread_main,
+                             UART_LOG_STACK_SIZE,
+                             (beken_thread_arg_t)0);
+    if(kNoErr != ret)
+    {
+        rtos_deinit_semaphore(&uart_log_sema);
+        uart_log_sema = NULL;
+        return;
+    }
+
+    uart_log_mode = UART_LOG_TEXT;
+}
+
+void uart_log_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv)
+{
+    static const char *mode_name[] = {"direct", "text", "bin"};
+    UINT32 i;
+
+    if(argc > 1)
+    {
+        for(i = 0; i < sizeof(mode_name) / sizeof(mode_name[0]); i++)
+        {
+            if(0 == os_strcmp(argv[1], mode_name[i]))
+            {
+                break;
+            }
+        }
+
+        if((i == sizeof(mode_name) / sizeof(mode_name[0]))
+                || ((UART_LOG_DIRECT != i) && (NULL == uart_log_thread)))
+        {
+            os_printf("Usage: logmode [direct|text|bin]\r\n");
+            return;
+        }
+
+        uart_log_mode = i;
+    }
+
+    os_printf("logmode %s, ring %d/%d max %d, dropped %d\r\n", mode_name[uart_log_mode],
+              uart_log_in - uart_log_out, CFG_UART_DEFER_LOG_SIZE, uart_log_used_max,
+              uart_log_drops);
+}
+#else
+void bk_log_flush(void)
+{
+}
+#endif // CFG_UART_DEFER_LOG
+// EOF
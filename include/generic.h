@@ -24,6 +24,7 @@ typedef void (*FUNC_2PARAM_PTR)(void *arg, uint8_t vif_idx);
 #endif
 
 extern void bk_printf(const char *fmt, ...);
+extern void bk_log_flush(void);
 #define as_printf (bk_printf("%s:%d\r\n",__FUNCTION__,__LINE__))
 
 #if (0 == CFG_RELEASE_FIRMWARE)
@@ -32,6 +33,7 @@ extern void bk_printf(const char *fmt, ...);
     if ((a) != (b))                                 \
     {                                               \
         bk_printf("%s:%d %d!=%d\r\n",__FUNCTION__,__LINE__, (a), (b)); \
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 }
@@ -40,6 +42,7 @@ extern void bk_printf(const char *fmt, ...);
     if ((a) == (b))                                 \
     {                                               \
         bk_printf("%s:%d %d==%d\r\n",__FUNCTION__,__LINE__, (a), (b)); \
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 }
@@ -48,6 +51,7 @@ extern void bk_printf(const char *fmt, ...);
     if ((a) <= (b))                                 \
     {                                               \
         bk_printf("%s:%d %d<=%d\r\n",__FUNCTION__,__LINE__, (a), (b)); \
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 }
@@ -56,6 +60,7 @@ extern void bk_printf(const char *fmt, ...);
     if ((a) < (b))                                 \
     {                                               \
         bk_printf("%s:%d %d<%d\r\n",__FUNCTION__,__LINE__, (a), (b)); \
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 }
@@ -64,6 +69,7 @@ extern void bk_printf(const char *fmt, ...);
     if ((a) >= (b))                                 \
     {                                               \
         bk_printf("%s:%d %d>=%d\r\n",__FUNCTION__,__LINE__, (a), (b)); \
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 }
@@ -72,6 +78,7 @@ extern void bk_printf(const char *fmt, ...);
     if ((a) > (b))                                 \
     {                                               \
         bk_printf("%s:%d %d>%d\r\n",__FUNCTION__,__LINE__, (a), (b)); \
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 }
@@ -80,6 +87,7 @@ extern void bk_printf(const char *fmt, ...);
     if ( !(exp) )                                   \
     {                                               \
     	as_printf;							     	\
+        bk_log_flush();                             \
         while(1);                                   \
     }                                               \
 } 
@@ -105,6 +113,9 @@ extern void bk_printf(const char *fmt, ...);
 
 #define BIT(i)                   (1UL << (i))
 
+/* compiler barrier, orders producer/consumer index updates on the single core */
+#define barrier()                __asm volatile("" ::: "memory")
+
 static inline __uint16_t __bswap16(__uint16_t _x)
 {
 
@@ -652,6 +652,11 @@ void *pvPortMalloc( size_t xWantedSize )
 		xWantedSize = 4;
 
 	vTaskSuspendAll();
+	#if MEM_SLAB_EN
+	/* Small blocks come from the size-class slab, heap_4 is the fallback. */
+	pvReturn = mem_slab_alloc(xWantedSize);
+	if( pvReturn == NULL )
+	#endif
 	pvReturn = malloc_without_lock(xWantedSize);
 	#if OSMALLOC_STATISTICAL
 	{
@@ -680,6 +685,16 @@ void vPortFree( void *pv )
 uint8_t *puc = ( uint8_t * ) pv;
 BlockLink_t *pxLink;
 
+	#if MEM_SLAB_EN
+	if( mem_slab_is_owner( pv ) )
+	{
+		vTaskSuspendAll();
+		mem_slab_free( pv );
+		( void ) xTaskResumeAll();
+		return;
+	}
+	#endif
+
 	if( pv != NULL )
 	{
 		/* The memory being freed will have an BlockLink_t structure immediately
@@ -948,91 +963,182 @@ uint8_t *puc;
 	}
 }
 
-/*yhb added 2015-08-13. wzl added:this function has an issue*/
+/*
+ * Resize an allocated block in place where the heap layout allows it:
+ * shrink by splitting off the tail, grow into the free block that follows
+ * and/or precedes it.  Only when no neighbour fits is a new block allocated,
+ * and then only the old block's real payload is copied.
+ */
 void *pvPortRealloc( void *pv, size_t xWantedSize )
 {
-	uint8_t *puc = ( uint8_t * ) pv;
-	BlockLink_t *pxLink;
-	int presize, datasize;
-	void *pvReturn = NULL;
-	BlockLink_t *pxIterator, *pxPreviousBlock, *tmp;
+uint8_t *puc = ( uint8_t * ) pv;
+BlockLink_t *pxLink, *pxNewLink, *pxPrev, *pxBefore, *pxBeforePrev, *pxAfter;
+size_t xBlockSize, xDataSize, xAvailable;
+void *pvReturn = NULL;
+
+#if MEM_SLAB_EN
+	if( mem_slab_is_owner( pv ) )
+	{
+		xDataSize = mem_slab_obj_size( pv );
+		if( xDataSize >= xWantedSize )
+		{
+			return pv;
+		}
+
+		pvReturn = pvPortMalloc( xWantedSize );
+		if( pvReturn != NULL )
+		{
+			os_memcpy( pvReturn, pv, xDataSize );
+			vPortFree( pv );
+		}
+		return pvReturn;
+	}
+#endif
 
 #if (CFG_SOC_NAME == SOC_BK7221U)
-    if (puc > psram_ucHeap)
-    {
-        return psram_realloc(pv, xWantedSize);
-    }
-	if (pv == NULL)
+	if( puc > psram_ucHeap )
 	{
-		return psram_malloc(xWantedSize);
+		return psram_realloc( pv, xWantedSize );
+	}
+	if( pv == NULL )
+	{
+		return psram_malloc( xWantedSize );
 	}
 #else
-	if (pv == NULL)
-		return pvPortMalloc(xWantedSize);
+	if( pv == NULL )
+	{
+		return pvPortMalloc( xWantedSize );
+	}
 #endif
 
-	/* The memory being freed will have an BlockLink_t structure immediately
+	if( xWantedSize == 0 )
+	{
+		xWantedSize = 4;
+	}
+
+	if( ( ( xWantedSize + xHeapStructSize + portBYTE_ALIGNMENT ) & xBlockAllocatedBit ) != 0 )
+	{
+		return NULL;
+	}
+
+	/* The memory being resized will have an BlockLink_t structure immediately
 	before it. */
 	puc -= xHeapStructSize;
-	/* This casting is to keep the compiler from issuing warnings. */
 	pxLink = ( void * ) puc;
 
-	presize = (pxLink->xBlockSize & ~xBlockAllocatedBit);
-	datasize = presize - xHeapStructSize;
-	if (datasize >= xWantedSize) // have enough memory don't need realloc
-		return pv;
+	configASSERT( ( pxLink->xBlockSize & xBlockAllocatedBit ) != 0 );
+	configASSERT( pxLink->pxNextFreeBlock == NULL );
+
+	xBlockSize = pxLink->xBlockSize & ~xBlockAllocatedBit;
+	xDataSize = xBlockSize - xHeapStructSize;
+
+	/* Same rounding as malloc_without_lock(). */
+	xWantedSize += xHeapStructSize;
+	if( ( xWantedSize & portBYTE_ALIGNMENT_MASK ) != 0x00 )
+	{
+		xWantedSize += ( portBYTE_ALIGNMENT - ( xWantedSize & portBYTE_ALIGNMENT_MASK ) );
+	}
 
-	pxLink->xBlockSize &= ~xBlockAllocatedBit;
 	vTaskSuspendAll();
-	/* Add this block to the list of free blocks. */
-	xFreeBytesRemaining += pxLink->xBlockSize;
-	prvInsertBlockIntoFreeList( ( ( BlockLink_t * ) pxLink ) );
-	pvReturn = malloc_without_lock(xWantedSize);
-	if (pvReturn != NULL) {
-		if (pvReturn != pv)
-			os_memcpy(pvReturn, pv, datasize);
-	} else { // if can't realloc such big memory, we should NOT put pv in free list.
-		pxPreviousBlock = &xStart;
-		pxIterator = xStart.pxNextFreeBlock;
-		while( pxIterator != NULL )
+	{
+		if( xWantedSize <= xBlockSize )
 		{
-			if (pxIterator > pxLink) {
-				break;
+			/* Shrink: give the tail back if it is worth a block of its own. */
+			if( ( xBlockSize - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+			{
+				pxNewLink = ( void * ) ( puc + xWantedSize );
+				pxNewLink->xBlockSize = xBlockSize - xWantedSize;
+				pxLink->xBlockSize = xWantedSize | xBlockAllocatedBit;
+
+				xFreeBytesRemaining += pxNewLink->xBlockSize;
+				prvInsertBlockIntoFreeList( pxNewLink );
 			}
-			if (pxIterator == pxLink) {// find pxLink at the begin
-				if (pxIterator->xBlockSize > presize) {
-					tmp = (BlockLink_t *)((uint8_t*)pxLink + presize);
-					tmp->xBlockSize = (pxIterator->xBlockSize - presize);
-					tmp->pxNextFreeBlock = pxIterator->pxNextFreeBlock;
-					pxPreviousBlock->pxNextFreeBlock = tmp;
-				} else {
-					pxPreviousBlock->pxNextFreeBlock = pxIterator->pxNextFreeBlock;
-				}
-				goto INSERTED;
+			pvReturn = pv;
+		}
+		else
+		{
+			/* Find the free blocks on either side of this one.  The free list
+			is address ordered, so they are consecutive list entries. */
+			pxBeforePrev = NULL;
+			pxPrev = &xStart;
+			while( pxPrev->pxNextFreeBlock < pxLink )
+			{
+				pxBeforePrev = pxPrev;
+				pxPrev = pxPrev->pxNextFreeBlock;
 			}
-			if ((uint8_t*)pxIterator+pxIterator->xBlockSize == (uint8_t*)pxLink + presize) { // find pxLink at the end
-				pxIterator->xBlockSize -= presize;
-				goto INSERTED;
+			pxBefore = pxPrev;
+			pxAfter = pxPrev->pxNextFreeBlock;
+
+			if( ( pxBefore == &xStart ) || ( ( ( uint8_t * ) pxBefore + pxBefore->xBlockSize ) != puc ) )
+			{
+				pxBefore = NULL;
 			}
-			if ((uint8_t*)pxIterator+pxIterator->xBlockSize > (uint8_t*)pxLink + presize) { // find pxLink in the middle
-				pxPreviousBlock = pxIterator;
-				pxIterator = (BlockLink_t *)((uint8_t*)pxLink + presize);
-				pxIterator->xBlockSize = ((uint8_t*)pxPreviousBlock+pxPreviousBlock->xBlockSize)-
-					((uint8_t*)pxLink + presize);
-				tmp = pxPreviousBlock->pxNextFreeBlock;
-				pxPreviousBlock->pxNextFreeBlock = pxIterator;
-				pxPreviousBlock->xBlockSize = (uint8_t*)pxLink - (uint8_t*)pxPreviousBlock;
-				pxIterator->pxNextFreeBlock = tmp;
-				goto INSERTED;
+			if( ( pxAfter == pxEnd ) || ( ( puc + xBlockSize ) != ( uint8_t * ) pxAfter ) )
+			{
+				pxAfter = NULL;
 			}
-			pxPreviousBlock = pxIterator;
-			pxIterator = pxIterator->pxNextFreeBlock;
-		}
 
-INSERTED:
-		pxLink->xBlockSize = presize|xBlockAllocatedBit;;
-		pxLink->pxNextFreeBlock = NULL;
-		xFreeBytesRemaining -= presize;
+			xAvailable = xBlockSize + ( pxAfter ? pxAfter->xBlockSize : 0 );
+			if( ( pxAfter != NULL ) && ( xAvailable >= xWantedSize ) )
+			{
+				/* Grow forward, the data stays where it is. */
+				pxPrev->pxNextFreeBlock = pxAfter->pxNextFreeBlock;
+				xFreeBytesRemaining -= pxAfter->xBlockSize;
+				pxNewLink = pxLink;
+				pvReturn = pv;
+			}
+			else if( ( pxBefore != NULL ) && ( ( xAvailable + pxBefore->xBlockSize ) >= xWantedSize ) )
+			{
+				/* Grow backward (and forward if possible), the data has to be
+				moved down but nothing else is allocated. */
+				xAvailable += pxBefore->xBlockSize;
+				pxBeforePrev->pxNextFreeBlock = ( pxAfter ? pxAfter : pxBefore )->pxNextFreeBlock;
+				xFreeBytesRemaining -= pxBefore->xBlockSize + ( pxAfter ? pxAfter->xBlockSize : 0 );
+				pxNewLink = pxBefore;
+				pvReturn = ( ( uint8_t * ) pxNewLink ) + xHeapStructSize;
+				os_memmove( pvReturn, pv, xDataSize );
+			}
+			else
+			{
+				pxNewLink = NULL;
+			}
+
+			if( pxNewLink != NULL )
+			{
+				if( ( xAvailable - xWantedSize ) > heapMINIMUM_BLOCK_SIZE )
+				{
+					BlockLink_t *pxTail = ( void * ) ( ( ( uint8_t * ) pxNewLink ) + xWantedSize );
+
+					pxTail->xBlockSize = xAvailable - xWantedSize;
+					xFreeBytesRemaining += pxTail->xBlockSize;
+					prvInsertBlockIntoFreeList( pxTail );
+					xAvailable = xWantedSize;
+				}
+
+				pxNewLink->xBlockSize = xAvailable | xBlockAllocatedBit;
+				pxNewLink->pxNextFreeBlock = NULL;
+
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
+			}
+			else
+			{
+				/* No room around the block, move it.  On failure the old
+				block is left untouched. */
+				pvReturn = malloc_without_lock( xWantedSize - xHeapStructSize );
+				if( pvReturn != NULL )
+				{
+					os_memcpy( pvReturn, pv, xDataSize );
+
+					pxLink->xBlockSize = xBlockSize;
+					xFreeBytesRemaining += xBlockSize;
+					traceFREE( pv, xBlockSize );
+					prvInsertBlockIntoFreeList( pxLink );
+				}
+			}
+		}
 	}
 	( void ) xTaskResumeAll();
 
@@ -29,6 +29,33 @@ void *psram_zalloc(size_t size);
 #endif
 #define psram_free        os_free
 
+#if (CFG_MEM_SLAB && (!OSMALLOC_STATISTICAL))
+#define MEM_SLAB_EN       1
+#else
+#define MEM_SLAB_EN       0
+#endif
+
+#if MEM_SLAB_EN
+/* called by heap_4 with the scheduler suspended */
+void *mem_slab_alloc(size_t size);
+void mem_slab_free(void *ptr);
+int mem_slab_is_owner(void *ptr);
+size_t mem_slab_obj_size(void *ptr);
+void mem_slab_dump(void);
+#endif
+
+#if (CFG_MEM_TRACE && (!OSMALLOC_STATISTICAL))
+#define MEM_TRACE_EN      1
+#else
+#define MEM_TRACE_EN      0
+#endif
+
+#if MEM_TRACE_EN
+void mem_trace_alloc(void *ptr, size_t size, void *caller);
+void mem_trace_free(void *ptr, void *caller);
+void mem_trace_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv);
+#endif
+
 #endif // _MEM_PUB_H_
 
 // EOF
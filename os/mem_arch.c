@@ -28,25 +28,23 @@ void *os_memset(void *b, int c, UINT32 len)
 
 void *os_realloc(void *ptr, size_t size)
 {
-	#ifdef FIX_REALLOC_ISSUE
-    return pvPortRealloc(ptr, size);
-	#else
-	void *tmp;
+    void *tmp;
 
     if(platform_is_in_interrupt_context())
     {
         os_printf("realloc_risk\r\n");
     }
 
-	tmp = (void *)pvPortMalloc(size);
-	if(tmp)
-	{
-		os_memcpy(tmp, ptr, size);
-		vPortFree(ptr);
-	}
+    tmp = pvPortRealloc(ptr, size);
+#if MEM_TRACE_EN
+    if(tmp)
+    {
+        mem_trace_free(ptr, __builtin_return_address(0));
+        mem_trace_alloc(tmp, size, __builtin_return_address(0));
+    }
+#endif
 
-	return tmp;
-	#endif
+    return tmp;
 }
 
 int os_memcmp_const(const void *a, const void *b, size_t len)
@@ -55,7 +53,7 @@ int os_memcmp_const(const void *a, const void *b, size_t len)
 }
 
 #if !OSMALLOC_STATISTICAL
-void *os_malloc(size_t size)
+static void *os_malloc_internal(size_t size)
 {
     if(platform_is_in_interrupt_context())
     {
@@ -73,12 +71,26 @@ void *os_malloc(size_t size)
     return (void *)pvPortMalloc(size);
 }
 
+void *os_malloc(size_t size)
+{
+    void *ptr = os_malloc_internal(size);
+
+#if MEM_TRACE_EN
+    mem_trace_alloc(ptr, size, __builtin_return_address(0));
+#endif
+
+    return ptr;
+}
+
 void * os_zalloc(size_t size)
 {
-	void *n = (void *)os_malloc(size);
+	void *n = (void *)os_malloc_internal(size);
 
 	if (n)
 		os_memset(n, 0, size);
+#if MEM_TRACE_EN
+	mem_trace_alloc(n, size, __builtin_return_address(0));
+#endif
 	return n;
 }
 
@@ -91,6 +103,9 @@ void os_free(void *ptr)
     
     if(ptr)
     {        
+#if MEM_TRACE_EN
+        mem_trace_free(ptr, __builtin_return_address(0));
+#endif
         vPortFree(ptr);
     }
 }
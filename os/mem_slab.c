@@ -0,0 +1,245 @@
+#include "include.h"
+#include "arm_arch.h"
+
+#include "sys_rtos.h"
+#include "uart_pub.h"
+#include "mem_pub.h"
+
+#if MEM_SLAB_EN
+#define MEM_SLAB_PAGE_SIZE          1024
+#define MEM_SLAB_PAGE_CNT           (CFG_MEM_SLAB_ARENA_SIZE / MEM_SLAB_PAGE_SIZE)
+#define MEM_SLAB_CLASS_CNT          6
+#define MEM_SLAB_MAX_SIZE           512
+#define MEM_SLAB_PAGE_NONE          0xFF
+
+typedef struct mem_slab_page_st
+{
+    struct mem_slab_page_st *next;  // next partial page of class, or next free page
+    void *free_obj;                 // free objects, linked through their first word
+    UINT16 used;
+    UINT8 cls;
+} MEM_SLAB_PAGE_ST, *MEM_SLAB_PAGE_PTR;
+
+typedef struct mem_slab_class_st
+{
+    UINT32 size;
+    MEM_SLAB_PAGE_PTR partial;      // pages with at least one free object
+
+    UINT32 alloc_cnt;
+    UINT32 free_cnt;
+    UINT32 in_use;
+    UINT32 in_use_max;
+    UINT32 fallback;                // no page left, served by heap_4
+} MEM_SLAB_CLASS_ST, *MEM_SLAB_CLASS_PTR;
+
+static const UINT16 mem_slab_size_tbl[MEM_SLAB_CLASS_CNT] = {16, 32, 64, 128, 256, 512};
+
+static UINT64 mem_slab_arena[CFG_MEM_SLAB_ARENA_SIZE / sizeof(UINT64)];
+static MEM_SLAB_PAGE_ST mem_slab_page[MEM_SLAB_PAGE_CNT];
+static MEM_SLAB_CLASS_ST mem_slab_class[MEM_SLAB_CLASS_CNT];
+static MEM_SLAB_PAGE_PTR mem_slab_free_page = NULL;
+static UINT32 mem_slab_free_page_cnt = 0;
+static UINT32 mem_slab_inited = 0;
+
+static void mem_slab_init(void)
+{
+    UINT32 i;
+
+    for(i = 0; i < MEM_SLAB_CLASS_CNT; i++)
+    {
+        mem_slab_class[i].size = mem_slab_size_tbl[i];
+        mem_slab_class[i].partial = NULL;
+    }
+
+    mem_slab_free_page = NULL;
+    for(i = MEM_SLAB_PAGE_CNT; i > 0; i--)
+    {
+        mem_slab_page[i - 1].cls = MEM_SLAB_PAGE_NONE;
+        mem_slab_page[i - 1].next = mem_slab_free_page;
+        mem_slab_free_page = &mem_slab_page[i - 1];
+    }
+    mem_slab_free_page_cnt = MEM_SLAB_PAGE_CNT;
+
+    mem_slab_inited = 1;
+}
+
+static UINT8 *mem_slab_page_addr(MEM_SLAB_PAGE_PTR page)
+{
+    return (UINT8 *)mem_slab_arena + (page - mem_slab_page) * MEM_SLAB_PAGE_SIZE;
+}
+
+static MEM_SLAB_PAGE_PTR mem_slab_page_get(UINT32 cls)
+{
+    MEM_SLAB_PAGE_PTR page = mem_slab_free_page;
+    UINT8 *obj;
+    UINT32 size, i;
+
+    if(NULL == page)
+    {
+        return NULL;
+    }
+
+    mem_slab_free_page = page->next;
+    mem_slab_free_page_cnt--;
+
+    // carve the page into objects of this class
+    size = mem_slab_size_tbl[cls];
+    obj = mem_slab_page_addr(page);
+    page->free_obj = NULL;
+    for(i = MEM_SLAB_PAGE_SIZE / size; i > 0; i--)
+    {
+        *(void **)(obj + (i - 1) * size) = page->free_obj;
+        page->free_obj = obj + (i - 1) * size;
+    }
+
+    page->used = 0;
+    page->cls = cls;
+    page->next = NULL;
+
+    return page;
+}
+
+static void mem_slab_page_put(MEM_SLAB_PAGE_PTR page)
+{
+    MEM_SLAB_CLASS_PTR slab_cls = &mem_slab_class[page->cls];
+    MEM_SLAB_PAGE_PTR *pp = &slab_cls->partial;
+
+    while(*pp && (*pp != page))
+    {
+        pp = &(*pp)->next;
+    }
+    if(*pp)
+    {
+        *pp = page->next;
+    }
+
+    page->cls = MEM_SLAB_PAGE_NONE;
+    page->next = mem_slab_free_page;
+    mem_slab_free_page = page;
+    mem_slab_free_page_cnt++;
+}
+
+int mem_slab_is_owner(void *ptr)
+{
+    return (((UINT8 *)ptr >= (UINT8 *)mem_slab_arena)
+            && ((UINT8 *)ptr < (UINT8 *)mem_slab_arena + sizeof(mem_slab_arena)));
+}
+
+size_t mem_slab_obj_size(void *ptr)
+{
+    MEM_SLAB_PAGE_PTR page;
+
+    page = &mem_slab_page[((UINT8 *)ptr - (UINT8 *)mem_slab_arena) / MEM_SLAB_PAGE_SIZE];
+    ASSERT(page->cls < MEM_SLAB_CLASS_CNT);
+
+    return mem_slab_size_tbl[page->cls];
+}
+
+void *mem_slab_alloc(size_t size)
+{
+    MEM_SLAB_CLASS_PTR slab_cls;
+    MEM_SLAB_PAGE_PTR page;
+    void *obj;
+    UINT32 cls;
+
+    if(size > MEM_SLAB_MAX_SIZE)
+    {
+        return NULL;
+    }
+
+    if(0 == mem_slab_inited)
+    {
+        mem_slab_init();
+    }
+
+    for(cls = 0; size > mem_slab_size_tbl[cls]; cls++)
+        ;
+    slab_cls = &mem_slab_class[cls];
+
+    page = slab_cls->partial;
+    if(NULL == page)
+    {
+        page = mem_slab_page_get(cls);
+        if(NULL == page)
+        {
+            slab_cls->fallback++;
+            return NULL;
+        }
+        slab_cls->partial = page;
+    }
+
+    obj = page->free_obj;
+    page->free_obj = *(void **)obj;
+    page->used++;
+    if(NULL == page->free_obj)
+    {
+        // page is full, drop it from partial list
+        slab_cls->partial = page->next;
+        page->next = NULL;
+    }
+
+    slab_cls->alloc_cnt++;
+    slab_cls->in_use++;
+    if(slab_cls->in_use > slab_cls->in_use_max)
+    {
+        slab_cls->in_use_max = slab_cls->in_use;
+    }
+
+    return obj;
+}
+
+void mem_slab_free(void *ptr)
+{
+    MEM_SLAB_CLASS_PTR slab_cls;
+    MEM_SLAB_PAGE_PTR page;
+
+    page = &mem_slab_page[((UINT8 *)ptr - (UINT8 *)mem_slab_arena) / MEM_SLAB_PAGE_SIZE];
+    ASSERT(page->cls < MEM_SLAB_CLASS_CNT);
+    ASSERT(page->used);
+    slab_cls = &mem_slab_class[page->cls];
+
+    if(NULL == page->free_obj)
+    {
+        // was full, available again
+        page->next = slab_cls->partial;
+        slab_cls->partial = page;
+    }
+
+    *(void **)ptr = page->free_obj;
+    page->free_obj = ptr;
+    page->used--;
+
+    slab_cls->free_cnt++;
+    slab_cls->in_use--;
+
+    // give empty page back, so other classes can use it
+    if((0 == page->used) && ((page != slab_cls->partial) || page->next))
+    {
+        mem_slab_page_put(page);
+    }
+}
+
+void mem_slab_dump(void)
+{
+    MEM_SLAB_CLASS_PTR slab_cls;
+    UINT32 i;
+
+    if(0 == mem_slab_inited)
+    {
+        os_printf("slab: not used\r\n");
+        return;
+    }
+
+    os_printf("slab: %d/%d pages free, page %d bytes\r\n",
+              mem_slab_free_page_cnt, MEM_SLAB_PAGE_CNT, MEM_SLAB_PAGE_SIZE);
+    os_printf("size   alloc    free     in_use  max     fallback\r\n");
+    for(i = 0; i < MEM_SLAB_CLASS_CNT; i++)
+    {
+        slab_cls = &mem_slab_class[i];
+        os_printf("%-6d %-8d %-8d %-7d %-7d %d\r\n", slab_cls->size,
+                  slab_cls->alloc_cnt, slab_cls->free_cnt,
+                  slab_cls->in_use, slab_cls->in_use_max, slab_cls->fallback);
+    }
+}
+#endif // MEM_SLAB_EN
+// EOF
@@ -0,0 +1,317 @@
+#include "include.h"
+#include "arm_arch.h"
+
+#include "sys_rtos.h"
+#include "rtos_pub.h"
+#include "uart_pub.h"
+#include "mem_pub.h"
+#include "str_pub.h"
+
+#if MEM_TRACE_EN
+#define MEM_TRACE_MASK              (CFG_MEM_TRACE_CNT - 1)
+#define MEM_TRACE_LOG_CNT           64
+#define MEM_TRACE_GROUP_MAX         64
+#define MEM_TRACE_SCAN_STEP         32
+
+#if (CFG_MEM_TRACE_CNT & MEM_TRACE_MASK)
+#error "CFG_MEM_TRACE_CNT must be power of 2"
+#endif
+
+#define MEM_TRACE_EV_FREE           0x80000000
+
+// one live allocation, open addressing by pointer
+typedef struct mem_trace_rec_st
+{
+    void *ptr;
+    void *caller;
+    UINT32 size;
+    UINT32 time;
+} MEM_TRACE_REC_ST, *MEM_TRACE_REC_PTR;
+
+// recent alloc/free events, bit31 of size marks a free
+typedef struct mem_trace_ev_st
+{
+    void *ptr;
+    void *caller;
+    UINT32 size;
+    UINT32 time;
+} MEM_TRACE_EV_ST;
+
+typedef struct mem_trace_group_st
+{
+    void *caller;
+    UINT32 cnt;
+    UINT32 bytes;
+    UINT32 oldest;
+} MEM_TRACE_GROUP_ST;
+
+static MEM_TRACE_REC_ST mem_trace_rec[CFG_MEM_TRACE_CNT];
+static MEM_TRACE_EV_ST mem_trace_log[MEM_TRACE_LOG_CNT];
+static UINT32 mem_trace_log_in = 0;
+static UINT32 mem_trace_live = 0;
+static UINT32 mem_trace_bytes = 0;
+static UINT32 mem_trace_overflow = 0;   // allocations not recorded, table full
+static UINT32 mem_trace_untracked = 0;  // frees of pointers not in table
+static UINT32 mem_trace_enable = 1;
+
+static MEM_TRACE_GROUP_ST mem_trace_group[MEM_TRACE_GROUP_MAX];
+
+static UINT32 mem_trace_hash(void *ptr)
+{
+    UINT32 val = (UINT32)ptr >> 3;
+
+    return (val ^ (val >> 9)) & MEM_TRACE_MASK;
+}
+
+static void mem_trace_log_put(void *ptr, UINT32 size, void *caller, UINT32 time)
+{
+    MEM_TRACE_EV_ST *ev = &mem_trace_log[mem_trace_log_in % MEM_TRACE_LOG_CNT];
+
+    ev->ptr = ptr;
+    ev->caller = caller;
+    ev->size = size;
+    ev->time = time;
+    mem_trace_log_in++;
+}
+
+void mem_trace_alloc(void *ptr, size_t size, void *caller)
+{
+    UINT32 i, cnt, time;
+    GLOBAL_INT_DECLARATION();
+
+    if((NULL == ptr) || (0 == mem_trace_enable))
+    {
+        return;
+    }
+
+    time = rtos_get_time();
+
+    GLOBAL_INT_DISABLE();
+    mem_trace_log_put(ptr, size, caller, time);
+
+    i = mem_trace_hash(ptr);
+    for(cnt = 0; cnt < CFG_MEM_TRACE_CNT; cnt++)
+    {
+        if(NULL == mem_trace_rec[i].ptr)
+        {
+            mem_trace_rec[i].ptr = ptr;
+            mem_trace_rec[i].caller = caller;
+            mem_trace_rec[i].size = size;
+            mem_trace_rec[i].time = time;
+            mem_trace_live++;
+            mem_trace_bytes += size;
+            break;
+        }
+        i = (i + 1) & MEM_TRACE_MASK;
+    }
+
+    if(cnt == CFG_MEM_TRACE_CNT)
+    {
+        mem_trace_overflow++;
+    }
+    GLOBAL_INT_RESTORE();
+}
+
+void mem_trace_free(void *ptr, void *caller)
+{
+    UINT32 i, j, k, cnt;
+    GLOBAL_INT_DECLARATION();
+
+    if((NULL == ptr) || (0 == mem_trace_enable))
+    {
+        return;
+    }
+
+    GLOBAL_INT_DISABLE();
+    i = mem_trace_hash(ptr);
+    for(cnt = 0; cnt < CFG_MEM_TRACE_CNT; cnt++)
+    {
+        if((NULL == mem_trace_rec[i].ptr) || (ptr == mem_trace_rec[i].ptr))
+        {
+            break;
+        }
+        i = (i + 1) & MEM_TRACE_MASK;
+    }
+
+    if((cnt == CFG_MEM_TRACE_CNT) || (NULL == mem_trace_rec[i].ptr))
+    {
+        mem_trace_untracked++;
+        mem_trace_log_put(ptr, MEM_TRACE_EV_FREE, caller, rtos_get_time());
+        GLOBAL_INT_RESTORE();
+        return;
+    }
+
+    mem_trace_log_put(ptr, mem_trace_rec[i].size | MEM_TRACE_EV_FREE, caller, rtos_get_time());
+    mem_trace_live--;
+    mem_trace_bytes -= mem_trace_rec[i].size;
+
+    // backward shift delete, keeps probe chains intact without tombstones
+    j = i;
+    while(1)
+    {
+        j = (j + 1) & MEM_TRACE_MASK;
+        if(NULL == mem_trace_rec[j].ptr)
+        {
+            break;
+        }
+
+        k = mem_trace_hash(mem_trace_rec[j].ptr);
+        if(((j > i) && ((k <= i) || (k > j)))
+                || ((j < i) && ((k <= i) && (k > j))))
+        {
+            mem_trace_rec[i] = mem_trace_rec[j];
+            i = j;
+        }
+    }
+    mem_trace_rec[i].ptr = NULL;
+    GLOBAL_INT_RESTORE();
+}
+
+static void mem_trace_clear(void)
+{
+    GLOBAL_INT_DECLARATION();
+
+    GLOBAL_INT_DISABLE();
+    os_memset(mem_trace_rec, 0, sizeof(mem_trace_rec));
+    mem_trace_log_in = 0;
+    mem_trace_live = 0;
+    mem_trace_bytes = 0;
+    mem_trace_overflow = 0;
+    mem_trace_untracked = 0;
+    GLOBAL_INT_RESTORE();
+}
+
+static UINT32 mem_trace_group_live(void)
+{
+    MEM_TRACE_REC_PTR rec;
+    UINT32 i, j, grp_cnt = 0, other = 0;
+    GLOBAL_INT_DECLARATION();
+
+    for(i = 0; i < CFG_MEM_TRACE_CNT; i++)
+    {
+        // short critical sections, so a dump does not hold off wifi
+        if(0 == (i % MEM_TRACE_SCAN_STEP))
+        {
+            GLOBAL_INT_DISABLE();
+        }
+
+        rec = &mem_trace_rec[i];
+        if(rec->ptr)
+        {
+            for(j = 0; j < grp_cnt; j++)
+            {
+                if(mem_trace_group[j].caller == rec->caller)
+                {
+                    break;
+                }
+            }
+
+            if(j == grp_cnt)
+            {
+                if(grp_cnt < MEM_TRACE_GROUP_MAX)
+                {
+                    mem_trace_group[j].caller = rec->caller;
+                    mem_trace_group[j].cnt = 0;
+                    mem_trace_group[j].bytes = 0;
+                    mem_trace_group[j].oldest = rec->time;
+                    grp_cnt++;
+                }
+                else
+                {
+                    other++;
+                    j = MEM_TRACE_GROUP_MAX;
+                }
+            }
+
+            if(j < MEM_TRACE_GROUP_MAX)
+            {
+                mem_trace_group[j].cnt++;
+                mem_trace_group[j].bytes += rec->size;
+                if((INT32)(rec->time - mem_trace_group[j].oldest) < 0)
+                {
+                    mem_trace_group[j].oldest = rec->time;
+                }
+            }
+        }
+
+        // also at the end, the table may be smaller than one step
+        if(((MEM_TRACE_SCAN_STEP - 1) == (i % MEM_TRACE_SCAN_STEP))
+                || ((CFG_MEM_TRACE_CNT - 1) == i))
+        {
+            GLOBAL_INT_RESTORE();
+        }
+    }
+
+    if(other)
+    {
+        os_printf("memtrace: %d allocations in ungrouped callsites\r\n", other);
+    }
+
+    return grp_cnt;
+}
+
+static void mem_trace_dump_live(void)
+{
+    UINT32 i, grp_cnt;
+
+    grp_cnt = mem_trace_group_live();
+
+    // format parsed by tools/memory_leak/mem_trace_diff.py
+    os_printf("memtrace begin t=%d free=%d live=%d bytes=%d overflow=%d untracked=%d\r\n",
+              rtos_get_time(), xPortGetFreeHeapSize(), mem_trace_live, mem_trace_bytes,
+              mem_trace_overflow, mem_trace_untracked);
+    for(i = 0; i < grp_cnt; i++)
+    {
+        os_printf("mt:%p,%d,%d,%d\r\n", mem_trace_group[i].caller, mem_trace_group[i].cnt,
+                  mem_trace_group[i].bytes, mem_trace_group[i].oldest);
+    }
+    os_printf("memtrace end\r\n");
+}
+
+static void mem_trace_dump_log(void)
+{
+    MEM_TRACE_EV_ST ev;
+    UINT32 i, start, end;
+
+    end = mem_trace_log_in;
+    start = (end > MEM_TRACE_LOG_CNT) ? (end - MEM_TRACE_LOG_CNT) : 0;
+
+    for(i = start; i < end; i++)
+    {
+        ev = mem_trace_log[i % MEM_TRACE_LOG_CNT];
+        os_printf("ev:%d,%c,%p,%d,%p\r\n", ev.time, (ev.size & MEM_TRACE_EV_FREE) ? 'f' : 'm',
+                  ev.ptr, ev.size & ~MEM_TRACE_EV_FREE, ev.caller);
+    }
+}
+
+void mem_trace_cmd(char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv)
+{
+    if((argc < 2) || (0 == os_strcmp(argv[1], "live")))
+    {
+        mem_trace_dump_live();
+    }
+    else if(0 == os_strcmp(argv[1], "log"))
+    {
+        mem_trace_dump_log();
+    }
+    else if(0 == os_strcmp(argv[1], "clear"))
+    {
+        mem_trace_clear();
+    }
+    else if(0 == os_strcmp(argv[1], "on"))
+    {
+        mem_trace_enable = 1;
+    }
+    else if(0 == os_strcmp(argv[1], "off"))
+    {
+        // stale records would show up as leaks, start over on next "on"
+        mem_trace_enable = 0;
+        mem_trace_clear();
+    }
+    else
+    {
+        os_printf("Usage: memtrace [live|log|clear|on|off]\r\n");
+    }
+}
+#endif // MEM_TRACE_EN
+// EOF
@@ -0,0 +1,342 @@
+/*
+ * The usb host fatfs, components/fatfs ff.c and disk_io.c, on a disk image
+ * file instead of udisk, with and without the disk_cache.c sector cache in
+ * between (CFG_FATFS_CACHE_SECTORS from the Makefile).
+ *
+ * Workloads, each on a freshly formatted image:
+ *   small files  - files of 0.5 to 16 KB in a few directories, written in
+ *                  uneven pieces and closed, then read back
+ *   mp3 stream   - one 8 MB file read in 2 KB frames like the player does,
+ *                  with the play position saved to a small file (f_sync)
+ *                  every 64 frames
+ * Afterwards the drive is unmounted, the cache dropped, and every file is
+ * checked against its generator from the image alone, so sectors the cache
+ * never wrote back show up as mismatches.
+ *
+ * Device time is a model of a full speed usb stick, a fixed cost per
+ * command plus a cost per sector, both settable; the host wall time of the
+ * image file says nothing about the target.
+ *   ./dc_bench_cache [cmd_us] [sector_us] [seed]
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ff.h"
+#include "diskio.h"
+#include "driver_udisk.h"
+#include "disk_cache.h"
+
+#define DC_DRIVE                    "1:"        // DISK_TYPE_UDISK in disk_io.c
+#define DC_PDRV                     1
+#define DC_SECTOR_SIZE              512
+#define DC_DISK_SECTORS             (128 * 1024 * 1024 / DC_SECTOR_SIZE)
+#define DC_SMALL_FILES              300
+#define DC_SMALL_DIRS               6
+#define DC_SMALL_MIN                512
+#define DC_SMALL_MAX                (16 * 1024)
+#define DC_SONG_SIZE                (8 * 1024 * 1024)
+#define DC_FRAME                    2048
+#define DC_POS_EVERY                64          // frames between play position saves
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+typedef struct dc_dev_stats
+{
+    unsigned long rd_cmd;
+    unsigned long rd_sect;
+    unsigned long wr_cmd;
+    unsigned long wr_sect;
+} DC_DEV_STATS;
+
+static int dc_fd = -1;
+static DC_DEV_STATS dc_dev;
+static unsigned long dc_cmd_us = 1000;
+static unsigned long dc_sector_us = 400;
+static uint32 dc_small_len[DC_SMALL_FILES];
+static FATFS dc_fs;
+
+/* ------------------------------------------------------------------ udisk on a file */
+
+uint8 udisk_init(void)
+{
+    return (dc_fd >= 0) ? USB_RET_OK : USB_RET_ERROR;
+}
+
+void udisk_uninit(void)
+{
+}
+
+uint32 udisk_get_size(void)
+{
+    return DC_DISK_SECTORS;
+}
+
+uint8 udisk_is_attached(void)
+{
+    return 1;
+}
+
+int udisk_rd_blk_sync(uint32 first_block, uint32 block_num, uint8 *dest)
+{
+    size_t len = (size_t)block_num * DC_SECTOR_SIZE;
+
+    CHECK(first_block + block_num <= DC_DISK_SECTORS);
+    dc_dev.rd_cmd++;
+    dc_dev.rd_sect += block_num;
+    return (pread(dc_fd, dest, len, (off_t)first_block * DC_SECTOR_SIZE) == (ssize_t)len) ? USB_RET_OK : USB_RET_ERROR;
+}
+
+int udisk_wr_blk_sync(uint32 first_block, uint32 block_num, uint8 *dest)
+{
+    size_t len = (size_t)block_num * DC_SECTOR_SIZE;
+
+    CHECK(first_block + block_num <= DC_DISK_SECTORS);
+    dc_dev.wr_cmd++;
+    dc_dev.wr_sect += block_num;
+    return (pwrite(dc_fd, dest, len, (off_t)first_block * DC_SECTOR_SIZE) == (ssize_t)len) ? USB_RET_OK : USB_RET_ERROR;
+}
+
+/* ------------------------------------------------------------------ helpers */
+
+// byte i of a file, different for every file
+static uint8 dc_byte(uint32 file, uint32 i)
+{
+    uint32 x = (file + 1) * 2654435761u ^ (i >> 2) * 40503u;
+
+    return (uint8)(x >> ((i & 3) * 8));
+}
+
+static void dc_small_name(char *name, uint32 file)
+{
+    sprintf(name, DC_DRIVE "D%u/F%04u.DAT", file % DC_SMALL_DIRS, file);
+}
+
+static unsigned long dc_dev_ms(const DC_DEV_STATS *s)
+{
+    return ((s->rd_cmd + s->wr_cmd) * dc_cmd_us + (s->rd_sect + s->wr_sect) * dc_sector_us) / 1000;
+}
+
+static void dc_report(const char *name, const DC_DEV_STATS *from)
+{
+    DC_DEV_STATS d;
+
+    d.rd_cmd = dc_dev.rd_cmd - from->rd_cmd;
+    d.rd_sect = dc_dev.rd_sect - from->rd_sect;
+    d.wr_cmd = dc_dev.wr_cmd - from->wr_cmd;
+    d.wr_sect = dc_dev.wr_sect - from->wr_sect;
+    printf("  %-22s read %6lu cmds %7lu sectors, write %6lu cmds %7lu sectors, device %6lu ms\n",
+           name, d.rd_cmd, d.rd_sect, d.wr_cmd, d.wr_sect, dc_dev_ms(&d));
+}
+
+static void dc_write_file(const char *name, uint32 file, uint32 len, unsigned int *seed)
+{
+    uint8 buf[4096];
+    uint32 done = 0;
+    uint32 n, i;
+    UINT bw;
+    FIL fp;
+
+    CHECK(f_open(&fp, name, FA_WRITE | FA_CREATE_ALWAYS) == FR_OK);
+    while(done < len)
+    {
+        n = 1 + rand_r(seed) % sizeof(buf);
+        if(n > len - done)
+        {
+            n = len - done;
+        }
+        for(i = 0; i < n; i++)
+        {
+            buf[i] = dc_byte(file, done + i);
+        }
+        CHECK(f_write(&fp, buf, n, &bw) == FR_OK && bw == n);
+        done += n;
+    }
+    CHECK(f_close(&fp) == FR_OK);
+}
+
+static void dc_check_file(const char *name, uint32 file, uint32 len)
+{
+    uint8 buf[4096];
+    uint32 done = 0;
+    uint32 i;
+    UINT br;
+    FIL fp;
+
+    CHECK(f_open(&fp, name, FA_READ) == FR_OK);
+    CHECK(f_size(&fp) == len);
+    while(done < len)
+    {
+        CHECK(f_read(&fp, buf, sizeof(buf), &br) == FR_OK && br > 0);
+        for(i = 0; i < br; i++)
+        {
+            if(buf[i] != dc_byte(file, done + i))
+            {
+                printf("FAIL %s byte %u\n", name, done + i);
+                exit(1);
+            }
+        }
+        done += br;
+    }
+    CHECK(f_close(&fp) == FR_OK);
+}
+
+/* ------------------------------------------------------------------ workloads */
+
+static void dc_format(void)
+{
+    static uint8 work[4096];
+
+    CHECK(ftruncate(dc_fd, 0) == 0);
+    CHECK(ftruncate(dc_fd, (off_t)DC_DISK_SECTORS * DC_SECTOR_SIZE) == 0);
+    CHECK(disk_initialize(DC_PDRV) == RES_OK);
+    CHECK(f_mkfs(DC_DRIVE, FM_FAT32, 0, work, sizeof(work)) == FR_OK);
+    CHECK(f_mount(&dc_fs, DC_DRIVE, 1) == FR_OK);
+}
+
+// unmount, drop the cache, mount again: what follows reads the image
+static void dc_remount(void)
+{
+    CHECK(f_mount(NULL, DC_DRIVE, 0) == FR_OK);
+    CHECK(disk_unmount(DC_PDRV) == RES_OK);
+    CHECK(disk_initialize(DC_PDRV) == RES_OK);
+    CHECK(f_mount(&dc_fs, DC_DRIVE, 1) == FR_OK);
+}
+
+static void dc_small_files(unsigned int *seed)
+{
+    DC_DEV_STATS from;
+    char name[32];
+    uint32 i;
+
+    for(i = 0; i < DC_SMALL_DIRS; i++)
+    {
+        sprintf(name, DC_DRIVE "D%u", i);
+        CHECK(f_mkdir(name) == FR_OK);
+    }
+
+    from = dc_dev;
+    for(i = 0; i < DC_SMALL_FILES; i++)
+    {
+        dc_small_len[i] = DC_SMALL_MIN + rand_r(seed) % (DC_SMALL_MAX - DC_SMALL_MIN + 1);
+        dc_small_name(name, i);
+        dc_write_file(name, i, dc_small_len[i], seed);
+    }
+    dc_report("small files write", &from);
+
+    from = dc_dev;
+    for(i = 0; i < DC_SMALL_FILES; i++)
+    {
+        dc_small_name(name, i);
+        dc_check_file(name, i, dc_small_len[i]);
+    }
+    dc_report("small files read", &from);
+}
+
+static void dc_mp3_stream(unsigned int *seed)
+{
+    DC_DEV_STATS from;
+    uint8 frame[DC_FRAME];
+    uint32 pos = 0;
+    uint32 frames = 0;
+    UINT br, bw;
+    FIL song, save;
+
+    dc_write_file(DC_DRIVE "SONG.MP3", DC_SMALL_FILES, DC_SONG_SIZE, seed);
+    CHECK(f_open(&save, DC_DRIVE "PLAYPOS.TXT", FA_WRITE | FA_CREATE_ALWAYS) == FR_OK);
+
+    from = dc_dev;
+    CHECK(f_open(&song, DC_DRIVE "SONG.MP3", FA_READ) == FR_OK);
+    for(;;)
+    {
+        CHECK(f_read(&song, frame, sizeof(frame), &br) == FR_OK);
+        if(0 == br)
+        {
+            break;
+        }
+        CHECK(frame[0] == dc_byte(DC_SMALL_FILES, pos));
+        pos += br;
+
+        if(0 == (++frames % DC_POS_EVERY))
+        {
+            CHECK(f_lseek(&save, 0) == FR_OK);
+            CHECK(f_write(&save, &pos, sizeof(pos), &bw) == FR_OK && bw == sizeof(pos));
+            CHECK(f_sync(&save) == FR_OK);
+        }
+    }
+    CHECK(pos == DC_SONG_SIZE);
+    CHECK(f_close(&song) == FR_OK);
+    CHECK(f_close(&save) == FR_OK);
+    dc_report("mp3 stream", &from);
+}
+
+static void dc_verify(void)
+{
+    char name[32];
+    uint32 pos;
+    UINT br;
+    FIL fp;
+    uint32 i;
+
+    dc_remount();
+    for(i = 0; i < DC_SMALL_FILES; i++)
+    {
+        dc_small_name(name, i);
+        dc_check_file(name, i, dc_small_len[i]);
+    }
+    dc_check_file(DC_DRIVE "SONG.MP3", DC_SMALL_FILES, DC_SONG_SIZE);
+
+    CHECK(f_open(&fp, DC_DRIVE "PLAYPOS.TXT", FA_READ) == FR_OK);
+    CHECK(f_read(&fp, &pos, sizeof(pos), &br) == FR_OK && br == sizeof(pos));
+    CHECK(pos == DC_SONG_SIZE / DC_FRAME / DC_POS_EVERY * DC_POS_EVERY * DC_FRAME);
+    CHECK(f_close(&fp) == FR_OK);
+}
+
+int main(int argc, char **argv)
+{
+    char path[] = "/tmp/dc_diskXXXXXX";
+    unsigned int seed;
+    DC_DEV_STATS from;
+
+    dc_cmd_us = argc > 1 ? strtoul(argv[1], NULL, 0) : dc_cmd_us;
+    dc_sector_us = argc > 2 ? strtoul(argv[2], NULL, 0) : dc_sector_us;
+    seed = argc > 3 ? atoi(argv[3]) : 1;
+
+    dc_fd = mkstemp(path);
+    CHECK(dc_fd >= 0);
+    unlink(path);
+
+#if CFG_FATFS_CACHE_SECTORS
+    printf("fatfs on a %u MB image, %u sector cache, %lu us/cmd %lu us/sector\n",
+           DC_DISK_SECTORS / 2048, CFG_FATFS_CACHE_SECTORS, dc_cmd_us, dc_sector_us);
+#else
+    printf("fatfs on a %u MB image, no cache, %lu us/cmd %lu us/sector\n",
+           DC_DISK_SECTORS / 2048, dc_cmd_us, dc_sector_us);
+#endif
+
+    from = dc_dev;
+    dc_format();
+    dc_small_files(&seed);
+    dc_mp3_stream(&seed);
+    dc_report("all, with format", &from);
+
+#if CFG_FATFS_CACHE_SECTORS
+    {
+        DISK_CACHE_STATS_ST stats;
+
+        disk_cache_get_stats(&stats);
+        printf("  cache: %u hits, %u misses, %u bypassed, %u sectors written back in %u writes\n",
+               stats.hit, stats.miss, stats.bypass, stats.writeback, stats.dev_write);
+    }
+#endif
+
+    dc_verify();
+    CHECK(f_mount(NULL, DC_DRIVE, 0) == FR_OK);
+    close(dc_fd);
+    printf("ok\n");
+
+    return 0;
+}
+// eof
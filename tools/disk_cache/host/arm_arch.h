@@ -0,0 +1,7 @@
+#ifndef __DC_HOST_ARM_ARCH_H__
+#define __DC_HOST_ARM_ARCH_H__
+
+// no registers behind the fatfs, the disk is an image file
+
+#endif
+// eof
@@ -0,0 +1,19 @@
+#ifndef _FF_INTEGER_
+#define _FF_INTEGER_
+
+// forced ahead of the fatfs sources: integer.h makes DWORD a long, which is
+// 64 bit on a pc and fatfs wants 32
+#include <stdint.h>
+
+typedef int             INT;
+typedef unsigned int    UINT;
+typedef unsigned char   BYTE;
+typedef short           SHORT;
+typedef unsigned short  WORD;
+typedef unsigned short  WCHAR;
+typedef int32_t         LONG;
+typedef uint32_t        DWORD;
+typedef uint64_t        QWORD;
+
+#endif
+// eof
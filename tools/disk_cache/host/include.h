@@ -0,0 +1,14 @@
+#ifndef __DC_HOST_INCLUDE_H__
+#define __DC_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, builds the usb host fatfs and disk_cache.c on a pc
+#include <stdint.h>
+#include <stddef.h>
+#include "typedef.h"
+
+#define CFG_USE_SDCARD_HOST               0
+#define CFG_USE_USB_HOST                  1
+// CFG_FATFS_CACHE_SECTORS comes from the Makefile, one binary with and one without
+
+#endif
+// eof
@@ -0,0 +1,13 @@
+#ifndef __DC_HOST_MEM_PUB_H__
+#define __DC_HOST_MEM_PUB_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+#define os_malloc                         malloc
+#define os_free                           free
+#define os_memset                         memset
+#define os_memcpy                         memcpy
+
+#endif
+// eof
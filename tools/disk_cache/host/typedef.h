@@ -0,0 +1,14 @@
+#ifndef __DC_HOST_TYPEDEF_H__
+#define __DC_HOST_TYPEDEF_H__
+
+#include <stdint.h>
+
+typedef uint8_t uint8;
+typedef int8_t int8;
+typedef uint16_t uint16;
+typedef int16_t int16;
+typedef uint32_t uint32;
+typedef int32_t int32;
+
+#endif
+// eof
@@ -0,0 +1,13 @@
+#ifndef __DC_HOST_UART_PUB_H__
+#define __DC_HOST_UART_PUB_H__
+
+#include <stdio.h>
+
+// the fatfs sources chat through os_printf, the bench prints with printf
+#define os_printf(...)
+#define null_prf(...)
+#define warning_prf                       printf
+#define fatal_prf                         printf
+
+#endif
+// eof
@@ -0,0 +1,632 @@
+// host test of components/easy_flash/src/ef_env.c: the ENV records appended behind the
+// saved ENV (EF_ENV_USING_INCR_SAVE) and the hash index (EF_ENV_INDEX_SIZE) over a ram flash
+// which loses the power at a chosen step. It includes the source for the static state.
+#include <stdio.h>
+#include <stdlib.h>
+#include "ef_host.h"
+#include "../../components/easy_flash/src/ef_env.c"
+
+#define CHECK(x) do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+#ifndef EF_ENV_USING_INCR_SAVE
+#error "the test is for the ENV records"
+#endif
+
+#define ET_KEYS             100
+#define ET_DEFAULTS         3
+#define ET_CUT_ROUNDS       200
+
+static ef_env et_default[ET_DEFAULTS] =
+{
+    {"boot", "0"},
+    {"ip", "192.168.1.1"},
+    {"name", "bk7251"},
+};
+
+// data section of the ENV ram cache
+typedef struct et_snap_st
+{
+    size_t len;
+    uint8_t data[ENV_USER_SETTING_SIZE];
+} ET_SNAP;
+
+static uint32_t et_seed = 1;
+static uint32_t et_wraps = 0;
+
+static uint32_t et_rand(void)
+{
+    et_seed ^= et_seed << 13;
+    et_seed ^= et_seed >> 17;
+    et_seed ^= et_seed << 5;
+    return et_seed;
+}
+
+// the defaults, then k0 k1 .. k96, some keys are the start of others
+static const char *et_key(uint32_t i)
+{
+    static char key[8];
+
+    if (i < ET_DEFAULTS)
+    {
+        return et_default[i].key;
+    }
+    sprintf(key, "k%u", i - ET_DEFAULTS);
+    return key;
+}
+
+static void et_snap(ET_SNAP *snap)
+{
+    snap->len = get_env_data_size();
+    memcpy(snap->data, (uint8_t *) env_cache + ENV_PARAM_BYTE_SIZE, snap->len);
+}
+
+static bool et_same(const ET_SNAP *snap)
+{
+    return (get_env_data_size() == snap->len)
+        && !memcmp(snap->data, (uint8_t *) env_cache + ENV_PARAM_BYTE_SIZE, snap->len);
+}
+
+static uint32_t et_incr_start(void)
+{
+    return get_env_system_addr() + ENV_USER_SETTING_SIZE;
+}
+
+static bool et_erased(uint32_t addr, uint32_t end)
+{
+    for (; addr < end; addr++)
+    {
+        if (ef_host_flash[addr - EF_START_ADDR] != 0xFF)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the index finds what the linear search finds, and it is a valid linear probe table
+static void et_index_check(void)
+{
+#if EF_ENV_INDEX_SIZE
+    char *env = (char *) env_cache + ENV_PARAM_BYTE_SIZE;
+    char *env_end = (char *) env_cache + get_env_user_used_size();
+    char *found[ET_KEYS], key[16];
+    uint16_t off_bak[EF_ENV_INDEX_SIZE], tag_bak[EF_ENV_INDEX_SIZE];
+    size_t cnt_bak, key_len, n = 0, used = 0, i, j, home;
+    bool ok = env_index_ok;
+
+    for (; env < env_end; env += (strlen(env) + 1 + 3) / 4 * 4)
+    {
+        key_len = strchr(env, '=') - env;
+        memcpy(key, env, key_len);
+        key[key_len] = '\0';
+        CHECK(find_env(key) == env);
+        n++;
+    }
+
+    for (i = 0; i < ET_KEYS; i++)
+    {
+        found[i] = find_env(et_key(i));
+        env_index_ok = false;
+        CHECK(find_env(et_key(i)) == found[i]);
+        env_index_ok = ok;
+    }
+
+    if (ok)
+    {
+        CHECK(env_index_cnt == n);
+        for (i = 0; i < EF_ENV_INDEX_SIZE; i++)
+        {
+            if (!env_index_off[i])
+            {
+                continue;
+            }
+            used++;
+            env = (char *) env_cache + env_index_off[i];
+            CHECK((env_index_off[i] >= ENV_PARAM_BYTE_SIZE) && (env < env_end) && (env_index_off[i] % 4 == 0));
+            CHECK((uint16_t) calc_key_hash(env, &key_len) == env_index_tag[i]);
+            // no empty slot between the home slot and the ENV
+            home = env_index_tag[i] & (EF_ENV_INDEX_SIZE - 1);
+            for (j = home; j != i; j = (j + 1) & (EF_ENV_INDEX_SIZE - 1))
+            {
+                CHECK(env_index_off[j]);
+            }
+            if (i < home)
+            {
+                et_wraps++;
+            }
+        }
+        CHECK(used == n);
+    }
+    else
+    {
+        // it only gives up when the ENV don't fit
+        CHECK(n > EF_ENV_INDEX_SIZE * 3 / 4);
+    }
+
+    // a rebuilt index finds the same
+    memcpy(off_bak, env_index_off, sizeof(off_bak));
+    memcpy(tag_bak, env_index_tag, sizeof(tag_bak));
+    cnt_bak = env_index_cnt;
+    env_index_build();
+    CHECK(env_index_ok == ok);
+    for (i = 0; i < ET_KEYS; i++)
+    {
+        CHECK(find_env(et_key(i)) == found[i]);
+    }
+    memcpy(env_index_off, off_bak, sizeof(off_bak));
+    memcpy(env_index_tag, tag_bak, sizeof(tag_bak));
+    env_index_cnt = cnt_bak;
+    env_index_ok = ok;
+#endif
+}
+
+// ram as after a reset, the flash as it is
+static void et_boot(void)
+{
+    memset(env_cache, 0, sizeof(env_cache));
+    env_start_addr = 0;
+    env_cache_changed = false;
+    init_ok = false;
+#ifdef EF_ENV_USING_PFS_MODE
+    cur_load_area_addr = 0;
+    next_save_area_addr = 0;
+#endif
+#if EF_ENV_INDEX_SIZE
+    memset(env_index_off, 0, sizeof(env_index_off));
+    memset(env_index_tag, 0, sizeof(env_index_tag));
+    env_index_cnt = 0;
+    env_index_ok = false;
+#endif
+    memset(env_incr_buf, 0, sizeof(env_incr_buf));
+    env_incr_len = 0;
+    env_incr_addr = 0;
+    env_incr_full = true;
+
+    ef_host_power_on();
+    CHECK(ef_env_init(et_default, ET_DEFAULTS) == EF_NO_ERR);
+    et_index_check();
+}
+
+static void et_format_boot(void)
+{
+    ef_host_format();
+    et_boot();
+}
+
+// save, reboot and find the same ENV
+static void et_save_boot(void)
+{
+    ET_SNAP snap;
+
+    CHECK(ef_save_env() == EF_NO_ERR);
+    et_snap(&snap);
+    et_boot();
+    CHECK(et_same(&snap));
+}
+
+static EfErrCode et_set(uint32_t key, uint32_t value_max, uint32_t del_pct)
+{
+    char value[16];
+    uint32_t len = 0, i;
+
+    if (et_rand() % 100 >= del_pct)
+    {
+        len = 1 + et_rand() % value_max;
+    }
+    for (i = 0; i < len; i++)
+    {
+        value[i] = 'a' + et_rand() % 26;
+    }
+    value[len] = '\0';
+
+    return ef_set_env(et_key(key), value);
+}
+
+// some changes for one save
+static void et_changes(uint32_t seed, uint32_t min, uint32_t max)
+{
+    uint32_t n, i;
+
+    et_seed = seed * 2654435761u | 1;
+    n = min + et_rand() % (max - min + 1);
+    for (i = 0; i < n; i++)
+    {
+        et_set(et_rand() % 30, 12, 25);
+    }
+}
+
+// the records are applied over the saved ENV, in order
+static void et_replay(void)
+{
+    ET_SNAP snap;
+    uint32_t erases, addr, i;
+
+    et_format_boot();
+    CHECK(!strcmp(ef_get_env("ip"), "192.168.1.1"));
+    CHECK(env_incr_addr == et_incr_start());
+    CHECK(et_erased(env_incr_addr, get_env_system_addr() + ENV_INCR_AREA_SIZE));
+
+    erases = ef_host_erases;
+    CHECK(ef_set_env("ip", "10.0.0.2") == EF_NO_ERR);
+    CHECK(ef_set_env("boot", "") == EF_NO_ERR);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(ef_set_env("boot", "1") == EF_NO_ERR);
+    CHECK(ef_set_env("ip", "10.0.0.3") == EF_NO_ERR);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    for (i = 0; i < 10; i++)
+    {
+        et_changes(i + 1, 1, 3);
+        CHECK(ef_save_env() == EF_NO_ERR);
+    }
+    // only appended
+    CHECK(ef_host_erases == erases);
+    CHECK(env_incr_addr > et_incr_start());
+
+    et_snap(&snap);
+    addr = env_incr_addr;
+    et_boot();
+    CHECK(et_same(&snap));
+    CHECK(env_incr_addr == addr);
+    CHECK(!env_incr_full);
+    CHECK(!env_cache_changed);
+
+    // a save without changes writes nothing
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(env_incr_addr == addr);
+    CHECK(ef_host_overwrites == 0);
+}
+
+// a record cut by power fail is dropped with all of its changes, the next save rewrites the ENV
+static void et_torn(void)
+{
+    ET_SNAP snap;
+    uint32_t erases, system, addr;
+
+    et_format_boot();
+    CHECK(ef_set_env("k1", "one") == EF_NO_ERR);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    et_snap(&snap);
+
+    CHECK(ef_set_env("k2", "two") == EF_NO_ERR);
+    CHECK(ef_set_env("k3", "three") == EF_NO_ERR);
+    CHECK(ef_set_env("boot", "") == EF_NO_ERR);
+    addr = env_incr_addr;
+    // in "k3=three"
+    ef_host_cut = ENV_INCR_HDR_SIZE + 8 + 6;
+    ef_save_env();
+    CHECK(ef_host_off);
+    CHECK(!et_erased(addr, addr + ENV_INCR_HDR_SIZE));
+
+    et_boot();
+    CHECK(et_same(&snap));
+    CHECK(ef_get_env("k2") == NULL);
+    CHECK(!strcmp(ef_get_env("boot"), "0"));
+    CHECK(env_incr_full);
+    CHECK(env_incr_addr == addr);
+
+    system = get_env_system_addr();
+    erases = ef_host_erases;
+    CHECK(ef_set_env("k4", "four") == EF_NO_ERR);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(ef_host_erases == erases + 1);
+#ifdef EF_ENV_USING_PFS_MODE
+    CHECK(get_env_system_addr() != system);
+#else
+    CHECK(get_env_system_addr() == system);
+#endif
+    CHECK(env_incr_addr == et_incr_start());
+    CHECK(et_erased(env_incr_addr, get_env_system_addr() + ENV_INCR_AREA_SIZE));
+
+    et_snap(&snap);
+    et_boot();
+    CHECK(et_same(&snap));
+    CHECK(!strcmp(ef_get_env("k4"), "four"));
+    CHECK(!env_incr_full);
+    CHECK(ef_host_overwrites == 0);
+}
+
+// a record with a flipped bit in the header, the CRC or the data stops the replay there
+static void et_crc(void)
+{
+    static const uint32_t pos[] = { 0, 4, ENV_INCR_HDR_SIZE, ENV_INCR_HDR_SIZE + 5 };
+    ET_SNAP snap;
+    uint32_t erases, addr, i;
+    uint8_t *byte;
+
+    for (i = 0; i < sizeof(pos) / sizeof(pos[0]); i++)
+    {
+        et_format_boot();
+        CHECK(ef_set_env("k1", "one") == EF_NO_ERR);
+        CHECK(ef_save_env() == EF_NO_ERR);
+        et_snap(&snap);
+        addr = env_incr_addr;
+        CHECK(ef_set_env("k2", "two") == EF_NO_ERR);
+        CHECK(ef_set_env("name", "") == EF_NO_ERR);
+        CHECK(ef_save_env() == EF_NO_ERR);
+        CHECK(ef_set_env("k3", "three") == EF_NO_ERR);
+        CHECK(ef_save_env() == EF_NO_ERR);
+
+        // clear the lowest set bit, like a weak cell
+        byte = &ef_host_flash[addr + pos[i] - EF_START_ADDR];
+        CHECK(*byte);
+        *byte &= *byte - 1;
+
+        et_boot();
+        CHECK(et_same(&snap));
+        CHECK(ef_get_env("k3") == NULL);
+        CHECK(env_incr_full);
+        CHECK(env_incr_addr == addr);
+
+        erases = ef_host_erases;
+        CHECK(ef_set_env("k5", "five") == EF_NO_ERR);
+        CHECK(ef_save_env() == EF_NO_ERR);
+        CHECK(ef_host_erases == erases + 1);
+        CHECK(env_incr_addr == et_incr_start());
+        et_snap(&snap);
+        et_boot();
+        CHECK(et_same(&snap));
+        CHECK(!strcmp(ef_get_env("k5"), "five"));
+    }
+    CHECK(ef_host_overwrites == 0);
+}
+
+// records until they don't fit, then the whole ENV is saved again and the records erased
+static void et_fill(void)
+{
+    ET_SNAP snap;
+    uint32_t erases, system, addr, area, i, j;
+    char value[16];
+#ifdef EF_ENV_USING_PFS_MODE
+    uint32_t count;
+#endif
+
+    et_format_boot();
+    area = get_env_system_addr();
+    for (j = 0; j < 2; j++)
+    {
+        system = get_env_system_addr();
+        erases = ef_host_erases;
+#ifdef EF_ENV_USING_PFS_MODE
+        count = env_cache[ENV_PARAM_INDEX_SAVED_COUNT];
+#endif
+        for (i = 0; ; i++)
+        {
+            CHECK(i < 1000);
+            addr = env_incr_addr;
+            // "fill=value0000\0" is one 24 bytes record
+            sprintf(value, "value%04u", i);
+            CHECK(ef_set_env("fill", value) == EF_NO_ERR);
+            CHECK(ef_save_env() == EF_NO_ERR);
+            if (ef_host_erases != erases)
+            {
+                break;
+            }
+            CHECK(env_incr_addr == addr + 24);
+        }
+        CHECK(i > 0);
+        CHECK(addr + 24 > system + ENV_INCR_AREA_SIZE);
+        CHECK(ef_host_erases == erases + 1);
+#ifdef EF_ENV_USING_PFS_MODE
+        CHECK(get_env_system_addr() != system);
+        CHECK(env_cache[ENV_PARAM_INDEX_SAVED_COUNT] == count + 1);
+#else
+        CHECK(get_env_system_addr() == system);
+#endif
+        CHECK(env_incr_addr == et_incr_start());
+        CHECK(et_erased(env_incr_addr, get_env_system_addr() + ENV_INCR_AREA_SIZE));
+
+        et_snap(&snap);
+        et_boot();
+        CHECK(et_same(&snap));
+        CHECK(!strcmp(ef_get_env("fill"), value));
+    }
+    // PFS mode is back in the first area
+    CHECK(get_env_system_addr() == area);
+
+    // more changes than the ram buffer holds
+    erases = ef_host_erases;
+    for (i = 0; i < 20; i++)
+    {
+        sprintf(value, "value%04u", i);
+        CHECK(ef_set_env(et_key(ET_DEFAULTS + i), value) == EF_NO_ERR);
+    }
+    CHECK(env_incr_full);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(ef_host_erases == erases + 1);
+    CHECK(!env_incr_full);
+    et_snap(&snap);
+    et_boot();
+    CHECK(et_same(&snap));
+    CHECK(ef_host_overwrites == 0);
+}
+
+// an image without records, like older firmware writes it
+static void et_old(void)
+{
+    static const char old[] = "old=records of an other layout";
+    ET_SNAP snap;
+    uint32_t erases, addr;
+
+    et_format_boot();
+    CHECK(ef_set_env("k1", "one") == EF_NO_ERR);
+    CHECK(ef_set_env("ip", "10.0.0.2") == EF_NO_ERR);
+    // what the old save did, the whole ENV and the erase of the sector behind it
+    env_incr_full = true;
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(et_erased(et_incr_start(), get_env_system_addr() + ENV_INCR_AREA_SIZE));
+    et_snap(&snap);
+
+    et_boot();
+    CHECK(et_same(&snap));
+    CHECK(!env_incr_full);
+    CHECK(env_incr_addr == et_incr_start());
+    erases = ef_host_erases;
+    CHECK(ef_set_env("k2", "two") == EF_NO_ERR);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(ef_host_erases == erases);
+    et_save_boot();
+    CHECK(!strcmp(ef_get_env("k2"), "two"));
+
+    // data behind the ENV which isn't a record is ignored, the first save rewrites all
+    env_incr_full = true;
+    env_cache_changed = true;
+    CHECK(ef_save_env() == EF_NO_ERR);
+    addr = et_incr_start();
+    memcpy(&ef_host_flash[addr - EF_START_ADDR], old, sizeof(old));
+    et_snap(&snap);
+    et_boot();
+    CHECK(et_same(&snap));
+    CHECK(env_incr_full);
+    erases = ef_host_erases;
+    CHECK(ef_set_env("k3", "three") == EF_NO_ERR);
+    CHECK(ef_save_env() == EF_NO_ERR);
+    CHECK(ef_host_erases == erases + 1);
+    CHECK(et_erased(et_incr_start(), get_env_system_addr() + ENV_INCR_AREA_SIZE));
+    et_save_boot();
+    CHECK(!strcmp(ef_get_env("k3"), "three"));
+}
+
+// a failed erase leaves the records where they were, the next save rewrites all
+static void et_erase_err(void)
+{
+    EfErrCode result = EF_NO_ERR;
+    char value[16];
+    uint32_t i;
+
+    et_format_boot();
+    ef_host_erase_err = true;
+    for (i = 0; ef_host_erase_err; i++)
+    {
+        CHECK(i < 1000);
+        sprintf(value, "value%04u", i);
+        CHECK(ef_set_env("fill", value) == EF_NO_ERR);
+        result = ef_save_env();
+    }
+    CHECK(result == EF_ERASE_ERR);
+    CHECK(env_incr_full);
+    CHECK(env_cache_changed);
+    CHECK(ef_set_env("k1", "one") == EF_NO_ERR);
+    et_save_boot();
+    CHECK(!strcmp(ef_get_env("fill"), value));
+    CHECK(!strcmp(ef_get_env("k1"), "one"));
+    CHECK(ef_host_overwrites == 0);
+}
+
+// the power is cut at every step of a save, the ENV is all before or all after it
+static void et_cut(void)
+{
+    static uint8_t image[ENV_AREA_SIZE], image_new[ENV_AREA_SIZE];
+    ET_SNAP snap_old, snap_new, snap_def, snap;
+    uint32_t round, step, steps, erases, cuts = 0, fulls = 0;
+    bool full;
+    char value[16];
+
+    et_format_boot();
+    et_snap(&snap_def);
+    for (round = 0; round < ET_CUT_ROUNDS; round++)
+    {
+        et_snap(&snap_old);
+        memcpy(image, ef_host_flash, sizeof(image));
+
+        et_changes(round + 100, 2, 4);
+        et_snap(&snap_new);
+        ef_host_steps = 0;
+        erases = ef_host_erases;
+        CHECK(ef_save_env() == EF_NO_ERR);
+        steps = ef_host_steps;
+        full = ef_host_erases != erases;
+        fulls += full;
+        memcpy(image_new, ef_host_flash, sizeof(image_new));
+
+        for (step = 0; step < steps; step++)
+        {
+            memcpy(ef_host_flash, image, sizeof(image));
+            et_boot();
+            CHECK(et_same(&snap_old));
+            et_changes(round + 100, 2, 4);
+            ef_host_cut = step;
+            ef_save_env();
+            CHECK(ef_host_off);
+
+            et_boot();
+#ifdef EF_ENV_USING_PFS_MODE
+            CHECK(et_same(&snap_old) || et_same(&snap_new));
+#else
+            // one area, a cut full save loses all
+            CHECK(et_same(&snap_old) || et_same(&snap_new) || (full && et_same(&snap_def)));
+#endif
+            // and it works on
+            sprintf(value, "%u", step);
+            CHECK(ef_set_env("after", value) == EF_NO_ERR);
+            et_save_boot();
+            CHECK(!strcmp(ef_get_env("after"), value));
+            CHECK(ef_host_overwrites == 0);
+            cuts++;
+        }
+
+        memcpy(ef_host_flash, image_new, sizeof(image_new));
+        et_boot();
+        CHECK(et_same(&snap_new));
+    }
+    // some cut rewrites of the whole ENV too
+    CHECK(fulls >= 2);
+    printf("%u cuts in %u saves, %u of them full\n", cuts, ET_CUT_ROUNDS, fulls);
+    et_snap(&snap);
+    CHECK(snap.len > 0);
+}
+
+// random ENV changes, the index against the linear search after each one
+static void et_index(void)
+{
+    ET_SNAP snap;
+    bool was_off = false, back_on = false;
+    uint32_t i;
+
+    et_format_boot();
+    et_seed = 7;
+    et_wraps = 0;
+    for (i = 0; i < 6000; i++)
+    {
+        // grow and shrink
+        et_set(et_rand() % ET_KEYS, (i / 1000) % 2 ? 4 : 2, (i / 1000) % 2 ? 97 : 15);
+        et_index_check();
+#if EF_ENV_INDEX_SIZE
+        if (!env_index_ok)
+        {
+            was_off = true;
+        }
+        else if (was_off)
+        {
+            back_on = true;
+        }
+#endif
+        if (i % 97 == 0)
+        {
+            CHECK(ef_save_env() == EF_NO_ERR);
+            et_snap(&snap);
+            et_boot();
+            CHECK(et_same(&snap));
+        }
+    }
+#if EF_ENV_INDEX_SIZE
+    // too many ENV for the index and back
+    CHECK(was_off && back_on);
+    CHECK(et_wraps > 0);
+#endif
+    CHECK(ef_host_overwrites == 0);
+}
+
+int main(int argc, char *argv[])
+{
+    ef_host_verbose = argc > 1;
+    et_replay();
+    et_torn();
+    et_crc();
+    et_fill();
+    et_old();
+    et_erase_err();
+    et_index();
+    et_cut();
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef __EF_HOST_CFG_H__
+#define __EF_HOST_CFG_H__
+
+// the shipped config, the Makefile builds some variants of it
+#include "../../../components/easy_flash/port/ef_cfg.h"
+
+// one ENV area without a backup
+#ifdef EF_HOST_NORMAL
+#undef EF_ENV_USING_PFS_MODE
+#undef ENV_AREA_SIZE
+#define ENV_AREA_SIZE                  (1 * EF_ERASE_MIN_SIZE)
+#endif
+
+#ifdef EF_HOST_INDEX_SIZE
+#undef EF_ENV_INDEX_SIZE
+#define EF_ENV_INDEX_SIZE              EF_HOST_INDEX_SIZE
+#endif
+
+#endif
+// eof
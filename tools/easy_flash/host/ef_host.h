@@ -0,0 +1,27 @@
+#ifndef __EF_HOST_H__
+#define __EF_HOST_H__
+
+#include <easyflash.h>
+
+// ram flash under the ENV area, a write only clears bits and an erase sets a sector to 0xFF.
+// a cut write leaves any bits of the rest of its 256 bytes page programmed
+extern uint8_t ef_host_flash[ENV_AREA_SIZE];
+// flash steps until the power is cut, a step is a programmed byte or an erased sector. -1 is never
+extern long ef_host_cut;
+// power is cut, the flash is not changed anymore until ef_host_power_on
+extern bool ef_host_off;
+// steps done, a cut step is not counted
+extern uint32_t ef_host_steps;
+// sector erases, a cut one too
+extern uint32_t ef_host_erases;
+// bytes written over programmed bits, the ENV code must not do it
+extern uint32_t ef_host_overwrites;
+// the next erase fails and leaves the flash as it is
+extern bool ef_host_erase_err;
+extern bool ef_host_verbose;
+
+void ef_host_format(void);
+void ef_host_power_on(void);
+
+#endif
+// eof
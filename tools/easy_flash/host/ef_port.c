@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "ef_host.h"
+
+uint8_t ef_host_flash[ENV_AREA_SIZE];
+long ef_host_cut = -1;
+bool ef_host_off = false;
+uint32_t ef_host_steps = 0;
+uint32_t ef_host_erases = 0;
+uint32_t ef_host_overwrites = 0;
+bool ef_host_erase_err = false;
+bool ef_host_verbose = false;
+
+static uint32_t ef_host_seed = 1;
+static int ef_host_locks = 0;
+
+// torn data of a cut step
+static uint8_t ef_host_noise(void)
+{
+    ef_host_seed = ef_host_seed * 1103515245 + 12345;
+    return ef_host_seed >> 16;
+}
+
+// bits of a byte in a cut page program, none, all or some of them
+static uint8_t ef_host_torn(uint8_t src)
+{
+    switch (ef_host_noise() % 3)
+    {
+    case 0:
+        return 0xFF;
+    case 1:
+        return src;
+    default:
+        return src | ef_host_noise();
+    }
+}
+
+// a cut step is done and counted unless the power has gone
+static bool ef_host_step(void)
+{
+    if (ef_host_off)
+    {
+        return false;
+    }
+    if (ef_host_cut == 0)
+    {
+        ef_host_off = true;
+        return false;
+    }
+    if (ef_host_cut > 0)
+    {
+        ef_host_cut--;
+    }
+    ef_host_steps++;
+    return true;
+}
+
+static uint8_t *ef_host_addr(uint32_t addr, size_t size)
+{
+    if ((addr < EF_START_ADDR) || (addr + size > EF_START_ADDR + ENV_AREA_SIZE))
+    {
+        printf("FAIL flash access 0x%08X size %ld out of the ENV area\n", addr, (long) size);
+        exit(1);
+    }
+    return ef_host_flash + addr - EF_START_ADDR;
+}
+
+void ef_host_format(void)
+{
+    memset(ef_host_flash, 0xFF, sizeof(ef_host_flash));
+}
+
+void ef_host_power_on(void)
+{
+    ef_host_off = false;
+    ef_host_cut = -1;
+    ef_host_erase_err = false;
+    ef_host_locks = 0;
+}
+
+EfErrCode ef_port_read(uint32_t addr, uint32_t *buf, size_t size)
+{
+    memcpy(buf, ef_host_addr(addr, size), size);
+    return EF_NO_ERR;
+}
+
+// whole 4K sectors like bk_erase
+EfErrCode ef_port_erase(uint32_t addr, size_t size)
+{
+    uint8_t *sector;
+    size_t i;
+
+    EF_ASSERT(addr % EF_ERASE_MIN_SIZE == 0);
+    if (ef_host_erase_err)
+    {
+        ef_host_erase_err = false;
+        return EF_ERASE_ERR;
+    }
+
+    size = (size + EF_ERASE_MIN_SIZE - 1) / EF_ERASE_MIN_SIZE * EF_ERASE_MIN_SIZE;
+    for (sector = ef_host_addr(addr, size); size; sector += EF_ERASE_MIN_SIZE, size -= EF_ERASE_MIN_SIZE)
+    {
+        ef_host_erases++;
+        if (ef_host_step())
+        {
+            memset(sector, 0xFF, EF_ERASE_MIN_SIZE);
+        }
+        else if (ef_host_off && (ef_host_cut == 0))
+        {
+            // an erase cut half way leaves any data
+            for (i = 0; i < EF_ERASE_MIN_SIZE; i++)
+            {
+                sector[i] = ef_host_noise();
+            }
+            ef_host_cut = -1;
+        }
+    }
+    return EF_NO_ERR;
+}
+
+EfErrCode ef_port_write(uint32_t addr, const uint32_t *buf, size_t size)
+{
+    const uint8_t *src = (const uint8_t *) buf;
+    uint8_t *dst;
+    size_t i;
+
+    EF_ASSERT(size % 4 == 0);
+    dst = ef_host_addr(addr, size);
+    for (i = 0; i < size; i++)
+    {
+        if (ef_host_step())
+        {
+            if ((dst[i] & src[i]) != src[i])
+            {
+                ef_host_overwrites++;
+            }
+            dst[i] &= src[i];
+        }
+        else if (ef_host_off && (ef_host_cut == 0))
+        {
+            // the flash programs a 256 bytes page at once, the rest of it is torn
+            do
+            {
+                dst[i] &= ef_host_torn(src[i]);
+                i++;
+            } while ((i < size) && ((addr + i) % 256));
+            ef_host_cut = -1;
+        }
+    }
+    return EF_NO_ERR;
+}
+
+void ef_port_env_lock(void)
+{
+    ef_host_locks++;
+    if (ef_host_locks != 1)
+    {
+        printf("FAIL ENV lock taken twice\n");
+        exit(1);
+    }
+}
+
+void ef_port_env_unlock(void)
+{
+    ef_host_locks--;
+}
+
+void ef_log_debug(const char *file, const long line, const char *format, ...)
+{
+    va_list args;
+
+    // EF_ASSERT spins forever after this
+    if (strstr(format, "assert failed"))
+    {
+        va_start(args, format);
+        printf("FAIL %s:%ld ", file, line);
+        vprintf(format, args);
+        va_end(args);
+        exit(1);
+    }
+    if (ef_host_verbose)
+    {
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+    }
+}
+
+void ef_log_info(const char *format, ...)
+{
+    va_list args;
+
+    if (ef_host_verbose)
+    {
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+    }
+}
+
+void ef_print(const char *format, ...)
+{
+    va_list args;
+
+    if (ef_host_verbose)
+    {
+        va_start(args, format);
+        vprintf(format, args);
+        va_end(args);
+    }
+}
+// eof
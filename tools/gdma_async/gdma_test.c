@@ -0,0 +1,592 @@
+/*
+ * Host test of the gdma copy engine queueing in driver/general_dma/gdma_async.c.
+ *
+ * The general dma channels are a mock behind the gdma_async_hw_xxx hooks. A
+ * transfer takes a few ticks, then copies its bytes and raises the finish
+ * status. The isr stand-in routes it like gdma_isr does: to the engine when
+ * gdma_async_owns() the channel, to the driver otherwise.
+ *
+ * Single threaded cases tick the mock by hand, polling a busy channel moves
+ * it on, so a spin ends. The stress case runs the mock and the isr in a
+ * second thread while this one submits, waits and takes channels away.
+ *
+ *   ./gdma_test [stress_rounds] [seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "include.h"
+#include "../../driver/general_dma/gdma_async.c"
+
+#define TEST_MASK                   0x09        // the sdk default, channels 0 and 3
+#define TEST_REQ_MAX                64
+#define TEST_SRC_LEN                (1024 * 1024)
+
+typedef struct hw_chnl_st
+{
+    UINT32 active;
+    UINT32 ticks;
+    UINT8 *dst;
+    const UINT8 *src;
+    UINT32 len;
+    UINT32 inten;                               // finish interrupt enabled
+    UINT32 status;                              // finish status, cleared by ack
+} HW_CHNL_ST;
+
+static HW_CHNL_ST hw[GDMA_CHANNEL_MAX];
+static pthread_mutex_t hw_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t int_lock;
+static volatile UINT32 hw_threaded;
+static volatile UINT32 hw_stop;
+
+static UINT32 hw_driver_mask;                   // taken by a driver, the engine must not start them
+static UINT32 hw_starts;
+static UINT32 hw_driver_irqs;
+static UINT32 hw_max_active;
+static const void *hw_start_log[TEST_REQ_MAX];
+static UINT32 hw_start_log_cnt;
+static UINT32 errors;
+
+static UINT8 *src_pool;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond))                                                        \
+        {                                                                   \
+            printf("  check failed, line %d: %s\n", __LINE__, #cond);       \
+            errors++;                                                       \
+        }                                                                   \
+    } while (0)
+
+void host_int_disable(void)
+{
+    pthread_mutex_lock(&int_lock);
+}
+
+void host_int_restore(void)
+{
+    pthread_mutex_unlock(&int_lock);
+}
+
+OSStatus rtos_set_semaphore(beken_semaphore_t *semaphore)
+{
+    __atomic_add_fetch((UINT32 *)*semaphore, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+// with hw_lock held
+static void hw_step(UINT32 ch)
+{
+    HW_CHNL_ST *c = &hw[ch];
+
+    if (c->active && (0 == --c->ticks))
+    {
+        memcpy(c->dst, c->src, c->len);
+        c->active = 0;
+        c->status = 1;
+    }
+}
+
+void gdma_async_hw_start(UINT32 channel, void *dst, const void *src, UINT32 len)
+{
+    HW_CHNL_ST *c = &hw[channel];
+    UINT32 ch, active = 0;
+
+    pthread_mutex_lock(&hw_lock);
+    if (c->active || (hw_driver_mask & (1 << channel)) || (0 == len) || (len > GDMA_ASYNC_CHUNK_MAX))
+    {
+        printf("  bad start: chnl %u active %u len %u\n", channel, c->active, len);
+        errors++;
+    }
+
+    c->dst = dst;
+    c->src = src;
+    c->len = len;
+    c->ticks = 1 + (len >> 14) + (rand() & 1);
+    c->active = 1;
+    c->status = 0;
+
+    hw_starts++;
+    if (hw_start_log_cnt < TEST_REQ_MAX)
+    {
+        hw_start_log[hw_start_log_cnt++] = dst;
+    }
+    for (ch = 0; ch < GDMA_CHANNEL_MAX; ch++)
+    {
+        active += hw[ch].active;
+    }
+    if (active > hw_max_active)
+    {
+        hw_max_active = active;
+    }
+    pthread_mutex_unlock(&hw_lock);
+}
+
+UINT32 gdma_async_hw_busy(UINT32 channel)
+{
+    UINT32 busy;
+
+    pthread_mutex_lock(&hw_lock);
+    // without the hw thread, polling is what moves the transfer on
+    if (!hw_threaded)
+    {
+        hw_step(channel);
+    }
+    busy = hw[channel].active;
+    pthread_mutex_unlock(&hw_lock);
+
+    return busy;
+}
+
+void gdma_async_hw_ack(UINT32 channel)
+{
+    pthread_mutex_lock(&hw_lock);
+    hw[channel].status = 0;
+    pthread_mutex_unlock(&hw_lock);
+}
+
+// gdma_isr, runs with interrupts off
+static void host_isr(void)
+{
+    UINT32 ch, status;
+
+    host_int_disable();
+    for (ch = 0; ch < GDMA_CHANNEL_MAX; ch++)
+    {
+        pthread_mutex_lock(&hw_lock);
+        status = hw[ch].status && hw[ch].inten;
+        if (status)
+        {
+            hw[ch].status = 0;
+        }
+        pthread_mutex_unlock(&hw_lock);
+
+        if (!status)
+        {
+            continue;
+        }
+        if (gdma_async_owns(ch))
+        {
+            gdma_async_complete(ch);
+        }
+        else
+        {
+            hw_driver_irqs++;
+        }
+    }
+    host_int_restore();
+}
+
+static void host_tick(UINT32 deliver)
+{
+    UINT32 ch;
+
+    pthread_mutex_lock(&hw_lock);
+    for (ch = 0; ch < GDMA_CHANNEL_MAX; ch++)
+    {
+        hw_step(ch);
+    }
+    pthread_mutex_unlock(&hw_lock);
+
+    if (deliver)
+    {
+        host_isr();
+    }
+}
+
+static void *hw_thread(void *arg)
+{
+    while (!hw_stop)
+    {
+        host_tick(1);
+        sched_yield();
+    }
+
+    return NULL;
+}
+
+// gdma_init: engine channels get the finish interrupt
+static void host_reset(UINT32 mask)
+{
+    UINT32 ch;
+
+    memset(hw, 0, sizeof(hw));
+    for (ch = 0; ch < GDMA_CHANNEL_MAX; ch++)
+    {
+        hw[ch].inten = (mask >> ch) & 1;
+    }
+    hw_driver_mask = 0;
+    hw_starts = 0;
+    hw_driver_irqs = 0;
+    hw_max_active = 0;
+    hw_start_log_cnt = 0;
+
+    gdma_async_init(mask);
+}
+
+// the driver side of gdma_ctrl(CMD_GDMA_CFG_TYPEx) on an engine channel
+static void host_driver_take(UINT32 ch)
+{
+    gdma_async_revoke(ch);
+    pthread_mutex_lock(&hw_lock);
+    hw[ch].inten = 1;                   // its own finish interrupt from here on
+    hw_driver_mask |= (1 << ch);
+    pthread_mutex_unlock(&hw_lock);
+}
+
+static void done_cb(void *arg)
+{
+    __atomic_add_fetch((UINT32 *)arg, 1, __ATOMIC_SEQ_CST);
+}
+
+static UINT32 run_until_done(GDMA_REQ_ST *req, UINT32 cnt, UINT32 deliver)
+{
+    UINT32 i, ticks = 0, left;
+
+    do
+    {
+        host_tick(deliver);
+        ticks++;
+        left = 0;
+        for (i = 0; i < cnt; i++)
+        {
+            left += !gdma_req_done(&req[i]);
+        }
+    } while (left && (ticks < 100000));
+
+    return left;
+}
+
+// more requests than channels: two run at a time, the rest wait and start in order
+static void test_fifo(void)
+{
+    GDMA_REQ_ST req[10];
+    UINT8 *dst[10];
+    GDMA_ASYNC_STATS_ST stats;
+    UINT32 i, len, cb_cnt = 0;
+
+    printf("fifo\n");
+    host_reset(TEST_MASK);
+    memset(req, 0, sizeof(req));
+    for (i = 0; i < 10; i++)
+    {
+        len = 1000 + i * 3000;
+        dst[i] = malloc(len);
+        CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req[i], dst[i], src_pool + i * 7, len, done_cb, &cb_cnt));
+    }
+
+    gdma_async_get_stats(&stats);
+    CHECK(8 == stats.queue_max);
+    CHECK(2 == hw_max_active);
+    CHECK(0 == run_until_done(req, 10, 1));
+
+    CHECK(10 == cb_cnt);
+
+    // the waiting ones got their channel in the order they came
+    CHECK(10 == hw_start_log_cnt);
+    for (i = 0; i < 10; i++)
+    {
+        CHECK(hw_start_log[i] == dst[i]);
+        CHECK(GDMA_REQ_DONE == req[i].state);
+        CHECK(0 == memcmp(dst[i], src_pool + i * 7, req[i].len));
+        free(dst[i]);
+    }
+}
+
+// copies over one transfer length are split, small ones done by cpu
+static void test_chunk_and_small(void)
+{
+    GDMA_REQ_ST req[2];
+    UINT32 len = 3 * GDMA_ASYNC_CHUNK_MAX + 100, cb_cnt = 0;
+    UINT8 *dst = malloc(len);
+    UINT8 small[64];
+
+    printf("chunk and small\n");
+    host_reset(TEST_MASK);
+    memset(req, 0, sizeof(req));
+
+    CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req[0], dst, src_pool, len, done_cb, &cb_cnt));
+    CHECK(0 == run_until_done(req, 1, 1));
+    CHECK(4 == hw_starts);
+    CHECK(0 == memcmp(dst, src_pool, len));
+    CHECK(1 == cb_cnt);
+
+    CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req[1], small, src_pool + 5, sizeof(small), done_cb, &cb_cnt));
+    CHECK(GDMA_REQ_DONE == req[1].state);
+    CHECK(4 == hw_starts);
+    CHECK(2 == cb_cnt);
+    CHECK(0 == memcmp(small, src_pool + 5, sizeof(small)));
+
+    free(dst);
+}
+
+// a request in flight can't be submitted again, the caller falls back
+static void test_busy_req(void)
+{
+    GDMA_REQ_ST req;
+    UINT8 dst[4096];
+
+    printf("busy request\n");
+    host_reset(TEST_MASK);
+    memset(&req, 0, sizeof(req));
+
+    CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req, dst, src_pool, sizeof(dst), NULL, NULL));
+    CHECK(GDMA_FAILURE == gdma_memcpy_async(&req, dst, src_pool, sizeof(dst), NULL, NULL));
+    gdma_req_wait(&req);
+    CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req, dst, src_pool + 1, sizeof(dst), NULL, NULL));
+    gdma_req_wait(&req);
+    CHECK(0 == memcmp(dst, src_pool + 1, sizeof(dst)));
+}
+
+// no interrupt ever comes: gdma_req_wait finishes the channels itself,
+// and the requests queued ahead of the one waited for
+static void test_wait_polled(void)
+{
+    GDMA_REQ_ST req[5];
+    UINT8 *dst[5];
+    UINT32 i, sema_cnt = 0;
+
+    printf("polled wait\n");
+    host_reset(TEST_MASK);
+    memset(req, 0, sizeof(req));
+    for (i = 0; i < 5; i++)
+    {
+        dst[i] = malloc(20000);
+        gdma_memcpy_async(&req[i], dst[i], src_pool + 100 * i, 20000, gdma_done_sema, &sema_cnt);
+    }
+
+    gdma_req_wait(&req[4]);
+    for (i = 0; i < 5; i++)
+    {
+        CHECK(GDMA_REQ_DONE == req[i].state);
+        CHECK(0 == memcmp(dst[i], src_pool + 100 * i, 20000));
+        free(dst[i]);
+    }
+    CHECK(5 == sema_cnt);
+    CHECK(0 == gdma_async.queue_cnt);
+    CHECK(gdma_async.free_mask == TEST_MASK);
+}
+
+// gdma_memcpy takes an idle engine channel, cpu when there is none
+static void test_sync_claim(void)
+{
+    GDMA_REQ_ST req[3];
+    UINT8 *dst[3];
+    GDMA_ASYNC_STATS_ST stats;
+    INT32 ch;
+    UINT32 i;
+
+    printf("sync claim\n");
+    host_reset(TEST_MASK);
+    memset(req, 0, sizeof(req));
+
+    ch = gdma_async_claim();
+    CHECK(0 == ch);
+    for (i = 0; i < 3; i++)
+    {
+        dst[i] = malloc(8000);
+        gdma_memcpy_async(&req[i], dst[i], src_pool, 8000, NULL, NULL);
+    }
+    // one runs on channel 3, two wait
+    CHECK(2 == gdma_async.queue_cnt);
+    CHECK(gdma_async_claim() < 0);
+    gdma_async_get_stats(&stats);
+    CHECK(1 == stats.sync_cpu);
+
+    // given back, the next waiting request starts on it
+    gdma_async_release(ch);
+    CHECK(1 == gdma_async.queue_cnt);
+    CHECK(0 == run_until_done(req, 3, 1));
+    for (i = 0; i < 3; i++)
+    {
+        CHECK(0 == memcmp(dst[i], src_pool, 8000));
+        free(dst[i]);
+    }
+}
+
+// a driver configures an engine channel while it is copying: the copy
+// lands, the rest of it and later requests never touch that channel again,
+// and its finish interrupt goes to the driver
+static void test_revoke(void)
+{
+    GDMA_REQ_ST req[6];
+    UINT8 *dst[6];
+    UINT32 i, cb_cnt = 0, len = 2 * GDMA_ASYNC_CHUNK_MAX;
+
+    printf("revoke\n");
+    host_reset(TEST_MASK);
+    memset(req, 0, sizeof(req));
+    for (i = 0; i < 6; i++)
+    {
+        dst[i] = malloc(len);
+        gdma_memcpy_async(&req[i], dst[i], src_pool + i, len, done_cb, &cb_cnt);
+    }
+    CHECK(req[1].state == GDMA_REQ_BUSY);
+
+    host_driver_take(3);
+    CHECK(!gdma_async_owns(3));
+    CHECK(GDMA_REQ_DONE == req[1].state);
+    CHECK(1 == cb_cnt);
+
+    // the driver runs its own transfer, the interrupt is not the engine's
+    pthread_mutex_lock(&hw_lock);
+    hw[3].active = 1;
+    hw[3].ticks = 1;
+    hw[3].dst = dst[1];
+    hw[3].src = src_pool;
+    hw[3].len = 16;
+    pthread_mutex_unlock(&hw_lock);
+
+    CHECK(0 == run_until_done(req, 6, 1));
+    CHECK(1 == hw_driver_irqs);
+    CHECK(6 == cb_cnt);
+
+    // last channel taken with requests waiting, the cpu finishes them
+    for (i = 0; i < 4; i++)
+    {
+        gdma_memcpy_async(&req[i], dst[i], src_pool + 50 + i, len, done_cb, &cb_cnt);
+    }
+    CHECK(3 == gdma_async.queue_cnt);
+    host_driver_take(0);
+    CHECK(0 == gdma_async.chnl_mask);
+    CHECK(10 == cb_cnt);
+    for (i = 0; i < 4; i++)
+    {
+        CHECK(GDMA_REQ_DONE == req[i].state);
+        CHECK(0 == memcmp(dst[i], src_pool + 50 + i, len));
+    }
+
+    // without channels every copy is a cpu copy
+    CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req[0], dst[0], src_pool, len, NULL, NULL));
+    CHECK(GDMA_REQ_DONE == req[0].state);
+    CHECK(gdma_async_claim() < 0);
+
+    for (i = 0; i < 6; i++)
+    {
+        free(dst[i]);
+    }
+}
+
+// hardware and isr in their own thread, random sizes, waits by polling and
+// by gdma_req_wait, one channel taken away half way through
+static void test_stress(UINT32 rounds)
+{
+    static GDMA_REQ_ST req[TEST_REQ_MAX];
+    static UINT8 *dst[TEST_REQ_MAX];
+    static UINT32 cb_cnt[TEST_REQ_MAX];
+    static UINT32 off[TEST_REQ_MAX];
+    GDMA_ASYNC_STATS_ST stats;
+    pthread_t tid;
+    UINT32 r, i, cnt, len, copies = 0;
+    unsigned long long bytes = 0;
+
+    printf("stress, %u rounds\n", rounds);
+    host_reset(0x3F);
+    memset(req, 0, sizeof(req));
+    for (i = 0; i < TEST_REQ_MAX; i++)
+    {
+        dst[i] = malloc(3 * GDMA_ASYNC_CHUNK_MAX);
+    }
+
+    hw_threaded = 1;
+    hw_stop = 0;
+    pthread_create(&tid, NULL, hw_thread, NULL);
+
+    for (r = 0; r < rounds; r++)
+    {
+        if (r == rounds / 2)
+        {
+            host_driver_take(3);
+            host_driver_take(5);
+        }
+
+        cnt = 1 + rand() % TEST_REQ_MAX;
+        for (i = 0; i < cnt; i++)
+        {
+            len = (rand() & 3) ? (1 + rand() % 6000) : (1 + rand() % (3 * GDMA_ASYNC_CHUNK_MAX));
+            off[i] = rand() % (TEST_SRC_LEN - len);
+            cb_cnt[i] = 0;
+            CHECK(GDMA_SUCCESS == gdma_memcpy_async(&req[i], dst[i], src_pool + off[i], len,
+                                                    done_cb, &cb_cnt[i]));
+            bytes += len;
+        }
+
+        for (i = 0; i < cnt; i++)
+        {
+            if (i & 1)
+            {
+                gdma_req_wait(&req[i]);
+            }
+            else
+            {
+                while (!gdma_req_done(&req[i]))
+                {
+                    sched_yield();
+                }
+            }
+        }
+
+        for (i = 0; i < cnt; i++)
+        {
+            // the callback runs after state is set, give it a moment
+            while (0 == __atomic_load_n(&cb_cnt[i], __ATOMIC_SEQ_CST))
+            {
+                sched_yield();
+            }
+            CHECK(1 == cb_cnt[i]);
+            CHECK(0 == memcmp(dst[i], src_pool + off[i], req[i].len));
+        }
+        copies += cnt;
+    }
+
+    hw_stop = 1;
+    pthread_join(tid, NULL);
+    hw_threaded = 0;
+
+    gdma_async_get_stats(&stats);
+    printf("  %u copies, %llu bytes, %u by dma (%u waited for a channel, %u at most), "
+           "%u by cpu, %u dma starts\n", copies, bytes, stats.submit,
+           stats.queued, stats.queue_max, stats.cpu_copy, hw_starts);
+    CHECK(gdma_async.chnl_mask == (0x3F & ~((1 << 3) | (1 << 5))));
+    CHECK(0 == gdma_async.queue_cnt);
+
+    for (i = 0; i < TEST_REQ_MAX; i++)
+    {
+        free(dst[i]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 rounds = (argc > 1) ? atoi(argv[1]) : 2000;
+    UINT32 seed = (argc > 2) ? atoi(argv[2]) : 1;
+    pthread_mutexattr_t attr;
+    UINT32 i;
+
+    srand(seed);
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&int_lock, &attr);
+
+    src_pool = malloc(TEST_SRC_LEN);
+    for (i = 0; i < TEST_SRC_LEN; i++)
+    {
+        src_pool[i] = rand();
+    }
+
+    test_fifo();
+    test_chunk_and_small();
+    test_busy_req();
+    test_wait_polled();
+    test_sync_claim();
+    test_revoke();
+    test_stress(rounds);
+
+    free(src_pool);
+    printf("%s, %u errors\n", errors ? "FAIL" : "ok", errors);
+
+    return errors ? 1 : 0;
+}
+// eof
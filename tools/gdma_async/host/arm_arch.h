@@ -0,0 +1,7 @@
+#ifndef __GDMA_HOST_ARM_ARCH_H__
+#define __GDMA_HOST_ARM_ARCH_H__
+
+// no registers on the host, gdma_async.c reaches the engine through gdma_async_hw_xxx
+
+#endif
+// eof
@@ -0,0 +1,34 @@
+#ifndef __GDMA_HOST_INCLUDE_H__
+#define __GDMA_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, lets driver/general_dma/gdma_async.c build on a pc
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+
+#define SOC_BK7231                        1
+#define SOC_BK7231U                       2
+#define SOC_BK7221U                       3
+#define CFG_SOC_NAME                      SOC_BK7231U
+
+#define CFG_GENERAL_DMA                   1
+#define CFG_GDMA_ASYNC                    1
+#define CFG_GDMA_ASYNC_MIN_LEN            128
+
+#define ASSERT(exp)
+#define MIN(a, b)                         (((a) < (b)) ? (a) : (b))
+
+// interrupts off is one recursive lock, the isr stand-in runs with it held
+void host_int_disable(void);
+void host_int_restore(void);
+
+#define GLOBAL_INT_DECLARATION()
+#define GLOBAL_INT_DISABLE()              host_int_disable()
+#define GLOBAL_INT_RESTORE()              host_int_restore()
+
+#endif
+// eof
@@ -0,0 +1,10 @@
+#ifndef __GDMA_HOST_MEM_PUB_H__
+#define __GDMA_HOST_MEM_PUB_H__
+
+#include <string.h>
+
+#define os_memset                         memset
+#define os_memcpy                         memcpy
+
+#endif
+// eof
@@ -0,0 +1,11 @@
+#ifndef __GDMA_HOST_RTOS_PUB_H__
+#define __GDMA_HOST_RTOS_PUB_H__
+
+typedef int OSStatus;
+typedef void *beken_semaphore_t;
+
+// the semaphore is a counter, see gdma_test.c
+OSStatus rtos_set_semaphore(beken_semaphore_t *semaphore);
+
+#endif
+// eof
@@ -0,0 +1,10 @@
+#ifndef __GDMA_HOST_UART_PUB_H__
+#define __GDMA_HOST_UART_PUB_H__
+
+#include <stdio.h>
+
+#define os_printf                         printf
+#define null_prf(...)
+
+#endif
+// eof
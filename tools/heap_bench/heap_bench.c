@@ -0,0 +1,285 @@
+/*
+ * Replays an allocation trace on os heap_4.c, with or without the mem_slab.c
+ * front end, and reports failed allocations, fragmentation of the free heap
+ * and time per call. Both builds get the same memory: the slab arena is cut
+ * out of the heap_4 heap.
+ *   ./heap_bench_h4 [ops] [seed]          synthetic wifi/lwip/tls mix
+ *   ./heap_bench_slab -f log.txt          memtrace "ev:" or OSMALLOC_STATISTICAL "m:/f:" lines
+ */
+#include "../../os/FreeRTOSv9.0.0/FreeRTOS/Source/portable/MemMang/heap_4.c"
+#if MEM_SLAB_EN
+#include "../../os/mem_slab.c"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define HB_SLOTS                    8192
+#define HB_SAMPLE_OPS               1000
+
+typedef struct hb_op
+{
+    UINT32 slot;
+    UINT32 size;                    // 0 is a free
+} HB_OP;
+
+typedef struct hb_kind
+{
+    UINT32 weight;
+    UINT32 size_min;
+    UINT32 size_max;
+    UINT32 life_min;                // in ops
+    UINT32 life_max;
+} HB_KIND;
+
+// what a busy station allocates: mac/lwip buffers come and go, tls records
+// and sockets live longer, timers and control blocks stay
+static const HB_KIND hb_kinds[] =
+{
+    {30, 1600, 1700,    2,    40},  // rx/tx pbuf
+    {20,   64,  200,    2,    40},  // msdu node, small pbuf
+    {15,   16,   64,   50,  4000},  // timer, semaphore, list node
+    {10,  100,  500,   20,  1000},  // socket, pcb, netbuf
+    { 4, 2048, 6144,   20,   300},  // tls record
+    { 1, 8192, 8192,   50,   200},  // http or ota buffer
+    {20,   16,  128,    1,    10},  // string, temp
+};
+
+// longer than any life above, frees are hung on a wheel by the op they are due
+#define HB_WHEEL                    4096
+
+static HB_OP *hb_ops;
+static UINT32 hb_op_cnt;
+static void *hb_ptr[HB_SLOTS];
+
+static UINT32 hb_rand(UINT32 *seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return *seed >> 8;
+}
+
+static void hb_op_add(UINT32 slot, UINT32 size)
+{
+    hb_ops[hb_op_cnt].slot = slot;
+    hb_ops[hb_op_cnt].size = size;
+    hb_op_cnt++;
+}
+
+static void hb_gen(UINT32 ops, UINT32 seed)
+{
+    INT32 *wheel = malloc(HB_WHEEL * sizeof(INT32));
+    INT32 *next = malloc(HB_SLOTS * sizeof(INT32));
+    UINT32 *free_slot = malloc(HB_SLOTS * sizeof(UINT32));
+    UINT32 free_cnt = 0, total = 0, i, k, r, slot, now, due;
+    const HB_KIND *kind;
+    INT32 s;
+
+    for (k = 0; k < sizeof(hb_kinds) / sizeof(hb_kinds[0]); k++)
+    {
+        total += hb_kinds[k].weight;
+    }
+    for (i = 0; i < HB_WHEEL; i++)
+    {
+        wheel[i] = -1;
+    }
+    for (i = HB_SLOTS; i > 0; i--)
+    {
+        free_slot[free_cnt++] = i - 1;
+    }
+
+    hb_ops = malloc(ops * 2 * sizeof(HB_OP));
+    for (now = 0; hb_op_cnt < ops; now++)
+    {
+        for (s = wheel[now % HB_WHEEL]; s >= 0; s = next[s])
+        {
+            hb_op_add(s, 0);
+            free_slot[free_cnt++] = s;
+        }
+        wheel[now % HB_WHEEL] = -1;
+        if (free_cnt == 0)
+        {
+            continue;
+        }
+
+        r = hb_rand(&seed) % total;
+        for (k = 0; r >= hb_kinds[k].weight; k++)
+        {
+            r -= hb_kinds[k].weight;
+        }
+        kind = &hb_kinds[k];
+        slot = free_slot[--free_cnt];
+        hb_op_add(slot, kind->size_min + hb_rand(&seed) % (kind->size_max - kind->size_min + 1));
+        due = (now + 1 + kind->life_min + hb_rand(&seed) % (kind->life_max - kind->life_min + 1)) % HB_WHEEL;
+        next[slot] = wheel[due];
+        wheel[due] = slot;
+    }
+
+    free(wheel);
+    free(next);
+    free(free_slot);
+}
+
+// "ev:time,m,ptr,size,caller" of memtrace log, or "m:ptr,size|func,line" and
+// "f:ptr,size|func,line" of OSMALLOC_STATISTICAL
+static void hb_load(const char *path)
+{
+    char line[256], type;
+    unsigned long ptr, addr[HB_SLOTS];
+    unsigned int size, t, slot;
+    FILE *fp = fopen(path, "r");
+    UINT32 cap = 1024;
+
+    if (fp == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    memset(addr, 0, sizeof(addr));
+    hb_ops = malloc(cap * sizeof(HB_OP));
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *s = strstr(line, "ev:");
+
+        if (s && (sscanf(s, "ev:%u,%c,%lx,%u", &t, &type, &ptr, &size) == 4))
+        {
+        }
+        else if ((s = strstr(line, "m:")) && (sscanf(s, "m:%lx,%u", &ptr, &size) == 2))
+        {
+            type = 'm';
+        }
+        else if ((s = strstr(line, "f:")) && (sscanf(s, "f:%lx,%u", &ptr, &size) == 2))
+        {
+            type = 'f';
+        }
+        else
+        {
+            continue;
+        }
+
+        if (hb_op_cnt == cap)
+        {
+            cap *= 2;
+            hb_ops = realloc(hb_ops, cap * sizeof(HB_OP));
+        }
+
+        for (slot = 0; (slot < HB_SLOTS) && (addr[slot] != ((type == 'm') ? 0 : ptr)); slot++)
+            ;
+        if (slot == HB_SLOTS)
+        {
+            // free of a block from before the log started, or too many live
+            continue;
+        }
+        addr[slot] = (type == 'm') ? ptr : 0;
+        hb_op_add(slot, (type == 'm') ? (size ? size : 1) : 0);
+    }
+    fclose(fp);
+}
+
+// free bytes and largest free block of heap_4, plus whole free slab pages
+static void hb_heap_walk(size_t *free_bytes, size_t *largest)
+{
+    BlockLink_t *blk;
+
+    *free_bytes = 0;
+    *largest = 0;
+    if (pxEnd == NULL)
+    {
+        return;
+    }
+    for (blk = xStart.pxNextFreeBlock; blk != pxEnd; blk = blk->pxNextFreeBlock)
+    {
+        *free_bytes += blk->xBlockSize;
+        if (blk->xBlockSize > *largest)
+        {
+            *largest = blk->xBlockSize;
+        }
+    }
+    #if MEM_SLAB_EN
+    *free_bytes += mem_slab_free_page_cnt * MEM_SLAB_PAGE_SIZE;
+    #endif
+}
+
+static double hb_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 ops = 1000000, seed = 1, i, j, fails = 0, fails_big = 0, samples = 0;
+    size_t free_bytes, largest, largest_min = (size_t) - 1, live = 0, live_max = 0;
+    size_t live_size[HB_SLOTS];
+    double frag, frag_sum = 0, frag_max = 0, ns = 0, t0;
+    UINT32 mallocs = 0, frees = 0;
+
+    if ((argc > 2) && (strcmp(argv[1], "-f") == 0))
+    {
+        hb_load(argv[2]);
+    }
+    else
+    {
+        ops = (argc > 1) ? atoi(argv[1]) : ops;
+        seed = (argc > 2) ? atoi(argv[2]) : seed;
+        hb_gen(ops, seed);
+    }
+
+    memset(live_size, 0, sizeof(live_size));
+    for (i = 0; i < hb_op_cnt; i += HB_SAMPLE_OPS)
+    {
+        t0 = hb_now_ns();
+        for (j = i; (j < hb_op_cnt) && (j < i + HB_SAMPLE_OPS); j++)
+        {
+            HB_OP *op = &hb_ops[j];
+
+            if (op->size)
+            {
+                hb_ptr[op->slot] = pvPortMalloc(op->size);
+                mallocs++;
+                if (hb_ptr[op->slot] == NULL)
+                {
+                    fails++;
+                    fails_big += (op->size > 1024);
+                    continue;
+                }
+                live += op->size;
+                live_size[op->slot] = op->size;
+            }
+            else if (hb_ptr[op->slot])
+            {
+                vPortFree(hb_ptr[op->slot]);
+                frees++;
+                hb_ptr[op->slot] = NULL;
+                live -= live_size[op->slot];
+            }
+        }
+        ns += hb_now_ns() - t0;
+
+        if (live > live_max)
+        {
+            live_max = live;
+        }
+        hb_heap_walk(&free_bytes, &largest);
+        frag = free_bytes ? 1.0 - (double)largest / free_bytes : 0;
+        frag_sum += frag;
+        frag_max = (frag > frag_max) ? frag : frag_max;
+        largest_min = (largest < largest_min) ? largest : largest_min;
+        samples++;
+    }
+
+    printf("%-10s ops %u, peak live %zu B, failed %u (>1KB %u), frag avg %.1f%% max %.1f%%, "
+           "largest free min %zu B, %.0f ns/call\n",
+           MEM_SLAB_EN ? "slab+heap4" : "heap4", hb_op_cnt, live_max, fails, fails_big,
+           100 * frag_sum / samples, 100 * frag_max, largest_min, ns / (mallocs + frees));
+    #if MEM_SLAB_EN
+    mem_slab_dump();
+    #endif
+
+    return 0;
+}
+// eof
@@ -0,0 +1,27 @@
+#ifndef __HEAP_BENCH_FREERTOS_H__
+#define __HEAP_BENCH_FREERTOS_H__
+
+// the part heap_4.c takes from FreeRTOS, a single thread needs no lock
+#define configSUPPORT_DYNAMIC_ALLOCATION  1
+#define configDYNAMIC_HEAP_SIZE           0
+#define configAPPLICATION_ALLOCATED_HEAP  0
+#define configUSE_MALLOC_FAILED_HOOK      0
+#if CFG_MEM_SLAB
+#define configTOTAL_HEAP_SIZE             (HEAP_BENCH_SIZE - CFG_MEM_SLAB_ARENA_SIZE)
+#else
+#define configTOTAL_HEAP_SIZE             HEAP_BENCH_SIZE
+#endif
+
+#define portBYTE_ALIGNMENT                8
+#define portBYTE_ALIGNMENT_MASK           (portBYTE_ALIGNMENT - 1)
+
+#define configASSERT(x)                   assert(x)
+#define mtCOVERAGE_TEST_MARKER()
+#define traceMALLOC(p, size)
+#define traceFREE(p, size)
+
+#define vTaskSuspendAll()
+#define xTaskResumeAll()                  0
+
+#endif
+// eof
@@ -0,0 +1,33 @@
+#ifndef __HEAP_BENCH_INCLUDE_H__
+#define __HEAP_BENCH_INCLUDE_H__
+
+// stand-in for the sdk include.h, builds os heap_4.c and mem_slab.c on a pc
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+typedef uint8_t u8;
+
+#define SOC_BK7231U                       2
+#define SOC_BK7221U                       3
+#define CFG_SOC_NAME                      SOC_BK7231U
+
+#define OSMALLOC_STATISTICAL              0
+// CFG_MEM_SLAB comes from the Makefile, one binary each way
+#ifndef CFG_MEM_SLAB
+#define CFG_MEM_SLAB                      0
+#endif
+#define CFG_MEM_SLAB_ARENA_SIZE           (24 * 1024)
+
+// heap of a bk7231u after bss, the slab arena comes out of it
+#define HEAP_BENCH_SIZE                   (184 * 1024)
+
+#define ASSERT(exp)                       assert(exp)
+
+#endif
+// eof
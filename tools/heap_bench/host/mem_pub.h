@@ -0,0 +1,31 @@
+#ifndef __HEAP_BENCH_MEM_PUB_H__
+#define __HEAP_BENCH_MEM_PUB_H__
+
+#include <string.h>
+
+#define os_memcpy                         memcpy
+#define os_memset                         memset
+#define os_memmove                        memmove
+
+void *pvPortMalloc(size_t xWantedSize);
+void vPortFree(void *pv);
+void *pvPortRealloc(void *pv, size_t xWantedSize);
+#define psram_malloc                      pvPortMalloc
+
+// same switch as os/include/mem_pub.h
+#if (CFG_MEM_SLAB && (!OSMALLOC_STATISTICAL))
+#define MEM_SLAB_EN       1
+#else
+#define MEM_SLAB_EN       0
+#endif
+
+#if MEM_SLAB_EN
+void *mem_slab_alloc(size_t size);
+void mem_slab_free(void *ptr);
+int mem_slab_is_owner(void *ptr);
+size_t mem_slab_obj_size(void *ptr);
+void mem_slab_dump(void);
+#endif
+
+#endif
+// eof
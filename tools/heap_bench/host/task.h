@@ -0,0 +1 @@
+// eof
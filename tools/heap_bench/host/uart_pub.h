@@ -0,0 +1,10 @@
+#ifndef __HEAP_BENCH_UART_PUB_H__
+#define __HEAP_BENCH_UART_PUB_H__
+
+#include <stdio.h>
+
+#define os_printf                         printf
+#define bk_printf                         printf
+
+#endif
+// eof
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Diff two "memtrace live" dumps captured from the uart log.
+
+Usage:
+    mem_trace_diff.py before.txt after.txt [--elf beken7231.elf]
+    mem_trace_diff.py log.txt [--elf beken7231.elf]
+
+With one file the first and the last dump in it are compared.  Callsites
+are return addresses of os_malloc/os_zalloc/os_realloc; pass the elf to
+resolve them with arm-none-eabi-addr2line.
+"""
+
+import argparse
+import re
+import subprocess
+import sys
+
+BEGIN_RE = re.compile(r'memtrace begin t=(\d+) free=(\d+) live=(\d+) bytes=(\d+)')
+REC_RE = re.compile(r'mt:(?:0x)?([0-9a-fA-F]+),(\d+),(\d+),(\d+)')
+
+
+def parse_dumps(path):
+    dumps = []
+    cur = None
+    with open(path, 'r', errors='ignore') as f:
+        for line in f:
+            m = BEGIN_RE.search(line)
+            if m:
+                cur = {'time': int(m.group(1)), 'free': int(m.group(2)),
+                       'live': int(m.group(3)), 'bytes': int(m.group(4)),
+                       'sites': {}}
+                continue
+            if cur is None:
+                continue
+            if 'memtrace end' in line:
+                dumps.append(cur)
+                cur = None
+                continue
+            m = REC_RE.search(line)
+            if m:
+                cur['sites'][int(m.group(1), 16)] = (int(m.group(2)), int(m.group(3)),
+                                                     int(m.group(4)))
+    return dumps
+
+
+def resolve(addrs, elf, addr2line):
+    names = {}
+    if not elf or not addrs:
+        return names
+    # return address points after the call, step back into the caller
+    cmd = [addr2line, '-f', '-s', '-e', elf] + ['0x%x' % (a - 4) for a in addrs]
+    try:
+        out = subprocess.check_output(cmd, universal_newlines=True).splitlines()
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.stderr.write('addr2line failed: %s\n' % e)
+        return names
+    for i, addr in enumerate(addrs):
+        if 2 * i + 1 < len(out):
+            names[addr] = '%s %s' % (out[2 * i], out[2 * i + 1])
+    return names
+
+
+def main():
+    parser = argparse.ArgumentParser(description='diff memtrace dumps by callsite')
+    parser.add_argument('dumps', nargs='+', help='one log with >= 2 dumps, or two logs')
+    parser.add_argument('--elf', help='firmware elf to resolve callsites')
+    parser.add_argument('--addr2line', default='arm-none-eabi-addr2line')
+    parser.add_argument('--all', action='store_true', help='also show unchanged callsites')
+    args = parser.parse_args()
+
+    if len(args.dumps) == 1:
+        dumps = parse_dumps(args.dumps[0])
+        if len(dumps) < 2:
+            sys.exit('need two dumps in %s, found %d' % (args.dumps[0], len(dumps)))
+        old, new = dumps[0], dumps[-1]
+    elif len(args.dumps) == 2:
+        old_dumps = parse_dumps(args.dumps[0])
+        new_dumps = parse_dumps(args.dumps[1])
+        if not old_dumps or not new_dumps:
+            sys.exit('no memtrace dump found')
+        old, new = old_dumps[-1], new_dumps[-1]
+    else:
+        sys.exit('give one or two dump files')
+
+    rows = []
+    for addr in set(old['sites']) | set(new['sites']):
+        ocnt, obytes, _ = old['sites'].get(addr, (0, 0, 0))
+        ncnt, nbytes, oldest = new['sites'].get(addr, (0, 0, 0))
+        if args.all or ncnt != ocnt or nbytes != obytes:
+            rows.append((nbytes - obytes, ncnt - ocnt, ncnt, nbytes, oldest, addr))
+    rows.sort(reverse=True)
+
+    names = resolve([r[5] for r in rows], args.elf, args.addr2line)
+
+    print('interval %d ms, free heap %d -> %d (%+d), traced %d -> %d bytes (%+d)' % (
+        new['time'] - old['time'], old['free'], new['free'], new['free'] - old['free'],
+        old['bytes'], new['bytes'], new['bytes'] - old['bytes']))
+    print('%-10s %8s %6s %8s %6s %10s  %s' % ('callsite', 'd_bytes', 'd_cnt', 'bytes', 'cnt',
+                                              'oldest', 'where'))
+    for dbytes, dcnt, cnt, nbytes, oldest, addr in rows:
+        print('0x%08x %+8d %+6d %8d %6d %10d  %s' % (addr, dbytes, dcnt, nbytes, cnt, oldest,
+                                                     names.get(addr, '')))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,17 @@
+#ifndef __RB_HOST_ARCH_H__
+#define __RB_HOST_ARCH_H__
+
+// the sdk barrier() only keeps the compiler in order, enough on the one
+// core. producer and consumer run on two cores here, so it is a real fence
+#define barrier()                         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// interrupts off is one lock, only rb_init and rb_clear take it
+void host_int_disable(void);
+void host_int_restore(void);
+
+#define GLOBAL_INT_DECLARATION()
+#define GLOBAL_INT_DISABLE()              host_int_disable()
+#define GLOBAL_INT_RESTORE()              host_int_restore()
+
+#endif
+// eof
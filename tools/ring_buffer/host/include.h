@@ -0,0 +1,14 @@
+#ifndef __RB_HOST_INCLUDE_H__
+#define __RB_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, lets driver/audio/ring_buffer.c build on a pc
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+
+#endif
+// eof
@@ -0,0 +1,13 @@
+#ifndef __RB_HOST_MEM_PUB_H__
+#define __RB_HOST_MEM_PUB_H__
+
+#include <string.h>
+
+// a preemption point in the middle of the copy, see rb_test.c
+void *host_memcpy(void *dst, const void *src, size_t n);
+
+#define os_memcpy                         host_memcpy
+#define os_memset                         memset
+
+#endif
+// eof
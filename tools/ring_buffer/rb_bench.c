@@ -0,0 +1,249 @@
+/*
+ * Throughput of the audio ring buffer, driver/audio/ring_buffer.c, per chunk
+ * size: the copy calls (rb_write/rb_read) against the in place ones
+ * (rb_acquire/rb_commit, rb_peek/rb_consume). The producer makes its data,
+ * the consumer sums it, in place both work on the ring memory itself.
+ * "1 thread" takes turns on one thread like the audio isr and task do on the
+ * one core, "2 threads" runs producer and consumer on their own pthreads.
+ *   ./rb_bench [mbytes] [capacity]
+ */
+#include "../../driver/audio/ring_buffer.c"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RB_CHUNK_MAX                2048
+
+typedef struct rb_bench_run
+{
+    RB_ST rb;
+    UINT32 chunk;
+    UINT32 in_place;
+    unsigned long long total;
+    unsigned long long sum;
+    unsigned long long full;        // producer found no room
+    unsigned long long empty;       // consumer found nothing
+} RB_BENCH_RUN;
+
+static pthread_mutex_t rb_int_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void host_int_disable(void)
+{
+    pthread_mutex_lock(&rb_int_lock);
+}
+
+void host_int_restore(void)
+{
+    pthread_mutex_unlock(&rb_int_lock);
+}
+
+void *host_memcpy(void *dst, const void *src, size_t n)
+{
+    return memcpy(dst, src, n);
+}
+
+static double rb_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// one chunk in, 0 when the ring has no room for it
+static UINT32 rb_bench_put(RB_BENCH_RUN *r, UINT8 val)
+{
+    UINT8 buf[RB_CHUNK_MAX];
+    RB_SPAN_ST span;
+
+    if (!r->in_place)
+    {
+        memset(buf, val, r->chunk);
+        return rb_write(&r->rb, buf, 1, r->chunk);
+    }
+
+    if (rb_acquire(&r->rb, &span) < r->chunk)
+    {
+        return 0;
+    }
+    if (span.len[0] >= r->chunk)
+    {
+        memset(span.addr[0], val, r->chunk);
+    }
+    else
+    {
+        memset(span.addr[0], val, span.len[0]);
+        memset(span.addr[1], val, r->chunk - span.len[0]);
+    }
+    rb_commit(&r->rb, r->chunk);
+
+    return r->chunk;
+}
+
+static UINT32 rb_bench_sum(const UINT8 *p, UINT32 len)
+{
+    UINT32 i, sum = 0;
+
+    for (i = 0; i < len; i++)
+    {
+        sum += p[i];
+    }
+    return sum;
+}
+
+// up to one chunk out, 0 when the ring is empty
+static UINT32 rb_bench_get(RB_BENCH_RUN *r)
+{
+    UINT8 buf[RB_CHUNK_MAX];
+    RB_SPAN_ST span;
+    UINT32 n;
+
+    if (!r->in_place)
+    {
+        n = rb_read(&r->rb, buf, 1, r->chunk);
+        r->sum += rb_bench_sum(buf, n);
+        return n;
+    }
+
+    n = rb_peek(&r->rb, &span);
+    n = n < r->chunk ? n : r->chunk;
+    if (n <= span.len[0])
+    {
+        r->sum += rb_bench_sum(span.addr[0], n);
+    }
+    else
+    {
+        r->sum += rb_bench_sum(span.addr[0], span.len[0]);
+        r->sum += rb_bench_sum(span.addr[1], n - span.len[0]);
+    }
+    rb_consume(&r->rb, n);
+
+    return n;
+}
+
+static void *rb_bench_producer(void *arg)
+{
+    RB_BENCH_RUN *r = arg;
+    unsigned long long put = 0;
+
+    while (put < r->total)
+    {
+        if (rb_bench_put(r, (UINT8)put))
+        {
+            put += r->chunk;
+        }
+        else
+        {
+            r->full++;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static double rb_bench_one(RB_BENCH_RUN *r, UINT32 threads)
+{
+    unsigned long long got = 0, put = 0;
+    pthread_t tid;
+    UINT32 n;
+    double t0;
+
+    t0 = rb_now();
+    if (threads > 1)
+    {
+        pthread_create(&tid, NULL, rb_bench_producer, r);
+        while (got < r->total)
+        {
+            n = rb_bench_get(r);
+            if (0 == n)
+            {
+                r->empty++;
+                sched_yield();
+            }
+            got += n;
+        }
+        pthread_join(tid, NULL);
+    }
+    else
+    {
+        // the isr fills until the ring is full, the task drains it
+        while (got < r->total)
+        {
+            while ((put < r->total) && rb_bench_put(r, (UINT8)put))
+            {
+                put += r->chunk;
+            }
+            r->full++;
+            while ((n = rb_bench_get(r)) != 0)
+            {
+                got += n;
+            }
+            r->empty++;
+        }
+    }
+
+    return rb_now() - t0;
+}
+
+int main(int argc, char **argv)
+{
+    static const UINT32 chunks[] = {32, 128, 512, 2048};
+    UINT32 mbytes = argc > 1 ? atoi(argv[1]) : 256;
+    UINT32 capacity = argc > 2 ? atoi(argv[2]) : 8192;
+    UINT8 *mem;
+    RB_BENCH_RUN r;
+    UINT32 c, in_place, threads;
+    unsigned long long want, put;
+    double t;
+
+    if (capacity < RB_CHUNK_MAX + RWP_SAFE_INTERVAL)
+    {
+        printf("capacity must be at least %d\n", RB_CHUNK_MAX + RWP_SAFE_INTERVAL);
+        return 1;
+    }
+    mem = malloc(capacity);
+
+    printf("%u MB through a %u byte ring\n", mbytes, capacity);
+    printf("%-10s %6s %-9s %10s %12s %12s\n", "", "chunk", "calls", "MB/s", "full", "empty");
+    for (threads = 1; threads <= 2; threads++)
+    {
+        for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++)
+        {
+            for (in_place = 0; in_place <= 1; in_place++)
+            {
+                memset(&r, 0, sizeof(r));
+                rb_init(&r.rb, mem, capacity);
+                r.chunk = chunks[c];
+                r.in_place = in_place;
+                r.total = (unsigned long long)mbytes * 1024 * 1024 / r.chunk * r.chunk;
+
+                t = rb_bench_one(&r, threads);
+
+                // every chunk is one byte value, repeated: the sum is known
+                want = 0;
+                for (put = 0; put < r.total; put += r.chunk)
+                {
+                    want += (unsigned long long)(UINT8)put * r.chunk;
+                }
+                if (want != r.sum)
+                {
+                    printf("FAIL: sum %llu, want %llu\n", r.sum, want);
+                    return 1;
+                }
+
+                printf("%u %-8s %6u %-9s %10.1f %12llu %12llu\n", threads,
+                       threads > 1 ? "threads" : "thread", r.chunk,
+                       in_place ? "in place" : "copy", r.total / t / 1e6, r.full, r.empty);
+            }
+        }
+    }
+
+    free(mem);
+
+    return 0;
+}
+// eof
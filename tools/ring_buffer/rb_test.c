@@ -0,0 +1,247 @@
+/*
+ * Host test of the audio ring buffer, driver/audio/ring_buffer.c. The edge
+ * cases run first on one thread. Then a producer and a consumer pthread push
+ * a numbered byte stream through a small ring, each side switching at random
+ * between the copy calls (rb_write/rb_read) and the in place ones
+ * (rb_acquire/rb_commit, rb_peek/rb_consume). The consumer checks that every
+ * byte comes out once and in order, and that fill never goes past capacity
+ * minus RWP_SAFE_INTERVAL. os_memcpy yields halfway now and then, on a
+ * single core that is where an isr on the other side would cut in.
+ *   ./rb_test [seconds] [seed]
+ */
+#include "../../driver/audio/ring_buffer.c"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RT_CAPACITY                 1001        // odd, the spans wrap at every offset
+#define RT_CHUNK_MAX                300
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+static pthread_mutex_t rt_int_lock = PTHREAD_MUTEX_INITIALIZER;
+static RB_ST rt_rb;
+static UINT8 rt_mem[RT_CAPACITY];
+static time_t rt_end;
+static volatile unsigned long long rt_written;  // final byte count, set when the producer stops
+static volatile int rt_producer_done;
+
+void host_int_disable(void)
+{
+    pthread_mutex_lock(&rt_int_lock);
+}
+
+void host_int_restore(void)
+{
+    pthread_mutex_unlock(&rt_int_lock);
+}
+
+// on the one core the other side only runs when this one is preempted,
+// now and then that happens halfway through a copy
+void *host_memcpy(void *dst, const void *src, size_t n)
+{
+    static __thread unsigned int seed = 1;
+    size_t half = n / 2;
+
+    memcpy(dst, src, half);
+    if (0 == (rand_r(&seed) & 15))
+    {
+        sched_yield();
+    }
+    memcpy((UINT8 *)dst + half, (const UINT8 *)src + half, n - half);
+
+    return dst;
+}
+
+// byte at stream offset pos, 251 is prime so it never lines up with the ring
+static UINT8 rt_byte(unsigned long long pos)
+{
+    return (UINT8)(pos % 251);
+}
+
+static void rt_edges(void)
+{
+    UINT8 mem[64], buf[64];
+    RB_ST rb;
+    RB_SPAN_ST span;
+    UINT32 i;
+
+    printf("edges\n");
+    for (i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = i;
+    }
+
+    rb_init(&rb, mem, sizeof(mem));
+    CHECK(0 == rb_get_fill_size(&rb));
+    CHECK(sizeof(mem) - RWP_SAFE_INTERVAL == rb_get_free_size(&rb));
+    CHECK(0 == rb_read(&rb, buf, 1, 1));
+    CHECK(0 == rb_peek(&rb, &span));
+
+    // full never looks empty
+    CHECK(0 == rb_write(&rb, buf, 1, sizeof(mem) - RWP_SAFE_INTERVAL + 1));
+    CHECK(sizeof(mem) - RWP_SAFE_INTERVAL == rb_write(&rb, buf, 1, sizeof(mem) - RWP_SAFE_INTERVAL));
+    CHECK(0 == rb_get_free_size(&rb));
+    CHECK(sizeof(mem) - RWP_SAFE_INTERVAL == rb_get_fill_size(&rb));
+    CHECK(0 == rb_write(&rb, buf, 1, 1));
+    CHECK(0 == rb_acquire(&rb, &span));
+
+    // short read takes what is there
+    CHECK(50 == rb_read(&rb, buf + 4, 1, 50));
+    CHECK(10 == rb_read(&rb, buf + 4, 2, 10));
+    CHECK(0 == rb_get_fill_size(&rb));
+    CHECK(60 == rb.rp);
+
+    // free room wraps: 4 bytes at the end, the rest at the start
+    CHECK(sizeof(mem) - RWP_SAFE_INTERVAL == rb_acquire(&rb, &span));
+    CHECK(span.addr[0] == &mem[60] && 4 == span.len[0]);
+    CHECK(span.addr[1] == &mem[0] && 56 == span.len[1]);
+    for (i = 0; i < 10; i++)
+    {
+        i < 4 ? (span.addr[0][i] = 100 + i) : (span.addr[1][i - 4] = 100 + i);
+    }
+    rb_commit(&rb, 10);
+    CHECK(6 == rb.wp);
+
+    CHECK(10 == rb_peek(&rb, &span));
+    CHECK(4 == span.len[0] && 6 == span.len[1]);
+    CHECK(3 == rb_span_copy_out(&span, buf, 3));
+    CHECK(100 == buf[0] && 102 == buf[2]);
+    rb_consume(&rb, 7);
+    CHECK(3 == rb_read(&rb, buf, 1, 64));
+    CHECK(107 == buf[0] && 109 == buf[2]);
+    CHECK(rb.rp == rb.wp);
+
+    rb_write(&rb, buf, 1, 20);
+    rb_clear(&rb);
+    CHECK(0 == rb_get_fill_size(&rb) && 0 == rb.wp);
+}
+
+static void *rt_producer(void *arg)
+{
+    unsigned int seed = (unsigned int)(long)arg;
+    unsigned long long pos = 0;
+    UINT8 buf[RT_CHUNK_MAX];
+    RB_SPAN_ST span;
+    UINT32 len, n, i;
+
+    while (time(NULL) < rt_end)
+    {
+        len = 1 + rand_r(&seed) % RT_CHUNK_MAX;
+        if (rand_r(&seed) & 1)
+        {
+            for (i = 0; i < len; i++)
+            {
+                buf[i] = rt_byte(pos + i);
+            }
+            if (0 == rb_write(&rt_rb, buf, 1, len))
+            {
+                sched_yield();
+                continue;
+            }
+        }
+        else
+        {
+            n = rb_acquire(&rt_rb, &span);
+            if (0 == n)
+            {
+                sched_yield();
+                continue;
+            }
+            len = len < n ? len : n;
+            for (i = 0; i < len; i++)
+            {
+                if (i < span.len[0])
+                {
+                    span.addr[0][i] = rt_byte(pos + i);
+                }
+                else
+                {
+                    span.addr[1][i - span.len[0]] = rt_byte(pos + i);
+                }
+            }
+            rb_commit(&rt_rb, len);
+        }
+        pos += len;
+    }
+
+    rt_written = pos;
+    __atomic_store_n(&rt_producer_done, 1, __ATOMIC_SEQ_CST);
+
+    return NULL;
+}
+
+static unsigned long long rt_consumer(unsigned int seed)
+{
+    unsigned long long pos = 0;
+    UINT8 buf[RT_CHUNK_MAX];
+    RB_SPAN_ST span;
+    UINT32 len, n, i;
+    int done;
+
+    for (;;)
+    {
+        done = __atomic_load_n(&rt_producer_done, __ATOMIC_SEQ_CST);
+        len = 1 + rand_r(&seed) % RT_CHUNK_MAX;
+        if (rand_r(&seed) & 1)
+        {
+            n = rb_read(&rt_rb, buf, 1, len);
+            for (i = 0; i < n; i++)
+            {
+                CHECK(buf[i] == rt_byte(pos + i));
+            }
+        }
+        else
+        {
+            n = rb_peek(&rt_rb, &span);
+            CHECK(n <= RT_CAPACITY - RWP_SAFE_INTERVAL);
+            n = len < n ? len : n;
+            for (i = 0; i < n; i++)
+            {
+                CHECK(rt_byte(pos + i) ==
+                      (i < span.len[0] ? span.addr[0][i] : span.addr[1][i - span.len[0]]));
+            }
+            rb_consume(&rt_rb, n);
+        }
+        pos += n;
+
+        if (0 == n)
+        {
+            // empty after the producer stopped: all of it came out
+            if (done)
+            {
+                break;
+            }
+            sched_yield();
+        }
+    }
+
+    CHECK(pos == rt_written);
+
+    return pos;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    unsigned int seed = argc > 2 ? atoi(argv[2]) : 1;
+    unsigned long long bytes;
+    pthread_t tid;
+
+    rt_edges();
+
+    printf("stress, %d s, capacity %d\n", seconds, RT_CAPACITY);
+    rb_init(&rt_rb, rt_mem, sizeof(rt_mem));
+    rt_end = time(NULL) + seconds;
+    pthread_create(&tid, NULL, rt_producer, (void *)(long)(seed * 2 + 1));
+    bytes = rt_consumer(seed * 2);
+    pthread_join(tid, NULL);
+
+    printf("  %llu bytes in order, ok\n", bytes);
+
+    return 0;
+}
+// eof
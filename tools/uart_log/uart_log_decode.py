@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""Decode a uart capture taken with "logmode bin".
+
+Usage:
+    uart_log_decode.py capture.bin --elf beken7231.elf [-o log.txt]
+
+In binary mode every bk_printf is sent as 0xA5 0x5A followed by the raw
+record of driver/uart/uart_log.c: format address (u32), time in ms (u32),
+record length (u16), reserved (u16), then the args in format order.  Ints
+are 4 bytes, long long and double 8 bytes, strings a length byte plus the
+chars padded to 4 bytes.  The format strings are read back from the elf.
+Bytes outside of records (boot rom, exception dumps) are passed through.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = b'\xa5\x5a'
+HDR_LEN = 12
+REC_MAX = 128
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+ARG_NONE, ARG_INT, ARG_LL, ARG_DBL, ARG_STR = range(5)
+
+
+class Elf(object):
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF' or data[4] != 1:
+            sys.exit('%s: not an elf32 file' % path)
+        end = '<' if data[5] == 1 else '>'
+        shoff, = struct.unpack_from(end + 'I', data, 0x20)
+        shentsize, shnum = struct.unpack_from(end + 'HH', data, 0x2e)
+
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, flags, addr, offset, size) = struct.unpack_from(
+                end + 'IIIIII', data, shoff + i * shentsize)
+            if (flags & SHF_ALLOC) and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def cstr(self, addr):
+        for base, body in self.sections:
+            if base <= addr < base + len(body):
+                off = addr - base
+                end = body.find(b'\0', off)
+                if end < 0:
+                    end = len(body)
+                return body[off:end].decode('latin-1')
+        return None
+
+
+def parse_spec(fmt, i):
+    """Same walk as uart_log_spec(), i points behind '%'.
+
+    Returns (end, type, stars, python spec without the leading '%').
+    """
+    start = i
+    while i < len(fmt) and fmt[i] in '-+ #0':
+        i += 1
+    stars = 0
+    if i < len(fmt) and fmt[i] == '*':
+        stars += 1
+        i += 1
+    while i < len(fmt) and fmt[i].isdigit():
+        i += 1
+    if i < len(fmt) and fmt[i] == '.':
+        i += 1
+        if i < len(fmt) and fmt[i] == '*':
+            stars += 1
+            i += 1
+        while i < len(fmt) and fmt[i].isdigit():
+            i += 1
+    flags = fmt[start:i]
+
+    l_cnt = 0
+    while i < len(fmt) and fmt[i] in 'lhzjtLq':
+        if fmt[i] in 'ljq':
+            l_cnt += 1 if fmt[i] == 'l' else 2
+        i += 1
+
+    if i >= len(fmt):
+        return i, ARG_NONE, stars, ''
+
+    conv = fmt[i]
+    if conv in 'diuoxX':
+        arg = ARG_LL if l_cnt >= 2 else ARG_INT
+    elif conv in 'cpn':
+        arg = ARG_INT
+    elif conv in 'fFeEgGaA':
+        arg = ARG_DBL
+    elif conv == 's':
+        arg = ARG_STR
+    else:
+        arg = ARG_NONE
+    return i + 1, arg, stars, flags + conv
+
+
+class Record(object):
+    def __init__(self, body):
+        self.body = body
+        self.pos = HDR_LEN
+
+    def take(self, size):
+        if self.pos + size > len(self.body):
+            raise IndexError
+        val = self.body[self.pos:self.pos + size]
+        self.pos += size
+        return val
+
+    def take_str(self):
+        n = self.take(1)[0]
+        val = self.take(n).decode('latin-1')
+        self.pos = (self.pos + 3) & ~3
+        return val
+
+
+def format_spec(spec, arg, stars, rec):
+    if arg == ARG_NONE:
+        return '%' if spec == '%' else ''
+
+    try:
+        star = [struct.unpack('<i', rec.take(4))[0] for _ in range(stars)]
+        if arg == ARG_INT:
+            val, = struct.unpack('<I', rec.take(4))
+            if spec[-1] in 'di' and val & 0x80000000:
+                val -= 1 << 32
+        elif arg == ARG_LL:
+            val, = struct.unpack('<Q', rec.take(8))
+            if spec[-1] in 'di' and val & (1 << 63):
+                val -= 1 << 64
+        elif arg == ARG_DBL:
+            val, = struct.unpack('<d', rec.take(8))
+        else:
+            val = rec.take_str()
+    except IndexError:
+        return '?'
+
+    conv = spec[-1]
+    if conv == 'n':
+        return ''
+    if conv == 'p':
+        return '0x%x' % val
+    if conv in 'iu':
+        spec = spec[:-1] + 'd'
+    elif conv in 'aA':
+        spec = spec[:-1] + 'f'
+    elif conv == 'F':
+        spec = spec[:-1] + 'f'
+    elif conv == 'c':
+        val = chr(val & 0xff)
+    try:
+        return ('%' + spec) % tuple(star + [val])
+    except (TypeError, ValueError):
+        return '?'
+
+
+def format_record(body, elf):
+    fmt_addr, time, length = struct.unpack_from('<IIH', body, 0)
+    fmt = elf.cstr(fmt_addr)
+    if fmt is None:
+        return '[%d] <unknown format 0x%08x>\r\n' % (time, fmt_addr)
+
+    rec = Record(body)
+    out = []
+    i = 0
+    while i < len(fmt):
+        if fmt[i] != '%':
+            out.append(fmt[i])
+            i += 1
+            continue
+        i, arg, stars, spec = parse_spec(fmt, i + 1)
+        out.append(format_spec(spec, arg, stars, rec))
+    return ''.join(out)
+
+
+def decode(data, elf, out, show_time):
+    i = 0
+    while i < len(data):
+        j = data.find(SYNC, i)
+        if j < 0:
+            out.write(data[i:].decode('latin-1'))
+            break
+        out.write(data[i:j].decode('latin-1'))
+
+        hdr = data[j + 2:j + 2 + HDR_LEN]
+        if len(hdr) < HDR_LEN:
+            break
+        length, = struct.unpack_from('<H', hdr, 8)
+        if length < HDR_LEN or length > REC_MAX or length & 3:
+            # not a record, the sync bytes were plain data
+            out.write(data[j:j + 1].decode('latin-1'))
+            i = j + 1
+            continue
+
+        body = data[j + 2:j + 2 + length]
+        if len(body) < length:
+            sys.stderr.write('capture ends inside a record\n')
+            break
+        if show_time:
+            out.write('[%d] ' % struct.unpack_from('<I', body, 4)[0])
+        out.write(format_record(body, elf))
+        i = j + 2 + length
+
+
+def main():
+    parser = argparse.ArgumentParser(description='decode a binary bk_printf capture')
+    parser.add_argument('capture', help='raw bytes read from the log uart')
+    parser.add_argument('--elf', required=True, help='elf of the firmware that made the capture')
+    parser.add_argument('-o', '--output', help='write the text here instead of stdout')
+    parser.add_argument('-t', '--time', action='store_true', help='prefix lines with the ms tick')
+    args = parser.parse_args()
+
+    elf = Elf(args.elf)
+    with open(args.capture, 'rb') as f:
+        data = f.read()
+
+    if args.output:
+        with open(args.output, 'w', newline='') as out:
+            decode(data, elf, out, args.time)
+    else:
+        decode(data, elf, sys.stdout, args.time)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,33 @@
+#ifndef __MSC_HOST_USB_CONFIG_H__
+#define __MSC_HOST_USB_CONFIG_H__
+
+// stand-in for demo/beken/usb_device/usb_config.h, builds class/msc/usbd_msc.c on a pc
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHERRYUSB_VERSION 0x000700
+
+#define CONFIG_USB_PRINTF(...) printf(__VA_ARGS__)
+
+#define usb_malloc(size) malloc(size)
+#define usb_free(ptr)    free(ptr)
+
+#define CONFIG_USB_DBG_LEVEL  USB_DBG_ERROR
+#define CONFIG_USB_ALIGN_SIZE 4
+
+#define USB_NOCACHE_RAM_SECTION
+
+#define CONFIG_USBDEV_REQUEST_BUFFER_LEN 1024
+
+// eight 512 byte sectors per chunk, so a chunk is never one sector
+#define CONFIG_USBDEV_MSC_BLOCK_SIZE          4096
+#define CONFIG_USBDEV_MSC_MANUFACTURER_STRING "host"
+#define CONFIG_USBDEV_MSC_PRODUCT_STRING      "ramdisk"
+#define CONFIG_USBDEV_MSC_VERSION_STRING      "0.01"
+#define CONFIG_USBDEV_MSC_STATS
+#define CONFIG_USBDEV_MSC_PRIO                4
+#define CONFIG_USBDEV_MSC_STACKSIZE           2048
+// CONFIG_USBDEV_MSC_THREAD comes from the Makefile, one binary each way
+
+#endif
+// eof
@@ -0,0 +1,614 @@
+/*
+ * Host test of the usb mass storage class, CherryUSB class/msc/usbd_msc.c,
+ * on a ram disk behind the usbd_msc_sector_xxx provider. The bulk endpoints
+ * are a mock: usbd_ep_start_read/write only arm them, and the host side
+ * below moves the data and calls the completion handlers like the musb isr
+ * does. Commands are bulk-only CBW/data/CSW, checked against a shadow copy
+ * of the disk: random READ10/WRITE10 of 1 to 64 sectors, and a media write
+ * fault in the middle of a write, which must drain the data and fail the CSW.
+ *
+ * msc_test_thread is built with CONFIG_USBDEV_MSC_THREAD, the data phases run
+ * on the msc thread while this one plays the isr and sends the next OUT
+ * chunk as soon as it is armed.
+ *
+ * Throughput is taken in virtual time, as the ram disk and the memcpy bus
+ * take none: a full and a high speed bulk bus, and a media with a cost per
+ * call plus a cost per byte. A transfer starts once the endpoint is armed
+ * and the bus is free, its completion runs at its end, and the media calls
+ * take device time on the isr or the msc thread, where the class makes
+ * them. Streaming the disk this way gives the ping-pong rate; one buffer
+ * would do every transfer and media call one after the other, their sum.
+ *   ./msc_test [commands] [seed]
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "usbd_core.h"
+#include "usbd_msc.h"
+#include "usb_scsi.h"
+#include "usb_osal.h"
+
+#define MT_OUT_EP                   0x01
+#define MT_IN_EP                    0x81
+#define MT_SECTOR_SIZE              512
+#define MT_SECTOR_NUM               4096
+#define MT_CMD_SECTORS_MAX          64
+#define MT_WAIT_S                   5
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+void mass_storage_bulk_out(uint8_t ep, uint32_t nbytes);
+void mass_storage_bulk_in(uint8_t ep, uint32_t nbytes);
+void msc_storage_notify_handler(uint8_t event, void *arg);
+
+// the two bulk endpoints, armed by the device, completed by the host side
+static struct mt_bus {
+    pthread_mutex_t lock;
+    uint8_t *out_buf;
+    uint32_t out_len;
+    int out_armed;
+    const uint8_t *in_buf;
+    uint32_t in_len;
+    int in_armed;
+    uint32_t stalls;
+} mt_bus = { PTHREAD_MUTEX_INITIALIZER };
+
+static uint8_t *mt_disk;
+static uint8_t *mt_shadow;
+static uint32_t mt_fail_sector = 0xFFFFFFFF;   // the media write covering it fails
+static unsigned int mt_seed;
+static uint32_t mt_tag;
+static uint32_t mt_chunks_out;
+static uint32_t mt_short_chunks;               // the shorter last chunk of a write
+static pthread_t mt_main;                      // plays the host and the isr
+
+/* ------------------------------------------------------------------ time model */
+
+#define MT_MEDIA_READ_CALL_NS       200000
+#define MT_MEDIA_READ_BYTE_NS       250         // 4 MB/s
+#define MT_MEDIA_WRITE_CALL_NS      500000
+#define MT_MEDIA_WRITE_BYTE_NS      500         // 2 MB/s
+
+// all in ns of virtual time, MB/s are 10^6 bytes
+struct mt_model {
+    const char *name;
+    uint32_t pkt;                              // bulk max packet size
+    uint32_t pkt_ns;                           // at the most packets per (micro)frame
+    uint64_t bus;                              // the bus is free from
+    uint64_t isr;                              // device time in completions
+    uint64_t thr;                              // device time on the msc thread
+    uint64_t out_arm;
+    uint64_t in_arm;
+    uint64_t bus_sum;                          // time on the bus
+    uint64_t media_sum;                        // time in media calls
+    uint64_t ev_ts[8];                         // isr time of each queued thread event
+};
+
+// 19 packets of 64 bytes per 1 ms frame, 13 of 512 bytes per 125 us microframe
+static struct mt_model mt_model[2] = {
+    { "full speed", 64, 1000000 / 19 },
+    { "high speed", 512, 125000 / 13 },
+};
+static pthread_mutex_t mt_model_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define MT_MODEL_CNT                (sizeof(mt_model) / sizeof(mt_model[0]))
+#define MT_MAX(a, b)                ((a) > (b) ? (a) : (b))
+
+static uint64_t *mt_model_clock(struct mt_model *m)
+{
+#ifdef CONFIG_USBDEV_MSC_THREAD
+    if (!pthread_equal(pthread_self(), mt_main)) {
+        return &m->thr;
+    }
+#endif
+    return &m->isr;
+}
+
+static uint64_t mt_model_bus_ns(struct mt_model *m, uint32_t len)
+{
+    return (uint64_t)((len + m->pkt - 1) / m->pkt + (len == 0)) * m->pkt_ns;
+}
+
+static void mt_model_media(uint32_t len, int write)
+{
+    uint64_t ns = write ? MT_MEDIA_WRITE_CALL_NS + (uint64_t)len * MT_MEDIA_WRITE_BYTE_NS
+                        : MT_MEDIA_READ_CALL_NS + (uint64_t)len * MT_MEDIA_READ_BYTE_NS;
+    uint32_t i;
+
+    pthread_mutex_lock(&mt_model_lock);
+    for (i = 0; i < MT_MODEL_CNT; i++) {
+        *mt_model_clock(&mt_model[i]) += ns;
+        mt_model[i].media_sum += ns;
+    }
+    pthread_mutex_unlock(&mt_model_lock);
+}
+
+static void mt_model_arm(int in)
+{
+    uint32_t i;
+
+    pthread_mutex_lock(&mt_model_lock);
+    for (i = 0; i < MT_MODEL_CNT; i++) {
+        *(in ? &mt_model[i].in_arm : &mt_model[i].out_arm) = *mt_model_clock(&mt_model[i]);
+    }
+    pthread_mutex_unlock(&mt_model_lock);
+}
+
+// the host moved len bytes, the completion runs at the end of it
+static void mt_model_xfer(uint32_t len, int in)
+{
+    struct mt_model *m;
+    uint32_t i;
+
+    pthread_mutex_lock(&mt_model_lock);
+    for (i = 0; i < MT_MODEL_CNT; i++) {
+        m = &mt_model[i];
+        m->bus = MT_MAX(m->bus, in ? m->in_arm : m->out_arm) + mt_model_bus_ns(m, len);
+        m->bus_sum += mt_model_bus_ns(m, len);
+        m->isr = MT_MAX(m->isr, m->bus);
+    }
+    pthread_mutex_unlock(&mt_model_lock);
+}
+
+static void mt_model_event(uint32_t slot, int send)
+{
+    struct mt_model *m;
+    uint32_t i;
+
+    pthread_mutex_lock(&mt_model_lock);
+    for (i = 0; i < MT_MODEL_CNT; i++) {
+        m = &mt_model[i];
+        if (send) {
+            m->ev_ts[slot % 8] = m->isr;
+        } else {
+            m->thr = MT_MAX(m->thr, m->ev_ts[slot % 8]);
+        }
+    }
+    pthread_mutex_unlock(&mt_model_lock);
+}
+
+/* ------------------------------------------------------------------ ram disk */
+
+void usbd_msc_get_cap(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
+{
+    *block_num = MT_SECTOR_NUM;
+    *block_size = MT_SECTOR_SIZE;
+}
+
+int usbd_msc_sector_read(uint32_t sector, uint8_t *buffer, uint32_t length)
+{
+    CHECK(length % MT_SECTOR_SIZE == 0);
+    CHECK(sector + length / MT_SECTOR_SIZE <= MT_SECTOR_NUM);
+    mt_model_media(length, 0);
+    memcpy(buffer, mt_disk + sector * MT_SECTOR_SIZE, length);
+
+    return 0;
+}
+
+int usbd_msc_sector_write(uint32_t sector, uint8_t *buffer, uint32_t length)
+{
+    CHECK(length % MT_SECTOR_SIZE == 0);
+    CHECK(sector + length / MT_SECTOR_SIZE <= MT_SECTOR_NUM);
+    if ((mt_fail_sector >= sector) && (mt_fail_sector < sector + length / MT_SECTOR_SIZE)) {
+        return -1;
+    }
+
+    // a slow card now and then, the host runs ahead meanwhile
+    if ((rand_r(&mt_seed) & 15) == 0) {
+        usleep(50);
+    }
+    mt_model_media(length, 1);
+    memcpy(mt_disk + sector * MT_SECTOR_SIZE, buffer, length);
+
+    return 0;
+}
+
+uint32_t usbd_msc_get_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* ------------------------------------------------------------------ dcd mock */
+
+int usbd_ep_start_read(const uint8_t ep, uint8_t *data, uint32_t data_len)
+{
+    CHECK(ep == MT_OUT_EP);
+    mt_model_arm(0);
+    pthread_mutex_lock(&mt_bus.lock);
+    CHECK(!mt_bus.out_armed);
+    mt_bus.out_buf = data;
+    mt_bus.out_len = data_len;
+    mt_bus.out_armed = 1;
+    pthread_mutex_unlock(&mt_bus.lock);
+
+    return 0;
+}
+
+int usbd_ep_start_write(const uint8_t ep, const uint8_t *data, uint32_t data_len)
+{
+    CHECK(ep == MT_IN_EP);
+    mt_model_arm(1);
+    pthread_mutex_lock(&mt_bus.lock);
+    CHECK(!mt_bus.in_armed);
+    mt_bus.in_buf = data;
+    mt_bus.in_len = data_len;
+    mt_bus.in_armed = 1;
+    pthread_mutex_unlock(&mt_bus.lock);
+
+    return 0;
+}
+
+int usbd_ep_set_stall(const uint8_t ep)
+{
+    mt_bus.stalls++;
+    return 0;
+}
+
+void usbd_add_endpoint(struct usbd_endpoint *ep)
+{
+}
+
+/* ------------------------------------------------------------------ osal, for the thread build */
+
+struct mt_mq {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t max;
+    uint32_t in;
+    uint32_t out;
+    uintptr_t msg[8];
+};
+
+static uint32_t mt_mq_full;
+
+usb_osal_mq_t usb_osal_mq_create(uint32_t max_msgs)
+{
+    struct mt_mq *mq = calloc(1, sizeof(*mq));
+
+    CHECK(max_msgs <= 8);
+    pthread_mutex_init(&mq->lock, NULL);
+    pthread_cond_init(&mq->cond, NULL);
+    mq->max = max_msgs;
+
+    return mq;
+}
+
+// from the isr, never blocks
+int usb_osal_mq_send(usb_osal_mq_t handle, uintptr_t addr)
+{
+    struct mt_mq *mq = handle;
+    int ret = 0;
+
+    pthread_mutex_lock(&mq->lock);
+    if (mq->in - mq->out >= mq->max) {
+        mt_mq_full++;
+        ret = -1;
+    } else {
+        mt_model_event(mq->in, 1);
+        mq->msg[mq->in++ % 8] = addr;
+        pthread_cond_signal(&mq->cond);
+    }
+    pthread_mutex_unlock(&mq->lock);
+
+    return ret;
+}
+
+int usb_osal_mq_recv(usb_osal_mq_t handle, uintptr_t *addr, uint32_t timeout)
+{
+    struct mt_mq *mq = handle;
+
+    pthread_mutex_lock(&mq->lock);
+    while (mq->in == mq->out) {
+        pthread_cond_wait(&mq->cond, &mq->lock);
+    }
+    mt_model_event(mq->out, 0);
+    *addr = mq->msg[mq->out++ % 8];
+    pthread_mutex_unlock(&mq->lock);
+
+    return 0;
+}
+
+usb_osal_thread_t usb_osal_thread_create(const char *name, uint32_t stack_size, uint32_t prio, usb_thread_entry_t entry, void *args)
+{
+    pthread_t *tid = malloc(sizeof(*tid));
+
+    pthread_create(tid, NULL, (void *(*)(void *))entry, args);
+    pthread_detach(*tid);
+
+    return tid;
+}
+
+/* ------------------------------------------------------------------ host side */
+
+// until the device arms the endpoint, the msc thread may still be at it
+static void mt_wait(volatile int *armed)
+{
+    time_t end = time(NULL) + MT_WAIT_S;
+    int on;
+
+    for (;;) {
+        pthread_mutex_lock(&mt_bus.lock);
+        on = *armed;
+        pthread_mutex_unlock(&mt_bus.lock);
+        if (on) {
+            return;
+        }
+        if (time(NULL) > end) {
+            printf("FAIL: endpoint never armed, device hangs\n");
+            exit(1);
+        }
+        sched_yield();
+    }
+}
+
+static void mt_out(const uint8_t *data, uint32_t len)
+{
+    uint32_t n;
+
+    mt_wait(&mt_bus.out_armed);
+    pthread_mutex_lock(&mt_bus.lock);
+    n = len < mt_bus.out_len ? len : mt_bus.out_len;
+    memcpy(mt_bus.out_buf, data, n);
+    mt_bus.out_armed = 0;
+    pthread_mutex_unlock(&mt_bus.lock);
+
+    CHECK(n == len);
+    mt_model_xfer(n, 0);
+    mass_storage_bulk_out(MT_OUT_EP, n);
+}
+
+static uint32_t mt_in(uint8_t *data, uint32_t max)
+{
+    uint32_t n;
+
+    mt_wait(&mt_bus.in_armed);
+    pthread_mutex_lock(&mt_bus.lock);
+    n = mt_bus.in_len;
+    CHECK(n <= max);
+    memcpy(data, mt_bus.in_buf, n);
+    mt_bus.in_armed = 0;
+    pthread_mutex_unlock(&mt_bus.lock);
+
+    mt_model_xfer(n, 1);
+    mass_storage_bulk_in(MT_IN_EP, n);
+
+    return n;
+}
+
+static void mt_cbw(uint8_t op, uint32_t data_len, int dir_in, uint32_t lba, uint16_t n)
+{
+    struct CBW cbw;
+
+    memset(&cbw, 0, sizeof(cbw));
+    cbw.dSignature = MSC_CBW_Signature;
+    cbw.dTag = ++mt_tag;
+    cbw.dDataLength = data_len;
+    cbw.bmFlags = dir_in ? 0x80 : 0;
+    cbw.CB[0] = op;
+    if (op < 0x20) {
+        // six byte cdb, allocation length in byte 4
+        cbw.bCBLength = 6;
+        cbw.CB[4] = data_len;
+    } else {
+        cbw.bCBLength = 10;
+        SET_BE32(&cbw.CB[2], lba);
+        SET_BE16(&cbw.CB[7], n);
+    }
+    mt_out((uint8_t *)&cbw, USB_SIZEOF_MSC_CBW);
+}
+
+static uint8_t mt_csw(uint32_t residue)
+{
+    struct CSW csw;
+
+    CHECK(USB_SIZEOF_MSC_CSW == mt_in((uint8_t *)&csw, sizeof(csw)));
+    CHECK(csw.dSignature == MSC_CSW_Signature);
+    CHECK(csw.dTag == mt_tag);
+    CHECK(csw.dDataResidue == residue);
+
+    return csw.bStatus;
+}
+
+static void mt_read10(uint32_t lba, uint16_t n, uint8_t *buf)
+{
+    uint32_t len = n * MT_SECTOR_SIZE, got = 0;
+
+    mt_cbw(SCSI_CMD_READ10, len, 1, lba, n);
+    while (got < len) {
+        got += mt_in(buf + got, len - got);
+    }
+    CHECK(got == len);
+    CHECK(CSW_STATUS_CMD_PASSED == mt_csw(0));
+}
+
+// the host sends what the device armed for, as a real one sends packets
+static uint8_t mt_write10(uint32_t lba, uint16_t n, const uint8_t *buf, uint32_t residue)
+{
+    uint32_t len = n * MT_SECTOR_SIZE, sent = 0, chunk;
+
+    mt_cbw(SCSI_CMD_WRITE10, len, 0, lba, n);
+    while (sent < len) {
+        mt_wait(&mt_bus.out_armed);
+        chunk = mt_bus.out_len;
+        if (chunk < CONFIG_USBDEV_MSC_BLOCK_SIZE) {
+            mt_short_chunks++;
+        }
+        mt_out(buf + sent, chunk);
+        mt_chunks_out++;
+        sent += chunk;
+    }
+    CHECK(sent == len);
+
+    return mt_csw(residue);
+}
+
+static void mt_read_capacity(void)
+{
+    uint8_t cap[8];
+
+    mt_cbw(SCSI_CMD_READCAPACITY10, sizeof(cap), 1, 0, 0);
+    CHECK(sizeof(cap) == mt_in(cap, sizeof(cap)));
+    CHECK(CSW_STATUS_CMD_PASSED == mt_csw(0));
+    CHECK(GET_BE32(&cap[0]) == MT_SECTOR_NUM - 1);
+    CHECK(GET_BE32(&cap[4]) == MT_SECTOR_SIZE);
+}
+
+static void mt_write_fault(void)
+{
+    uint8_t buf[MT_CMD_SECTORS_MAX * MT_SECTOR_SIZE];
+    uint8_t sense[18];
+    uint32_t lba = 100, i;
+
+    printf("write fault\n");
+    for (i = 0; i < sizeof(buf); i++) {
+        buf[i] = rand_r(&mt_seed);
+    }
+
+    // the third chunk fails: two are on the media, the rest is drained
+    mt_fail_sector = lba + 2 * CONFIG_USBDEV_MSC_BLOCK_SIZE / MT_SECTOR_SIZE + 1;
+    CHECK(CSW_STATUS_CMD_FAILED == mt_write10(lba, 40, buf, 40 * MT_SECTOR_SIZE - 2 * CONFIG_USBDEV_MSC_BLOCK_SIZE));
+    mt_fail_sector = 0xFFFFFFFF;
+    memcpy(mt_shadow + lba * MT_SECTOR_SIZE, buf, 2 * CONFIG_USBDEV_MSC_BLOCK_SIZE);
+    CHECK(0 == memcmp(mt_disk, mt_shadow, MT_SECTOR_NUM * MT_SECTOR_SIZE));
+
+    mt_cbw(SCSI_CMD_REQUESTSENSE, sizeof(sense), 1, 0, 0);
+    CHECK(sizeof(sense) == mt_in(sense, sizeof(sense)));
+    CHECK(CSW_STATUS_CMD_PASSED == mt_csw(0));
+    CHECK(((sense[2] & 0x0f) << 16 | sense[12] << 8 | sense[13]) == SCSI_KCQHE_WRITEFAULT);
+
+    // and the next command works
+    CHECK(CSW_STATUS_CMD_PASSED == mt_write10(lba, 40, buf, 0));
+    memcpy(mt_shadow + lba * MT_SECTOR_SIZE, buf, 40 * MT_SECTOR_SIZE);
+}
+
+static void mt_random(uint32_t cmds)
+{
+    static uint8_t buf[MT_CMD_SECTORS_MAX * MT_SECTOR_SIZE];
+    uint32_t c, i, lba, n, reads = 0, writes = 0;
+
+    printf("random, %u commands\n", cmds);
+    for (c = 0; c < cmds; c++) {
+        n = 1 + rand_r(&mt_seed) % MT_CMD_SECTORS_MAX;
+        lba = rand_r(&mt_seed) % (MT_SECTOR_NUM - n + 1);
+        if (rand_r(&mt_seed) & 1) {
+            for (i = 0; i < n * MT_SECTOR_SIZE; i++) {
+                buf[i] = rand_r(&mt_seed);
+            }
+            CHECK(CSW_STATUS_CMD_PASSED == mt_write10(lba, n, buf, 0));
+            memcpy(mt_shadow + lba * MT_SECTOR_SIZE, buf, n * MT_SECTOR_SIZE);
+            writes++;
+        } else {
+            mt_read10(lba, n, buf);
+            CHECK(0 == memcmp(buf, mt_shadow + lba * MT_SECTOR_SIZE, n * MT_SECTOR_SIZE));
+            reads++;
+        }
+    }
+    CHECK(0 == memcmp(mt_disk, mt_shadow, MT_SECTOR_NUM * MT_SECTOR_SIZE));
+    printf("  %u reads, %u writes, %u out chunks (%u short)\n", reads, writes, mt_chunks_out, mt_short_chunks);
+}
+
+// the device is done with the last command once the csw is out
+static void mt_model_snap(struct mt_model *snap)
+{
+    pthread_mutex_lock(&mt_model_lock);
+    memcpy(snap, mt_model, sizeof(mt_model));
+    pthread_mutex_unlock(&mt_model_lock);
+}
+
+static void mt_stream_report(const char *dir, const struct mt_model *from, uint32_t bytes)
+{
+    struct mt_model now[MT_MODEL_CNT];
+    uint64_t took, serial, bus, media;
+    uint32_t i;
+
+    mt_model_snap(now);
+    for (i = 0; i < MT_MODEL_CNT; i++) {
+        took = now[i].bus - MT_MAX(from[i].bus, MT_MAX(from[i].isr, from[i].thr));
+        bus = now[i].bus_sum - from[i].bus_sum;
+        media = now[i].media_sum - from[i].media_sum;
+        serial = bus + media;
+        printf("  %-10s %-5s bus limit %5.2f MB/s, media %4.2f MB/s; ping-pong %4.2f MB/s, one buffer %4.2f MB/s, %3.0f%% of the overlap\n",
+               now[i].name, dir, (double)now[i].pkt * 1000 / now[i].pkt_ns, (double)bytes * 1000 / media,
+               (double)bytes * 1000 / took, (double)bytes * 1000 / serial,
+               100.0 * (serial - took) / (bus < media ? bus : media));
+
+        // the next transfer is on the bus while the media works on the last
+        CHECK(took < serial);
+        CHECK((serial - took) * 2 > (bus < media ? bus : media));
+    }
+}
+
+// the whole disk out and back in, commands of the most sectors
+static void mt_stream(void)
+{
+    static uint8_t buf[MT_CMD_SECTORS_MAX * MT_SECTOR_SIZE];
+    struct mt_model from[MT_MODEL_CNT];
+    uint32_t lba, i;
+
+    printf("stream, %u KB in %u sector commands, %u byte chunks\n",
+           MT_SECTOR_NUM * MT_SECTOR_SIZE / 1024, MT_CMD_SECTORS_MAX, CONFIG_USBDEV_MSC_BLOCK_SIZE);
+    mt_model_snap(from);
+    for (lba = 0; lba < MT_SECTOR_NUM; lba += MT_CMD_SECTORS_MAX) {
+        for (i = 0; i < sizeof(buf); i++) {
+            buf[i] = rand_r(&mt_seed);
+        }
+        CHECK(CSW_STATUS_CMD_PASSED == mt_write10(lba, MT_CMD_SECTORS_MAX, buf, 0));
+        memcpy(mt_shadow + lba * MT_SECTOR_SIZE, buf, sizeof(buf));
+    }
+    mt_stream_report("write", from, MT_SECTOR_NUM * MT_SECTOR_SIZE);
+
+    mt_model_snap(from);
+    for (lba = 0; lba < MT_SECTOR_NUM; lba += MT_CMD_SECTORS_MAX) {
+        mt_read10(lba, MT_CMD_SECTORS_MAX, buf);
+        CHECK(0 == memcmp(buf, mt_shadow + lba * MT_SECTOR_SIZE, sizeof(buf)));
+    }
+    mt_stream_report("read", from, MT_SECTOR_NUM * MT_SECTOR_SIZE);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t cmds = argc > 1 ? atoi(argv[1]) : 5000;
+    static struct usbd_interface intf;
+    struct usbd_msc_stats stats;
+    uint32_t i;
+
+    mt_seed = argc > 2 ? atoi(argv[2]) : 1;
+    mt_main = pthread_self();
+    mt_disk = malloc(MT_SECTOR_NUM * MT_SECTOR_SIZE);
+    mt_shadow = malloc(MT_SECTOR_NUM * MT_SECTOR_SIZE);
+    for (i = 0; i < MT_SECTOR_NUM * MT_SECTOR_SIZE; i++) {
+        mt_disk[i] = rand_r(&mt_seed);
+    }
+    memcpy(mt_shadow, mt_disk, MT_SECTOR_NUM * MT_SECTOR_SIZE);
+
+#ifdef CONFIG_USBDEV_MSC_THREAD
+    printf("msc data phases on the msc thread\n");
+#endif
+    CHECK(usbd_msc_init_intf(&intf, MT_OUT_EP, MT_IN_EP) == &intf);
+    msc_storage_notify_handler(USBD_EVENT_CONFIGURED, NULL);
+
+    mt_read_capacity();
+    mt_write_fault();
+    mt_random(cmds);
+    mt_stream();
+
+    usbd_msc_get_stats(&stats);
+    printf("  media read %u us, write %u us; data in %u us, out %u us; %u chunks read on demand\n",
+           stats.media_read_us, stats.media_write_us, stats.data_in_us, stats.data_out_us, stats.read_sync);
+    CHECK(0 == mt_mq_full);
+    CHECK(0 == mt_bus.stalls);
+
+    free(mt_disk);
+    free(mt_shadow);
+    printf("ok\n");
+
+    return 0;
+}
+// eof
@@ -0,0 +1,14 @@
+#ifndef __MUSB_HOST_ARM_ARCH_H__
+#define __MUSB_HOST_ARM_ARCH_H__
+
+#include <stdint.h>
+
+// register accesses land in the simulation, see musb_sim.c
+uint32_t ms_reg_read(uint32_t addr);
+void ms_reg_write(uint32_t addr, uint32_t val);
+
+#define REG_READ(addr)                    ms_reg_read((uint32_t)(addr))
+#define REG_WRITE(addr, _data)            ms_reg_write((uint32_t)(addr), (uint32_t)(_data))
+
+#endif
+// eof
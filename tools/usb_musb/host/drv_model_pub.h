@@ -0,0 +1,16 @@
+#ifndef __MUSB_HOST_DRV_MODEL_PUB_H__
+#define __MUSB_HOST_DRV_MODEL_PUB_H__
+
+#include "include.h"
+
+typedef struct _sdd_operations_
+{
+    UINT32 (*control)(UINT32 cmd, void *param);
+} SDD_OPERATIONS;
+
+UINT32 sddev_control(char *dev_name, UINT32 cmd, void *param);
+INT32 sddev_register_dev(char *dev_name, SDD_OPERATIONS *optr);
+INT32 sddev_unregister_dev(char *dev_name);
+
+#endif
+// eof
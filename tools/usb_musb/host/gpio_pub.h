@@ -0,0 +1,7 @@
+#ifndef __MUSB_HOST_GPIO_PUB_H__
+#define __MUSB_HOST_GPIO_PUB_H__
+
+void gpio_usb_second_function(void);
+
+#endif
+// eof
@@ -0,0 +1,21 @@
+#ifndef __MUSB_HOST_ICU_PUB_H__
+#define __MUSB_HOST_ICU_PUB_H__
+
+#include "drv_model_pub.h"
+
+#define ICU_DEV_NAME                      "icu"
+#define ICU_SUCCESS                       0
+
+#define CMD_ICU_INT_ENABLE                1
+#define CMD_ICU_INT_DISABLE               2
+#define CMD_CLK_PWR_UP                    3
+#define CMD_CLK_PWR_DOWN                  4
+#define CMD_ICU_GLOBAL_INT_ENABLE         5
+
+#define IRQ_USB_BIT                       (1 << 1)
+#define IRQ_GDMA_BIT                      (1 << 2)
+#define PWD_USB_CLK_BIT                   (1 << 3)
+#define GINTR_IRQ_BIT                     (1 << 0)
+
+#endif
+// eof
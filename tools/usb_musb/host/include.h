@@ -0,0 +1,32 @@
+#ifndef __MUSB_HOST_INCLUDE_H__
+#define __MUSB_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, builds general_dma.c and the musb port on a pc
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+
+#define SOC_BK7231                        1
+#define SOC_BK7231U                       2
+#define SOC_BK7221U                       3
+#define CFG_SOC_NAME                      SOC_BK7231U
+
+#define CFG_GENERAL_DMA                   1
+#define CFG_GDMA_ASYNC                    0
+
+#define ASSERT(exp)
+
+// one thread, interrupts off only holds back the simulated gdma isr
+void host_int_disable(void);
+void host_int_restore(void);
+
+#define GLOBAL_INT_DECLARATION()
+#define GLOBAL_INT_DISABLE()              host_int_disable()
+#define GLOBAL_INT_RESTORE()              host_int_restore()
+
+#endif
+// eof
@@ -0,0 +1,18 @@
+#ifndef __MUSB_HOST_INTC_PUB_H__
+#define __MUSB_HOST_INTC_PUB_H__
+
+#include "include.h"
+
+typedef void (*FUNCPTR)(void);
+
+#define IRQ_USB                           1
+#define IRQ_GENERDMA                      2
+#define PRI_IRQ_USB                       0
+#define PRI_IRQ_GENERDMA                  0
+
+// the sim keeps the isr of each
+void intc_service_register(UINT8 int_num, UINT8 int_pri, FUNCPTR isr);
+void intc_enable(int index);
+
+#endif
+// eof
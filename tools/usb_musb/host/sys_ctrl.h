@@ -0,0 +1,8 @@
+#ifndef __MUSB_HOST_SYS_CTRL_H__
+#define __MUSB_HOST_SYS_CTRL_H__
+
+// outside the simulated blocks, the sim ignores it
+#define SCTRL_ANALOG_CTRL2                (0x00800000 + 0x56 * 4)
+
+#endif
+// eof
@@ -0,0 +1,19 @@
+#ifndef __MUSB_HOST_SYS_CTRL_PUB_H__
+#define __MUSB_HOST_SYS_CTRL_PUB_H__
+
+#include "drv_model_pub.h"
+
+#define SCTRL_DEV_NAME                    "sys_ctrl"
+
+#define CMD_SCTRL_USB_POWERUP             1
+#define CMD_SCTRL_USB_SUBSYS_RESET        2
+#define CMD_SCTRL_BLK_ENABLE              3
+#define CMD_SCTRL_MCLK_SELECT             4
+#define CMD_SCTRL_MCLK_DIVISION           5
+
+#define BLK_BIT_DPLL_480M                 (1 << 0)
+#define BLK_BIT_USB                       (1 << 1)
+#define MCLK_SELECT_DPLL                  1
+
+#endif
+// eof
@@ -0,0 +1,42 @@
+#ifndef __MUSB_HOST_USB_CONFIG_H__
+#define __MUSB_HOST_USB_CONFIG_H__
+
+// stand-in for demo/beken/usb_device/usb_config.h, builds port/beken_musb on a pc
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "include.h"
+#include "uart_pub.h"
+
+#define CHERRYUSB_VERSION 0x000700
+
+#define CONFIG_USB_PRINTF(...) printf(__VA_ARGS__)
+
+#define usb_malloc(size) malloc(size)
+#define usb_free(ptr)    free(ptr)
+
+#define CONFIG_USB_DBG_LEVEL  USB_DBG_ERROR
+#define CONFIG_USB_ALIGN_SIZE 4
+
+#define USB_NOCACHE_RAM_SECTION
+
+#define CONFIG_USBDEV_REQUEST_BUFFER_LEN 512
+
+#define USBD_IRQHandler USBD_IRQHandler
+#define USBD_BASE (0x00804000)
+#define CONFIG_USBDEV_EP_NUM 4
+#define USB_NUM_BIDIR_ENDPOINTS 16
+
+// register accesses go to the simulation, see musb_sim.c
+void *ms_usb_reg(uint32_t addr, uint32_t size);
+#define HWREG(x)  (*((volatile uint32_t *)ms_usb_reg((uint32_t)(x), 4)))
+#define HWREGH(x) (*((volatile uint16_t *)ms_usb_reg((uint32_t)(x), 2)))
+#define HWREGB(x) (*((volatile uint8_t *)ms_usb_reg((uint32_t)(x), 1)))
+
+#define CONFIG_USB_MUSB_GDMA
+#define CONFIG_USB_MUSB_GDMA_CHNL    4
+#define CONFIG_USB_MUSB_GDMA_MIN_LEN 32
+#define CONFIG_USB_MUSB_BOUNCE_SIZE  512
+
+#endif
+// eof
@@ -0,0 +1,8 @@
+#ifndef __MUSB_HOST_USB_PUB_H__
+#define __MUSB_HOST_USB_PUB_H__
+
+#define USB_HOST_MODE                     0
+#define USB_DEVICE_MODE                   1
+
+#endif
+// eof
@@ -0,0 +1,758 @@
+/*
+ * Host simulation of the musb fifo register interface. The beken port,
+ * CherryUSB port/beken_musb/usb_dc_beken_musb.c, and the gdma fifo channel of
+ * driver/general_dma/general_dma.c are built against simulated registers:
+ * HWREG/HWREGH/HWREGB and REG_READ/REG_WRITE land here.
+ *
+ * The usb block keeps the common registers, the ones banked by EPIDX and one
+ * fifo per endpoint. A fifo access moves 1 or 4 bytes, a word access packs
+ * little endian like the musb does. Setting TXRDY hands the bytes written
+ * since the last one to the host as a packet, clearing RXRDY checks the
+ * device read the whole OUT packet. The interrupt status registers clear on
+ * read. The gdma block runs a started channel when the test lets time pass,
+ * or after a few polls of its enable bit, then raises the finish interrupt.
+ *
+ * Checked: IN and OUT bulk transfers of random length and alignment arrive
+ * intact by cpu, by dma and through the bounce buffer; gdma_fifo_init refuses
+ * channel 0, a channel a driver set up and a channel it already gave out; a
+ * driver taking the channel while a packet is in flight lets that packet
+ * finish, and the port goes on by cpu.
+ *   ./musb_sim [transfers] [seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "usbd_core.h"
+#include "usb_beken_musb_reg.h"
+#include "usb_dc_beken_musb.h"
+#include "arm_arch.h"
+#include "drv_model_pub.h"
+#include "intc_pub.h"
+#include "general_dma_pub.h"
+#include "general_dma.h"
+
+#define MS_USB_BASE                 USBD_BASE
+#define MS_USB_SIZE                 0x100
+#define MS_IND_OFFSET               0x10    // 0x10..0x1f banked by EPIDX
+#define MS_EPIDX_OFFSET             0x0E
+#define MS_TXIS_OFFSET              0x02
+#define MS_RXIS_OFFSET              0x04
+#define MS_IS_OFFSET                0x06
+#define MS_TXCSRL_OFFSET            0x11
+#define MS_RXCSRL_OFFSET            0x14
+#define MS_RXCOUNT_OFFSET           0x16
+#define MS_FIFO_OFFSET              0x20
+#define MS_EP_NUM                   16
+#define MS_PKT_MAX                  2048
+
+#define MS_GDMA_BASE                0x00809000
+#define MS_GDMA_REGS                0x40
+#define MS_GDMA_CHNL_NUM            6
+#define MS_GDMA_STATUS_IDX          0x38
+#define MS_GDMA_POLLS               3       // enable bit reads a transfer takes
+
+#define MS_IN_EP                    0x81
+#define MS_OUT_EP                   0x02
+#define MS_MPS                      512
+#define MS_XFER_MAX                 (4 * MS_MPS + 100)
+#define MS_LOOP_MAX                 1000
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+void gdma_init(void);
+
+static uint8_t ms_usb[MS_USB_SIZE];
+static uint8_t ms_ind[MS_EP_NUM][0x10];
+static uint16_t ms_txis;
+static uint16_t ms_rxis;
+static uint8_t ms_is;
+
+static struct ms_fifo {
+    uint8_t tx[MS_PKT_MAX];     // written by the device since the last TXRDY
+    uint32_t tx_len;
+    uint8_t in[MS_PKT_MAX];     // committed by TXRDY, waits for the host
+    uint32_t in_len;
+    uint8_t rx[MS_PKT_MAX];     // an OUT packet from the host
+    uint32_t rx_len;
+    uint32_t rx_pos;
+} ms_fifo[MS_EP_NUM];
+
+// HWREGx() hands out the latch, it is applied at the next register access
+enum { MS_LATCH_NONE, MS_LATCH_REG, MS_LATCH_IRQ, MS_LATCH_FIFO_RD, MS_LATCH_FIFO_WR };
+
+static struct ms_latch {
+    int kind;
+    uint32_t off;
+    uint32_t size;
+    uint32_t ep;
+    uint32_t val;
+    uint32_t old;
+} ms_latch;
+
+static uint32_t ms_gdma[MS_GDMA_REGS];
+static uint32_t ms_gdma_status;
+static uint32_t ms_gdma_polls[MS_GDMA_CHNL_NUM];
+static uint32_t ms_gdma_done;                       // transfers run
+
+static int ms_int_depth;
+static FUNCPTR ms_usb_isr;
+static FUNCPTR ms_gdma_isr;
+
+static uint32_t ms_in_done = 0xFFFFFFFF;            // nbytes of the last completion
+static uint32_t ms_out_done = 0xFFFFFFFF;
+static unsigned int ms_seed;
+
+// the transfer buffers are static so that they have 32 bit addresses for the
+// gdma registers, the Makefile links without pie
+static USB_MEM_ALIGNX uint8_t ms_src[MS_XFER_MAX + 4];
+static USB_MEM_ALIGNX uint8_t ms_dst[MS_XFER_MAX + 4];
+static uint8_t ms_host_buf[MS_XFER_MAX];
+
+/* ------------------------------------------------------------------ usb block */
+
+static uint8_t *ms_usb_byte(uint32_t off)
+{
+    if ((off >= MS_IND_OFFSET) && (off < MS_IND_OFFSET + 0x10)) {
+        return &ms_ind[ms_usb[MS_EPIDX_OFFSET] & (MS_EP_NUM - 1)][off - MS_IND_OFFSET];
+    }
+    return &ms_usb[off];
+}
+
+static void ms_fifo_read(uint32_t ep, uint8_t *data, uint32_t size)
+{
+    struct ms_fifo *fifo = &ms_fifo[ep];
+
+    CHECK(ms_ind[ep][MS_RXCSRL_OFFSET - MS_IND_OFFSET] & USB_RXCSRL1_RXRDY);
+    CHECK(fifo->rx_pos + size <= fifo->rx_len);
+    memcpy(data, fifo->rx + fifo->rx_pos, size);
+    fifo->rx_pos += size;
+}
+
+static void ms_fifo_write(uint32_t ep, const uint8_t *data, uint32_t size)
+{
+    struct ms_fifo *fifo = &ms_fifo[ep];
+
+    CHECK(!(ms_ind[ep][MS_TXCSRL_OFFSET - MS_IND_OFFSET] & USB_TXCSRL1_TXRDY));
+    CHECK(fifo->tx_len + size <= MS_PKT_MAX);
+    memcpy(fifo->tx + fifo->tx_len, data, size);
+    fifo->tx_len += size;
+}
+
+// an OUT packet waits in the fifo, accesses read it
+static int ms_fifo_rx_loaded(uint32_t ep)
+{
+    return (ep != 0) && (ms_ind[ep][MS_RXCSRL_OFFSET - MS_IND_OFFSET] & USB_RXCSRL1_RXRDY);
+}
+
+static void ms_csr_written(uint32_t off, uint8_t old, uint8_t val)
+{
+    uint32_t ep = ms_usb[MS_EPIDX_OFFSET] & (MS_EP_NUM - 1);
+    struct ms_fifo *fifo = &ms_fifo[ep];
+    uint8_t *csr = ms_usb_byte(off);
+
+    if (ep == 0) {
+        return;
+    }
+
+    if (off == MS_TXCSRL_OFFSET) {
+        if (val & USB_TXCSRL1_FLUSH) {
+            fifo->tx_len = 0;
+            val &= ~USB_TXCSRL1_TXRDY;
+        }
+        if ((val & USB_TXCSRL1_TXRDY) && !(old & USB_TXCSRL1_TXRDY)) {
+            memcpy(fifo->in, fifo->tx, fifo->tx_len);
+            fifo->in_len = fifo->tx_len;
+            fifo->tx_len = 0;
+        }
+        *csr = val & ~(USB_TXCSRL1_FLUSH | USB_TXCSRL1_CLRDT);
+    } else if (off == MS_RXCSRL_OFFSET) {
+        if (val & USB_RXCSRL1_FLUSH) {
+            fifo->rx_pos = fifo->rx_len;
+            val &= ~USB_RXCSRL1_RXRDY;
+        }
+        if ((old & USB_RXCSRL1_RXRDY) && !(val & USB_RXCSRL1_RXRDY)) {
+            /* the whole packet went out of the fifo */
+            CHECK(fifo->rx_pos == fifo->rx_len);
+            fifo->rx_len = 0;
+            fifo->rx_pos = 0;
+        }
+        *csr = val & ~(USB_RXCSRL1_FLUSH | USB_RXCSRL1_CLRDT);
+    }
+}
+
+static void ms_commit(void)
+{
+    struct ms_latch *l = &ms_latch;
+    uint8_t old;
+    uint8_t val;
+
+    switch (l->kind) {
+        case MS_LATCH_FIFO_WR:
+            ms_fifo_write(l->ep, (uint8_t *)&l->val, l->size);
+            break;
+        case MS_LATCH_REG:
+            if (l->val == l->old) {
+                break;
+            }
+            for (uint32_t i = 0; i < l->size; i++) {
+                old = (uint8_t)(l->old >> (8 * i));
+                val = (uint8_t)(l->val >> (8 * i));
+                *ms_usb_byte(l->off + i) = val;
+                if ((l->off + i == MS_TXCSRL_OFFSET) || (l->off + i == MS_RXCSRL_OFFSET)) {
+                    ms_csr_written(l->off + i, old, val);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    l->kind = MS_LATCH_NONE;
+}
+
+void *ms_usb_reg(uint32_t addr, uint32_t size)
+{
+    struct ms_latch *l = &ms_latch;
+    uint32_t off = addr - MS_USB_BASE;
+
+    ms_commit();
+    CHECK(off + size <= MS_USB_SIZE);
+
+    l->off = off;
+    l->size = size;
+    l->val = 0;
+
+    if ((off >= MS_FIFO_OFFSET) && (off < MS_FIFO_OFFSET + 4 * MS_EP_NUM)) {
+        CHECK((off & 0x03) == 0);
+        l->ep = (off - MS_FIFO_OFFSET) >> 2;
+        if (ms_fifo_rx_loaded(l->ep)) {
+            l->kind = MS_LATCH_FIFO_RD;
+            ms_fifo_read(l->ep, (uint8_t *)&l->val, size);
+        } else {
+            l->kind = MS_LATCH_FIFO_WR;
+        }
+    } else if (off == MS_TXIS_OFFSET) {
+        l->kind = MS_LATCH_IRQ;
+        l->val = ms_txis;
+        ms_txis = 0;
+    } else if (off == MS_RXIS_OFFSET) {
+        l->kind = MS_LATCH_IRQ;
+        l->val = ms_rxis;
+        ms_rxis = 0;
+    } else if (off == MS_IS_OFFSET) {
+        l->kind = MS_LATCH_IRQ;
+        l->val = ms_is;
+        ms_is = 0;
+    } else {
+        l->kind = MS_LATCH_REG;
+        for (uint32_t i = 0; i < size; i++) {
+            l->val |= (uint32_t)*ms_usb_byte(off + i) << (8 * i);
+        }
+        l->old = l->val;
+    }
+
+    return &l->val;
+}
+
+static uint8_t *ms_ep_reg(uint32_t ep, uint32_t off)
+{
+    return &ms_ind[ep][off - MS_IND_OFFSET];
+}
+
+/* ------------------------------------------------------------------ gdma block */
+
+static uint32_t ms_bus_read32(uint32_t addr)
+{
+    uint32_t word;
+
+    if ((addr >= MS_USB_BASE + MS_FIFO_OFFSET) && (addr < MS_USB_BASE + MS_FIFO_OFFSET + 4 * MS_EP_NUM)) {
+        ms_fifo_read((addr - MS_USB_BASE - MS_FIFO_OFFSET) >> 2, (uint8_t *)&word, 4);
+    } else {
+        memcpy(&word, (void *)(uintptr_t)addr, 4);
+    }
+    return word;
+}
+
+static void ms_bus_write32(uint32_t addr, uint32_t word)
+{
+    if ((addr >= MS_USB_BASE + MS_FIFO_OFFSET) && (addr < MS_USB_BASE + MS_FIFO_OFFSET + 4 * MS_EP_NUM)) {
+        ms_fifo_write((addr - MS_USB_BASE - MS_FIFO_OFFSET) >> 2, (uint8_t *)&word, 4);
+    } else {
+        memcpy((void *)(uintptr_t)addr, &word, 4);
+    }
+}
+
+static int ms_gdma_running(uint32_t ch)
+{
+    return (ms_gdma[ch * 8] & GDMA_X_DMA_EN) != 0;
+}
+
+static void ms_gdma_finish(uint32_t ch)
+{
+    uint32_t conf = ms_gdma[ch * 8];
+    uint32_t dst = ms_gdma[ch * 8 + 1];
+    uint32_t src = ms_gdma[ch * 8 + 2];
+    uint32_t len = ((conf >> GDMA_X_TRANS_LEN_POSI) & GDMA_X_TRANS_LEN_MASK) + 1;
+
+    CHECK(((conf >> GDMA_X_SRCDATA_WIDTH_POSI) & GDMA_X_SRCDATA_WIDTH_MASK) == GDMA_DATA_WIDTH_32BIT);
+    CHECK(((conf >> GDMA_X_DSTDATA_WIDTH_POSI) & GDMA_X_DSTDATA_WIDTH_MASK) == GDMA_DATA_WIDTH_32BIT);
+    CHECK((len & 0x03) == 0);
+
+    for (uint32_t i = 0; i < len; i += 4) {
+        ms_bus_write32(dst + ((conf & GDMA_X_DSTADDR_INC) ? i : 0),
+                       ms_bus_read32(src + ((conf & GDMA_X_SRCADDR_INC) ? i : 0)));
+    }
+
+    ms_gdma[ch * 8] &= ~GDMA_X_DMA_EN;
+    ms_gdma_status |= (1 << ch);
+    ms_gdma_done++;
+}
+
+uint32_t ms_reg_read(uint32_t addr)
+{
+    uint32_t idx = (addr - MS_GDMA_BASE) >> 2;
+
+    ms_commit();
+    if ((addr < MS_GDMA_BASE) || (idx >= MS_GDMA_REGS)) {
+        return 0;
+    }
+
+    if (idx == MS_GDMA_STATUS_IDX) {
+        return ms_gdma_status;
+    }
+    if (((idx & 7) == 0) && (idx < MS_GDMA_CHNL_NUM * 8) && ms_gdma_running(idx >> 3)) {
+        /* the hardware goes on while the cpu polls */
+        if (++ms_gdma_polls[idx >> 3] >= MS_GDMA_POLLS) {
+            ms_gdma_finish(idx >> 3);
+        }
+    }
+    return ms_gdma[idx];
+}
+
+void ms_reg_write(uint32_t addr, uint32_t val)
+{
+    uint32_t idx = (addr - MS_GDMA_BASE) >> 2;
+
+    ms_commit();
+    if ((addr < MS_GDMA_BASE) || (idx >= MS_GDMA_REGS)) {
+        return;
+    }
+
+    if (idx == MS_GDMA_STATUS_IDX) {
+        ms_gdma_status &= ~val;
+        return;
+    }
+    if (((idx & 7) == 0) && (idx < MS_GDMA_CHNL_NUM * 8) && (val & GDMA_X_DMA_EN) && !ms_gdma_running(idx >> 3)) {
+        ms_gdma_polls[idx >> 3] = 0;
+    }
+    ms_gdma[idx] = val;
+}
+
+// time passes: started transfers finish, the finish interrupt is taken
+static void ms_gdma_run(void)
+{
+    uint32_t pending = 0;
+
+    ms_commit();
+    for (uint32_t ch = 0; ch < MS_GDMA_CHNL_NUM; ch++) {
+        if (ms_gdma_running(ch)) {
+            ms_gdma_finish(ch);
+        }
+        if ((ms_gdma_status & (1 << ch)) && (ms_gdma[ch * 8] & GDMA_X_FIN_INTEN)) {
+            pending = 1;
+        }
+    }
+    if (pending && (ms_int_depth == 0) && ms_gdma_isr) {
+        ms_gdma_isr();
+        ms_commit();
+    }
+}
+
+/* ------------------------------------------------------------------ sdk stubs */
+
+void host_int_disable(void)
+{
+    ms_int_depth++;
+}
+
+void host_int_restore(void)
+{
+    CHECK(ms_int_depth > 0);
+    ms_int_depth--;
+}
+
+UINT32 sddev_control(char *dev_name, UINT32 cmd, void *param)
+{
+    return 0;
+}
+
+INT32 sddev_register_dev(char *dev_name, SDD_OPERATIONS *optr)
+{
+    return 0;
+}
+
+INT32 sddev_unregister_dev(char *dev_name)
+{
+    return 0;
+}
+
+void intc_service_register(UINT8 int_num, UINT8 int_pri, FUNCPTR isr)
+{
+    if (int_num == IRQ_USB) {
+        ms_usb_isr = isr;
+    } else if (int_num == IRQ_GENERDMA) {
+        ms_gdma_isr = isr;
+    }
+}
+
+void intc_enable(int index)
+{
+}
+
+void gpio_usb_second_function(void)
+{
+}
+
+void delay(int num)
+{
+}
+
+void usbd_event_reset_handler(void)
+{
+}
+
+void usbd_event_ep0_setup_complete_handler(uint8_t *psetup)
+{
+}
+
+void usbd_event_ep_in_complete_handler(uint8_t ep, uint32_t nbytes)
+{
+    CHECK(ep == MS_IN_EP);
+    ms_in_done = nbytes;
+}
+
+void usbd_event_ep_out_complete_handler(uint8_t ep, uint32_t nbytes)
+{
+    CHECK(ep == (MS_OUT_EP & 0x7F));
+    ms_out_done = nbytes;
+}
+
+/* ------------------------------------------------------------------ host side */
+
+static void ms_usb_irq(void)
+{
+    ms_commit();
+    CHECK(ms_usb_isr);
+    ms_usb_isr();
+    ms_commit();
+}
+
+// take the IN packet the device committed, -1 if there is none
+static int ms_host_in(uint32_t ep, uint8_t *buf)
+{
+    uint8_t *csr = ms_ep_reg(ep, MS_TXCSRL_OFFSET);
+    int len;
+
+    ms_commit();
+    if (!(*csr & USB_TXCSRL1_TXRDY)) {
+        return -1;
+    }
+    len = ms_fifo[ep].in_len;
+    memcpy(buf, ms_fifo[ep].in, len);
+    ms_fifo[ep].in_len = 0;
+    *csr &= ~USB_TXCSRL1_TXRDY;
+    ms_txis |= (1 << ep);
+
+    return len;
+}
+
+// put an OUT packet in the fifo, -1 while the last one is not read yet
+static int ms_host_out(uint32_t ep, const uint8_t *data, uint32_t len)
+{
+    uint8_t *csr = ms_ep_reg(ep, MS_RXCSRL_OFFSET);
+
+    ms_commit();
+    if (*csr & USB_RXCSRL1_RXRDY) {
+        return -1;
+    }
+    memcpy(ms_fifo[ep].rx, data, len);
+    ms_fifo[ep].rx_len = len;
+    ms_fifo[ep].rx_pos = 0;
+    *ms_ep_reg(ep, MS_RXCOUNT_OFFSET) = (uint8_t)len;
+    *ms_ep_reg(ep, MS_RXCOUNT_OFFSET + 1) = (uint8_t)(len >> 8);
+    *csr |= USB_RXCSRL1_RXRDY;
+    ms_rxis |= (1 << ep);
+
+    return 0;
+}
+
+static void ms_fill(uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        buf[i] = rand_r(&ms_seed);
+    }
+}
+
+static void ms_open_eps(void)
+{
+    struct usb_endpoint_descriptor in_ep = { 7, USB_DESCRIPTOR_TYPE_ENDPOINT, MS_IN_EP, USB_ENDPOINT_TYPE_BULK, MS_MPS, 0 };
+    struct usb_endpoint_descriptor out_ep = { 7, USB_DESCRIPTOR_TYPE_ENDPOINT, MS_OUT_EP, USB_ENDPOINT_TYPE_BULK, MS_MPS, 0 };
+
+    CHECK(usbd_ep_open(&in_ep) == 0);
+    CHECK(usbd_ep_open(&out_ep) == 0);
+}
+
+// one IN transfer of @len bytes from @data, checked at the host
+static void ms_xfer_in(const uint8_t *data, uint32_t len, int take_chnl)
+{
+    uint32_t got = 0;
+    uint32_t loops = 0;
+    int n;
+
+    ms_in_done = 0xFFFFFFFF;
+    CHECK(usbd_ep_start_write(MS_IN_EP, data, len) == 0);
+    if (take_chnl) {
+        GDMACFG_TPYES_ST cfg;
+
+        /* a driver sets the channel up, the packet on it still finishes */
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.channel = CONFIG_USB_MUSB_GDMA_CHNL;
+        cfg.dstdat_width = 32;
+        cfg.srcdat_width = 32;
+        gdma_ctrl(CMD_GDMA_CFG_TYPE0, &cfg);
+    }
+
+    while (ms_in_done == 0xFFFFFFFF) {
+        CHECK(++loops < MS_LOOP_MAX);
+        ms_gdma_run();
+        n = ms_host_in(MS_IN_EP & 0x7F, ms_host_buf + got);
+        if (n < 0) {
+            continue;
+        }
+        CHECK(got + n <= len);
+        CHECK((n == MS_MPS) || (got + n == len));
+        got += n;
+        ms_usb_irq();
+    }
+
+    CHECK(ms_in_done == len);
+    CHECK(got == len);
+    CHECK(memcmp(ms_host_buf, data, len) == 0);
+}
+
+// one OUT transfer of @len bytes into @buf, sent by the host in packets
+static void ms_xfer_out(uint8_t *buf, uint32_t len, int take_chnl)
+{
+    uint32_t sent = 0;
+    uint32_t loops = 0;
+    uint32_t n;
+
+    ms_fill(ms_host_buf, len);
+    ms_out_done = 0xFFFFFFFF;
+    CHECK(usbd_ep_start_read(MS_OUT_EP, buf, len) == 0);
+
+    while (ms_out_done == 0xFFFFFFFF) {
+        CHECK(++loops < MS_LOOP_MAX);
+        n = MIN(len - sent, MS_MPS);
+        if (ms_host_out(MS_OUT_EP, ms_host_buf + sent, n) == 0) {
+            sent += n;
+            ms_usb_irq();
+            if (take_chnl) {
+                GDMACFG_TPYES_ST cfg;
+
+                memset(&cfg, 0, sizeof(cfg));
+                cfg.channel = CONFIG_USB_MUSB_GDMA_CHNL;
+                cfg.dstdat_width = 32;
+                cfg.srcdat_width = 32;
+                gdma_ctrl(CMD_GDMA_CFG_TYPE0, &cfg);
+                take_chnl = 0;
+            }
+        }
+        ms_gdma_run();
+    }
+
+    CHECK(ms_out_done == len);
+    CHECK(sent == len);
+    CHECK(memcmp(buf, ms_host_buf, len) == 0);
+}
+
+static void ms_random(uint32_t xfers)
+{
+    uint32_t len;
+    uint32_t align;
+
+    for (uint32_t i = 0; i < xfers; i++) {
+        len = rand_r(&ms_seed) % (MS_XFER_MAX + 1);
+        if ((rand_r(&ms_seed) & 3) == 0) {
+            len = (rand_r(&ms_seed) % 5) * MS_MPS;
+        }
+        align = rand_r(&ms_seed) & 3;
+
+        if (i & 1) {
+            ms_fill(ms_src + align, len);
+            ms_xfer_in(ms_src + align, len, 0);
+        } else {
+            memset(ms_dst, 0, sizeof(ms_dst));
+            /* an OUT transfer of n packets ends on a short one or the length */
+            ms_xfer_out(ms_dst + align, len ? len : 1, 0);
+        }
+    }
+}
+
+static void ms_reset_sim(void)
+{
+    memset(ms_usb, 0, sizeof(ms_usb));
+    memset(ms_ind, 0, sizeof(ms_ind));
+    memset(ms_fifo, 0, sizeof(ms_fifo));
+    memset(ms_gdma, 0, sizeof(ms_gdma));
+    memset(&ms_latch, 0, sizeof(ms_latch));
+    ms_txis = 0;
+    ms_rxis = 0;
+    ms_is = 0;
+    ms_gdma_status = 0;
+    gdma_init();
+    usbd_musb_clear_fifo_stats();
+}
+
+static void ms_get_stats(struct musb_fifo_stats *in, struct musb_fifo_stats *out)
+{
+    CHECK(usbd_musb_get_fifo_stats(MS_IN_EP, in) == 0);
+    CHECK(usbd_musb_get_fifo_stats(MS_OUT_EP, out) == 0);
+}
+
+/* ------------------------------------------------------------------ tests */
+
+static void ms_nop_fin(UINT32 param)
+{
+}
+
+static void ms_ownership(void)
+{
+    GDMACFG_TPYES_ST cfg;
+
+    ms_reset_sim();
+
+    CHECK(gdma_fifo_init(GDMA_CHANNEL_0, ms_nop_fin) == GDMA_FAILURE);
+    CHECK(gdma_fifo_init(GDMA_CHANNEL_MAX, ms_nop_fin) == GDMA_FAILURE);
+
+    /* a driver has channel 1 */
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.channel = GDMA_CHANNEL_1;
+    cfg.dstdat_width = 32;
+    cfg.srcdat_width = 32;
+    cfg.fin_handler = ms_nop_fin;
+    gdma_ctrl(CMD_GDMA_CFG_TYPE0, &cfg);
+    CHECK(gdma_fifo_init(GDMA_CHANNEL_1, ms_nop_fin) == GDMA_FAILURE);
+
+    CHECK(gdma_fifo_init(GDMA_CHANNEL_4, ms_nop_fin) == GDMA_SUCCESS);
+    CHECK(gdma_fifo_init(GDMA_CHANNEL_4, ms_nop_fin) == GDMA_FAILURE);
+    gdma_fifo_deinit(GDMA_CHANNEL_4);
+    CHECK(gdma_fifo_init(GDMA_CHANNEL_4, ms_nop_fin) == GDMA_SUCCESS);
+    CHECK(gdma_fifo_start(GDMA_CHANNEL_4, (volatile void *)(MS_USB_BASE + MS_FIFO_OFFSET + 4), ms_src, 64, 1) == GDMA_SUCCESS);
+    ms_gdma_run();
+    CHECK(ms_fifo[1].tx_len == 64);
+    CHECK(memcmp(ms_fifo[1].tx, ms_src, 64) == 0);
+    ms_fifo[1].tx_len = 0;
+    gdma_fifo_deinit(GDMA_CHANNEL_4);
+    CHECK(gdma_fifo_start(GDMA_CHANNEL_4, (volatile void *)(MS_USB_BASE + MS_FIFO_OFFSET + 4), ms_src, 64, 1) == GDMA_FAILURE);
+    CHECK(!gdma_fifo_busy(GDMA_CHANNEL_4));
+    printf("  ownership\n");
+}
+
+static void ms_transfers(uint32_t xfers)
+{
+    struct musb_fifo_stats in, out;
+    uint32_t runs;
+
+    ms_reset_sim();
+    CHECK(usb_dc_init() == 0);
+    ms_open_eps();
+
+    runs = ms_gdma_done;
+    ms_random(xfers);
+    ms_get_stats(&in, &out);
+    printf("  %u transfers: in %u by cpu, %u by dma (%u bounced), out %u by cpu, %u by dma (%u bounced)\n",
+           xfers, in.pio_bytes, in.dma_bytes, in.bounce_bytes, out.pio_bytes, out.dma_bytes, out.bounce_bytes);
+    CHECK(ms_gdma_done > runs);
+    CHECK(in.dma_bytes && in.bounce_bytes && in.pio_bytes);
+    CHECK(out.dma_bytes && out.bounce_bytes && out.pio_bytes);
+
+    CHECK(usb_dc_deinit() == 0);
+}
+
+// a driver set the channel up before usb_dc_init, all goes by cpu
+static void ms_refused(uint32_t xfers)
+{
+    GDMACFG_TPYES_ST cfg;
+    struct musb_fifo_stats in, out;
+
+    ms_reset_sim();
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.channel = CONFIG_USB_MUSB_GDMA_CHNL;
+    cfg.dstdat_width = 32;
+    cfg.srcdat_width = 32;
+    gdma_ctrl(CMD_GDMA_CFG_TYPE0, &cfg);
+
+    CHECK(usb_dc_init() == 0);
+    ms_open_eps();
+    ms_random(xfers);
+    ms_get_stats(&in, &out);
+    CHECK(in.dma_bytes == 0 && out.dma_bytes == 0);
+    CHECK(in.pio_bytes && out.pio_bytes);
+    CHECK(usb_dc_deinit() == 0);
+    printf("  refused channel: %u transfers by cpu\n", xfers);
+}
+
+// a driver takes the channel with a packet on it
+static void ms_takeover(int in_dir)
+{
+    struct musb_fifo_stats in, out;
+
+    ms_reset_sim();
+    CHECK(usb_dc_init() == 0);
+    ms_open_eps();
+
+    if (in_dir) {
+        ms_fill(ms_src, 4 * MS_MPS);
+        ms_xfer_in(ms_src, 4 * MS_MPS, 1);
+    } else {
+        ms_xfer_out(ms_dst, 4 * MS_MPS, 1);
+    }
+
+    ms_get_stats(&in, &out);
+    if (in_dir) {
+        CHECK(in.dma_bytes == MS_MPS);
+        CHECK(in.pio_bytes == 3 * MS_MPS);
+    } else {
+        CHECK(out.dma_bytes == MS_MPS);
+        CHECK(out.pio_bytes == 3 * MS_MPS);
+    }
+
+    /* and stays by cpu */
+    ms_random(8);
+    ms_get_stats(&in, &out);
+    CHECK(in.dma_bytes + out.dma_bytes == MS_MPS);
+    CHECK(usb_dc_deinit() == 0);
+    printf("  channel taken by a driver during an %s transfer\n", in_dir ? "in" : "out");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t xfers = argc > 1 ? atoi(argv[1]) : 2000;
+
+    ms_seed = argc > 2 ? atoi(argv[2]) : 1;
+
+    /* the gdma registers take 32 bit addresses */
+    CHECK(((uintptr_t)ms_src >> 32) == 0);
+    CHECK(((uintptr_t)ms_dst >> 32) == 0);
+
+    ms_ownership();
+    ms_transfers(xfers);
+    ms_refused(xfers / 10 + 2);
+    ms_takeover(1);
+    ms_takeover(0);
+
+    printf("ok\n");
+    return 0;
+}
+// eof
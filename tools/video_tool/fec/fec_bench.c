@@ -0,0 +1,196 @@
+/*
+ * Loss simulation for the udp video fec: frames are cut into packets the way
+ * video_transfer does, the firmware encoder adds the parity, a lossy channel
+ * drops packets and vfec_rx puts the frames back together. Prints the share
+ * of complete frames against the parity overhead for some k / m and losses.
+ *
+ *   fec_bench [frames] [seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include.h"
+#include "mem_pub.h"
+#include "video_fec.h"
+#include "vfec_rx.h"
+
+#define BENCH_HDR_SIZE              4
+#define BENCH_PAYLOAD               (VFEC_PKT_MAX - BENCH_HDR_SIZE)
+#define BENCH_FRAME_MIN             (15 * 1024)
+#define BENCH_FRAME_MAX             (45 * 1024)
+
+typedef struct
+{
+    const char *name;
+    double loss;                // random loss, or loss in the bad state
+    double p_gb;                // good to bad, 0 for random loss
+    double p_bg;                // bad to good
+} BENCH_CHAN_ST;
+
+typedef struct
+{
+    UINT32 seed;
+    UINT32 bad;                 // gilbert state
+    UINT8 frame[BENCH_FRAME_MAX];
+    UINT32 frame_len;
+    UINT32 frames_bad;          // complete but not the bytes sent
+} BENCH_ST;
+
+static UINT32 bench_rand(BENCH_ST *b)
+{
+    b->seed = b->seed * 1103515245 + 12345;
+    return b->seed >> 8;
+}
+
+static double bench_uniform(BENCH_ST *b)
+{
+    return (bench_rand(b) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static int bench_lost(BENCH_ST *b, const BENCH_CHAN_ST *chan)
+{
+    if (chan->p_gb == 0)
+    {
+        return bench_uniform(b) < chan->loss;
+    }
+
+    if (b->bad)
+    {
+        b->bad = !(bench_uniform(b) < chan->p_bg);
+    }
+    else
+    {
+        b->bad = bench_uniform(b) < chan->p_gb;
+    }
+    return b->bad && (bench_uniform(b) < chan->loss);
+}
+
+static void bench_frame_cb(void *arg, UINT32 id, const UINT8 *frame, UINT32 len, UINT32 recovered)
+{
+    BENCH_ST *b = (BENCH_ST *)arg;
+
+    (void)id;
+    (void)recovered;
+    if ((len != b->frame_len) || memcmp(frame, b->frame, len))
+    {
+        b->frames_bad++;
+    }
+}
+
+static void bench_run(UINT32 frames, UINT32 seed, UINT32 k, UINT32 m, const BENCH_CHAN_ST *chan)
+{
+    static BENCH_ST b;
+    VFEC_ENC_ST enc;
+    VFEC_RX_ST rx;
+    UINT8 pkt[VFEC_PKT_MAX];
+    UINT8 *parity;
+    UINT32 f, i, seq, cnt, off, len, plen;
+    UINT32 data_bytes = 0, sent = 0, lost = 0;
+
+    memset(&b, 0, sizeof(b));
+    b.seed = seed;
+    vfec_enc_init(&enc);
+    vfec_enc_config(&enc, k, m);
+    vfec_rx_init(&rx, BENCH_HDR_SIZE, bench_frame_cb, &b);
+
+    for (f = 0; f < frames; f++)
+    {
+        b.frame_len = BENCH_FRAME_MIN + bench_rand(&b) % (BENCH_FRAME_MAX - BENCH_FRAME_MIN);
+        for (i = 0; i < b.frame_len; i++)
+        {
+            b.frame[i] = bench_rand(&b);
+        }
+        cnt = (b.frame_len + BENCH_PAYLOAD - 1) / BENCH_PAYLOAD;
+
+        for (seq = 1, off = 0; seq <= cnt; seq++, off += len)
+        {
+            len = b.frame_len - off;
+            if (len > BENCH_PAYLOAD)
+            {
+                len = BENCH_PAYLOAD;
+            }
+
+            // header as app_demo_add_pkt_header writes it
+            pkt[0] = f & 0xFF;
+            pkt[1] = (seq == cnt);
+            pkt[2] = (seq == cnt) ? cnt : 0;
+            pkt[3] = seq;
+            memcpy(pkt + BENCH_HDR_SIZE, b.frame + off, len);
+
+            data_bytes += BENCH_HDR_SIZE + len;
+            sent++;
+            if (bench_lost(&b, chan))
+            {
+                lost++;
+            }
+            else
+            {
+                vfec_rx_input(&rx, pkt, BENCH_HDR_SIZE + len);
+            }
+
+            if (!vfec_enc_input(&enc, pkt[0], seq, pkt[1], pkt, BENCH_HDR_SIZE + len))
+            {
+                continue;
+            }
+            for (i = 0; i < enc.m; i++)
+            {
+                plen = vfec_enc_parity(&enc, i, &parity);
+                enc.stats.parity_pkts++;
+                enc.stats.parity_bytes += plen;
+                sent++;
+                if (bench_lost(&b, chan))
+                {
+                    lost++;
+                }
+                else
+                {
+                    vfec_rx_input(&rx, parity, plen);
+                }
+            }
+        }
+    }
+    vfec_rx_flush(&rx);
+
+    printf("%-10s k=%-2u m=%u  overhead %5.1f%%  loss %5.2f%%  frames ok %6.2f%%"
+           "  recovered pkts %6u  frames %6u  failed blocks %5u%s\n",
+           chan->name, k, m, 100.0 * enc.stats.parity_bytes / data_bytes,
+           100.0 * lost / sent, 100.0 * rx.stats.frames_ok / frames,
+           rx.stats.pkts_recovered, rx.stats.frames_recovered, rx.stats.blocks_failed,
+           b.frames_bad ? "  CORRUPT" : "");
+
+    vfec_rx_deinit(&rx);
+    vfec_enc_deinit(&enc);
+}
+
+int main(int argc, char **argv)
+{
+    static const BENCH_CHAN_ST chans[] =
+    {
+        {"rand 1%",   0.01, 0,    0},
+        {"rand 3%",   0.03, 0,    0},
+        {"rand 5%",   0.05, 0,    0},
+        {"rand 10%",  0.10, 0,    0},
+        // 5% of the time in bursts of 4 packets on average
+        {"burst 5%",  1.00, 0.013, 0.25},
+    };
+    static const UINT8 cfgs[][2] =
+    {
+        {8, 0}, {16, 1}, {8, 1}, {4, 1}, {16, 2}, {8, 2}, {16, 4}, {8, 4},
+    };
+    UINT32 frames = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+    UINT32 seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+    UINT32 c, i;
+
+    for (c = 0; c < sizeof(chans) / sizeof(chans[0]); c++)
+    {
+        for (i = 0; i < sizeof(cfgs) / sizeof(cfgs[0]); i++)
+        {
+            bench_run(frames, seed, cfgs[i][0], cfgs[i][1], &chans[c]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+// eof
@@ -0,0 +1,17 @@
+#ifndef __VFEC_HOST_INCLUDE_H__
+#define __VFEC_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, lets app/video_work/video_fec.c build on a pc
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int32_t INT32;
+
+#define CFG_USE_APP_DEMO_VIDEO_TRANSFER   1
+#define VFEC_DECODER                      1
+
+#endif
+// eof
@@ -0,0 +1,14 @@
+#ifndef __VFEC_HOST_MEM_PUB_H__
+#define __VFEC_HOST_MEM_PUB_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+#define os_memset                         memset
+#define os_memcpy                         memcpy
+#define os_memcmp                         memcmp
+#define os_malloc                         malloc
+#define os_free                           free
+
+#endif
+// eof
@@ -0,0 +1,389 @@
+/*
+ * Loss simulation for the udp video nack: the firmware retransmit cache and
+ * the sender behaviour of video_transfer_udp.c (asked packets go out after
+ * the next data packet) against vfec_rx with a receiver that asks for the
+ * missing packets. Both ways are lossy and delayed. Prints complete frames
+ * per second and how many of them were saved by a resent packet.
+ *
+ *   nack_bench [seconds] [seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "include.h"
+#include "mem_pub.h"
+#include "video_rtx.h"
+#include "vfec_rx.h"
+
+#define BENCH_HDR_SIZE              4
+#define BENCH_PAYLOAD               (VRTX_PKT_MAX - BENCH_HDR_SIZE)
+#define BENCH_FRAME_MIN             (15 * 1024)
+#define BENCH_FRAME_MAX             (45 * 1024)
+#define BENCH_FPS                   20
+#define BENCH_PKT_US                1000        // 1472 bytes at about 12 Mbit/s
+#define BENCH_DELAY_US              4000        // one way
+#define BENCH_TICK_US               5000        // receiver looks for gaps
+#define BENCH_QUEUE                 1024
+#define BENCH_REQ_MAX               32          // APP_DEMO_UDP_RTX_REQ_MAX
+#define BENCH_NACK_MAX              64          // pkt_seq per nack message
+#define BENCH_NACK_TRIES            3
+#define BENCH_RENACK_US             30000       // asked packets wait for the next data packet
+
+typedef struct
+{
+    const char *name;
+    double loss;
+    double p_gb;                // good to bad, 0 for random loss
+    double p_bg;
+} BENCH_CHAN_ST;
+
+typedef struct
+{
+    UINT32 at;
+    UINT16 len;
+    UINT8 resent;
+    UINT8 data[VRTX_PKT_MAX];
+} BENCH_PKT_ST;
+
+typedef struct
+{
+    UINT32 seed;
+    UINT32 bad;
+    const BENCH_CHAN_ST *chan;
+
+    // sender
+    VRTX_ST rtx;
+    UINT32 nack_on;
+    UINT32 link_at;             // link busy until
+    UINT16 req[BENCH_REQ_MAX];
+    UINT32 req_rd, req_wr;
+    UINT32 data_bytes, resent_bytes;
+
+    // sender to receiver, and nacks back
+    BENCH_PKT_ST fwd[BENCH_QUEUE];
+    UINT32 fwd_rd, fwd_wr;
+    BENCH_PKT_ST rev[BENCH_QUEUE];
+    UINT32 rev_rd, rev_wr;
+
+    // receiver
+    VFEC_RX_ST rx;
+    UINT32 nack_at[256][256];
+    UINT8 nack_cnt[256][256];
+    UINT8 used_rtx[256];
+    UINT32 frames_rtx;
+    UINT32 nacks_sent;
+    UINT32 resent_useless;      // came twice or too late
+} BENCH_ST;
+
+static UINT32 bench_rand(BENCH_ST *b)
+{
+    b->seed = b->seed * 1103515245 + 12345;
+    return b->seed >> 8;
+}
+
+static double bench_uniform(BENCH_ST *b)
+{
+    return (bench_rand(b) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static int bench_lost(BENCH_ST *b)
+{
+    const BENCH_CHAN_ST *chan = b->chan;
+
+    if (chan->p_gb == 0)
+    {
+        return bench_uniform(b) < chan->loss;
+    }
+
+    if (b->bad)
+    {
+        b->bad = !(bench_uniform(b) < chan->p_bg);
+    }
+    else
+    {
+        b->bad = bench_uniform(b) < chan->p_gb;
+    }
+    return b->bad && (bench_uniform(b) < chan->loss);
+}
+
+static void bench_queue(BENCH_PKT_ST *q, UINT32 *wr, UINT32 at, const UINT8 *data,
+                        UINT32 len, UINT32 resent)
+{
+    BENCH_PKT_ST *p = &q[*wr % BENCH_QUEUE];
+
+    p->at = at;
+    p->len = len;
+    p->resent = resent;
+    memcpy(p->data, data, len);
+    (*wr)++;
+}
+
+// one packet on the air, lost or on its way
+static void bench_xmit(BENCH_ST *b, const UINT8 *data, UINT32 len, UINT32 resent)
+{
+    b->link_at += BENCH_PKT_US;
+    if (!bench_lost(b))
+    {
+        bench_queue(b->fwd, &b->fwd_wr, b->link_at + BENCH_DELAY_US, data, len, resent);
+    }
+}
+
+// app_demo_udp_send_packet and app_demo_udp_rtx_sent
+static void bench_send(BENCH_ST *b, const UINT8 *pkt, UINT32 len)
+{
+    UINT32 req, plen;
+    UINT8 *data;
+
+    bench_xmit(b, pkt, len, 0);
+    b->data_bytes += len;
+    if (!b->nack_on)
+    {
+        return;
+    }
+
+    vrtx_put(&b->rtx, pkt, len);
+    while (b->req_rd != b->req_wr)
+    {
+        req = b->req[b->req_rd++ % BENCH_REQ_MAX];
+        plen = vrtx_find(&b->rtx, req >> 8, req & 0xFF, &data);
+        if (plen)
+        {
+            bench_xmit(b, data, plen, 1);
+            b->resent_bytes += plen;
+            b->rtx.stats.resent++;
+        }
+    }
+}
+
+// app_demo_udp_nack
+static void bench_nack_in(BENCH_ST *b, const UINT8 *data, UINT32 len)
+{
+    UINT32 i;
+
+    for (i = 0; i < data[3]; i++)
+    {
+        if (b->req_wr - b->req_rd >= BENCH_REQ_MAX)
+        {
+            b->rtx.stats.req_dropped++;
+            continue;
+        }
+        b->req[b->req_wr++ % BENCH_REQ_MAX] = (data[2] << 8) | data[4 + i];
+    }
+}
+
+static void bench_frame_cb(void *arg, UINT32 id, const UINT8 *frame, UINT32 len, UINT32 recovered)
+{
+    BENCH_ST *b = (BENCH_ST *)arg;
+
+    (void)frame;
+    (void)len;
+    (void)recovered;
+    if (b->used_rtx[id])
+    {
+        b->frames_rtx++;
+    }
+}
+
+// ask again for what is still missing, not before a round trip went by
+static void bench_nack_out(BENCH_ST *b, UINT32 now)
+{
+    UINT16 list[BENCH_NACK_MAX * 2];
+    UINT8 msg[4 + BENCH_NACK_MAX];
+    UINT32 cnt, i, id, seq;
+
+    if (!b->nack_on)
+    {
+        return;
+    }
+
+    cnt = vfec_rx_missing(&b->rx, list, BENCH_NACK_MAX * 2);
+    msg[3] = 0;
+    for (i = 0; i <= cnt; i++)
+    {
+        id = (i < cnt) ? (list[i] >> 8) : 0x100;
+        if (msg[3] && ((id != msg[2]) || (msg[3] == BENCH_NACK_MAX)))
+        {
+            b->nacks_sent++;
+            if (!bench_lost(b))
+            {
+                bench_queue(b->rev, &b->rev_wr, now + BENCH_DELAY_US, msg, 4 + msg[3], 0);
+            }
+            msg[3] = 0;
+        }
+        if (i == cnt)
+        {
+            break;
+        }
+
+        seq = list[i] & 0xFF;
+        if ((b->nack_cnt[id][seq] >= BENCH_NACK_TRIES)
+                || (b->nack_cnt[id][seq] && (now - b->nack_at[id][seq] < BENCH_RENACK_US)))
+        {
+            continue;
+        }
+        b->nack_cnt[id][seq]++;
+        b->nack_at[id][seq] = now;
+
+        msg[0] = 0x20;          // CMD_IMG_HEADER
+        msg[1] = 0x3A;          // CMD_NACK
+        msg[2] = id;
+        msg[4 + msg[3]++] = seq;
+    }
+}
+
+static void bench_rx(BENCH_ST *b, BENCH_PKT_ST *p)
+{
+    UINT32 old = b->rx.stats.dup_pkts + b->rx.stats.late_pkts;
+    UINT32 newest = b->rx.started ? b->rx.newest : 0x100;
+
+    // the frame callback runs inside, so count it first and take it back when useless
+    b->used_rtx[p->data[0]] += p->resent;
+    vfec_rx_input(&b->rx, p->data, p->len);
+    if (b->rx.newest != newest)
+    {
+        // frame ids come round again
+        memset(b->nack_cnt[b->rx.newest], 0, sizeof(b->nack_cnt[0]));
+    }
+    if (p->resent && (old != b->rx.stats.dup_pkts + b->rx.stats.late_pkts))
+    {
+        b->used_rtx[p->data[0]]--;
+        b->resent_useless++;
+    }
+}
+
+static void bench_run(UINT32 secs, UINT32 seed, UINT32 nack_on, UINT32 slots,
+                      const BENCH_CHAN_ST *chan)
+{
+    static BENCH_ST b;
+    static UINT8 frame[BENCH_FRAME_MAX];
+    UINT8 pkt[VRTX_PKT_MAX];
+    UINT32 frames = secs * BENCH_FPS;
+    UINT32 f = 0, seq = 1, cnt = 0, off = 0, len, frame_len = 0, i;
+    UINT32 t, t_frame, t_tick = 0;
+    BENCH_PKT_ST *fwd, *rev;
+
+    memset(&b, 0, sizeof(b));
+    b.seed = seed;
+    b.chan = chan;
+    b.nack_on = nack_on;
+    vrtx_init(&b.rtx, slots, 2);
+    vfec_rx_init(&b.rx, BENCH_HDR_SIZE, bench_frame_cb, &b);
+
+    while (1)
+    {
+        t_frame = f * (1000000 / BENCH_FPS);
+        fwd = (b.fwd_rd != b.fwd_wr) ? &b.fwd[b.fwd_rd % BENCH_QUEUE] : NULL;
+        rev = (b.rev_rd != b.rev_wr) ? &b.rev[b.rev_rd % BENCH_QUEUE] : NULL;
+
+        // earliest of: next frame, next packet of this frame, arrivals, receiver tick
+        t = t_tick;
+        if (fwd && (fwd->at < t))
+        {
+            t = fwd->at;
+        }
+        if (rev && (rev->at < t))
+        {
+            t = rev->at;
+        }
+        if ((seq <= cnt) && (b.link_at < t))
+        {
+            t = b.link_at;
+        }
+        if (t_frame <= t)
+        {
+            if (f == frames)
+            {
+                break;
+            }
+
+            // next frame from the camera, what is left of the last one is dropped
+            frame_len = BENCH_FRAME_MIN + bench_rand(&b) % (BENCH_FRAME_MAX - BENCH_FRAME_MIN);
+            for (i = 0; i < frame_len; i++)
+            {
+                frame[i] = bench_rand(&b);
+            }
+            cnt = (frame_len + BENCH_PAYLOAD - 1) / BENCH_PAYLOAD;
+            seq = 1;
+            off = 0;
+            b.used_rtx[f & 0xFF] = 0;
+            if (b.link_at < t_frame)
+            {
+                b.link_at = t_frame;
+            }
+            f++;
+        }
+        else if ((seq <= cnt) && (t == b.link_at))
+        {
+            len = frame_len - off;
+            if (len > BENCH_PAYLOAD)
+            {
+                len = BENCH_PAYLOAD;
+            }
+
+            // header as app_demo_add_pkt_header writes it
+            pkt[0] = (f - 1) & 0xFF;
+            pkt[1] = (seq == cnt);
+            pkt[2] = (seq == cnt) ? cnt : 0;
+            pkt[3] = seq;
+            memcpy(pkt + BENCH_HDR_SIZE, frame + off, len);
+            bench_send(&b, pkt, BENCH_HDR_SIZE + len);
+
+            seq++;
+            off += len;
+        }
+        else if (rev && (t == rev->at))
+        {
+            b.rev_rd++;
+            bench_nack_in(&b, rev->data, rev->len);
+        }
+        else if (fwd && (t == fwd->at))
+        {
+            b.fwd_rd++;
+            bench_rx(&b, fwd);
+            bench_nack_out(&b, t);
+        }
+        else
+        {
+            bench_nack_out(&b, t);
+            t_tick += BENCH_TICK_US;
+        }
+    }
+    vfec_rx_flush(&b.rx);
+
+    printf("%-10s %-12s loss %5.2f%%  ok %5.2f fps of %u  by resend %5.2f fps"
+           "  resent %5.1f%% (useless %4u)  nacks %6u  cache misses %5u\n",
+           chan->name, !nack_on ? "no nack" : (slots < 48) ? "nack 24 pkts" : "nack 64 pkts",
+           100.0 * chan->loss * (chan->p_gb ? chan->p_gb / (chan->p_gb + chan->p_bg) : 1),
+           (double)b.rx.stats.frames_ok / secs, BENCH_FPS, (double)b.frames_rtx / secs,
+           100.0 * b.resent_bytes / b.data_bytes, b.resent_useless, b.nacks_sent, b.rtx.stats.missed);
+
+    vfec_rx_deinit(&b.rx);
+    vrtx_deinit(&b.rtx);
+}
+
+int main(int argc, char **argv)
+{
+    static const BENCH_CHAN_ST chans[] =
+    {
+        {"rand 1%",   0.01, 0,    0},
+        {"rand 3%",   0.03, 0,    0},
+        {"rand 5%",   0.05, 0,    0},
+        {"rand 10%",  0.10, 0,    0},
+        {"burst 5%",  1.00, 0.013, 0.25},
+    };
+    UINT32 secs = (argc > 1) ? strtoul(argv[1], NULL, 0) : 60;
+    UINT32 seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+    UINT32 c;
+
+    for (c = 0; c < sizeof(chans) / sizeof(chans[0]); c++)
+    {
+        bench_run(secs, seed, 0, 24, &chans[c]);
+        bench_run(secs, seed, 1, 24, &chans[c]);
+        bench_run(secs, seed, 1, 64, &chans[c]);
+        printf("\n");
+    }
+
+    return 0;
+}
+// eof
@@ -0,0 +1,238 @@
+/*
+ * Live udp video receiver that asks the board for lost packets. Starts the
+ * stream like the pc tool, drops a share of the packets on purpose when -l
+ * is given, puts the frames together with vfec_rx and sends CMD_NACK to the
+ * command port for what is missing. Prints the frame rate every second.
+ *
+ *   nack_rx [-l loss%] [-n] [-t seconds] [-d] board_ip
+ *     -n  no nacks, to compare
+ *     -d  ports and header of the SUPPORT_TIANZHIHENG_DRONE build
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "include.h"
+#include "vfec_rx.h"
+
+#define RX_NACK_MAX                 64
+#define RX_NACK_TRIES               3
+#define RX_RENACK_US                30000
+#define RX_TICK_US                  5000
+
+typedef struct
+{
+    int fd;
+    struct sockaddr_in img;
+    struct sockaddr_in cmd;
+    UINT8 cmd_hdr;
+    UINT8 cmd_start;
+    UINT8 cmd_stop;
+
+    VFEC_RX_ST rx;
+    UINT32 nack_on;
+    UINT32 nack_at[256][256];
+    UINT8 nack_cnt[256][256];
+    UINT32 nacks;
+    UINT32 dropped;
+    UINT32 frames;
+    UINT32 bytes;
+} RX_ST;
+
+static UINT32 rx_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void rx_frame_cb(void *arg, UINT32 id, const UINT8 *frame, UINT32 len, UINT32 recovered)
+{
+    RX_ST *r = (RX_ST *)arg;
+
+    (void)id;
+    (void)frame;
+    (void)recovered;
+    r->frames++;
+    r->bytes += len;
+}
+
+static void rx_cmd(RX_ST *r, struct sockaddr_in *to, const UINT8 *msg, UINT32 len)
+{
+    sendto(r->fd, msg, len, 0, (struct sockaddr *)to, sizeof(*to));
+}
+
+// CMD_IMG_HEADER, CMD_NACK, frame id, count, pkt_seq...
+static void rx_nack(RX_ST *r, UINT32 now)
+{
+    UINT16 list[RX_NACK_MAX * 2];
+    UINT8 msg[4 + RX_NACK_MAX];
+    UINT32 cnt, i, id, seq;
+
+    cnt = vfec_rx_missing(&r->rx, list, RX_NACK_MAX * 2);
+    msg[3] = 0;
+    for (i = 0; i <= cnt; i++)
+    {
+        id = (i < cnt) ? (list[i] >> 8) : 0x100;
+        if (msg[3] && ((id != msg[2]) || (msg[3] == RX_NACK_MAX)))
+        {
+            rx_cmd(r, &r->cmd, msg, 4 + msg[3]);
+            r->nacks++;
+            msg[3] = 0;
+        }
+        if (i == cnt)
+        {
+            break;
+        }
+
+        seq = list[i] & 0xFF;
+        if ((r->nack_cnt[id][seq] >= RX_NACK_TRIES)
+                || (r->nack_cnt[id][seq] && (now - r->nack_at[id][seq] < RX_RENACK_US)))
+        {
+            continue;
+        }
+        r->nack_cnt[id][seq]++;
+        r->nack_at[id][seq] = now;
+
+        msg[0] = r->cmd_hdr;
+        msg[1] = 0x3A;
+        msg[2] = id;
+        msg[4 + msg[3]++] = seq;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static RX_ST r;
+    UINT8 buf[2048], msg[4];
+    double loss = 0;
+    UINT32 secs = 10, drone = 0, now, start, sec_at, tick_at, last_frames = 0;
+    UINT32 newest, started;
+    struct timeval tv;
+    fd_set fds;
+    int opt, len;
+
+    r.nack_on = 1;
+    while ((opt = getopt(argc, argv, "l:nt:d")) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            loss = atof(optarg) / 100;
+            break;
+        case 'n':
+            r.nack_on = 0;
+            break;
+        case 't':
+            secs = strtoul(optarg, NULL, 0);
+            break;
+        case 'd':
+            drone = 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l loss%%] [-n] [-t seconds] [-d] board_ip\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-l loss%%] [-n] [-t seconds] [-d] board_ip\n", argv[0]);
+        return 1;
+    }
+
+    // video_transfer_config.h
+    r.img.sin_family = AF_INET;
+    r.img.sin_addr.s_addr = inet_addr(argv[optind]);
+    r.img.sin_port = htons(drone ? 8080 : 7080);
+    r.cmd = r.img;
+    r.cmd.sin_port = htons(drone ? 8090 : 7090);
+    r.cmd_hdr = drone ? 0x42 : 0x20;
+    r.cmd_start = drone ? 0x76 : 0x36;
+    r.cmd_stop = drone ? 0x77 : 0x37;
+
+    r.fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if ((r.fd < 0) || vfec_rx_init(&r.rx, drone ? 8 : 4, rx_frame_cb, &r))
+    {
+        perror("init");
+        return 1;
+    }
+    srand(time(NULL));
+
+    msg[0] = r.cmd_hdr;
+    msg[1] = r.cmd_start;
+    rx_cmd(&r, &r.img, msg, 2);
+    if (r.nack_on)
+    {
+        // empty nack, the board takes its retransmit cache
+        msg[1] = 0x3A;
+        msg[2] = 0;
+        msg[3] = 0;
+        rx_cmd(&r, &r.cmd, msg, 4);
+    }
+
+    start = sec_at = tick_at = rx_now_us();
+    while ((now = rx_now_us()) - start < secs * 1000000)
+    {
+        FD_ZERO(&fds);
+        FD_SET(r.fd, &fds);
+        tv.tv_sec = 0;
+        tv.tv_usec = RX_TICK_US;
+        if ((select(r.fd + 1, &fds, NULL, NULL, &tv) > 0)
+                && ((len = recv(r.fd, buf, sizeof(buf), 0)) > 0))
+        {
+            if (rand() < loss * RAND_MAX)
+            {
+                r.dropped++;
+            }
+            else
+            {
+                newest = r.rx.newest;
+                started = r.rx.started;
+                vfec_rx_input(&r.rx, buf, len);
+                if (!started || (r.rx.newest != newest))
+                {
+                    // frame ids come round again
+                    memset(r.nack_cnt[r.rx.newest], 0, sizeof(r.nack_cnt[0]));
+                }
+            }
+        }
+
+        now = rx_now_us();
+        if (r.nack_on && (now - tick_at >= RX_TICK_US))
+        {
+            rx_nack(&r, now);
+            tick_at = now;
+        }
+        if (now - sec_at >= 1000000)
+        {
+            printf("%u fps  %u kB/s  dropped %u  fec rebuilt %u  nacks %u  lost frames %u\n",
+                   r.frames - last_frames, r.bytes / 1024, r.dropped,
+                   r.rx.stats.pkts_recovered, r.nacks, r.rx.stats.frames_lost);
+            last_frames = r.frames;
+            r.bytes = 0;
+            sec_at = now;
+        }
+    }
+
+    msg[0] = r.cmd_hdr;
+    msg[1] = r.cmd_stop;
+    rx_cmd(&r, &r.img, msg, 2);
+    vfec_rx_flush(&r.rx);
+
+    printf("total: %u frames ok, %u lost, %u packets dropped, %u nacks\n",
+           r.rx.stats.frames_ok, r.rx.stats.frames_lost, r.dropped, r.nacks);
+
+    vfec_rx_deinit(&r.rx);
+    close(r.fd);
+
+    return 0;
+}
+// eof
@@ -0,0 +1,423 @@
+#include "include.h"
+#include "mem_pub.h"
+
+#include "vfec_rx.h"
+
+#define VFEC_RX_UNIT(f, seq)        ((f)->unit + (seq) * VFEC_UNIT_MAX)
+#define VFEC_RX_PARITY(f, fs, j)    ((f)->parity + ((fs) * VFEC_M_MAX + (j)) * VFEC_UNIT_MAX)
+
+int vfec_rx_init(VFEC_RX_PTR rx, UINT32 hdr_size, vfec_rx_frame_cb cb, void *arg)
+{
+    VFEC_RX_FRAME_PTR f;
+    UINT32 i;
+
+    os_memset(rx, 0, sizeof(VFEC_RX_ST));
+    vfec_gf_init();
+
+    rx->hdr_size = hdr_size;
+    rx->cb = cb;
+    rx->arg = arg;
+
+    rx->out = (UINT8 *)os_malloc(VFEC_RX_SEQ_MAX * VFEC_PKT_MAX);
+    if (rx->out == NULL)
+    {
+        return -1;
+    }
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        f = &rx->frame[i];
+        f->unit = (UINT8 *)os_malloc(VFEC_RX_SEQ_MAX * VFEC_UNIT_MAX);
+        f->parity = (UINT8 *)os_malloc(VFEC_RX_SEQ_MAX * VFEC_M_MAX * VFEC_UNIT_MAX);
+        if ((f->unit == NULL) || (f->parity == NULL))
+        {
+            vfec_rx_deinit(rx);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void vfec_rx_deinit(VFEC_RX_PTR rx)
+{
+    UINT32 i;
+
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        os_free(rx->frame[i].unit);
+        os_free(rx->frame[i].parity);
+        rx->frame[i].unit = NULL;
+        rx->frame[i].parity = NULL;
+        rx->frame[i].open = 0;
+    }
+    os_free(rx->out);
+    rx->out = NULL;
+}
+
+// frame goes away, lost when it was not handed over
+static void vfec_rx_close(VFEC_RX_PTR rx, VFEC_RX_FRAME_PTR f)
+{
+    UINT32 fs;
+
+    if (!f->open)
+    {
+        return;
+    }
+
+    if (!f->done)
+    {
+        for (fs = 1; fs < VFEC_RX_SEQ_MAX; fs++)
+        {
+            if (f->blk[fs].mask && !f->blk[fs].done)
+            {
+                rx->stats.blocks_failed++;
+            }
+        }
+        rx->stats.frames_lost++;
+    }
+    f->open = 0;
+}
+
+static VFEC_RX_FRAME_PTR vfec_rx_frame(VFEC_RX_PTR rx, UINT8 id)
+{
+    VFEC_RX_FRAME_PTR f = NULL;
+    UINT32 i;
+    INT32 ahead;
+
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        if (rx->frame[i].open && (rx->frame[i].id == id))
+        {
+            return &rx->frame[i];
+        }
+    }
+
+    ahead = (signed char)(id - rx->newest);
+    if (rx->started)
+    {
+        if (ahead <= 0)
+        {
+            rx->stats.late_pkts++;
+            return NULL;
+        }
+        // frames in between never showed up
+        rx->stats.frames_lost += ahead - 1;
+    }
+
+    // free slot, or the oldest frame
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        if (!rx->frame[i].open)
+        {
+            f = &rx->frame[i];
+            break;
+        }
+        if ((f == NULL) || ((UINT8)(id - rx->frame[i].id) > (UINT8)(id - f->id)))
+        {
+            f = &rx->frame[i];
+        }
+    }
+    vfec_rx_close(rx, f);
+
+    f->open = 1;
+    f->id = id;
+    f->done = 0;
+    f->max_seq = 0;
+    f->total = 0;
+    f->recovered = 0;
+    os_memset(f->have, 0, sizeof(f->have));
+    os_memset(f->blk, 0, sizeof(f->blk));
+
+    rx->newest = id;
+    rx->started = 1;
+
+    return f;
+}
+
+// the eof packet is the last one, its pkt_seq is the packet count
+static void vfec_rx_mark(VFEC_RX_FRAME_PTR f, UINT32 seq, const UINT8 *pkt)
+{
+    f->have[seq] = 1;
+    if (seq > f->max_seq)
+    {
+        f->max_seq = seq;
+    }
+    if (pkt[1] == 1)
+    {
+        f->total = seq;
+    }
+}
+
+static void vfec_rx_store(VFEC_RX_FRAME_PTR f, UINT32 seq, const UINT8 *pkt, UINT32 len)
+{
+    UINT8 *unit = VFEC_RX_UNIT(f, seq);
+
+    // same coded unit as the sender, zeros behind so the decoder can use it
+    unit[0] = len & 0xFF;
+    unit[1] = len >> 8;
+    os_memcpy(unit + 2, pkt, len);
+    os_memset(unit + 2 + len, 0, VFEC_UNIT_MAX - 2 - len);
+
+    vfec_rx_mark(f, seq, pkt);
+}
+
+static void vfec_rx_decode(VFEC_RX_PTR rx, VFEC_RX_FRAME_PTR f, UINT32 fs)
+{
+    VFEC_RX_BLK_ST *blk = &f->blk[fs];
+    UINT8 *unit[VFEC_K_MAX], *parity[VFEC_M_MAX];
+    UINT32 have_mask = 0, miss = 0, cnt = 0;
+    UINT32 i, j, plen;
+    UINT8 *u;
+
+    if ((blk->mask == 0) || blk->done)
+    {
+        return;
+    }
+
+    for (i = 0; i < blk->k; i++)
+    {
+        unit[i] = VFEC_RX_UNIT(f, fs + i);
+        if (f->have[fs + i])
+        {
+            have_mask |= 1 << i;
+        }
+        else
+        {
+            miss++;
+        }
+    }
+    for (j = 0; j < VFEC_M_MAX; j++)
+    {
+        parity[j] = VFEC_RX_PARITY(f, fs, j);
+        if (blk->mask & (1 << j))
+        {
+            cnt++;
+        }
+    }
+
+    if (miss == 0)
+    {
+        blk->done = 1;
+        return;
+    }
+    if ((miss > cnt) || vfec_decode(unit, have_mask, parity, blk->mask, blk->k, blk->len))
+    {
+        // wait for more packets of the block
+        return;
+    }
+    blk->done = 1;
+
+    for (i = 0; i < blk->k; i++)
+    {
+        if (have_mask & (1 << i))
+        {
+            continue;
+        }
+
+        u = unit[i];
+        plen = u[0] | (u[1] << 8);
+        if ((plen < rx->hdr_size) || (plen + 2 > blk->len) || (u[2] != f->id))
+        {
+            rx->stats.blocks_failed++;
+            continue;
+        }
+        os_memset(u + 2 + plen, 0, VFEC_UNIT_MAX - 2 - plen);
+        vfec_rx_mark(f, fs + i, u + 2);
+        rx->stats.pkts_recovered++;
+        f->recovered++;
+    }
+}
+
+static void vfec_rx_complete(VFEC_RX_PTR rx, VFEC_RX_FRAME_PTR f)
+{
+    UINT32 seq, plen, len = 0, i;
+    UINT8 *u;
+
+    if (f->done || (f->total == 0))
+    {
+        return;
+    }
+    for (seq = 1; seq <= f->total; seq++)
+    {
+        if (!f->have[seq])
+        {
+            return;
+        }
+    }
+
+    for (seq = 1; seq <= f->total; seq++)
+    {
+        u = VFEC_RX_UNIT(f, seq);
+        plen = (u[0] | (u[1] << 8)) - rx->hdr_size;
+        os_memcpy(rx->out + len, u + 2 + rx->hdr_size, plen);
+        len += plen;
+    }
+
+    f->done = 1;
+    rx->stats.frames_ok++;
+    if (f->recovered)
+    {
+        rx->stats.frames_recovered++;
+    }
+    if (rx->cb)
+    {
+        rx->cb(rx->arg, f->id, rx->out, len, f->recovered);
+    }
+
+    // older frames would be shown out of order now, give them up
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        if (rx->frame[i].open && ((signed char)(rx->frame[i].id - f->id) < 0))
+        {
+            vfec_rx_close(rx, &rx->frame[i]);
+        }
+    }
+}
+
+static void vfec_rx_parity(VFEC_RX_PTR rx, const UINT8 *pkt, UINT32 len)
+{
+    VFEC_HDR_PTR hdr = (VFEC_HDR_PTR)pkt;
+    VFEC_RX_FRAME_PTR f;
+    VFEC_RX_BLK_ST *blk;
+    UINT32 idx = hdr->flag & ~VFEC_PARITY_FLAG;
+    UINT32 ulen = hdr->len[0] | (hdr->len[1] << 8);
+
+    if ((len < VFEC_HDR_SIZE) || (ulen != len - VFEC_HDR_SIZE) || (ulen > VFEC_UNIT_MAX)
+            || (idx >= VFEC_M_MAX) || (hdr->k == 0) || (hdr->k > VFEC_K_MAX)
+            || (hdr->first_seq == 0) || (hdr->first_seq + hdr->k > VFEC_RX_SEQ_MAX))
+    {
+        rx->stats.bad_pkts++;
+        return;
+    }
+    rx->stats.parity_pkts++;
+
+    f = vfec_rx_frame(rx, hdr->id);
+    if (f == NULL)
+    {
+        return;
+    }
+
+    blk = &f->blk[hdr->first_seq];
+    if (blk->mask == 0)
+    {
+        blk->k = hdr->k;
+        blk->m = hdr->m;
+        blk->len = ulen;
+    }
+    else if ((blk->k != hdr->k) || (blk->len != ulen))
+    {
+        rx->stats.bad_pkts++;
+        return;
+    }
+    if (f->done || blk->done || (blk->mask & (1 << idx)))
+    {
+        return;
+    }
+
+    os_memcpy(VFEC_RX_PARITY(f, hdr->first_seq, idx), pkt + VFEC_HDR_SIZE, ulen);
+    blk->mask |= 1 << idx;
+
+    vfec_rx_decode(rx, f, hdr->first_seq);
+    vfec_rx_complete(rx, f);
+}
+
+void vfec_rx_input(VFEC_RX_PTR rx, const UINT8 *pkt, UINT32 len)
+{
+    VFEC_RX_FRAME_PTR f;
+    UINT32 seq, fs;
+
+    if (len < 4)
+    {
+        rx->stats.bad_pkts++;
+        return;
+    }
+    if (pkt[1] & VFEC_PARITY_FLAG)
+    {
+        vfec_rx_parity(rx, pkt, len);
+        return;
+    }
+
+    seq = pkt[3];
+    if ((len < rx->hdr_size) || (len > VFEC_PKT_MAX) || (seq == 0))
+    {
+        rx->stats.bad_pkts++;
+        return;
+    }
+    rx->stats.data_pkts++;
+
+    f = vfec_rx_frame(rx, pkt[0]);
+    if (f == NULL)
+    {
+        return;
+    }
+    if (f->done || f->have[seq])
+    {
+        rx->stats.dup_pkts++;
+        return;
+    }
+
+    vfec_rx_store(f, seq, pkt, len);
+
+    // blocks this packet may belong to, once their parity is in
+    fs = (seq > VFEC_K_MAX) ? (seq - VFEC_K_MAX + 1) : 1;
+    for (; fs <= seq; fs++)
+    {
+        if (f->blk[fs].mask && (seq < fs + f->blk[fs].k))
+        {
+            vfec_rx_decode(rx, f, fs);
+        }
+    }
+    vfec_rx_complete(rx, f);
+}
+
+UINT32 vfec_rx_missing(VFEC_RX_PTR rx, UINT16 *list, UINT32 max)
+{
+    VFEC_RX_FRAME_PTR f, order[VFEC_RX_FRAMES];
+    UINT32 n = 0, i, j, seq, hi, cnt = 0;
+
+    // open frames, oldest first
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        f = &rx->frame[i];
+        if (!f->open || f->done)
+        {
+            continue;
+        }
+        for (j = n++; (j > 0) && ((UINT8)(rx->newest - order[j - 1]->id) < (UINT8)(rx->newest - f->id)); j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = f;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        f = order[i];
+        hi = f->total ? f->total : f->max_seq;
+        // a newer frame began, so at least the eof packet is missing
+        if ((f->total == 0) && (f->id != rx->newest) && (hi < VFEC_RX_SEQ_MAX - 1))
+        {
+            hi++;
+        }
+        for (seq = 1; (seq <= hi) && (cnt < max); seq++)
+        {
+            if (!f->have[seq])
+            {
+                list[cnt++] = (f->id << 8) | seq;
+            }
+        }
+    }
+
+    return cnt;
+}
+
+void vfec_rx_flush(VFEC_RX_PTR rx)
+{
+    UINT32 i;
+
+    for (i = 0; i < VFEC_RX_FRAMES; i++)
+    {
+        vfec_rx_close(rx, &rx->frame[i]);
+    }
+}
+// eof
@@ -0,0 +1,82 @@
+#ifndef __VFEC_RX_H__
+#define __VFEC_RX_H__
+
+#include "include.h"
+#include "video_fec.h"
+
+/*
+ * Receiver side of the udp video stream: puts the packets of a frame back in
+ * pkt_seq order, rebuilds lost packets from the parity packets when the
+ * sender runs with fec, and hands over every complete frame. Works without
+ * fec too, then a frame is complete once every packet came, maybe resent
+ * after a nack. The last VFEC_RX_FRAMES frames stay open for late packets,
+ * a frame is given up once a newer one is complete.
+ */
+#define VFEC_RX_SEQ_MAX             256
+#define VFEC_RX_FRAMES              4
+
+typedef struct vfec_rx_stats_st
+{
+    UINT32 data_pkts;
+    UINT32 parity_pkts;
+    UINT32 dup_pkts;            // already there, or rebuilt before it came
+    UINT32 late_pkts;           // frame already closed
+    UINT32 bad_pkts;            // too short or not a video packet
+    UINT32 pkts_recovered;      // data packets rebuilt from parity
+    UINT32 blocks_failed;       // more lost than parity received
+    UINT32 frames_ok;
+    UINT32 frames_recovered;    // ok only thanks to the parity
+    UINT32 frames_lost;         // incomplete, or not a single packet came
+} VFEC_RX_STATS_ST, *VFEC_RX_STATS_PTR;
+
+// frame is the jpeg data without packet headers, valid during the call
+typedef void (*vfec_rx_frame_cb)(void *arg, UINT32 id, const UINT8 *frame, UINT32 len,
+                                 UINT32 recovered);
+
+typedef struct vfec_rx_blk_st
+{
+    UINT8 k;
+    UINT8 m;
+    UINT8 done;
+    UINT16 len;
+    UINT32 mask;                // parity packets received
+} VFEC_RX_BLK_ST;
+
+typedef struct vfec_rx_frame_st
+{
+    UINT8 open;
+    UINT8 id;
+    UINT8 done;                 // handed over, or given up
+    UINT8 max_seq;              // highest pkt_seq there
+    UINT32 total;               // packets of the frame, 0 until the eof packet is known
+    UINT32 recovered;
+    UINT8 have[VFEC_RX_SEQ_MAX];
+    VFEC_RX_BLK_ST blk[VFEC_RX_SEQ_MAX];    // by first_seq
+    UINT8 *unit;                // coded unit per seq, VFEC_UNIT_MAX each
+    UINT8 *parity;              // VFEC_M_MAX units per first_seq
+} VFEC_RX_FRAME_ST, *VFEC_RX_FRAME_PTR;
+
+typedef struct vfec_rx_st
+{
+    UINT32 hdr_size;            // data packet header, 4 or 8 for the drone build
+    vfec_rx_frame_cb cb;
+    void *arg;
+
+    UINT32 started;
+    UINT8 newest;               // id of the newest frame seen
+    UINT8 *out;
+    VFEC_RX_FRAME_ST frame[VFEC_RX_FRAMES];
+
+    VFEC_RX_STATS_ST stats;
+} VFEC_RX_ST, *VFEC_RX_PTR;
+
+int vfec_rx_init(VFEC_RX_PTR rx, UINT32 hdr_size, vfec_rx_frame_cb cb, void *arg);
+void vfec_rx_deinit(VFEC_RX_PTR rx);
+void vfec_rx_input(VFEC_RX_PTR rx, const UINT8 *pkt, UINT32 len);
+// lost packets of the open frames, oldest frame first, each id << 8 | pkt_seq
+UINT32 vfec_rx_missing(VFEC_RX_PTR rx, UINT16 *list, UINT32 max);
+// close the open frames, at the end of a stream
+void vfec_rx_flush(VFEC_RX_PTR rx);
+
+#endif // __VFEC_RX_H__
+// eof
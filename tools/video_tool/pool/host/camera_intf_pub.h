@@ -0,0 +1,12 @@
+#ifndef __TVIDEO_HOST_CAMERA_INTF_PUB_H__
+#define __TVIDEO_HOST_CAMERA_INTF_PUB_H__
+
+// the test drives tvideo_st handlers itself, these only record the calls
+void camera_intfer_init(void *data);
+void camera_intfer_deinit(void);
+UINT32 camera_intfer_set_video_param(UINT32 ppi_type, UINT32 pfs_type);
+UINT32 camera_intfer_get_frame_size(void);
+UINT32 camera_intfer_set_frame_size(UINT32 high, UINT32 low);
+
+#endif
+// eof
@@ -0,0 +1,91 @@
+#ifndef __TVIDEO_HOST_CO_LIST_H__
+#define __TVIDEO_HOST_CO_LIST_H__
+
+// the firmware takes these from the wifi lib, same behaviour
+#include <stdbool.h>
+
+struct co_list_hdr
+{
+    struct co_list_hdr *next;
+};
+
+struct co_list
+{
+    struct co_list_hdr *first;
+    struct co_list_hdr *last;
+};
+
+static inline void co_list_init(struct co_list *list)
+{
+    list->first = NULL;
+    list->last = NULL;
+}
+
+static inline void co_list_push_back(struct co_list *list, struct co_list_hdr *list_hdr)
+{
+    if (list->first == NULL)
+    {
+        list->first = list_hdr;
+    }
+    else
+    {
+        list->last->next = list_hdr;
+    }
+    list->last = list_hdr;
+    list_hdr->next = NULL;
+}
+
+static inline struct co_list_hdr *co_list_pop_front(struct co_list *list)
+{
+    struct co_list_hdr *element = list->first;
+
+    if (element != NULL)
+    {
+        list->first = element->next;
+    }
+    return element;
+}
+
+static inline bool co_list_is_empty(const struct co_list *const list)
+{
+    return list->first == NULL;
+}
+
+static inline struct co_list_hdr *co_list_pick(const struct co_list *const list)
+{
+    return list->first;
+}
+
+static inline UINT32 co_list_cnt(const struct co_list *const list)
+{
+    struct co_list_hdr *hdr = list->first;
+    UINT32 cnt = 0;
+
+    while (hdr)
+    {
+        cnt++;
+        hdr = hdr->next;
+    }
+    return cnt;
+}
+
+static inline void co_list_concat(struct co_list *list1, struct co_list *list2)
+{
+    if (list2->first == NULL)
+    {
+        return;
+    }
+    if (list1->first == NULL)
+    {
+        list1->first = list2->first;
+    }
+    else
+    {
+        list1->last->next = list2->first;
+    }
+    list1->last = list2->last;
+    list2->first = NULL;
+}
+
+#endif
+// eof
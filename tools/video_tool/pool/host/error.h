@@ -0,0 +1,10 @@
+#ifndef __TVIDEO_HOST_ERROR_H__
+#define __TVIDEO_HOST_ERROR_H__
+
+#define kNoErr                            0
+#define kGeneralErr                       -1
+#define kInProgressErr                    -2
+#define kTimeoutErr                       -3
+
+#endif
+// eof
@@ -0,0 +1,10 @@
+#ifndef __TVIDEO_HOST_GENERAL_DMA_PUB_H__
+#define __TVIDEO_HOST_GENERAL_DMA_PUB_H__
+
+// synchronous copy, counted per byte
+#define GDMA_ASYNC_EN                     0
+
+void gdma_memcpy(void *out, const void *in, UINT32 len);
+
+#endif
+// eof
@@ -0,0 +1,308 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host.h"
+#include "rtos_pub.h"
+#include "error.h"
+#include "mem_pub.h"
+#include "general_dma_pub.h"
+#include "camera_intf_pub.h"
+#include "lwip/pbuf.h"
+
+HOST_COUNT_ST host_count;
+int host_verbose;
+UINT32 host_time_ms;
+int host_time_fake;
+
+static pthread_mutex_t host_int_lock;
+static pthread_once_t host_int_once = PTHREAD_ONCE_INIT;
+
+static void host_int_setup(void)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&host_int_lock, &attr);
+}
+
+void host_int_disable(void)
+{
+    pthread_once(&host_int_once, host_int_setup);
+    pthread_mutex_lock(&host_int_lock);
+}
+
+void host_int_restore(void)
+{
+    pthread_mutex_unlock(&host_int_lock);
+}
+
+void host_isr_run(void (*fn)(void *arg), void *arg)
+{
+    host_int_disable();
+    fn(arg);
+    host_int_restore();
+}
+
+void *host_malloc(size_t size)
+{
+    host_count.mallocs++;
+    host_count.malloc_bytes += size;
+    return malloc(size);
+}
+
+void host_free(void *ptr)
+{
+    if (ptr)
+    {
+        host_count.frees++;
+    }
+    free(ptr);
+}
+
+void gdma_memcpy(void *out, const void *in, UINT32 len)
+{
+    host_count.dma_bytes += len;
+    memcpy(out, in, len);
+}
+
+// ---- rtos, queue is a locked ring, time is the monotonic clock ----
+typedef struct host_queue_st
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UINT32 msg_size;
+    UINT32 count;
+    UINT32 in;
+    UINT32 out;
+    UINT8 *buf;
+} HOST_QUEUE_ST;
+
+OSStatus rtos_init_queue(beken_queue_t *queue, const char *name, UINT32 msg_size, UINT32 count)
+{
+    HOST_QUEUE_ST *q = calloc(1, sizeof(HOST_QUEUE_ST));
+
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    q->msg_size = msg_size;
+    q->count = count;
+    q->buf = malloc(msg_size * count);
+    *queue = q;
+    return kNoErr;
+}
+
+OSStatus rtos_push_to_queue(beken_queue_t *queue, void *msg, UINT32 timeout_ms)
+{
+    HOST_QUEUE_ST *q = *queue;
+    OSStatus ret = kGeneralErr;
+
+    pthread_mutex_lock(&q->lock);
+    host_count.q_pushes++;
+    if (q->in - q->out < q->count)
+    {
+        memcpy(q->buf + (q->in % q->count) * q->msg_size, msg, q->msg_size);
+        q->in++;
+        pthread_cond_signal(&q->cond);
+        ret = kNoErr;
+    }
+    else
+    {
+        host_count.q_full++;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+OSStatus rtos_pop_from_queue(beken_queue_t *queue, void *msg, UINT32 timeout_ms)
+{
+    HOST_QUEUE_ST *q = *queue;
+    struct timespec ts;
+    OSStatus ret = kNoErr;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (timeout_ms != BEKEN_WAIT_FOREVER)
+    {
+        ts.tv_sec += timeout_ms / 1000;
+        ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000)
+        {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&q->lock);
+    while (q->in == q->out)
+    {
+        if (timeout_ms == BEKEN_NO_WAIT)
+        {
+            ret = kTimeoutErr;
+            break;
+        }
+        if (timeout_ms == BEKEN_WAIT_FOREVER)
+        {
+            pthread_cond_wait(&q->cond, &q->lock);
+        }
+        else if (pthread_cond_timedwait(&q->cond, &q->lock, &ts))
+        {
+            ret = kTimeoutErr;
+            break;
+        }
+    }
+    if (ret == kNoErr)
+    {
+        memcpy(msg, q->buf + (q->out % q->count) * q->msg_size, q->msg_size);
+        q->out++;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+UINT32 host_queue_cnt(void *queue)
+{
+    HOST_QUEUE_ST *q = queue;
+
+    return q ? (q->in - q->out) : 0;
+}
+
+OSStatus rtos_deinit_queue(beken_queue_t *queue)
+{
+    HOST_QUEUE_ST *q = *queue;
+
+    free(q->buf);
+    free(q);
+    *queue = NULL;
+    return kNoErr;
+}
+
+OSStatus rtos_create_thread(beken_thread_t *thread, UINT8 priority, const char *name,
+                            beken_thread_function_t function, UINT32 stack_size, beken_thread_arg_t arg)
+{
+    pthread_t tid;
+
+    if (pthread_create(&tid, NULL, (void *(*)(void *))function, arg))
+    {
+        return kGeneralErr;
+    }
+    pthread_detach(tid);
+    *thread = (beken_thread_t)tid;
+    return kNoErr;
+}
+
+OSStatus rtos_delete_thread(beken_thread_t *thread)
+{
+    pthread_exit(NULL);
+    return kNoErr;
+}
+
+void rtos_delay_milliseconds(UINT32 ms)
+{
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+
+    nanosleep(&ts, NULL);
+}
+
+UINT32 rtos_get_time(void)
+{
+    struct timespec ts;
+
+    if (host_time_fake)
+    {
+        return host_time_ms;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ---- camera, the test feeds tvideo_st itself ----
+void camera_intfer_init(void *data)
+{
+}
+
+void camera_intfer_deinit(void)
+{
+}
+
+UINT32 camera_intfer_set_video_param(UINT32 ppi_type, UINT32 pfs_type)
+{
+    return 0;
+}
+
+UINT32 camera_intfer_get_frame_size(void)
+{
+    return 0;
+}
+
+UINT32 camera_intfer_set_frame_size(UINT32 high, UINT32 low)
+{
+    return 0;
+}
+
+// ---- lwip custom pbufs ----
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, UINT16 length, pbuf_type type, struct pbuf_custom *p,
+                                 void *payload_mem, UINT16 payload_mem_len)
+{
+    UINT16 offset = 0;
+
+    switch (l)
+    {
+    case PBUF_TRANSPORT:
+        offset += PBUF_TRANSPORT_HLEN;
+    /* fall through */
+    case PBUF_IP:
+        offset += PBUF_IP_HLEN;
+    /* fall through */
+    case PBUF_LINK:
+        offset += PBUF_LINK_HLEN;
+    /* fall through */
+    case PBUF_RAW_TX:
+        offset += PBUF_LINK_ENCAPSULATION_HLEN;
+        break;
+    default:
+        break;
+    }
+
+    if (LWIP_MEM_ALIGN_SIZE(offset) + length > payload_mem_len)
+    {
+        return NULL;
+    }
+
+    p->pbuf.next = NULL;
+    p->pbuf.payload = (UINT8 *)payload_mem + LWIP_MEM_ALIGN_SIZE(offset);
+    p->pbuf.tot_len = length;
+    p->pbuf.len = length;
+    p->pbuf.type = type;
+    p->pbuf.flags = PBUF_FLAG_IS_CUSTOM;
+    p->pbuf.ref = 1;
+    host_count.pbuf_allocs++;
+    return &p->pbuf;
+}
+
+void pbuf_ref(struct pbuf *p)
+{
+    host_int_disable();
+    p->ref++;
+    host_int_restore();
+}
+
+UINT8 pbuf_free(struct pbuf *p)
+{
+    UINT16 ref;
+
+    host_int_disable();
+    ref = --p->ref;
+    host_int_restore();
+
+    if (ref)
+    {
+        return 0;
+    }
+
+    host_count.pbuf_frees++;
+    ((struct pbuf_custom *)p)->custom_free_function(p);
+    return 1;
+}
+// eof
@@ -0,0 +1,29 @@
+#ifndef __TVIDEO_HOST_H__
+#define __TVIDEO_HOST_H__
+
+#include "include.h"
+
+// what the stand-ins saw, tests read and reset these
+typedef struct host_count_st
+{
+    UINT64 dma_bytes;           // gdma_memcpy, camera ring into pool node
+    UINT64 malloc_bytes;
+    UINT32 mallocs;
+    UINT32 frees;
+    UINT32 pbuf_allocs;
+    UINT32 pbuf_frees;          // custom free function calls
+    UINT32 q_pushes;            // rtos_push_to_queue, wakeups of the video thread
+    UINT32 q_full;
+} HOST_COUNT_ST;
+
+extern HOST_COUNT_ST host_count;
+// rtos_get_time returns host_time_ms instead of the clock while host_time_fake is set
+extern UINT32 host_time_ms;
+extern int host_time_fake;
+
+// the isr stand-in, runs fn with interrupts off like the jpeg isr
+void host_isr_run(void (*fn)(void *arg), void *arg);
+UINT32 host_queue_cnt(void *queue);
+
+#endif
+// eof
@@ -0,0 +1,33 @@
+#ifndef __TVIDEO_HOST_INCLUDE_H__
+#define __TVIDEO_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, lets components/video_transfer/video_transfer.c build on a pc
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+
+#define CFG_USE_APP_DEMO_VIDEO_TRANSFER   1
+#define CFG_USE_CAMERA_INTF               1
+#define CFG_USE_SPIDMA                    0
+#define CFG_GENERAL_DMA                   1
+
+#define ASSERT(exp)
+
+// interrupts off is one lock for all, the isr stand-in runs with it held
+void host_int_disable(void);
+void host_int_restore(void);
+
+#define GLOBAL_INT_DECLARATION()
+#define GLOBAL_INT_DISABLE()              host_int_disable()
+#define GLOBAL_INT_RESTORE()              host_int_restore()
+
+// same compiler barrier as include/generic.h, x86 keeps stores in order
+#define barrier()                         __asm volatile("" ::: "memory")
+
+#endif
+// eof
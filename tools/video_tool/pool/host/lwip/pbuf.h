@@ -0,0 +1,59 @@
+#ifndef __TVIDEO_HOST_PBUF_H__
+#define __TVIDEO_HOST_PBUF_H__
+
+// the part of lwip pbuf.h the zero-copy path uses, header sizes as in lwipopts.h
+#define LWIP_SUPPORT_CUSTOM_PBUF          1
+#define MEM_ALIGNMENT                     4
+#define LWIP_MEM_ALIGN_SIZE(size)         (((size) + MEM_ALIGNMENT - 1U) & ~(MEM_ALIGNMENT - 1U))
+
+#define PBUF_LINK_ENCAPSULATION_HLEN      96
+#define PBUF_LINK_ENCAPSULATION_TLEN      16
+#define PBUF_LINK_HLEN                    14
+#define PBUF_IP_HLEN                      20
+#define PBUF_TRANSPORT_HLEN               20
+
+#define PBUF_FLAG_IS_CUSTOM               0x02U
+
+typedef enum
+{
+    PBUF_TRANSPORT,
+    PBUF_IP,
+    PBUF_LINK,
+    PBUF_RAW_TX,
+    PBUF_RAW
+} pbuf_layer;
+
+typedef enum
+{
+    PBUF_RAM,
+    PBUF_ROM,
+    PBUF_REF,
+    PBUF_POOL
+} pbuf_type;
+
+struct pbuf
+{
+    struct pbuf *next;
+    void *payload;
+    UINT16 tot_len;
+    UINT16 len;
+    UINT8 type;
+    UINT8 flags;
+    UINT16 ref;
+};
+
+typedef void (*pbuf_free_custom_fn)(struct pbuf *p);
+
+struct pbuf_custom
+{
+    struct pbuf pbuf;
+    pbuf_free_custom_fn custom_free_function;
+};
+
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, UINT16 length, pbuf_type type, struct pbuf_custom *p,
+                                 void *payload_mem, UINT16 payload_mem_len);
+void pbuf_ref(struct pbuf *p);
+UINT8 pbuf_free(struct pbuf *p);
+
+#endif
+// eof
@@ -0,0 +1,18 @@
+#ifndef __TVIDEO_HOST_MEM_PUB_H__
+#define __TVIDEO_HOST_MEM_PUB_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+// counted, so a test sees the pool go back to the heap
+void *host_malloc(size_t size);
+void host_free(void *ptr);
+
+#define os_memset                         memset
+#define os_memcpy                         memcpy
+#define os_memcmp                         memcmp
+#define os_malloc                         host_malloc
+#define os_free                           host_free
+
+#endif
+// eof
@@ -0,0 +1,24 @@
+#ifndef __TVIDEO_HOST_RTOS_PUB_H__
+#define __TVIDEO_HOST_RTOS_PUB_H__
+
+typedef int OSStatus;
+typedef void *beken_thread_t;
+typedef void *beken_queue_t;
+typedef void *beken_thread_arg_t;
+typedef void (*beken_thread_function_t)(beken_thread_arg_t arg);
+
+#define BEKEN_NO_WAIT                     0
+#define BEKEN_WAIT_FOREVER                0xFFFFFFFF
+
+OSStatus rtos_init_queue(beken_queue_t *queue, const char *name, UINT32 msg_size, UINT32 count);
+OSStatus rtos_push_to_queue(beken_queue_t *queue, void *msg, UINT32 timeout_ms);
+OSStatus rtos_pop_from_queue(beken_queue_t *queue, void *msg, UINT32 timeout_ms);
+OSStatus rtos_deinit_queue(beken_queue_t *queue);
+OSStatus rtos_create_thread(beken_thread_t *thread, UINT8 priority, const char *name,
+                            beken_thread_function_t function, UINT32 stack_size, beken_thread_arg_t arg);
+OSStatus rtos_delete_thread(beken_thread_t *thread);
+void rtos_delay_milliseconds(UINT32 ms);
+UINT32 rtos_get_time(void);
+
+#endif
+// eof
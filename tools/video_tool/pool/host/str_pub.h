@@ -0,0 +1,9 @@
+#ifndef __TVIDEO_HOST_STR_PUB_H__
+#define __TVIDEO_HOST_STR_PUB_H__
+
+#include <string.h>
+
+#define os_strcmp                         strcmp
+
+#endif
+// eof
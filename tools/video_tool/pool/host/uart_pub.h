@@ -0,0 +1,14 @@
+#ifndef __TVIDEO_HOST_UART_PUB_H__
+#define __TVIDEO_HOST_UART_PUB_H__
+
+#include <stdio.h>
+
+extern int host_verbose;
+
+#define os_printf(...)                    do { if (host_verbose) printf(__VA_ARGS__); } while (0)
+#define warning_prf                       printf
+#define fatal_prf                         printf
+#define null_prf(...)
+
+#endif
+// eof
@@ -0,0 +1,556 @@
+/*
+ * Pacer of video_transfer.c on a made up clock. First the token accounting
+ * of video_pace.c through take, give and charge, the wait it asks for
+ * against the ms ticks the video thread sleeps, the stale drop of the pool
+ * across a wrap of the frame counter and what the rate controller makes of
+ * it. Then jpeg frames go out over a link with a short queue in front of
+ * it, like the ap or the mac tx queue, with fec parity behind every block:
+ * sent as the camera hands the nodes over, paced, and paced with the
+ * parity kept away from the pacer. The paced run must lose far fewer
+ * packets and fec blocks and get more frames through whole, and with the
+ * parity charged nothing may go out beyond the pace rate but the bucket
+ * and one block's parity.
+ *   ./pace_test [seconds] [seed]
+ */
+#include "../../../components/video_transfer/video_transfer.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool_feed.h"
+
+#define PT_NODE                     TVIDEO_RXNODE_SIZE_UDP
+#define PT_HDR_SIZE                 4
+#define PT_POOL_NODES               32          // APP_DEMO_UDP_POOL_NODES
+#define PT_FPS                      20
+#define PT_READOUT                  40          // percent of the frame time the jpeg data comes in
+#define PT_FRAME_MIN                (14 * 1024)
+#define PT_FRAME_MAX                (22 * 1024)
+#define PT_LINK_KBPS                650         // kB/s, 1000 bytes
+#define PT_LINK_QUEUE               4           // packets waiting for the air
+#define PT_FEC_K                    8
+#define PT_FEC_M                    2
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+// ---- token accounting ----
+static void pt_pace_open(VPACE_PTR p, UINT32 frame_bytes)
+{
+    vpace_init(p, PT_NODE);
+    vpace_refill(p, 0, 0);
+    vpace_frame(p, 0, 1, frame_bytes);
+    vpace_frame(p, 40, 1, frame_bytes);
+    vpace_refill(p, 40, 0);
+}
+
+static void pt_tokens(void)
+{
+    VPACE_ST p, q;
+    UINT32 t, taken, len, wait, bytes, n;
+
+    // frame interval unknown, nothing is held back and nothing counted
+    vpace_init(&p, PT_NODE);
+    CHECK(vpace_take(&p, 100000) && (vpace_wait(&p, 100000) == 0));
+    vpace_charge(&p, 1000);
+    CHECK((p.debt == 0) && (p.extra == 1000));
+
+    // 15000 bytes per 40 ms frame, out within 30 ms
+    pt_pace_open(&p, 15000);
+    CHECK((p.interval == 40) && (p.frame_bytes == 15000));
+    CHECK(p.rate == 15000 * 1000 / 30);
+    CHECK(p.burst == PT_NODE * VPACE_BURST_PKTS);
+    CHECK(p.tokens == p.burst * 1000);
+
+    // a full bucket is two nodes, then nothing until the refill
+    CHECK(vpace_take(&p, PT_NODE) && vpace_take(&p, PT_NODE));
+    CHECK(!vpace_take(&p, 1) && (p.tokens == 0));
+    // what the socket didn't take comes back, up to the bucket
+    vpace_give(&p, 1000);
+    CHECK(!vpace_take(&p, 1001) && vpace_take(&p, 1000) && (p.tokens == 0));
+    vpace_give(&p, 10 * PT_NODE);
+    CHECK(p.tokens == p.burst * 1000);
+
+    // one second of sends as fast as tokens allow is the rate, give or take the bucket
+    taken = 0;
+    for (t = 41; t <= 1040; t++)
+    {
+        vpace_refill(&p, t, 0);
+        while (vpace_take(&p, PT_NODE))
+        {
+            taken += PT_NODE;
+        }
+    }
+    CHECK(taken + p.burst >= p.rate);
+    CHECK(taken <= p.rate + p.burst);
+
+    // the wait is whole ms: not a tick earlier, and the tick it says is enough
+    for (bytes = 2000; bytes <= 60000; bytes += 1300)
+    {
+        pt_pace_open(&p, bytes);
+        for (len = 1; len <= p.burst; len += 97)
+        {
+            for (n = 0; n < 3; n++)
+            {
+                // bucket drained to a third, two thirds or empty
+                p.tokens = p.burst * 1000 / 3 * (2 - n);
+                wait = vpace_wait(&p, len);
+                if (p.tokens >= len * 1000)
+                {
+                    CHECK(wait == 0);
+                    continue;
+                }
+                CHECK(wait > 0);
+
+                q = p;
+                vpace_refill(&q, q.now + wait, 0);
+                CHECK(vpace_take(&q, len));
+                q = p;
+                vpace_refill(&q, q.now + wait - 1, 0);
+                CHECK(!vpace_take(&q, len));
+            }
+        }
+    }
+
+    // parity past the bucket is a debt, the nodes wait until the link had time for it
+    pt_pace_open(&p, 15000);
+    vpace_charge(&p, 4000);
+    CHECK((p.tokens == 0) && (p.debt == (4000 - p.burst) * 1000));
+    CHECK(!vpace_take(&p, 1));
+    wait = vpace_wait(&p, PT_NODE);
+    CHECK(wait == ((PT_NODE + 4000 - p.burst) * 1000 + p.rate - 1) / p.rate);
+    q = p;
+    vpace_refill(&q, q.now + wait - 1, 0);
+    CHECK(!vpace_take(&q, PT_NODE));
+    vpace_refill(&p, p.now + wait, 0);
+    CHECK((p.debt == 0) && vpace_take(&p, PT_NODE));
+
+    // a give pays the debt first
+    p.tokens = 0;
+    vpace_charge(&p, 1000);
+    vpace_give(&p, 600);
+    CHECK((p.debt == 400 * 1000) && (p.tokens == 0));
+    vpace_give(&p, 600);
+    CHECK((p.debt == 0) && (p.tokens == 200 * 1000));
+
+    // a frame worth of debt at most
+    vpace_charge(&p, 1000000);
+    CHECK(p.debt == p.frame_bytes * 1000);
+
+    // and the charged bytes count into the next frame, the rate covers them
+    p.extra = 4000;
+    vpace_frame(&p, 80, 1, 15000);
+    CHECK((p.extra == 0) && (p.frame_bytes == 15000 - 15000 / 4 + 19000 / 4));
+
+    printf("tokens: ok\n");
+}
+
+// ---- stale drop over the pool ----
+static int pt_refuse(UINT8 *data, UINT32 len)
+{
+    return 0;
+}
+
+static void pt_stale_open(UINT32 send_type, UINT32 frames)
+{
+    TVIDEO_SETUP_DESC_ST setup;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.open_type = TVIDEO_OPEN_SCCB;
+    setup.send_type = send_type;
+    setup.send_func = pt_refuse;
+    setup.pace = 1;
+    tvideo_pool_init(&setup);
+    tvideo_config_desc();
+
+    tvideo_pool.pace_frames = frames;
+    tvideo_pool.pace_last_frames = frames;
+}
+
+static void pt_stale_frame(UINT32 nodes)
+{
+    POOL_FEED_ARG a;
+    UINT8 buf[PT_NODE];
+    UINT32 i;
+
+    memset(buf, 0, sizeof(buf));
+    for (i = 0; i < nodes; i++)
+    {
+        a.ptr = buf;
+        a.len = tvideo_st.node_len;
+        a.eof = (i + 1 == nodes);
+        a.frame_len = nodes * tvideo_st.node_len;
+        host_isr_run(pool_feed_isr_node, &a);
+    }
+    host_isr_run(pool_feed_isr_end, NULL);
+    tvideo_poll_handler();
+}
+
+static void pt_stale(void)
+{
+    // counter wraps between the second and the third frame
+    pt_stale_open(TVIDEO_SND_UDP, 0xFFFFFFFE);
+    pt_stale_frame(3);
+    CHECK((tvideo_ready_cnt() == 3) && (tvideo_pool.stats.pkts_stale == 0));
+    pt_stale_frame(3);
+    CHECK((tvideo_pool.pace_frames == 0) && (tvideo_ready_cnt() == 3));
+    CHECK(tvideo_pool.stats.pkts_stale == 3);
+    CHECK(tvideo_ready_peek(0)->frame == 0xFFFFFFFF);
+    pt_stale_frame(3);
+    CHECK((tvideo_ready_cnt() == 3) && (tvideo_pool.stats.pkts_stale == 6));
+    CHECK(tvideo_ready_peek(0)->frame == 0);
+    CHECK(tvideo_pool.stats.nodes_in_use == 3);
+    CHECK(co_list_cnt(&tvideo_pool.free) == tvideo_pool.node_cnt - 3);
+    tvideo_pool_deinit();
+
+    // a stream can't skip bytes, tcp keeps everything
+    pt_stale_open(TVIDEO_SND_TCP, 0xFFFFFFFE);
+    pt_stale_frame(2);
+    pt_stale_frame(2);
+    pt_stale_frame(2);
+    CHECK((tvideo_ready_cnt() == 6) && (tvideo_pool.stats.pkts_stale == 0));
+    tvideo_pool_deinit();
+
+    printf("stale drop across the counter wrap: ok\n");
+}
+
+// ---- stale drops at the rate controller ----
+static UINT32 pt_rate_cut(UINT32 dropped, UINT32 stale)
+{
+    VRATE_ST rc;
+    VRATE_CFG_ST cfg;
+    VRATE_IN_ST in;
+
+    cfg.size_min = 2 * 1024;
+    cfg.size_max = 32 * 1024;
+    cfg.period = 8;
+    cfg.fps_min = TYPE_20FPS;
+    cfg.fps_max = TYPE_20FPS;
+    vrate_init(&rc, &cfg);
+
+    // 8 frames of 5000 bytes in 400 ms, far below the 32 kB target
+    memset(&in, 0, sizeof(in));
+    in.elapse_ms = 400;
+    in.frames = 8;
+    in.bytes_sent = 40000;
+    in.node_cnt = PT_POOL_NODES;
+    in.rx_loss = VRATE_RX_LOSS_NONE;
+    in.pkts_dropped = dropped;
+    in.pkts_stale = stale;
+    vrate_update(&rc, &in);
+    return rc.target;
+}
+
+static void pt_rate_stale(void)
+{
+    // a pool overflow cuts to what the link carried, stale drops halve at most
+    CHECK(pt_rate_cut(0, 0) == 32 * 1024);
+    CHECK(pt_rate_cut(1, 0) == 5000 * 7 / 8);
+    CHECK(pt_rate_cut(0, 1) == 16 * 1024);
+    CHECK(pt_rate_cut(0, 40) == 16 * 1024);
+    printf("stale drops at the rate controller: ok\n");
+}
+
+// ---- link with a short queue ----
+typedef struct
+{
+    UINT16 pkts;                // data packets the camera gave
+    UINT16 sent;
+    UINT8 bad;                  // a block lost more than the parity repairs
+} PT_FRAME_ST;
+
+typedef struct
+{
+    const char *name;
+    UINT32 pace;
+    UINT32 charge;              // parity counted by the pacer
+
+    UINT32 pkts;                // on the link, data and parity
+    UINT32 lost;
+    UINT32 blocks;
+    UINT32 blocks_lost;
+    UINT32 frames;
+    UINT32 frames_good;
+    UINT32 stale;
+    UINT32 bytes;
+    UINT32 over;                // most sent beyond the pace rate in one frame interval
+} PT_RUN_ST;
+
+static PT_RUN_ST *pt_run;
+static PT_FRAME_ST *pt_frame;
+static UINT64 pt_link_out[PT_LINK_QUEUE + 1];   // us each queued packet is through
+static UINT32 pt_link_cnt;
+static UINT32 pt_blk_frame;
+static UINT32 pt_blk_data;
+static UINT32 pt_blk_lost;
+static UINT32 *pt_air;              // per ms, bytes handed to the link
+static UINT32 *pt_rate;             // per ms, pace rate in bytes/s
+
+// 1 if the queue had room for it
+static UINT32 pt_link_send(UINT32 len)
+{
+    UINT64 now = (UINT64)host_time_ms * 1000;
+    UINT64 at;
+    UINT32 i;
+
+    // gone over the air by now
+    for (i = 0; (i < pt_link_cnt) && (pt_link_out[i] <= now); i++)
+    {
+    }
+    memmove(pt_link_out, pt_link_out + i, (pt_link_cnt - i) * sizeof(pt_link_out[0]));
+    pt_link_cnt -= i;
+
+    pt_run->pkts++;
+    pt_air[host_time_ms] += len;
+    if (pt_link_cnt > PT_LINK_QUEUE)
+    {
+        pt_run->lost++;
+        return 0;
+    }
+
+    at = pt_link_cnt ? pt_link_out[pt_link_cnt - 1] : now;
+    pt_link_out[pt_link_cnt++] = at + (UINT64)len * 1000 / PT_LINK_KBPS;
+    pt_run->bytes += len;
+    return 1;
+}
+
+// parity of the block, app_demo_udp_fec_sent
+static void pt_blk_close(void)
+{
+    UINT32 j;
+
+    if (pt_blk_data == 0)
+    {
+        return;
+    }
+    for (j = 0; j < PT_FEC_M; j++)
+    {
+        pt_blk_lost += !pt_link_send(PT_NODE);
+        if (pt_run->charge)
+        {
+            video_transfer_pace_charge(PT_NODE);
+        }
+    }
+
+    pt_run->blocks++;
+    if (pt_blk_lost > PT_FEC_M)
+    {
+        pt_run->blocks_lost++;
+        pt_frame[pt_blk_frame].bad = 1;
+    }
+    pt_blk_data = 0;
+    pt_blk_lost = 0;
+}
+
+static void pt_data_sent(UINT8 *pkt, UINT32 len)
+{
+    UINT32 id = pkt[0] | (pkt[1] << 8);
+
+    if (pt_blk_data && (id != pt_blk_frame))
+    {
+        pt_blk_close();
+    }
+    pt_blk_frame = id;
+    pt_frame[id].sent++;
+
+    pt_blk_data++;
+    pt_blk_lost += !pt_link_send(len);
+    if ((pt_blk_data == PT_FEC_K) || pkt[2])
+    {
+        pt_blk_close();
+    }
+}
+
+static int pt_send_pbufs(struct pbuf **p, UINT32 cnt)
+{
+    UINT32 i;
+
+    for (i = 0; i < cnt; i++)
+    {
+        pt_data_sent(p[i]->payload, p[i]->tot_len);
+    }
+    return cnt;
+}
+
+static int pt_send(UINT8 *data, UINT32 len)
+{
+    pt_data_sent(data, len);
+    return len;
+}
+
+static void pt_add_hdr(TV_HDR_PARAM_PTR param)
+{
+    param->ptk_ptr[0] = (UINT8)param->frame_id;
+    param->ptk_ptr[1] = (UINT8)(param->frame_id >> 8);
+    param->ptk_ptr[2] = param->is_eof;
+    param->ptk_ptr[3] = 0;
+}
+
+static void pt_link_run(PT_RUN_ST *r, UINT32 seconds, UINT32 seed)
+{
+    TVIDEO_SETUP_DESC_ST setup;
+    POOL_FEED_ARG a;
+    UINT8 *jpeg = calloc(1, PT_FRAME_MAX);
+    UINT32 interval = 1000 / PT_FPS, frames = seconds * PT_FPS;
+    UINT32 t, fi = 0, node = 0, cnt = 0, size = 0, off = 0, next = BEKEN_WAIT_FOREVER;
+    UINT32 wake, start, pace_ms, w;
+    long long over = 0;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.open_type = TVIDEO_OPEN_SCCB;
+    setup.send_type = TVIDEO_SND_UDP;
+    setup.send_func = pt_send;
+    setup.send_pbufs_func = pt_send_pbufs;
+    setup.pkt_header_size = PT_HDR_SIZE;
+    setup.add_pkt_header = pt_add_hdr;
+    setup.pace = r->pace;
+    setup.pool_node_cnt = PT_POOL_NODES;
+
+    pt_run = r;
+    pt_frame = calloc(frames, sizeof(PT_FRAME_ST));
+    pt_air = calloc((seconds + 1) * 1000, sizeof(UINT32));
+    pt_rate = calloc((seconds + 1) * 1000, sizeof(UINT32));
+    pt_link_cnt = 0;
+    pt_blk_data = 0;
+    pt_blk_lost = 0;
+    host_time_fake = 1;
+    host_time_ms = 0;
+    pool_feed_open(&setup);
+
+    for (t = 0; t < (seconds + 1) * 1000; t++)
+    {
+        host_time_ms = t;
+        wake = 0;
+
+        // the camera hands the jpeg over in node pieces during the readout
+        start = fi * interval;
+        if ((fi < frames) && (t == start))
+        {
+            size = PT_FRAME_MIN + rand_r(&seed) % (PT_FRAME_MAX - PT_FRAME_MIN);
+            cnt = (size + tvideo_st.node_len - 1) / tvideo_st.node_len;
+            node = 0;
+            off = 0;
+            pt_frame[fi].pkts = cnt;
+        }
+        while ((fi < frames) && (t >= start) && (start + node * interval * PT_READOUT / 100 / cnt <= t))
+        {
+            a.ptr = jpeg + off;
+            a.len = (size - off > tvideo_st.node_len) ? tvideo_st.node_len : (size - off);
+            a.eof = (node + 1 == cnt);
+            a.frame_len = size;
+            off += a.len;
+            wake |= (tvideo_ready_cnt() == 0);
+            host_isr_run(pool_feed_isr_node, &a);
+            if (++node == cnt)
+            {
+                host_isr_run(pool_feed_isr_end, NULL);
+                wake = 1;
+                fi++;
+                break;
+            }
+        }
+
+        // video thread, woken by the isr or at the end of its wait
+        if (wake || (t >= next))
+        {
+            tvideo_poll_handler();
+            next = BEKEN_WAIT_FOREVER;
+            if (tvideo_ready_cnt())
+            {
+                next = TVIDEO_SEND_RETRY_MS;
+                pace_ms = tvideo_pace_wait();
+                if (pace_ms > next)
+                {
+                    next = pace_ms;
+                }
+                next += t;
+            }
+        }
+        pt_rate[t] = tvideo_pool.pace.rate;
+    }
+    pt_blk_close();
+
+    for (fi = 0; fi < frames; fi++)
+    {
+        r->frames++;
+        if ((pt_frame[fi].sent == pt_frame[fi].pkts) && !pt_frame[fi].bad)
+        {
+            r->frames_good++;
+        }
+    }
+    r->stale = tvideo_pool.stats.pkts_stale;
+
+    // what the pacer let out beyond its rate, over each frame interval once it knows the rate
+    w = 0;
+    for (t = 0; t < (seconds + 1) * 1000; t++)
+    {
+        if (pt_rate[t] == 0)
+        {
+            over = 0;
+            w = t + interval;
+            continue;
+        }
+        over += pt_air[t] * 1000LL - pt_rate[t];
+        if (t >= w)
+        {
+            over -= pt_air[t - interval] * 1000LL - pt_rate[t - interval];
+        }
+        if ((over > 0) && (over / 1000 > r->over))
+        {
+            r->over = over / 1000;
+        }
+    }
+    CHECK(tvideo_ready_cnt() == 0);
+    CHECK(tvideo_pool.stats.nodes_in_use == 0);
+
+    tvideo_pool_deinit();
+    host_time_fake = 0;
+    free(pt_frame);
+    free(pt_air);
+    free(pt_rate);
+    free(jpeg);
+
+    printf("%-22s %6.2f%% %6u/%-5u %6.1f%% %6u %6u %7u\n", r->name,
+           100.0 * r->lost / r->pkts, r->blocks_lost, r->blocks,
+           100.0 * r->frames_good / r->frames, r->stale, r->bytes / (seconds + 1) / 1000,
+           r->pace ? r->over : 0);
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 seconds = (argc > 1) ? atoi(argv[1]) : 60;
+    UINT32 seed = (argc > 2) ? atoi(argv[2]) : 1;
+    PT_RUN_ST run[3] =
+    {
+        {"as the camera gives", 0, 1},
+        {"paced", 1, 1},
+        {"paced, parity bypass", 1, 0},
+    };
+    PT_RUN_ST *raw = &run[0], *paced = &run[1], *bypass = &run[2];
+    UINT32 i;
+
+    pt_tokens();
+    pt_stale();
+    pt_rate_stale();
+
+    CHECK((seconds > 0) && (seconds * PT_FPS <= 0xFFFF));
+    printf("%u fps, %u-%u kB frames, %u kB/s link behind a %u packet queue, fec %u+%u, %u s\n",
+           PT_FPS, PT_FRAME_MIN / 1024, PT_FRAME_MAX / 1024, PT_LINK_KBPS, PT_LINK_QUEUE,
+           PT_FEC_K, PT_FEC_M, seconds);
+    printf("%-22s %7s %12s %7s %6s %6s %7s\n", "", "lost", "blocks lost", "whole", "stale",
+           "kB/s", "over B");
+    for (i = 0; i < sizeof(run) / sizeof(run[0]); i++)
+    {
+        pt_link_run(&run[i], seconds, seed);
+    }
+
+    // the queue overflows on the camera bursts, losing more than the parity repairs
+    CHECK(paced->lost * 10 < raw->lost);
+    CHECK(paced->blocks_lost * 10 < raw->blocks_lost);
+    CHECK(paced->frames_good > raw->frames_good);
+    // parity counted, the pacer's rate and bucket hold for all that goes out
+    CHECK(paced->over <= PT_NODE * (VPACE_BURST_PKTS + PT_FEC_M));
+    CHECK(bypass->over > PT_NODE * (VPACE_BURST_PKTS + PT_FEC_M));
+    printf("ok\n");
+    return 0;
+}
+// eof
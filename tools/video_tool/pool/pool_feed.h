@@ -0,0 +1,66 @@
+#ifndef __POOL_FEED_H__
+#define __POOL_FEED_H__
+
+/*
+ * Plays the camera for a test that includes video_transfer.c: a jpeg goes
+ * into the pool in node sized pieces from the isr stand-in, and the video
+ * thread part runs every few nodes and at end of frame.
+ */
+#include "host.h"
+
+#define POOL_FEED_POLL_NODES        4
+
+typedef struct pool_feed_arg
+{
+    UINT8 *ptr;
+    UINT32 len;
+    UINT32 eof;
+    UINT32 frame_len;
+} POOL_FEED_ARG;
+
+static inline void pool_feed_isr_node(void *arg)
+{
+    POOL_FEED_ARG *a = arg;
+
+    tvideo_st.node_full_handler(a->ptr, a->len, a->eof, a->frame_len);
+}
+
+static inline void pool_feed_isr_end(void *arg)
+{
+    tvideo_st.data_end_handler();
+}
+
+static inline void pool_feed_frame(UINT8 *jpeg, UINT32 len)
+{
+    POOL_FEED_ARG a;
+    UINT32 off;
+
+    for (off = 0; off < len; off += a.len)
+    {
+        a.ptr = jpeg + off;
+        a.len = len - off;
+        if (a.len > tvideo_st.node_len)
+        {
+            a.len = tvideo_st.node_len;
+        }
+        a.eof = (off + a.len == len);
+        a.frame_len = len;
+        host_isr_run(pool_feed_isr_node, &a);
+
+        if (tvideo_ready_cnt() >= POOL_FEED_POLL_NODES)
+        {
+            tvideo_poll_handler();
+        }
+    }
+    host_isr_run(pool_feed_isr_end, NULL);
+    tvideo_poll_handler();
+}
+
+static inline void pool_feed_open(TVIDEO_SETUP_DESC_PTR setup)
+{
+    tvideo_pool_init(setup);
+    tvideo_config_desc();
+}
+
+#endif // __POOL_FEED_H__
+// eof
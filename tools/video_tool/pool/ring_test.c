@@ -0,0 +1,152 @@
+/*
+ * Stress of the ready ring between jpeg isr and video thread. The real
+ * video thread runs on one pthread, a second one plays the isr and pushes
+ * numbered nodes as fast as it can. The send callback checks that every
+ * node comes out once, in order and with its own data, and that the
+ * coalesced wakeups never leave a node behind.
+ *   ./ring_test [seconds] [seed]
+ */
+#include "../../../components/video_transfer/video_transfer.c"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool_feed.h"
+
+#define RT_NODE_LEN                 TVIDEO_RXNODE_SIZE_UDP
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+static volatile int rt_run = 1;
+static UINT32 rt_produced;          // nodes the isr offered
+static UINT32 rt_frames;
+static UINT32 rt_next = 0;          // lowest seq the video thread may see next
+static UINT32 rt_got;
+static UINT32 rt_busy;              // sends refused, socket full
+static unsigned int rt_seed;
+
+static void rt_fill(UINT8 *buf, UINT32 seq, UINT32 len)
+{
+    UINT32 i;
+
+    memcpy(buf, &seq, 4);
+    for (i = 4; i < len; i++)
+    {
+        buf[i] = seq + i;
+    }
+}
+
+// video thread
+static int rt_send(UINT8 *data, UINT32 len)
+{
+    UINT32 seq, i;
+
+    if ((rand_r(&rt_seed) & 63) == 0)
+    {
+        rt_busy++;
+        return 0;
+    }
+
+    CHECK(len >= 4);
+    memcpy(&seq, data, 4);
+    // nodes of a dropped frame may be missing, never repeated or reordered
+    CHECK(seq >= rt_next);
+    for (i = 4; i < len; i++)
+    {
+        CHECK(data[i] == (UINT8)(seq + i));
+    }
+    rt_next = seq + 1;
+    rt_got++;
+
+    if ((rand_r(&rt_seed) & 255) == 0)
+    {
+        sched_yield();
+    }
+    return len;
+}
+
+// isr, a frame of 4..20 nodes, the last one short
+static void *rt_isr_main(void *arg)
+{
+    static UINT8 buf[RT_NODE_LEN];
+    unsigned int seed = (unsigned int)(long)arg;
+    UINT32 nodes, n, len;
+    POOL_FEED_ARG a;
+
+    while (rt_run)
+    {
+        nodes = 4 + rand_r(&seed) % 17;
+        for (n = 0; n < nodes; n++)
+        {
+            len = (n + 1 < nodes) ? tvideo_st.node_len : 4 + rand_r(&seed) % (tvideo_st.node_len - 4);
+            rt_fill(buf, rt_produced, len);
+            a.ptr = buf;
+            a.len = len;
+            a.eof = (n + 1 == nodes);
+            a.frame_len = 0;
+            host_isr_run(pool_feed_isr_node, &a);
+            rt_produced++;
+
+            if ((rand_r(&seed) & 7) == 0)
+            {
+                sched_yield();
+            }
+        }
+        host_isr_run(pool_feed_isr_end, NULL);
+        rt_frames++;
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 secs = (argc > 1) ? atoi(argv[1]) : 5;
+    TVIDEO_SETUP_DESC_ST setup;
+    TVIDEO_STATS_ST stats;
+    pthread_t tid;
+    UINT32 wait;
+
+    rt_seed = (argc > 2) ? atoi(argv[2]) : 1;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.open_type = TVIDEO_OPEN_SCCB;
+    setup.send_type = TVIDEO_SND_UDP;
+    setup.send_func = rt_send;
+    setup.pool_node_cnt = 16;
+
+    CHECK(video_transfer_init(&setup) == kNoErr);
+    while (tvideo_st.node_full_handler == NULL)
+    {
+        rtos_delay_milliseconds(1);
+    }
+
+    pthread_create(&tid, NULL, rt_isr_main, (void *)(long)rt_seed);
+    rtos_delay_milliseconds(secs * 1000);
+    rt_run = 0;
+    pthread_join(tid, NULL);
+
+    // isr is gone, only the wakeups already posted may empty the ring now
+    for (wait = 0; tvideo_ready_cnt() && (wait < 1000); wait++)
+    {
+        rtos_delay_milliseconds(1);
+    }
+    CHECK(tvideo_ready_cnt() == 0);
+
+    video_transfer_get_stats(&stats);
+    CHECK(stats.nodes_in_use == 0);
+    CHECK(stats.pkts_sent == rt_got);
+    CHECK(rt_got + stats.pkts_dropped == rt_produced);
+    CHECK(stats.frames == rt_frames);
+    CHECK(host_count.q_full == 0);
+
+    printf("frames %u, nodes %u, sent %u, dropped %u, busy %u, wakeups %u (%.2f per node), queue full %u: ok\n",
+           rt_frames, rt_produced, rt_got, stats.pkts_dropped, rt_busy, host_count.q_pushes,
+           (double)host_count.q_pushes / rt_produced, host_count.q_full);
+
+    video_transfer_deinit();
+    return 0;
+}
+// eof
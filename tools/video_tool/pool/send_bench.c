@@ -0,0 +1,260 @@
+/*
+ * Packets/s and sender cpu per packet of the video pool over loopback
+ * sockets, one send call per node against the batched calls, for udp and
+ * tcp. The callbacks do what the app/video_work ones do with lwip: sendto
+ * per node or per pbuf, sendmmsg for lwip_sendto_pbufs, send and sendmsg
+ * for the tcp stream.
+ *   ./send_bench [frames] [frame_kb]
+ */
+#define _GNU_SOURCE
+#include "../../../components/video_transfer/video_transfer.c"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pool_feed.h"
+
+#define SB_SOCK_BUF                 (4 * 1024 * 1024)
+
+enum
+{
+    SB_UDP_COPY = 0,
+    SB_UDP_PBUF,
+    SB_UDP_PBUFS,
+    SB_TCP_SEND,
+    SB_TCP_BATCH,
+    SB_MODE_MAX
+};
+
+static const char *sb_mode_name[SB_MODE_MAX] =
+{
+    "udp send_func", "udp pbuf", "udp pbufs batch", "tcp send_func", "tcp batch",
+};
+
+static int sb_fd = -1;
+static struct sockaddr_in sb_peer;
+static UINT64 sb_syscalls;
+static volatile int sb_rx_run;
+
+static int sb_udp_send(UINT8 *data, UINT32 len)
+{
+    sb_syscalls++;
+    return (sendto(sb_fd, data, len, MSG_DONTWAIT, (struct sockaddr *)&sb_peer, sizeof(sb_peer)) == len) ? len : 0;
+}
+
+static int sb_udp_send_pbuf(struct pbuf *p)
+{
+    sb_syscalls++;
+    return (sendto(sb_fd, p->payload, p->tot_len, MSG_DONTWAIT, (struct sockaddr *)&sb_peer,
+                   sizeof(sb_peer)) == p->tot_len) ? p->tot_len : 0;
+}
+
+static int sb_udp_send_pbufs(struct pbuf **p, UINT32 cnt)
+{
+    struct mmsghdr msg[TVIDEO_SEND_BATCH_MAX];
+    struct iovec iov[TVIDEO_SEND_BATCH_MAX];
+    UINT32 i;
+    int ret;
+
+    memset(msg, 0, sizeof(msg));
+    for (i = 0; i < cnt; i++)
+    {
+        iov[i].iov_base = p[i]->payload;
+        iov[i].iov_len = p[i]->tot_len;
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+        msg[i].msg_hdr.msg_name = &sb_peer;
+        msg[i].msg_hdr.msg_namelen = sizeof(sb_peer);
+    }
+
+    sb_syscalls++;
+    ret = sendmmsg(sb_fd, msg, cnt, MSG_DONTWAIT);
+    return (ret < 0) ? 0 : ret;
+}
+
+static int sb_tcp_send(UINT8 *data, UINT32 len)
+{
+    int ret;
+
+    sb_syscalls++;
+    ret = send(sb_fd, data, len, MSG_DONTWAIT | MSG_MORE);
+    return (ret < 0) ? 0 : ret;
+}
+
+static int sb_tcp_send_batch(TVIDEO_SEND_VEC_PTR vec, UINT32 cnt)
+{
+    struct iovec iov[TVIDEO_SEND_BATCH_MAX];
+    struct msghdr msg;
+    UINT32 i;
+    int ret;
+
+    for (i = 0; i < cnt; i++)
+    {
+        iov[i].iov_base = vec[i].data;
+        iov[i].iov_len = vec[i].len;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = cnt;
+
+    sb_syscalls++;
+    ret = sendmsg(sb_fd, &msg, MSG_DONTWAIT | MSG_MORE);
+    return (ret < 0) ? 0 : ret;
+}
+
+// receiver thread, drains the socket so the sender never stalls on it
+static void *sb_rx_main(void *arg)
+{
+    static UINT8 buf[65536];
+    int fd = (int)(long)arg;
+    struct timeval tv = {0, 100000};
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    while (sb_rx_run)
+    {
+        if ((recv(fd, buf, sizeof(buf), 0) == 0))
+        {
+            break;
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+static int sb_socket(int type)
+{
+    int fd = socket(AF_INET, type, 0);
+    int opt = SB_SOCK_BUF;
+
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &opt, sizeof(opt));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &opt, sizeof(opt));
+    return fd;
+}
+
+// sender socket in sb_fd, receiver thread on the other end
+static pthread_t sb_connect(UINT32 tcp)
+{
+    struct sockaddr_in addr;
+    socklen_t alen = sizeof(addr);
+    pthread_t tid;
+    int rx_fd, lfd;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    lfd = sb_socket(tcp ? SOCK_STREAM : SOCK_DGRAM);
+    bind(lfd, (struct sockaddr *)&addr, sizeof(addr));
+    getsockname(lfd, (struct sockaddr *)&sb_peer, &alen);
+
+    sb_fd = sb_socket(tcp ? SOCK_STREAM : SOCK_DGRAM);
+    if (tcp)
+    {
+        listen(lfd, 1);
+        connect(sb_fd, (struct sockaddr *)&sb_peer, sizeof(sb_peer));
+        rx_fd = accept(lfd, NULL, NULL);
+        close(lfd);
+    }
+    else
+    {
+        rx_fd = lfd;
+    }
+
+    sb_rx_run = 1;
+    pthread_create(&tid, NULL, sb_rx_main, (void *)(long)rx_fd);
+    return tid;
+}
+
+static double sb_time_us(clockid_t clk)
+{
+    struct timespec ts;
+
+    clock_gettime(clk, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void sb_run(UINT32 mode, UINT8 *jpeg, UINT32 frames, UINT32 frame_len)
+{
+    TVIDEO_SETUP_DESC_ST setup;
+    double wall, cpu;
+    pthread_t tid;
+    UINT32 i, tcp = (mode >= SB_TCP_SEND);
+    UINT32 pkts;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.open_type = TVIDEO_OPEN_SCCB;
+    setup.send_type = tcp ? TVIDEO_SND_TCP : TVIDEO_SND_UDP;
+    setup.send_func = tcp ? sb_tcp_send : sb_udp_send;
+    if (mode == SB_UDP_PBUF)
+    {
+        setup.send_pbuf_func = sb_udp_send_pbuf;
+    }
+    else if (mode == SB_UDP_PBUFS)
+    {
+        setup.send_pbufs_func = sb_udp_send_pbufs;
+    }
+    else if (mode == SB_TCP_BATCH)
+    {
+        setup.send_batch_func = sb_tcp_send_batch;
+    }
+    setup.pool_node_cnt = 32;
+
+    tid = sb_connect(tcp);
+    pool_feed_open(&setup);
+    sb_syscalls = 0;
+
+    wall = sb_time_us(CLOCK_MONOTONIC);
+    cpu = sb_time_us(CLOCK_THREAD_CPUTIME_ID);
+    for (i = 0; i < frames; i++)
+    {
+        pool_feed_frame(jpeg, frame_len);
+        // socket full, the firmware retries every TVIDEO_SEND_RETRY_MS
+        while (tvideo_ready_cnt())
+        {
+            tvideo_poll_handler();
+        }
+    }
+    cpu = sb_time_us(CLOCK_THREAD_CPUTIME_ID) - cpu;
+    wall = sb_time_us(CLOCK_MONOTONIC) - wall;
+
+    pkts = tvideo_pool.stats.pkts_sent;
+    printf("%-16s %8u pkts %9.0f pkt/s  %5.2f calls/pkt  %5.2f syscalls/pkt  %5.2f us cpu/pkt  drop %u\n",
+           sb_mode_name[mode], pkts, pkts * 1e6 / wall,
+           (double)tvideo_pool.stats.send_calls / pkts, (double)sb_syscalls / pkts, cpu / pkts,
+           tvideo_pool.stats.pkts_dropped);
+    tvideo_pool_deinit();
+
+    sb_rx_run = 0;
+    shutdown(sb_fd, SHUT_RDWR);
+    close(sb_fd);
+    pthread_join(tid, NULL);
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 frames = (argc > 1) ? atoi(argv[1]) : 2000;
+    UINT32 frame_len = ((argc > 2) ? atoi(argv[2]) : 20) * 1024;
+    UINT8 *jpeg = malloc(frame_len);
+    UINT32 i;
+
+    for (i = 0; i < frame_len; i++)
+    {
+        jpeg[i] = rand();
+    }
+
+    for (i = 0; i < SB_MODE_MAX; i++)
+    {
+        sb_run(i, jpeg, frames, frame_len);
+    }
+
+    free(jpeg);
+    return 0;
+}
+// eof
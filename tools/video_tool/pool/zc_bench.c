@@ -0,0 +1,186 @@
+/*
+ * Copies per payload byte of the video pool, copying send against zero-copy
+ * pbuf send, and a session closed while the mac still holds pbufs.
+ * video_transfer.c is built in here with the sdk calls stood in by host/.
+ *   ./zc_bench [frames] [frame_kb]
+ */
+#include "../../../components/video_transfer/video_transfer.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "pool_feed.h"
+
+#define ZC_MAC_DEPTH                64
+
+#define CHECK(x)                    do { if (!(x)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #x); exit(1); } } while (0)
+
+static UINT64 sock_bytes;           // copied by the socket, lwip_sendto into a new pbuf
+static UINT8 sock_buf[TVIDEO_RXNODE_SIZE_UDP];
+static struct pbuf *mac_q[ZC_MAC_DEPTH];
+static UINT32 mac_cnt;
+static UINT32 mac_depth;            // mac takes this many before it says no
+
+static int zc_send_copy(UINT8 *data, UINT32 len)
+{
+    memcpy(sock_buf, data, len);
+    sock_bytes += len;
+    return len;
+}
+
+static int zc_send_pbuf(struct pbuf *p)
+{
+    if (mac_cnt >= mac_depth)
+    {
+        return 0;
+    }
+
+    // node data must already sit behind the header room, nothing moves it
+    CHECK((UINT8 *)p->payload >= (UINT8 *)p + TVIDEO_ZC_PC_SIZE + TVIDEO_ZC_HDR_ROOM - PBUF_TRANSPORT_HLEN);
+    pbuf_ref(p);
+    mac_q[mac_cnt++] = p;
+    return p->tot_len;
+}
+
+// mac is done with the oldest n frames
+static void zc_mac_release(UINT32 n)
+{
+    UINT32 i;
+
+    if (n > mac_cnt)
+    {
+        n = mac_cnt;
+    }
+    for (i = 0; i < n; i++)
+    {
+        pbuf_free(mac_q[i]);
+    }
+    memmove(mac_q, mac_q + n, (mac_cnt - n) * sizeof(mac_q[0]));
+    mac_cnt -= n;
+}
+
+static void zc_open(UINT32 zero_copy)
+{
+    TVIDEO_SETUP_DESC_ST setup;
+
+    memset(&setup, 0, sizeof(setup));
+    setup.open_type = TVIDEO_OPEN_SCCB;
+    setup.send_type = TVIDEO_SND_UDP;
+    setup.send_func = zc_send_copy;
+    if (zero_copy)
+    {
+        setup.send_pbuf_func = zc_send_pbuf;
+    }
+
+    pool_feed_open(&setup);
+}
+
+static UINT32 zc_free_cnt(void)
+{
+    return co_list_cnt(&tvideo_pool.free);
+}
+
+static void zc_bench(UINT32 zero_copy, UINT8 *jpeg, UINT32 frames, UINT32 frame_len)
+{
+    struct timespec t0, t1;
+    UINT64 payload;
+    double us;
+    UINT32 i;
+
+    memset(&host_count, 0, sizeof(host_count));
+    sock_bytes = 0;
+    mac_depth = ZC_MAC_DEPTH;
+
+    zc_open(zero_copy);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (i = 0; i < frames; i++)
+    {
+        pool_feed_frame(jpeg, frame_len);
+        zc_mac_release(mac_cnt);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    payload = tvideo_pool.stats.bytes_sent;
+    CHECK(payload == (UINT64)frames * frame_len);
+    CHECK(tvideo_pool.stats.nodes_in_use == 0);
+    CHECK(zc_free_cnt() == tvideo_pool.node_cnt);
+    tvideo_pool_deinit();
+
+    us = (t1.tv_sec - t0.tv_sec) * 1e6 + (t1.tv_nsec - t0.tv_nsec) / 1e3;
+    printf("%-10s payload %8llu B  dma %8llu B  socket %8llu B  copies/byte %.2f  %.0f MB/s\n",
+           zero_copy ? "zero-copy" : "copy", (unsigned long long)payload,
+           (unsigned long long)host_count.dma_bytes, (unsigned long long)sock_bytes,
+           (double)(host_count.dma_bytes + sock_bytes) / payload, payload / us);
+}
+
+// session closes with pbufs in the mac, next one opens before they come back
+static void zc_close_inflight(UINT8 *jpeg, UINT32 frame_len)
+{
+    UINT32 held, frees;
+
+    memset(&host_count, 0, sizeof(host_count));
+    mac_depth = 6;
+
+    zc_open(1);
+    pool_feed_frame(jpeg, frame_len);
+    held = mac_cnt;
+    CHECK(held == 6);
+    CHECK(tvideo_pool.zc_inflight == held);
+
+    frees = host_count.frees;
+    tvideo_pool_deinit();
+    // elem array goes, pool stays with the mac
+    CHECK(host_count.frees == frees + 1);
+    CHECK(tvideo_pool.zc_old_pool != NULL);
+    CHECK(tvideo_pool.zc_inflight == 0);
+
+    // the new session, old pbufs must not land on its free list
+    zc_open(1);
+    mac_depth = ZC_MAC_DEPTH;
+    CHECK(zc_free_cnt() == tvideo_pool.node_cnt);
+    mac_q[held] = NULL;
+    zc_mac_release(held - 1);
+    CHECK(zc_free_cnt() == tvideo_pool.node_cnt);
+    CHECK(tvideo_pool.zc_old_inflight == 1);
+    CHECK(tvideo_pool.zc_old_pool != NULL);
+
+    // new session sends meanwhile, its nodes are counted apart
+    pool_feed_frame(jpeg, frame_len);
+    CHECK(tvideo_pool.zc_inflight == mac_cnt - 1);
+
+    // the last old pbuf hands the old pool back to the heap
+    frees = host_count.frees;
+    zc_mac_release(1);
+    CHECK(host_count.frees == frees + 1);
+    CHECK(tvideo_pool.zc_old_pool == NULL);
+
+    zc_mac_release(mac_cnt);
+    CHECK(tvideo_pool.zc_inflight == 0);
+    CHECK(tvideo_pool.stats.nodes_in_use == 0);
+    CHECK(zc_free_cnt() == tvideo_pool.node_cnt);
+    tvideo_pool_deinit();
+    CHECK(host_count.mallocs == host_count.frees);
+    printf("close with %d pbufs inflight: ok\n", held);
+}
+
+int main(int argc, char **argv)
+{
+    UINT32 frames = (argc > 1) ? atoi(argv[1]) : 2000;
+    UINT32 frame_len = ((argc > 2) ? atoi(argv[2]) : 20) * 1024;
+    UINT8 *jpeg = malloc(frame_len);
+    UINT32 i;
+
+    for (i = 0; i < frame_len; i++)
+    {
+        jpeg[i] = rand();
+    }
+
+    zc_bench(0, jpeg, frames, frame_len);
+    zc_bench(1, jpeg, frames, frame_len);
+    zc_close_inflight(jpeg, frame_len);
+
+    free(jpeg);
+    return 0;
+}
+// eof
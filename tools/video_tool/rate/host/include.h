@@ -0,0 +1,18 @@
+#ifndef __VRATE_HOST_INCLUDE_H__
+#define __VRATE_HOST_INCLUDE_H__
+
+// stand-in for the sdk include.h, lets components/video_transfer/video_rate.c build on a pc
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t UINT8;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef uint64_t UINT64;
+typedef int32_t INT32;
+
+#define CFG_USE_APP_DEMO_VIDEO_TRANSFER   1
+#define CFG_USE_CAMERA_INTF               1
+
+#endif
+// eof
@@ -0,0 +1,546 @@
+/*
+ * Trace driven bench for the jpeg rate controller in video_rate.c. A trace
+ * is a list of segments: how long, what the link carries, how big the
+ * frames of the scene are at full quality, and the packet loss on the air.
+ * The bench plays the camera, the encoder with its hardware bitrate control,
+ * the node pool of video_transfer.c with its frame drop watermarks, the link
+ * and a receiver that reports its loss once a second. Each segment is run
+ * with the controller and without it (20 fps, no size target, like before),
+ * and it prints what came through complete and how fast the controller
+ * settled after the change. It fails when in the second half of a segment,
+ * once settled, the controller gets fewer good frames through than no
+ * control, or as many but with clearly less in them.
+ *
+ *   rate_bench [-v] [trace]
+ *     trace  lines of: ms kB/s frame_bytes [loss per mille], # comments
+ *            frame_bytes can be recorded on the board with bitrate control off
+ *     -v     print every controller update
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "include.h"
+#include "video_transfer.h"
+#include "video_rate.h"
+
+#define BENCH_NODE_LEN              1472        // TVIDEO_RXNODE_SIZE_UDP
+#define BENCH_NODE_CNT              25          // TVIDEO_POOL_NODE_CNT
+#define BENCH_LOW_WM                (BENCH_NODE_CNT / 5)
+#define BENCH_HIGH_WM               (BENCH_NODE_CNT / 2)
+#define BENCH_PERIOD                8           // TVIDEO_RATE_PERIOD
+#define BENCH_SIZE_MAX              (35 * 1024) // JPEG_BITRATE_MAX_SIZE
+#define BENCH_SIZE_MIN              (BENCH_SIZE_MAX / 8)
+#define BENCH_READOUT               60          // percent of the frame time the jpeg data comes in
+#define BENCH_REPORT_MS             1000
+#define BENCH_SEG_MAX               64
+#define BENCH_FRAME_RING            64
+// settled worse than no control: under 9/10 of its good frames, or under
+// 11/10 of them with under 9/10 of its good bytes
+#define BENCH_WORSE_NUM             9
+#define BENCH_BETTER_NUM            11
+#define BENCH_WORSE_DEN             10
+
+#define BENCH_DROP_NONODE           0x01
+#define BENCH_DROP_WM               0x02
+
+typedef struct
+{
+    UINT32 ms;
+    UINT32 kbps;                // kB/s, 1000 bytes
+    UINT32 frame;               // bytes at full quality
+    UINT32 loss;                // per mille
+} BENCH_SEG_ST;
+
+typedef struct
+{
+    const char *name;
+    UINT32 cnt;
+    BENCH_SEG_ST seg[BENCH_SEG_MAX];
+} BENCH_TRACE_ST;
+
+typedef struct
+{
+    UINT32 pkts;
+    UINT32 out;                 // sent or lost on the air
+    UINT32 done;                // all of it came from the encoder
+    UINT32 bytes;
+    UINT32 bad;
+} BENCH_FRAME_ST;
+
+typedef struct
+{
+    UINT32 frames_ok;
+    UINT32 bytes_ok;
+    UINT32 frames;
+    UINT32 frames_dropped;
+    UINT32 bytes_sent;
+    UINT32 last_drop;           // ms from segment start
+    UINT32 late_frames_ok;      // second half of the segment
+    UINT32 late_bytes_ok;
+    double target_sum;
+    double target_sq;
+    UINT32 target_cnt;
+} BENCH_SEG_RES_ST;
+
+typedef struct
+{
+    UINT32 seed;
+    UINT32 rate_on;
+    UINT32 verbose;
+
+    // encoder
+    double scale;               // quality knob of the hardware, 1 is full quality
+    UINT32 fps;
+    VRATE_ST rc;
+
+    // node pool
+    UINT32 node_len[BENCH_NODE_CNT];
+    UINT32 node_frame[BENCH_NODE_CNT];
+    UINT32 q_rd, q_wr;
+    UINT32 drop_flag;
+    UINT32 frame_drop_pkts;
+    TVIDEO_STATS_ST stats;
+    TVIDEO_STATS_ST last;
+    UINT32 last_ms;
+
+    // link and receiver
+    UINT32 credit;
+    BENCH_FRAME_ST frame[BENCH_FRAME_RING];
+    UINT32 air_pkts, air_lost;
+    UINT32 rx_loss;
+
+    BENCH_SEG_RES_ST *res;
+    UINT32 seg_ms;
+    UINT32 seg_len;
+} BENCH_ST;
+
+static UINT32 bench_rand(BENCH_ST *b)
+{
+    b->seed ^= b->seed << 13;
+    b->seed ^= b->seed >> 17;
+    b->seed ^= b->seed << 5;
+    return b->seed;
+}
+
+static double bench_uniform(BENCH_ST *b)
+{
+    return (bench_rand(b) >> 8) / (double)(1 << 24);
+}
+
+static void bench_drop(BENCH_ST *b)
+{
+    b->res->last_drop = b->seg_ms;
+}
+
+// tvideo_rx_handler, one node worth of jpeg data
+static void bench_node_in(BENCH_ST *b, UINT32 id, UINT32 len)
+{
+    if (b->drop_flag)
+    {
+        b->frame_drop_pkts++;
+        b->frame[id % BENCH_FRAME_RING].bad = 1;
+        return;
+    }
+    if (b->q_wr - b->q_rd == BENCH_NODE_CNT)
+    {
+        b->drop_flag |= BENCH_DROP_NONODE;
+        b->frame_drop_pkts++;
+        b->frame[id % BENCH_FRAME_RING].bad = 1;
+        return;
+    }
+
+    b->node_len[b->q_wr % BENCH_NODE_CNT] = len;
+    b->node_frame[b->q_wr % BENCH_NODE_CNT] = id;
+    b->q_wr++;
+    b->frame[id % BENCH_FRAME_RING].pkts++;
+    b->stats.nodes_in_use++;
+}
+
+// tvideo_frame_drop_update
+static void bench_frame_end(BENCH_ST *b)
+{
+    UINT32 free_cnt = BENCH_NODE_CNT - b->stats.nodes_in_use;
+
+    b->stats.frames++;
+    b->res->frames++;
+    if (b->frame_drop_pkts)
+    {
+        b->stats.frames_dropped++;
+        b->stats.pkts_dropped += b->frame_drop_pkts;
+        b->res->frames_dropped++;
+        b->frame_drop_pkts = 0;
+        bench_drop(b);
+    }
+
+    b->drop_flag &= ~BENCH_DROP_NONODE;
+    if (b->drop_flag & BENCH_DROP_WM)
+    {
+        if (free_cnt >= BENCH_HIGH_WM)
+        {
+            b->drop_flag &= ~BENCH_DROP_WM;
+        }
+    }
+    else if (free_cnt < BENCH_LOW_WM)
+    {
+        b->drop_flag |= BENCH_DROP_WM;
+    }
+}
+
+// what the hardware does with the targets, a step of quality per frame
+static void bench_encoder_adjust(BENCH_ST *b, UINT32 size)
+{
+    if (!b->rate_on)
+    {
+        return;
+    }
+    if (size > b->rc.target)
+    {
+        b->scale *= 0.9;
+    }
+    else if ((size < b->rc.low) && (b->scale < 1))
+    {
+        b->scale *= 1.1;
+        if (b->scale > 1)
+        {
+            b->scale = 1;
+        }
+    }
+}
+
+// tvideo_rate_poll
+static void bench_rate_poll(BENCH_ST *b, UINT32 now)
+{
+    VRATE_IN_ST in;
+    UINT32 ret;
+
+    if (!b->rate_on || (b->stats.frames - b->last.frames < BENCH_PERIOD))
+    {
+        return;
+    }
+
+    in.elapse_ms = now - b->last_ms;
+    in.frames = b->stats.frames - b->last.frames;
+    in.frames_dropped = b->stats.frames_dropped - b->last.frames_dropped;
+    in.pkts_dropped = b->stats.pkts_dropped - b->last.pkts_dropped;
+    in.pkts_stale = 0;          // no pacer in here
+    in.bytes_sent = b->stats.bytes_sent - b->last.bytes_sent;
+    in.nodes_in_use = b->stats.nodes_in_use;
+    in.node_cnt = BENCH_NODE_CNT;
+    in.rx_loss = b->rx_loss;
+    b->rx_loss = VRATE_RX_LOSS_NONE;
+
+    ret = vrate_update(&b->rc, &in);
+    if (ret & VRATE_NEW_FPS)
+    {
+        b->fps = b->rc.fps;
+    }
+    if (b->verbose)
+    {
+        printf("  %6u ms  rate %4u kB/s  q %2u  drops %u/%u  loss %4d  -> target %5u fps %2u%s\n",
+               now, b->rc.rate / 1000, in.nodes_in_use, in.frames_dropped, in.frames,
+               (in.rx_loss == VRATE_RX_LOSS_NONE) ? -1 : (int)in.rx_loss,
+               b->rc.target, vrate_fps(b->rc.fps), ret ? " *" : "");
+    }
+
+    b->last = b->stats;
+    b->last_ms = now;
+}
+
+// the link takes the head node once it has the bytes for it
+static void bench_link(BENCH_ST *b, const BENCH_SEG_ST *seg)
+{
+    BENCH_FRAME_ST *f;
+    UINT32 len;
+
+    b->credit += seg->kbps;
+    while (b->q_rd != b->q_wr)
+    {
+        len = b->node_len[b->q_rd % BENCH_NODE_CNT];
+        if (b->credit < len)
+        {
+            return;
+        }
+        b->credit -= len;
+
+        f = &b->frame[b->node_frame[b->q_rd % BENCH_NODE_CNT] % BENCH_FRAME_RING];
+        b->q_rd++;
+        b->stats.nodes_in_use--;
+        b->stats.pkts_sent++;
+        b->stats.bytes_sent += len;
+        b->res->bytes_sent += len;
+
+        b->air_pkts++;
+        if (bench_uniform(b) * 1000 < seg->loss)
+        {
+            b->air_lost++;
+            f->bad = 1;
+        }
+        f->out++;
+        f->bytes += len;
+    }
+
+    // an idle link does not save up
+    if (b->credit > BENCH_NODE_LEN)
+    {
+        b->credit = BENCH_NODE_LEN;
+    }
+}
+
+static void bench_frame_check(BENCH_ST *b, UINT32 id)
+{
+    BENCH_FRAME_ST *f = &b->frame[id % BENCH_FRAME_RING];
+
+    if (f->done && f->pkts && (f->out == f->pkts))
+    {
+        if (!f->bad)
+        {
+            b->res->frames_ok++;
+            b->res->bytes_ok += f->bytes;
+            if (b->seg_ms >= b->seg_len / 2)
+            {
+                b->res->late_frames_ok++;
+                b->res->late_bytes_ok += f->bytes;
+            }
+        }
+        f->pkts = 0;
+    }
+}
+
+static void bench_run(const BENCH_TRACE_ST *tr, UINT32 rate_on, UINT32 verbose,
+                      BENCH_SEG_RES_ST *res)
+{
+    static BENCH_ST b;
+    VRATE_CFG_ST cfg;
+    UINT32 s, now = 0, t_frame = 0, t_read = 0, id = 0, size = 0, pkts = 0, put = 0;
+    UINT32 frame_ms, want, len, in_frame = 0, report_at = BENCH_REPORT_MS, i;
+
+    memset(&b, 0, sizeof(b));
+    b.seed = 0x2545F491;
+    b.rate_on = rate_on;
+    b.verbose = verbose;
+    b.scale = 1;
+    b.fps = TYPE_20FPS;
+    b.rx_loss = VRATE_RX_LOSS_NONE;
+
+    cfg.size_min = BENCH_SIZE_MIN;
+    cfg.size_max = BENCH_SIZE_MAX;
+    cfg.period = BENCH_PERIOD;
+    cfg.fps_min = TYPE_5FPS;
+    cfg.fps_max = TYPE_20FPS;
+    vrate_init(&b.rc, &cfg);
+
+    for (s = 0; s < tr->cnt; s++)
+    {
+        const BENCH_SEG_ST *seg = &tr->seg[s];
+
+        memset(&res[s], 0, sizeof(res[s]));
+        res[s].last_drop = (UINT32) - 1;
+        b.res = &res[s];
+        b.seg_len = seg->ms;
+        for (b.seg_ms = 0; b.seg_ms < seg->ms; b.seg_ms++, now++)
+        {
+            frame_ms = 1000 / vrate_fps(b.fps);
+
+            if (now >= t_frame)
+            {
+                // camera starts a frame, the size the encoder ends up with
+                id++;
+                size = seg->frame * (0.9 + 0.2 * bench_uniform(&b)) * b.scale;
+                if (size < 1024)
+                {
+                    size = 1024;
+                }
+                pkts = (size + BENCH_NODE_LEN - 1) / BENCH_NODE_LEN;
+                put = 0;
+                in_frame = 1;
+                memset(&b.frame[id % BENCH_FRAME_RING], 0, sizeof(BENCH_FRAME_ST));
+                t_read = now;
+                t_frame = now + frame_ms;
+            }
+
+            if (in_frame)
+            {
+                want = pkts * (now - t_read + 1) / (frame_ms * BENCH_READOUT / 100);
+                for (; (put < want) && (put < pkts); put++)
+                {
+                    len = (put + 1 < pkts) ? BENCH_NODE_LEN : size - put * BENCH_NODE_LEN;
+                    bench_node_in(&b, id, len);
+                }
+                if (put == pkts)
+                {
+                    in_frame = 0;
+                    b.frame[id % BENCH_FRAME_RING].done = 1;
+                    bench_frame_end(&b);
+                    bench_encoder_adjust(&b, size);
+                    bench_rate_poll(&b, now);
+                    res[s].target_sum += b.rc.target;
+                    res[s].target_sq += (double)b.rc.target * b.rc.target;
+                    res[s].target_cnt++;
+                }
+            }
+
+            bench_link(&b, seg);
+            for (i = 0; i < 4; i++)
+            {
+                bench_frame_check(&b, id - i);
+            }
+
+            if (now >= report_at)
+            {
+                if (b.air_pkts)
+                {
+                    b.rx_loss = b.air_lost * 1000 / b.air_pkts;
+                }
+                b.air_pkts = b.air_lost = 0;
+                report_at = now + BENCH_REPORT_MS;
+            }
+        }
+    }
+}
+
+static int bench_worse(const BENCH_SEG_RES_ST *on, const BENCH_SEG_RES_ST *off)
+{
+    if (on->late_frames_ok * BENCH_WORSE_DEN < off->late_frames_ok * BENCH_WORSE_NUM)
+    {
+        return 1;
+    }
+    return (on->late_frames_ok * BENCH_WORSE_DEN < off->late_frames_ok * BENCH_BETTER_NUM)
+           && ((UINT64)on->late_bytes_ok * BENCH_WORSE_DEN < (UINT64)off->late_bytes_ok * BENCH_WORSE_NUM);
+}
+
+// returns the number of segments the controller settled worse in
+static UINT32 bench_trace(const BENCH_TRACE_ST *tr, UINT32 verbose)
+{
+    static BENCH_SEG_RES_ST on[BENCH_SEG_MAX], off[BENCH_SEG_MAX];
+    UINT32 s, worse = 0;
+    double secs, mean, cv;
+    char settle[16];
+
+    printf("%s\n", tr->name);
+    bench_run(tr, 0, 0, off);
+    bench_run(tr, 1, verbose, on);
+
+    printf("  %6s %5s %6s %4s |  %-31s | %-31s %-14s %s\n", "ms", "kB/s", "frame", "loss",
+           "no control: fps  kB/frame  good", "control: fps  kB/frame  good", "target kB/cv", "settled");
+    for (s = 0; s < tr->cnt; s++)
+    {
+        const BENCH_SEG_ST *seg = &tr->seg[s];
+
+        secs = seg->ms / 1000.0;
+        mean = on[s].target_cnt ? on[s].target_sum / on[s].target_cnt : 0;
+        cv = on[s].target_cnt ? sqrt(on[s].target_sq / on[s].target_cnt - mean * mean) / mean : 0;
+        if (on[s].last_drop == (UINT32) - 1)
+        {
+            snprintf(settle, sizeof(settle), "no drops");
+        }
+        else if (on[s].last_drop > seg->ms * 4 / 5)
+        {
+            snprintf(settle, sizeof(settle), "never");
+        }
+        else
+        {
+            snprintf(settle, sizeof(settle), "%u ms", on[s].last_drop);
+        }
+
+        printf("  %6u %5u %6u %4u |  %14.1f %9.1f %5.0f%% | %11.1f %9.1f %5.0f%%   %5.1f/%4.2f  %s\n",
+               seg->ms, seg->kbps, seg->frame, seg->loss,
+               off[s].frames_ok / secs, off[s].frames_ok ? off[s].bytes_ok / 1024.0 / off[s].frames_ok : 0,
+               100.0 * off[s].bytes_ok / (seg->kbps * secs * 1000),
+               on[s].frames_ok / secs, on[s].frames_ok ? on[s].bytes_ok / 1024.0 / on[s].frames_ok : 0,
+               100.0 * on[s].bytes_ok / (seg->kbps * secs * 1000), mean / 1024, cv, settle);
+    }
+
+    for (s = 0; s < tr->cnt; s++)
+    {
+        if (bench_worse(&on[s], &off[s]))
+        {
+            secs = tr->seg[s].ms / 2000.0;
+            printf("  FAIL segment %u settled worse than no control: %.1f fps %.1f kB/s good, without %.1f fps %.1f kB/s\n",
+                   s + 1, on[s].late_frames_ok / secs, on[s].late_bytes_ok / 1000.0 / secs,
+                   off[s].late_frames_ok / secs, off[s].late_bytes_ok / 1000.0 / secs);
+            worse++;
+        }
+    }
+
+    return worse;
+}
+
+static int bench_load(BENCH_TRACE_ST *tr, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256];
+    BENCH_SEG_ST *seg;
+
+    if (fp == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+
+    tr->name = path;
+    tr->cnt = 0;
+    while (fgets(line, sizeof(line), fp) && (tr->cnt < BENCH_SEG_MAX))
+    {
+        seg = &tr->seg[tr->cnt];
+        seg->loss = 0;
+        if ((line[0] == '#') || (sscanf(line, "%u %u %u %u", &seg->ms, &seg->kbps, &seg->frame, &seg->loss) < 3))
+        {
+            continue;
+        }
+        tr->cnt++;
+    }
+    fclose(fp);
+
+    return tr->cnt ? 0 : -1;
+}
+
+static const BENCH_TRACE_ST bench_builtin[] =
+{
+    {
+        "link steps, 30 kB frames", 5,
+        {{10000, 900, 30000, 0}, {10000, 250, 30000, 0}, {10000, 900, 30000, 0},
+         {10000, 60, 30000, 0}, {10000, 900, 30000, 0}}
+    },
+    {
+        "scene changes, 400 kB/s link", 4,
+        {{10000, 400, 12000, 0}, {10000, 400, 40000, 0}, {10000, 400, 6000, 0},
+         {10000, 400, 30000, 0}}
+    },
+    {
+        "air loss, 900 kB/s link, 25 kB frames", 3,
+        {{10000, 900, 25000, 0}, {10000, 900, 25000, 80}, {10000, 900, 25000, 0}}
+    },
+};
+
+int main(int argc, char **argv)
+{
+    static BENCH_TRACE_ST tr;
+    UINT32 verbose = 0, worse = 0, i;
+
+    if ((argc > 1) && (strcmp(argv[1], "-v") == 0))
+    {
+        verbose = 1;
+        argc--;
+        argv++;
+    }
+
+    if (argc > 1)
+    {
+        if (bench_load(&tr, argv[1]))
+        {
+            fprintf(stderr, "usage: rate_bench [-v] [trace]\n");
+            return 1;
+        }
+        return bench_trace(&tr, verbose) ? 1 : 0;
+    }
+
+    for (i = 0; i < sizeof(bench_builtin) / sizeof(bench_builtin[0]); i++)
+    {
+        worse += bench_trace(&bench_builtin[i], verbose);
+    }
+
+    return worse ? 1 : 0;
+}
+// eof
@@ -0,0 +1,621 @@
+/*
+ * Receiver and meter for the video stream of app/video_work, in place of the
+ * windows pc tool. Starts the stream like that tool does, puts the frames
+ * together (udp: packet headers and fec parity through vfec_rx, tcp: jpeg
+ * markers), writes them to an mjpeg file and measures each frame: time from
+ * its first packet to its last (span), gap to the frame before, interarrival
+ * jitter, packets lost and throughput. Frames of video_tx carry their send
+ * time, with those the end to end latency is measured too.
+ *
+ *   video_rx [-t] [-d] [-o file.mjpeg] [-s seconds] [-l loss%] [-f k,m] [-n] [-r] [-v] board_ip
+ *     -t  tcp instead of udp
+ *     -d  ports and header of the SUPPORT_TIANZHIHENG_DRONE build
+ *     -l  drop a share of the udp packets on purpose
+ *     -f  ask for fec parity, k data and m parity packets per block
+ *     -n  ask for lost packets (CMD_NACK)
+ *     -r  report the loss every second (CMD_RX_LOSS), for the rate control
+ *     -v  a line per frame
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "include.h"
+#include "vfec_rx.h"
+#include "vstream.h"
+
+#define RX_TICK_US                  5000
+#define RX_NACK_MAX                 64
+#define RX_NACK_TRIES               3
+#define RX_RENACK_US                30000
+#define RX_TCP_BUF_LEN              (1024 * 1024)
+#define RX_JITTER_DIV               16          // rfc 3550
+
+typedef struct
+{
+    UINT32 *v;
+    UINT32 cnt;
+    UINT32 max;
+} RX_SAMPLES_ST;
+
+// packets of one frame id, for the loss count and the time of its first packet
+typedef struct
+{
+    UINT8 open;
+    UINT8 total;                // pkt_seq of the eof packet, 0 until it came
+    UINT8 max_seq;
+    UINT32 first_us;
+    UINT32 got;
+    UINT8 have[VFEC_RX_SEQ_MAX];
+} RX_TRACK_ST;
+
+typedef struct
+{
+    VSTREAM_CFG_ST cfg;
+    int fd;
+    UINT32 tcp;
+    struct sockaddr_in img;
+    struct sockaddr_in cmd;
+    FILE *out;
+    UINT32 verbose;
+    double loss;
+
+    // udp
+    VFEC_RX_ST rx;
+    RX_TRACK_ST track[256];
+    UINT32 started;
+    UINT8 newest;
+    UINT32 pkts_expected;
+    UINT32 pkts_lost;
+    UINT32 pkts_dropped;        // on purpose
+    UINT32 nack_on;
+    UINT32 nack_at[256][256];
+    UINT8 nack_cnt[256][256];
+    UINT32 nacks;
+    UINT32 report_on;
+    UINT32 reports;
+
+    // tcp
+    UINT8 *buf;
+    UINT32 buf_len;
+    UINT32 first_us;            // first byte of the frame at the head of buf
+
+    UINT32 frames;
+    UINT32 frames_broken;       // tcp, cut short by the next frame
+    UINT32 frames_recovered;
+    UINT32 bytes;
+    UINT32 last_us;
+    UINT32 last_transit;
+    UINT32 last_stamped;
+    double gap_avg;
+    double jitter;
+    RX_SAMPLES_ST span;
+    RX_SAMPLES_ST latency;
+    RX_SAMPLES_ST gap;
+} RX_ST;
+
+static void rx_sample(RX_SAMPLES_ST *s, UINT32 us)
+{
+    if (s->cnt == s->max)
+    {
+        s->max = s->max ? s->max * 2 : 1024;
+        s->v = realloc(s->v, s->max * sizeof(UINT32));
+        if (s->v == NULL)
+        {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    s->v[s->cnt++] = us;
+}
+
+static int rx_cmp(const void *a, const void *b)
+{
+    UINT32 x = *(const UINT32 *)a, y = *(const UINT32 *)b;
+
+    return (x > y) - (x < y);
+}
+
+static void rx_samples_print(const char *name, RX_SAMPLES_ST *s)
+{
+    double sum = 0;
+    UINT32 i;
+
+    if (s->cnt == 0)
+    {
+        return;
+    }
+
+    qsort(s->v, s->cnt, sizeof(UINT32), rx_cmp);
+    for (i = 0; i < s->cnt; i++)
+    {
+        sum += s->v[i];
+    }
+    printf("%-8s ms  avg %.1f  p50 %.1f  p95 %.1f  max %.1f\n", name, sum / s->cnt / 1000,
+           s->v[s->cnt / 2] / 1000.0, s->v[s->cnt * 95 / 100] / 1000.0, s->v[s->cnt - 1] / 1000.0);
+}
+
+static void rx_cmd(RX_ST *r, struct sockaddr_in *to, const UINT8 *msg, UINT32 len)
+{
+    sendto(r->fd, msg, len, 0, (struct sockaddr *)to, sizeof(*to));
+}
+
+// a whole jpeg came, first_us is when its first byte did
+static void rx_frame_done(RX_ST *r, const UINT8 *jpeg, UINT32 len, UINT32 first_us, UINT32 recovered)
+{
+    UINT32 now = vstream_now_us(), sent_us, transit = 0, stamped, gap = 0;
+    double d = 0;
+
+    stamped = vjpeg_stamp_get(jpeg, len, &sent_us);
+    if (stamped)
+    {
+        transit = now - sent_us;
+        rx_sample(&r->latency, transit);
+    }
+    rx_sample(&r->span, now - first_us);
+
+    if (r->frames)
+    {
+        gap = now - r->last_us;
+        rx_sample(&r->gap, gap);
+
+        // rfc 3550 interarrival jitter, from the send times when the frames have
+        // them, else against the average gap
+        if (stamped && r->last_stamped)
+        {
+            d = (double)(INT32)(transit - r->last_transit);
+        }
+        else if (r->frames > 1)
+        {
+            d = gap - r->gap_avg;
+        }
+        r->jitter += ((d < 0 ? -d : d) - r->jitter) / RX_JITTER_DIV;
+        r->gap_avg += (gap - r->gap_avg) / r->frames;
+    }
+
+    if (r->verbose)
+    {
+        printf("frame %u: %u bytes  span %.1f ms  gap %.1f ms", r->frames, len,
+               (now - first_us) / 1000.0, gap / 1000.0);
+        if (stamped)
+        {
+            printf("  latency %.1f ms", transit / 1000.0);
+        }
+        printf(recovered ? "  fec %u\n" : "\n", recovered);
+    }
+    if (r->out && (fwrite(jpeg, 1, len, r->out) != len))
+    {
+        perror("write");
+        fclose(r->out);
+        r->out = NULL;
+    }
+
+    r->frames++;
+    r->frames_recovered += recovered ? 1 : 0;
+    r->bytes += len;
+    r->last_us = now;
+    r->last_transit = transit;
+    r->last_stamped = stamped;
+}
+
+static void rx_udp_frame_cb(void *arg, UINT32 id, const UINT8 *frame, UINT32 len, UINT32 recovered)
+{
+    RX_ST *r = (RX_ST *)arg;
+
+    rx_frame_done(r, frame, len, r->track[id & 0xFF].first_us, recovered);
+}
+
+static void rx_track_close(RX_ST *r, RX_TRACK_ST *t)
+{
+    // without the eof packet at least that one is missing
+    UINT32 expected = t->total ? t->total : t->max_seq + 1;
+
+    r->pkts_expected += expected;
+    r->pkts_lost += expected - t->got;
+    t->open = 0;
+}
+
+// frames stay open as long as vfec_rx keeps them, packets after that are late
+static void rx_track(RX_ST *r, const UINT8 *pkt, UINT32 now)
+{
+    RX_TRACK_ST *t = &r->track[pkt[0]];
+    UINT32 seq = pkt[3], i;
+
+    if (r->started && ((signed char)(pkt[0] - r->newest) <= -VFEC_RX_FRAMES))
+    {
+        return;
+    }
+    if (!r->started || ((signed char)(pkt[0] - r->newest) > 0))
+    {
+        r->newest = pkt[0];
+        r->started = 1;
+        for (i = 0; i < 256; i++)
+        {
+            if (r->track[i].open && ((signed char)(r->newest - i) >= VFEC_RX_FRAMES))
+            {
+                rx_track_close(r, &r->track[i]);
+            }
+        }
+    }
+
+    if (!t->open)
+    {
+        memset(t, 0, sizeof(RX_TRACK_ST));
+        t->open = 1;
+        t->first_us = now;
+    }
+    if ((pkt[1] & VFEC_PARITY_FLAG) || (seq == 0) || t->have[seq])
+    {
+        return;
+    }
+
+    t->have[seq] = 1;
+    t->got++;
+    if (seq > t->max_seq)
+    {
+        t->max_seq = seq;
+    }
+    if (pkt[1] == 1)
+    {
+        t->total = seq;
+    }
+}
+
+// CMD_IMG_HEADER, CMD_NACK, frame id, count, pkt_seq...
+static void rx_nack(RX_ST *r, UINT32 now)
+{
+    UINT16 list[RX_NACK_MAX * 2];
+    UINT8 msg[4 + RX_NACK_MAX];
+    UINT32 cnt, i, id, seq;
+
+    cnt = vfec_rx_missing(&r->rx, list, RX_NACK_MAX * 2);
+    msg[3] = 0;
+    for (i = 0; i <= cnt; i++)
+    {
+        id = (i < cnt) ? (list[i] >> 8) : 0x100;
+        if (msg[3] && ((id != msg[2]) || (msg[3] == RX_NACK_MAX)))
+        {
+            rx_cmd(r, &r->cmd, msg, 4 + msg[3]);
+            r->nacks++;
+            msg[3] = 0;
+        }
+        if (i == cnt)
+        {
+            break;
+        }
+
+        seq = list[i] & 0xFF;
+        if ((r->nack_cnt[id][seq] >= RX_NACK_TRIES)
+                || (r->nack_cnt[id][seq] && (now - r->nack_at[id][seq] < RX_RENACK_US)))
+        {
+            continue;
+        }
+        r->nack_cnt[id][seq]++;
+        r->nack_at[id][seq] = now;
+
+        msg[0] = r->cfg.cmd_hdr;
+        msg[1] = VSTREAM_CMD_NACK;
+        msg[2] = id;
+        msg[4 + msg[3]++] = seq;
+    }
+}
+
+static void rx_udp_input(RX_ST *r, const UINT8 *pkt, UINT32 len, UINT32 now)
+{
+    UINT32 newest = r->rx.newest, started = r->rx.started;
+
+    if (rand() < r->loss * RAND_MAX)
+    {
+        r->pkts_dropped++;
+        return;
+    }
+
+    if (len >= 4)
+    {
+        rx_track(r, pkt, now);
+    }
+    vfec_rx_input(&r->rx, pkt, len);
+    if (!started || (r->rx.newest != newest))
+    {
+        // frame ids come round again
+        memset(r->nack_cnt[r->rx.newest], 0, sizeof(r->nack_cnt[0]));
+    }
+}
+
+static void rx_tcp_drop(RX_ST *r, UINT32 len)
+{
+    memmove(r->buf, r->buf + len, r->buf_len - len);
+    r->buf_len -= len;
+}
+
+// -1 when the board closed the connection
+static int rx_tcp_input(RX_ST *r, UINT32 now)
+{
+    UINT32 skip;
+    INT32 ret;
+    int len;
+
+    len = recv(r->fd, r->buf + r->buf_len, RX_TCP_BUF_LEN - r->buf_len, 0);
+    if (len <= 0)
+    {
+        return -1;
+    }
+    if (r->buf_len == 0)
+    {
+        r->first_us = now;
+    }
+    r->buf_len += len;
+
+    while (r->buf_len)
+    {
+        skip = vjpeg_find(r->buf, r->buf_len);
+        if ((skip == r->buf_len) && (r->buf[skip - 1] == 0xFF))
+        {
+            // SOI may be split over two reads
+            skip--;
+        }
+        rx_tcp_drop(r, skip);
+
+        ret = vjpeg_scan(r->buf, r->buf_len);
+        if (ret > 0)
+        {
+            rx_frame_done(r, r->buf, ret, r->first_us, 0);
+            rx_tcp_drop(r, ret);
+            r->first_us = now;
+        }
+        else if (ret < 0)
+        {
+            r->frames_broken++;
+            rx_tcp_drop(r, -ret);
+        }
+        else
+        {
+            if (r->buf_len == RX_TCP_BUF_LEN)
+            {
+                r->frames_broken++;
+                r->buf_len = 0;
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static void rx_report(RX_ST *r, UINT32 elapse)
+{
+    if (elapse == 0)
+    {
+        elapse = 1;
+    }
+
+    printf("frames   %u ok, %.1f fps, %.1f kB/s", r->frames, r->frames * 1e6 / elapse,
+           r->bytes * 1e6 / 1024 / elapse);
+    if (r->tcp)
+    {
+        printf(", %u broken\n", r->frames_broken);
+    }
+    else
+    {
+        printf(", %u lost, %u rebuilt by fec\n", r->rx.stats.frames_lost, r->frames_recovered);
+        printf("packets  %u of %u lost (%.2f%%), %u dropped on purpose, %u rebuilt, %u late, %u dup, %u nacks\n",
+               r->pkts_lost, r->pkts_expected,
+               r->pkts_expected ? r->pkts_lost * 100.0 / r->pkts_expected : 0.0,
+               r->pkts_dropped, r->rx.stats.pkts_recovered, r->rx.stats.late_pkts,
+               r->rx.stats.dup_pkts, r->nacks);
+    }
+    rx_samples_print("span", &r->span);
+    rx_samples_print("latency", &r->latency);
+    rx_samples_print("gap", &r->gap);
+    printf("jitter   ms  %.2f\n", r->jitter / 1000);
+}
+
+static void rx_usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-t] [-d] [-o file.mjpeg] [-s seconds] [-l loss%%] [-f k,m] [-n] [-r] [-v] board_ip\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    static RX_ST r;
+    UINT8 pkt[2048], msg[4];
+    UINT32 secs = 10, drone = 0, fec_k = 0, fec_m = 0, now, start, sec_at, tick_at;
+    UINT32 last_frames = 0, last_bytes = 0, last_expected = 0, last_lost = 0, loss;
+    const char *out = NULL;
+    struct timeval tv;
+    fd_set fds;
+    int opt, len;
+
+    while ((opt = getopt(argc, argv, "tdo:s:l:f:nrv")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            r.tcp = 1;
+            break;
+        case 'd':
+            drone = 1;
+            break;
+        case 'o':
+            out = optarg;
+            break;
+        case 's':
+            secs = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            r.loss = atof(optarg) / 100;
+            break;
+        case 'f':
+            if ((sscanf(optarg, "%u,%u", &fec_k, &fec_m) != 2) || (fec_k > VFEC_K_MAX) || (fec_m > VFEC_M_MAX))
+            {
+                fprintf(stderr, "fec k up to %d, m up to %d\n", VFEC_K_MAX, VFEC_M_MAX);
+                return 1;
+            }
+            break;
+        case 'n':
+            r.nack_on = 1;
+            break;
+        case 'r':
+            r.report_on = 1;
+            break;
+        case 'v':
+            r.verbose = 1;
+            break;
+        default:
+            rx_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        rx_usage(argv[0]);
+        return 1;
+    }
+
+    vstream_cfg(&r.cfg, drone);
+    r.img.sin_family = AF_INET;
+    r.img.sin_addr.s_addr = inet_addr(argv[optind]);
+    r.img.sin_port = htons(r.tcp ? r.cfg.tcp_port : r.cfg.img_port);
+    r.cmd = r.img;
+    r.cmd.sin_port = htons(r.cfg.cmd_port);
+
+    if (out && ((r.out = fopen(out, "wb")) == NULL))
+    {
+        perror(out);
+        return 1;
+    }
+    srand(time(NULL));
+
+    if (r.tcp)
+    {
+        // the board starts the video on accept
+        r.buf = malloc(RX_TCP_BUF_LEN);
+        r.fd = socket(AF_INET, SOCK_STREAM, 0);
+        if ((r.buf == NULL) || (r.fd < 0) || connect(r.fd, (struct sockaddr *)&r.img, sizeof(r.img)))
+        {
+            perror("connect");
+            return 1;
+        }
+    }
+    else
+    {
+        r.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if ((r.fd < 0) || vfec_rx_init(&r.rx, r.cfg.hdr_size, rx_udp_frame_cb, &r))
+        {
+            perror("init");
+            return 1;
+        }
+
+        msg[0] = r.cfg.cmd_hdr;
+        msg[1] = r.cfg.cmd_start;
+        msg[2] = fec_k;
+        msg[3] = fec_m;
+        rx_cmd(&r, &r.img, msg, fec_m ? 4 : 2);
+        if (r.nack_on)
+        {
+            // empty nack, the board takes its retransmit cache
+            msg[1] = VSTREAM_CMD_NACK;
+            msg[2] = 0;
+            msg[3] = 0;
+            rx_cmd(&r, &r.cmd, msg, 4);
+        }
+    }
+
+    start = sec_at = tick_at = vstream_now_us();
+    while ((now = vstream_now_us()) - start < secs * 1000000)
+    {
+        FD_ZERO(&fds);
+        FD_SET(r.fd, &fds);
+        tv.tv_sec = 0;
+        tv.tv_usec = RX_TICK_US;
+        if (select(r.fd + 1, &fds, NULL, NULL, &tv) > 0)
+        {
+            now = vstream_now_us();
+            if (r.tcp)
+            {
+                if (rx_tcp_input(&r, now))
+                {
+                    printf("connection closed\n");
+                    break;
+                }
+            }
+            else if ((len = recv(r.fd, pkt, sizeof(pkt), 0)) > 0)
+            {
+                rx_udp_input(&r, pkt, len, now);
+            }
+        }
+
+        now = vstream_now_us();
+        if (r.nack_on && (now - tick_at >= RX_TICK_US))
+        {
+            rx_nack(&r, now);
+            tick_at = now;
+        }
+        if (now - sec_at >= 1000000)
+        {
+            loss = (r.pkts_expected > last_expected)
+                   ? (r.pkts_lost - last_lost) * 1000 / (r.pkts_expected - last_expected) : 0;
+            printf("%u fps  %u kB/s  loss %u.%u%%  jitter %.1f ms\n", r.frames - last_frames,
+                   (r.bytes - last_bytes) / 1024, loss / 10, loss % 10, r.jitter / 1000);
+            if (r.report_on && (r.pkts_expected > last_expected))
+            {
+                // per mille, little endian
+                msg[0] = r.cfg.cmd_hdr;
+                msg[1] = VSTREAM_CMD_RX_LOSS;
+                msg[2] = loss & 0xFF;
+                msg[3] = loss >> 8;
+                rx_cmd(&r, &r.img, msg, 4);
+                r.reports++;
+            }
+            last_frames = r.frames;
+            last_bytes = r.bytes;
+            last_expected = r.pkts_expected;
+            last_lost = r.pkts_lost;
+            sec_at = now;
+        }
+    }
+
+    if (!r.tcp)
+    {
+        UINT32 i;
+
+        msg[0] = r.cfg.cmd_hdr;
+        msg[1] = r.cfg.cmd_stop;
+        rx_cmd(&r, &r.img, msg, 2);
+        vfec_rx_flush(&r.rx);
+        for (i = 0; i < 256; i++)
+        {
+            if (r.track[i].open)
+            {
+                rx_track_close(&r, &r.track[i]);
+            }
+        }
+    }
+
+    rx_report(&r, vstream_now_us() - start);
+
+    if (!r.tcp)
+    {
+        vfec_rx_deinit(&r.rx);
+    }
+    if (r.out)
+    {
+        fclose(r.out);
+    }
+    free(r.buf);
+    free(r.span.v);
+    free(r.latency.v);
+    free(r.gap.v);
+    close(r.fd);
+
+    return 0;
+}
+// eof
@@ -0,0 +1,561 @@
+/*
+ * Stand-in for the board on a linux pc, to run video_rx without hardware.
+ * Serves the udp image and command ports and the tcp port of
+ * video_transfer_config.h and sends the frames the way video_transfer_udp.c
+ * and video_transfer_tcp.c do: packet headers, a frame that does not fit
+ * the queue loses its rest, fec parity from video_fec.c, resends from the
+ * video_rtx.c cache on nack. Frames come from an mjpeg file (video_rx -o
+ * writes one), or are made up, and carry their send time for video_rx.
+ *
+ *   video_tx [-d] [-i file.mjpeg] [-b bytes] [-r fps] [-k kB/s] [-l loss%] [-s seconds]
+ *     -b  size of the made up frames, they vary by a quarter around it
+ *     -k  link rate, packets wait in the queue for it, 0 sends at once
+ *     -l  drop a share of the udp packets on purpose, resends and parity too
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "include.h"
+#include "video_fec.h"
+#include "video_rtx.h"
+#include "vstream.h"
+
+#define TX_QUEUE_LEN                64          // TVIDEO_POOL_NODE_MAX
+#define TX_FRAME_MAX                (255 * 1024)
+#define TX_TICK_US                  2000
+#define TX_RTX_PKTS                 24          // APP_DEMO_UDP_RTX_PKTS
+#define TX_RTX_FRAMES               2
+
+typedef struct
+{
+    VSTREAM_CFG_ST cfg;
+    int img_fd;
+    int cmd_fd;
+    int tcp_fd;
+    int cli_fd;
+    struct sockaddr_in remote;
+    UINT32 udp_on;
+
+    UINT8 *file;
+    UINT32 file_len;
+    UINT32 file_pos;
+    UINT32 frame_bytes;
+    UINT32 fps;
+    UINT8 frame[TX_FRAME_MAX];
+    UINT8 id;
+
+    UINT8 q[TX_QUEUE_LEN][VFEC_PKT_MAX];
+    UINT16 q_len[TX_QUEUE_LEN];
+    UINT32 q_rd;
+    UINT32 q_wr;
+    UINT32 rate;                // bytes/s, 0 for no limit
+    UINT32 link_at;             // link busy until
+    double loss;
+
+    VFEC_ENC_ST fec;
+    VRTX_ST rtx;
+    UINT32 rtx_on;
+
+    UINT32 frames;
+    UINT32 frames_cut;          // queue full, rest of the frame dropped
+    UINT32 pkts;
+    UINT32 bytes;
+    UINT32 pkts_lost;           // on purpose
+    UINT32 parity;
+    UINT32 resent;
+} TX_ST;
+
+static int tx_udp_socket(UINT16 port)
+{
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if ((fd < 0) || bind(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        perror("bind");
+        exit(1);
+    }
+
+    return fd;
+}
+
+// next jpeg with the send time behind SOI, from the file or made up
+static UINT32 tx_make_frame(TX_ST *t)
+{
+    UINT8 *out = t->frame;
+    const UINT8 *src;
+    UINT32 len, pos, i, stamp;
+    INT32 ret;
+
+    out[0] = 0xFF;
+    out[1] = 0xD8;
+    vjpeg_stamp_put(out + 2, vstream_now_us());
+    pos = 2 + VSTREAM_STAMP_LEN;
+
+    if (t->file)
+    {
+        do
+        {
+            t->file_pos += vjpeg_find(t->file + t->file_pos, t->file_len - t->file_pos);
+            ret = vjpeg_scan(t->file + t->file_pos, t->file_len - t->file_pos);
+            if (ret <= 0)
+            {
+                // end of the file, or junk, go round
+                t->file_pos = (ret < 0) ? (t->file_pos - ret) : 0;
+                continue;
+            }
+
+            src = t->file + t->file_pos + 2;
+            len = ret - 2;
+            t->file_pos += ret;
+            // recorded from video_tx, the old stamp goes
+            if (vjpeg_stamp_get(src - 2, ret, &stamp))
+            {
+                src += VSTREAM_STAMP_LEN;
+                len -= VSTREAM_STAMP_LEN;
+            }
+        }
+        while ((ret <= 0) || (pos + len > TX_FRAME_MAX));
+
+        memcpy(out + pos, src, len);
+        return pos + len;
+    }
+
+    // scan header with one component, then coded bytes that never hold a marker
+    len = t->frame_bytes * 3 / 4 + rand() % (t->frame_bytes / 2 + 1);
+    if (len > TX_FRAME_MAX - pos - 12)
+    {
+        len = TX_FRAME_MAX - pos - 12;
+    }
+    memcpy(out + pos, "\xFF\xDA\x00\x08\x01\x01\x00\x00\x3F\x00", 10);
+    pos += 10;
+    for (i = 0; i < len; i++)
+    {
+        out[pos++] = rand() % 0xFF;
+    }
+    out[pos++] = 0xFF;
+    out[pos++] = 0xD9;
+
+    return pos;
+}
+
+// the air, with the loss asked for
+static void tx_send(TX_ST *t, const UINT8 *pkt, UINT32 len)
+{
+    if (rand() < t->loss * RAND_MAX)
+    {
+        t->pkts_lost++;
+        return;
+    }
+    sendto(t->img_fd, pkt, len, 0, (struct sockaddr *)&t->remote, sizeof(t->remote));
+}
+
+static void tx_link(TX_ST *t, UINT32 len, UINT32 now)
+{
+    if (t->rate == 0)
+    {
+        return;
+    }
+    if ((INT32)(t->link_at - now) < 0)
+    {
+        t->link_at = now;
+    }
+    t->link_at += (UINT32)((double)len * 1000000 / t->rate);
+}
+
+// a data packet went out, as app_demo_udp_pkt_sent does it
+static void tx_pkt_sent(TX_ST *t, const UINT8 *pkt, UINT32 len, UINT32 now)
+{
+    UINT8 *parity;
+    UINT32 plen, j;
+
+    if (t->rtx_on)
+    {
+        vrtx_put(&t->rtx, pkt, len);
+    }
+
+    if ((t->fec.m == 0) || !vfec_enc_input(&t->fec, pkt[0], pkt[3], pkt[1], pkt, len))
+    {
+        return;
+    }
+    for (j = 0; j < t->fec.m; j++)
+    {
+        plen = vfec_enc_parity(&t->fec, j, &parity);
+        tx_send(t, parity, plen);
+        tx_link(t, plen, now);
+        t->parity++;
+    }
+}
+
+// cut into packets with HDR_ST in front, the rest is dropped once the queue is full
+static void tx_udp_frame(TX_ST *t, UINT32 len)
+{
+    UINT32 payload = VFEC_PKT_MAX - t->cfg.hdr_size, cnt, seq, plen;
+    UINT8 *pkt;
+
+    cnt = (len + payload - 1) / payload;
+    for (seq = 1; seq <= cnt; seq++)
+    {
+        if (t->q_wr - t->q_rd >= TX_QUEUE_LEN)
+        {
+            t->frames_cut++;
+            break;
+        }
+
+        plen = (seq == cnt) ? (len - (seq - 1) * payload) : payload;
+        pkt = t->q[t->q_wr % TX_QUEUE_LEN];
+        memset(pkt, 0, t->cfg.hdr_size);
+        pkt[0] = t->id;
+        pkt[1] = (seq == cnt);
+        pkt[2] = (seq == cnt) ? cnt : 0;
+        pkt[3] = seq;
+        memcpy(pkt + t->cfg.hdr_size, t->frame + (seq - 1) * payload, plen);
+        t->q_len[t->q_wr % TX_QUEUE_LEN] = t->cfg.hdr_size + plen;
+        t->q_wr++;
+    }
+}
+
+static void tx_drain(TX_ST *t, UINT32 now)
+{
+    UINT8 *pkt;
+    UINT32 len;
+
+    while ((t->q_rd != t->q_wr) && ((t->rate == 0) || ((INT32)(t->link_at - now) <= 0)))
+    {
+        pkt = t->q[t->q_rd % TX_QUEUE_LEN];
+        len = t->q_len[t->q_rd % TX_QUEUE_LEN];
+        t->q_rd++;
+
+        tx_send(t, pkt, len);
+        tx_link(t, len, now);
+        t->pkts++;
+        t->bytes += len;
+        tx_pkt_sent(t, pkt, len, now);
+    }
+}
+
+static void tx_frame(TX_ST *t)
+{
+    UINT32 len = tx_make_frame(t);
+
+    if (t->udp_on)
+    {
+        tx_udp_frame(t, len);
+        t->id++;
+    }
+    else if (t->cli_fd >= 0)
+    {
+        if (send(t->cli_fd, t->frame, len, MSG_NOSIGNAL) != (int)len)
+        {
+            printf("tcp client gone\n");
+            close(t->cli_fd);
+            t->cli_fd = -1;
+            return;
+        }
+        t->bytes += len;
+    }
+    t->frames++;
+}
+
+static void tx_fec(TX_ST *t, UINT32 k, UINT32 m)
+{
+    if (vfec_enc_config(&t->fec, k, m) == 0)
+    {
+        printf("fec k:%u m:%u\n", k, m);
+    }
+}
+
+// image port: start, stop, fec and loss reports, like app_demo_udp_receiver
+static void tx_img_cmd(TX_ST *t, const UINT8 *data, UINT32 len, struct sockaddr_in *from)
+{
+    if ((len < 2) || (data[0] != t->cfg.cmd_hdr))
+    {
+        return;
+    }
+
+    if (data[1] == t->cfg.cmd_start)
+    {
+        if (len >= 4)
+        {
+            tx_fec(t, data[2], data[3]);
+        }
+        t->remote = *from;
+        t->udp_on = 1;
+        printf("udp start to %s:%d\n", inet_ntoa(from->sin_addr), ntohs(from->sin_port));
+    }
+    else if (data[1] == t->cfg.cmd_stop)
+    {
+        t->udp_on = 0;
+        t->q_rd = t->q_wr;
+        printf("udp stop\n");
+    }
+    else if ((data[1] == VSTREAM_CMD_SET_FEC) && (len >= 4))
+    {
+        tx_fec(t, data[2], data[3]);
+    }
+    else if ((data[1] == VSTREAM_CMD_RX_LOSS) && (len >= 4))
+    {
+        printf("rx loss %.1f%%\n", (data[2] | (data[3] << 8)) / 10.0);
+    }
+}
+
+// command port: CMD_IMG_HEADER, CMD_NACK, frame id, count, pkt_seq...
+static void tx_nack(TX_ST *t, const UINT8 *data, UINT32 len, UINT32 now)
+{
+    UINT32 i, cnt, plen;
+    UINT8 *pkt;
+
+    if ((len < 4) || (data[0] != t->cfg.cmd_hdr) || (data[1] != VSTREAM_CMD_NACK))
+    {
+        return;
+    }
+    if (!t->rtx_on)
+    {
+        if (vrtx_init(&t->rtx, TX_RTX_PKTS, TX_RTX_FRAMES))
+        {
+            return;
+        }
+        t->rtx_on = 1;
+    }
+
+    cnt = data[3];
+    if (cnt > len - 4)
+    {
+        cnt = len - 4;
+    }
+    for (i = 0; i < cnt; i++)
+    {
+        plen = vrtx_find(&t->rtx, data[2], data[4 + i], &pkt);
+        if (plen)
+        {
+            tx_send(t, pkt, plen);
+            tx_link(t, plen, now);
+            t->resent++;
+        }
+    }
+}
+
+static void tx_load(TX_ST *t, const char *name)
+{
+    FILE *f = fopen(name, "rb");
+    long len;
+
+    if ((f == NULL) || fseek(f, 0, SEEK_END) || ((len = ftell(f)) <= 0))
+    {
+        perror(name);
+        exit(1);
+    }
+    rewind(f);
+    t->file = malloc(len);
+    if ((t->file == NULL) || (fread(t->file, 1, len, f) != (size_t)len))
+    {
+        perror(name);
+        exit(1);
+    }
+    fclose(f);
+    t->file_len = len;
+
+    t->file_pos = vjpeg_find(t->file, t->file_len);
+    if (vjpeg_scan(t->file + t->file_pos, t->file_len - t->file_pos) <= 0)
+    {
+        fprintf(stderr, "%s: no jpeg at the start\n", name);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static TX_ST t;
+    UINT8 buf[2048];
+    UINT32 drone = 0, secs = 0, now, start, sec_at, next_frame, wait, last_frames = 0, last_bytes = 0;
+    struct sockaddr_in from;
+    socklen_t from_len;
+    struct timeval tv;
+    fd_set fds;
+    int opt, len, maxfd, one = 1;
+
+    t.frame_bytes = 20 * 1024;
+    t.fps = 20;
+    t.cli_fd = -1;
+    while ((opt = getopt(argc, argv, "di:b:r:k:l:s:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            drone = 1;
+            break;
+        case 'i':
+            tx_load(&t, optarg);
+            break;
+        case 'b':
+            t.frame_bytes = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            t.fps = strtoul(optarg, NULL, 0);
+            break;
+        case 'k':
+            t.rate = strtoul(optarg, NULL, 0) * 1024;
+            break;
+        case 'l':
+            t.loss = atof(optarg) / 100;
+            break;
+        case 's':
+            secs = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d] [-i file.mjpeg] [-b bytes] [-r fps] [-k kB/s] [-l loss%%] [-s seconds]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if ((t.fps == 0) || (t.frame_bytes < 16))
+    {
+        fprintf(stderr, "bad fps or frame size\n");
+        return 1;
+    }
+
+    vstream_cfg(&t.cfg, drone);
+    t.img_fd = tx_udp_socket(t.cfg.img_port);
+    t.cmd_fd = tx_udp_socket(t.cfg.cmd_port);
+
+    t.tcp_fd = socket(AF_INET, SOCK_STREAM, 0);
+    from.sin_family = AF_INET;
+    from.sin_port = htons(t.cfg.tcp_port);
+    from.sin_addr.s_addr = htonl(INADDR_ANY);
+    setsockopt(t.tcp_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if ((t.tcp_fd < 0) || bind(t.tcp_fd, (struct sockaddr *)&from, sizeof(from)) || listen(t.tcp_fd, 1))
+    {
+        perror("tcp");
+        return 1;
+    }
+
+    vfec_gf_init();
+    if (vfec_enc_init(&t.fec))
+    {
+        perror("fec");
+        return 1;
+    }
+    srand(time(NULL));
+    printf("udp %d/%d, tcp %d, %u fps\n", t.cfg.img_port, t.cfg.cmd_port, t.cfg.tcp_port, t.fps);
+
+    start = sec_at = next_frame = vstream_now_us();
+    while (!secs || ((now = vstream_now_us()) - start < secs * 1000000))
+    {
+        now = vstream_now_us();
+        if ((INT32)(now - next_frame) >= 0)
+        {
+            if (t.udp_on || (t.cli_fd >= 0))
+            {
+                tx_frame(&t);
+            }
+            next_frame += 1000000 / t.fps;
+            if ((INT32)(now - next_frame) >= 0)
+            {
+                // fell behind, no burst to catch up
+                next_frame = now + 1000000 / t.fps;
+            }
+        }
+        tx_drain(&t, now);
+
+        if (now - sec_at >= 1000000)
+        {
+            if (t.udp_on || (t.cli_fd >= 0))
+            {
+                printf("%u fps  %u kB/s  cut %u  lost %u  parity %u  resent %u\n",
+                       t.frames - last_frames, (t.bytes - last_bytes) / 1024, t.frames_cut,
+                       t.pkts_lost, t.parity, t.resent);
+            }
+            last_frames = t.frames;
+            last_bytes = t.bytes;
+            sec_at = now;
+        }
+
+        wait = next_frame - now;
+        if ((t.q_rd != t.q_wr) && ((INT32)(t.link_at - now) < (INT32)wait))
+        {
+            wait = ((INT32)(t.link_at - now) > 0) ? (t.link_at - now) : 0;
+        }
+        if (wait > TX_TICK_US)
+        {
+            wait = TX_TICK_US;
+        }
+
+        FD_ZERO(&fds);
+        FD_SET(t.img_fd, &fds);
+        FD_SET(t.cmd_fd, &fds);
+        FD_SET(t.tcp_fd, &fds);
+        maxfd = (t.img_fd > t.cmd_fd) ? t.img_fd : t.cmd_fd;
+        maxfd = (t.tcp_fd > maxfd) ? t.tcp_fd : maxfd;
+        if (t.cli_fd >= 0)
+        {
+            FD_SET(t.cli_fd, &fds);
+            maxfd = (t.cli_fd > maxfd) ? t.cli_fd : maxfd;
+        }
+        tv.tv_sec = 0;
+        tv.tv_usec = wait;
+        if (select(maxfd + 1, &fds, NULL, NULL, &tv) <= 0)
+        {
+            continue;
+        }
+
+        now = vstream_now_us();
+        from_len = sizeof(from);
+        if (FD_ISSET(t.img_fd, &fds)
+                && ((len = recvfrom(t.img_fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &from_len)) > 0))
+        {
+            tx_img_cmd(&t, buf, len, &from);
+        }
+        if (FD_ISSET(t.cmd_fd, &fds) && ((len = recv(t.cmd_fd, buf, sizeof(buf), 0)) > 0))
+        {
+            tx_nack(&t, buf, len, now);
+        }
+        if (FD_ISSET(t.tcp_fd, &fds))
+        {
+            len = accept(t.tcp_fd, NULL, NULL);
+            if (t.cli_fd >= 0)
+            {
+                // APP_DEMO_TCP_LISTEN_MAX is 1
+                close(len);
+            }
+            else if (len >= 0)
+            {
+                t.cli_fd = len;
+                printf("tcp client\n");
+            }
+        }
+        if ((t.cli_fd >= 0) && FD_ISSET(t.cli_fd, &fds) && (recv(t.cli_fd, buf, sizeof(buf), 0) <= 0))
+        {
+            printf("tcp client gone\n");
+            close(t.cli_fd);
+            t.cli_fd = -1;
+        }
+    }
+
+    printf("total: %u frames, %u cut, %u packets, %u lost on purpose, %u parity, %u resent\n",
+           t.frames, t.frames_cut, t.pkts, t.pkts_lost, t.parity, t.resent);
+
+    vfec_enc_deinit(&t.fec);
+    vrtx_deinit(&t.rtx);
+    free(t.file);
+    close(t.img_fd);
+    close(t.cmd_fd);
+    close(t.tcp_fd);
+    if (t.cli_fd >= 0)
+    {
+        close(t.cli_fd);
+    }
+
+    return 0;
+}
+// eof
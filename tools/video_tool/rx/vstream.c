@@ -0,0 +1,138 @@
+#include <string.h>
+#include <time.h>
+
+#include "vstream.h"
+
+#define VJPEG_SOI                   0xD8
+#define VJPEG_EOI                   0xD9
+#define VJPEG_SOS                   0xDA
+#define VJPEG_COM                   0xFE
+
+void vstream_cfg(VSTREAM_CFG_PTR cfg, UINT32 drone)
+{
+    cfg->img_port = drone ? 8080 : 7080;
+    cfg->cmd_port = drone ? 8090 : 7090;
+    cfg->tcp_port = drone ? 8050 : 7050;
+    cfg->cmd_hdr = drone ? 0x42 : 0x20;
+    cfg->cmd_start = drone ? 0x76 : 0x36;
+    cfg->cmd_stop = drone ? 0x77 : 0x37;
+    cfg->hdr_size = drone ? 8 : 4;
+}
+
+UINT32 vstream_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+INT32 vjpeg_scan(const UINT8 *buf, UINT32 len)
+{
+    UINT32 pos = 2, seg, in_scan = 0;
+    UINT8 m;
+
+    if (len < 2)
+    {
+        return 0;
+    }
+    if ((buf[0] != 0xFF) || (buf[1] != VJPEG_SOI))
+    {
+        return -1;
+    }
+
+    while (pos + 1 < len)
+    {
+        m = buf[pos + 1];
+        if (in_scan)
+        {
+            // coded data, FF 00 is a stuffed byte, FF D0..D7 a restart marker
+            if ((buf[pos] != 0xFF) || (m == 0x00) || ((m >= 0xD0) && (m <= 0xD7)))
+            {
+                pos++;
+                continue;
+            }
+            in_scan = 0;
+        }
+
+        if (buf[pos] != 0xFF)
+        {
+            return -(INT32)pos;
+        }
+        if (m == 0xFF)
+        {
+            // fill byte
+            pos++;
+            continue;
+        }
+        if (m == VJPEG_EOI)
+        {
+            return pos + 2;
+        }
+        if (m == VJPEG_SOI)
+        {
+            // next frame began, the rest of this one never came
+            return -(INT32)pos;
+        }
+
+        if (pos + 4 > len)
+        {
+            return 0;
+        }
+        seg = (buf[pos + 2] << 8) | buf[pos + 3];
+        if (seg < 2)
+        {
+            return -(INT32)pos;
+        }
+        pos += 2 + seg;
+        if (m == VJPEG_SOS)
+        {
+            in_scan = 1;
+        }
+    }
+
+    return 0;
+}
+
+UINT32 vjpeg_find(const UINT8 *buf, UINT32 len)
+{
+    UINT32 pos;
+
+    for (pos = 0; pos + 1 < len; pos++)
+    {
+        if ((buf[pos] == 0xFF) && (buf[pos + 1] == VJPEG_SOI))
+        {
+            return pos;
+        }
+    }
+
+    return len;
+}
+
+void vjpeg_stamp_put(UINT8 *seg, UINT32 us)
+{
+    seg[0] = 0xFF;
+    seg[1] = VJPEG_COM;
+    seg[2] = 0;
+    seg[3] = VSTREAM_STAMP_LEN - 2;
+    memcpy(seg + 4, "vtx:", 4);
+    seg[8] = us >> 24;
+    seg[9] = us >> 16;
+    seg[10] = us >> 8;
+    seg[11] = us;
+}
+
+UINT32 vjpeg_stamp_get(const UINT8 *jpeg, UINT32 len, UINT32 *us)
+{
+    const UINT8 *seg = jpeg + 2;
+
+    if ((len < 2 + VSTREAM_STAMP_LEN) || (seg[0] != 0xFF) || (seg[1] != VJPEG_COM)
+            || (seg[2] != 0) || (seg[3] != VSTREAM_STAMP_LEN - 2) || memcmp(seg + 4, "vtx:", 4))
+    {
+        return 0;
+    }
+
+    *us = ((UINT32)seg[8] << 24) | (seg[9] << 16) | (seg[10] << 8) | seg[11];
+    return 1;
+}
+// eof
@@ -0,0 +1,43 @@
+#ifndef __VSTREAM_H__
+#define __VSTREAM_H__
+
+#include "include.h"
+
+/*
+ * What video_rx and video_tx share: ports and commands of app/video_work,
+ * the jpeg scanner that finds frames in the tcp stream, and the send time
+ * video_tx puts into its frames as a jpeg comment.
+ */
+#define VSTREAM_CMD_SET_FEC         0x39
+#define VSTREAM_CMD_NACK            0x3A
+#define VSTREAM_CMD_RX_LOSS         0x3B
+
+// stamp segment right behind SOI: FF FE, length, "vtx:", send time in us
+#define VSTREAM_STAMP_LEN           12
+
+typedef struct vstream_cfg_st
+{
+    UINT16 img_port;            // udp, start, stop, fec and loss reports, the packets come from here
+    UINT16 cmd_port;            // udp, nack
+    UINT16 tcp_port;
+    UINT8 cmd_hdr;
+    UINT8 cmd_start;
+    UINT8 cmd_stop;
+    UINT8 hdr_size;             // HDR_ST
+} VSTREAM_CFG_ST, *VSTREAM_CFG_PTR;
+
+// video_transfer_config.h, with SUPPORT_TIANZHIHENG_DRONE when drone is set
+void vstream_cfg(VSTREAM_CFG_PTR cfg, UINT32 drone);
+UINT32 vstream_now_us(void);
+
+// length of the jpeg at buf, 0 while it is not complete, or -n when it is
+// broken and the first n bytes are to be dropped
+INT32 vjpeg_scan(const UINT8 *buf, UINT32 len);
+// offset of the next SOI, len if there is none
+UINT32 vjpeg_find(const UINT8 *buf, UINT32 len);
+void vjpeg_stamp_put(UINT8 *seg, UINT32 us);
+// 1 and the send time when the jpeg has a stamp
+UINT32 vjpeg_stamp_get(const UINT8 *jpeg, UINT32 len, UINT32 *us);
+
+#endif // __VSTREAM_H__
+// eof